@@ -0,0 +1,43 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <cmath>
+#include <cstdio>
+
+#include "bcg_benchmarks.h"
+#include "bcg_library/geometry/mesh/bcg_meshio.h"
+#include "bcg_library/geometry/mesh/bcg_mesh_factory.h"
+
+namespace bcg {
+
+void benchmark_bcg_file(const benchmark_args &args) {
+    auto side = size_t(std::sqrt(double(args.size * 1000)));
+    halfedge_mesh mesh = mesh_factory().make_grid(side, side);
+    auto normals = mesh.vertices.get_or_add<VectorS<3>, 3>("v_normal", VectorS<3>::UnitZ());
+    auto quality = mesh.faces.get_or_add<bcg_scalar_t, 1>("f_quality", 1);
+    std::cout << "  vertices: " << mesh.num_vertices() << ", faces: " << mesh.num_faces() << "\n";
+
+    Timer timer;
+    meshio off("bcg_benchmark_file.off", meshio_flags());
+    off.write(mesh);
+    benchmark_report("write off", timer, mesh.num_vertices());
+    halfedge_mesh from_off;
+    off.read(from_off);
+    benchmark_report("read off (positions and faces only)", timer, mesh.num_vertices());
+
+    meshio bcg("bcg_benchmark_file.bcg", meshio_flags());
+    bcg.write(mesh);
+    benchmark_report("write bcg (all properties)", timer, mesh.num_vertices());
+    halfedge_mesh from_bcg;
+    bcg.read(from_bcg);
+    benchmark_report("read bcg (all properties)", timer, mesh.num_vertices());
+
+    std::cout << "  equal: " << (from_bcg == mesh) << ", properties: " << from_bcg.vertices.num_properties() << " + "
+              << from_bcg.halfedges.num_properties() << " + " << from_bcg.edges.num_properties() << " + "
+              << from_bcg.faces.num_properties() << "\n";
+    std::remove("bcg_benchmark_file.off");
+    std::remove("bcg_benchmark_file.bcg");
+}
+
+}
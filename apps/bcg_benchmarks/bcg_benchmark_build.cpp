@@ -0,0 +1,51 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <cmath>
+
+#include "bcg_benchmarks.h"
+#include "bcg_library/geometry/mesh/bcg_mesh_factory.h"
+
+namespace bcg {
+
+void benchmark_build_faces(const benchmark_args &args) {
+    auto side = size_t(std::sqrt(double(args.size * 1000)));
+    halfedge_mesh grid = mesh_factory().make_grid(side, side);
+    std::vector<VectorS<3>> points(grid.positions.vector().begin(), grid.positions.vector().end());
+    std::vector<bcg_index_t> indices;
+    indices.reserve(3 * grid.num_faces());
+    for (const auto f : grid.faces) {
+        for (const auto v : grid.get_vertices(f)) {
+            indices.push_back(v.idx);
+        }
+    }
+    std::cout << "  vertices: " << points.size() << ", faces: " << indices.size() / 3 << "\n";
+
+    Timer timer;
+    halfedge_mesh incremental;
+    std::vector<vertex_handle> face(3);
+    for (const auto &point : points) {
+        incremental.add_vertex(point);
+    }
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (size_t k = 0; k < 3; ++k) {
+            face[k] = vertex_handle(indices[i + k]);
+        }
+        incremental.add_face(face);
+    }
+    benchmark_report("add_face", timer, indices.size() / 3);
+
+    halfedge_mesh bulk;
+    bulk.build_from_faces(points, indices);
+    benchmark_report("build_from_faces", timer, indices.size() / 3);
+
+    size_t num_boundary = 0;
+    for (const auto v : bulk.vertices) {
+        num_boundary += bulk.is_boundary(v);
+    }
+    std::cout << "  edges: " << incremental.num_edges() << " / " << bulk.num_edges() << ", boundary vertices: "
+              << num_boundary << "\n";
+}
+
+}
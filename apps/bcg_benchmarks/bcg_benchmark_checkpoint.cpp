@@ -0,0 +1,50 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <cmath>
+#include <cstdio>
+
+#include "bcg_benchmarks.h"
+#include "bcg_library/geometry/bcg_property_io.h"
+#include "bcg_library/geometry/mesh/bcg_mesh_factory.h"
+
+namespace bcg {
+
+void benchmark_checkpoint(const benchmark_args &args) {
+    auto side = size_t(std::sqrt(double(args.size * 1000)));
+    halfedge_mesh mesh = mesh_factory().make_grid(side, side);
+    std::vector<const property_container *> containers = {&mesh.vertices, &mesh.halfedges, &mesh.edges, &mesh.faces,
+                                                          &mesh.object_properties};
+    property_checkpoint checkpoint("bcg_benchmark_checkpoint.bcg");
+
+    Timer timer;
+    checkpoint.save(containers);
+    benchmark_report("full save", timer, mesh.num_vertices());
+    std::cout << "  " << checkpoint.last_save_bytes / double(1 << 20) << " MB written\n";
+
+    // one processing step, which adds a vertex property
+    auto normals = mesh.vertices.get_or_add<VectorS<3>, 3>("v_normal");
+    for (const auto v : mesh.vertices) {
+        normals[v] = VectorS<3>::UnitZ();
+    }
+    normals.set_dirty();
+    timer = Timer();
+    checkpoint.save(containers);
+    benchmark_report("checkpoint after computing v_normal", timer, mesh.num_vertices());
+    std::cout << "  " << checkpoint.last_save_bytes / double(1 << 20) << " MB written\n";
+
+    timer = Timer();
+    checkpoint.save(containers);
+    benchmark_report("checkpoint without changes", timer, mesh.num_vertices());
+    std::cout << "  " << checkpoint.last_save_bytes / double(1 << 20) << " MB written\n";
+
+    timer = Timer();
+    halfedge_mesh result;
+    read_property_containers(checkpoint.filename, {&result.vertices, &result.halfedges, &result.edges, &result.faces,
+                                                   &result.object_properties});
+    benchmark_report("read latest versions", timer, result.vertices.size());
+    std::remove(checkpoint.filename.c_str());
+}
+
+}
@@ -0,0 +1,92 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <random>
+
+#include "bcg_benchmarks.h"
+#include "bcg_library/geometry/mesh/bcg_mesh.h"
+#include "bcg_library/geometry/distance_query/bcg_distance_triangle_point.h"
+
+namespace bcg {
+
+void benchmark_closest(const benchmark_args &args) {
+    size_t n = args.size * 1000;
+    size_t num_queries = 1000;
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<bcg_scalar_t> dist(0, 1);
+    auto random_point = [&]() { return VectorS<3>(dist(gen), dist(gen), dist(gen)); };
+
+    halfedge_mesh mesh;
+    for (size_t i = 0; i < n / 3; ++i) {
+        VectorS<3> center = random_point();
+        mesh.add_triangle(mesh.add_vertex(center + random_point() * 0.01),
+                          mesh.add_vertex(center + random_point() * 0.01),
+                          mesh.add_vertex(center + random_point() * 0.01));
+    }
+    std::vector<VectorS<3>> queries(num_queries);
+    for (auto &query : queries) {
+        query = random_point();
+    }
+
+    Timer timer;
+    size_t checks = 0;
+    for (const auto &query : queries) {
+        vertex_handle closest;
+        auto min_dist = scalar_max;
+        for (const auto v : mesh.vertices) {
+            auto d = (mesh.positions[v] - query).squaredNorm();
+            if (d < min_dist) {
+                min_dist = d;
+                closest = v;
+            }
+        }
+        checks += closest.idx;
+    }
+    benchmark_report("closest vertex, linear scan", timer, num_queries);
+    checks -= mesh.find_closest_vertex(queries[0]).idx;
+    benchmark_report("closest vertex, first query (builds index)", timer, 1);
+    for (size_t i = 1; i < num_queries; ++i) {
+        checks -= mesh.find_closest_vertex(queries[i]).idx;
+    }
+    benchmark_report("closest vertex, indexed", timer, num_queries - 1);
+    auto vertices = mesh.find_closest_vertex_batch(queries);
+    benchmark_report("closest vertex, batch", timer, num_queries);
+
+    distance_point3_triangle3 distance;
+    for (size_t i = 0; i < num_queries / 10; ++i) {
+        face_handle closest;
+        auto min_dist = scalar_max;
+        for (const auto f : mesh.faces) {
+            std::vector<VectorS<3>> corners;
+            for (const auto v : mesh.get_vertices(f)) {
+                corners.push_back(mesh.positions[v]);
+            }
+            auto d = distance(queries[i], triangle3(corners[0], corners[1], corners[2])).sqr_distance;
+            if (d < min_dist) {
+                min_dist = d;
+                closest = f;
+            }
+        }
+        checks += closest.idx;
+    }
+    benchmark_report("closest face, linear scan (1/10 of the queries)", timer, num_queries / 10);
+    for (size_t i = 0; i < num_queries / 10; ++i) {
+        checks -= mesh.find_closest_face(queries[i]).idx;
+    }
+    benchmark_report("closest face, indexed (includes build)", timer, num_queries / 10);
+    auto faces = mesh.find_closest_face_batch(queries);
+    benchmark_report("closest face, batch", timer, num_queries);
+
+    for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+        mesh.positions[i] += random_point() * 1e-3;
+    }
+    mesh.positions.set_dirty();
+    timer = Timer();
+    mesh.find_closest_face(queries[0]);
+    mesh.find_closest_vertex(queries[0]);
+    benchmark_report("first queries after moving all vertices (refit)", timer, 2);
+    std::cout << "  check: " << checks << " " << vertices.size() + faces.size() << "\n";
+}
+
+}
@@ -0,0 +1,67 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <cmath>
+#include <cstdio>
+
+#include "bcg_benchmarks.h"
+#include "bcg_library/utils/bcg_mapped_file.h"
+#include "bcg_library/geometry/mesh/bcg_meshio.h"
+#include "bcg_library/geometry/mesh/bcg_mesh_factory.h"
+#include "bcg_library/geometry/point_cloud/bcg_point_cloudio.h"
+
+namespace bcg {
+
+template<typename Object, typename IO, typename Flags>
+static void benchmark_compression_of(const std::string &name, const Object &object, const Flags &flags, size_t items) {
+    std::string raw_file = "bcg_benchmark_raw.bcg", compressed_file = "bcg_benchmark_compressed.bcg";
+    Timer timer;
+    IO(raw_file, Flags()).write(const_cast<Object &>(object));
+    benchmark_report(name + ": write raw", timer, items);
+    IO(compressed_file, flags).write(const_cast<Object &>(object));
+    benchmark_report(name + ": write compressed", timer, items);
+
+    Object raw, compressed;
+    IO(raw_file, Flags()).read(raw);
+    double raw_ms = timer.measure<MICROSECONDS>() / 1000.0;
+    benchmark_report(name + ": read raw", timer, items);
+    IO(compressed_file, flags).read(compressed);
+    double compressed_ms = timer.measure<MICROSECONDS>() / 1000.0;
+    benchmark_report(name + ": read compressed", timer, items);
+
+    size_t raw_size = mapped_file(raw_file).size(), compressed_size = mapped_file(compressed_file).size();
+    std::cout << "  " << name << ": " << raw_size / double(1 << 20) << " MB raw, " << compressed_size / double(1 << 20)
+              << " MB compressed, ratio " << double(raw_size) / compressed_size << ", decoded "
+              << raw_size / (compressed_ms * 1000.0) << " MB/s (raw copy " << raw_size / (raw_ms * 1000.0)
+              << " MB/s)\n";
+    std::remove(raw_file.c_str());
+    std::remove(compressed_file.c_str());
+}
+
+void benchmark_compression(const benchmark_args &args) {
+    size_t n = args.size * 1000;
+    point_cloud pc;
+    pc.vertices.resize(n);
+    auto labels = pc.vertices.get_or_add<int, 1>("v_label");
+    for (size_t i = 0; i < n; ++i) {
+        pc.positions[i] = VectorS<3>::Random().normalized();
+        labels[i] = int(i % 7);
+    }
+    point_cloudio_flags pc_flags;
+    pc_flags.use_compression = true;
+    pc_flags.position_bits = 16;
+    benchmark_compression_of<point_cloud, point_cloudio>("point cloud, 16 bits", pc, pc_flags, n);
+
+    auto side = size_t(std::sqrt(double(n)));
+    halfedge_mesh mesh = mesh_factory().make_grid(side, side);
+    for (const auto v : mesh.vertices) {
+        mesh.positions[v][2] = 0.01 * VectorS<1>::Random()[0];
+    }
+    meshio_flags mesh_flags;
+    mesh_flags.use_compression = true;
+    mesh_flags.position_bits = 20;
+    benchmark_compression_of<halfedge_mesh, meshio>("grid mesh, 20 bits", mesh, mesh_flags, mesh.num_vertices());
+}
+
+}
@@ -0,0 +1,70 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <vector>
+#include <random>
+
+#include "bcg_benchmarks.h"
+#include "bcg_library/geometry/mesh/bcg_mesh_factory.h"
+
+namespace bcg {
+
+namespace {
+// replica of the former per-element test against std::vector<bool>
+size_t sum_legacy(const std::vector<bool> &deleted) {
+    size_t sum = 0;
+    size_t i = 0;
+    while (i < deleted.size() && deleted[i]) ++i;
+    while (i < deleted.size()) {
+        sum += i;
+        ++i;
+        while (i < deleted.size() && deleted[i]) ++i;
+    }
+    return sum;
+}
+
+size_t sum_faces(const halfedge_mesh &mesh) {
+    size_t sum = 0;
+    for (const auto f : mesh.faces) {
+        sum += f.idx;
+    }
+    return sum;
+}
+}
+
+void benchmark_deletion(const benchmark_args &args) {
+    mesh_factory factory;
+    auto mesh = factory.make_grid(args.size, args.size);
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+
+    for (const double fraction : {0.0, 0.1, 0.5}) {
+        mesh.faces_deleted.reset(false);
+        mesh.faces_deleted.vector().update_maybe_any();
+        for (size_t i = 0; i < mesh.faces.size(); ++i) {
+            if (dist(gen) < fraction) {
+                mesh.faces_deleted[i] = true;
+            }
+        }
+        std::vector<bool> legacy(mesh.faces_deleted.begin(), mesh.faces_deleted.end());
+        std::string label = std::to_string(int(fraction * 100)) + "% deleted";
+
+        Timer timer;
+        size_t check_legacy = 0;
+        for (int r = 0; r < 10; ++r) {
+            check_legacy += sum_legacy(legacy);
+        }
+        benchmark_report("face iteration vector<bool> " + label, timer, 10 * mesh.faces.size());
+        size_t check = 0;
+        for (int r = 0; r < 10; ++r) {
+            check += sum_faces(mesh);
+        }
+        benchmark_report("face iteration word mask " + label, timer, 10 * mesh.faces.size());
+        if (check != check_legacy) {
+            std::cout << "  iteration mismatch: " << check << " != " << check_legacy << "\n";
+        }
+    }
+}
+
+}
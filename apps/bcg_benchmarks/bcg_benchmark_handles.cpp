@@ -0,0 +1,98 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <vector>
+
+#include "bcg_benchmarks.h"
+#include "bcg_library/geometry/mesh/bcg_mesh_factory.h"
+
+namespace bcg {
+
+namespace {
+// replica of the former handle layout (vtable + size_t) to compare against
+struct legacy_handle {
+    size_t idx;
+
+    legacy_handle(size_t idx = BCG_INVALID_ID) : idx(idx) {}
+
+    virtual ~legacy_handle() = default;
+};
+
+struct legacy_vertex_connectivity {
+    legacy_handle h;
+};
+
+struct legacy_halfedge_connectivity {
+    legacy_handle v;
+    legacy_handle nh;
+    legacy_handle ph;
+    legacy_handle f;
+};
+
+size_t sum_valences(const halfedge_mesh &mesh) {
+    size_t sum = 0;
+    for (const auto v : mesh.vertices) {
+        for (const auto h : mesh.halfedge_graph::get_halfedges(v)) {
+            sum += mesh.get_to_vertex(h).idx;
+        }
+    }
+    return sum;
+}
+
+template<typename HalfedgeVector, typename VertexVector>
+size_t sum_valences(const HalfedgeVector &hconn, const VertexVector &vconn) {
+    size_t sum = 0;
+    for (const auto &vh : vconn) {
+        size_t start = vh.h.idx;
+        if (start >= hconn.size()) continue;
+        size_t h = start;
+        do {
+            sum += hconn[h].v.idx;
+            // rotate_ccw: opposite(prev(h))
+            size_t p = hconn[h].ph.idx;
+            h = (p & 1) ? p - 1 : p + 1;
+        } while (h != start);
+    }
+    return sum;
+}
+}
+
+void benchmark_handles(const benchmark_args &args) {
+    mesh_factory factory;
+    Timer timer;
+    auto mesh = factory.make_grid(args.size, args.size);
+    benchmark_report("build grid mesh", timer, mesh.num_faces());
+
+    std::cout << "  sizeof(halfedge_connectivity): " << sizeof(halfedge_graph::halfedge_connectivity)
+              << " bytes (legacy " << sizeof(legacy_halfedge_connectivity) << " bytes)\n";
+    std::cout << "  halfedge connectivity memory: "
+              << mesh.halfedges.size() * sizeof(halfedge_graph::halfedge_connectivity) / (1024.0 * 1024.0)
+              << " MiB (legacy "
+              << mesh.halfedges.size() * sizeof(legacy_halfedge_connectivity) / (1024.0 * 1024.0) << " MiB)\n";
+
+    std::vector<legacy_halfedge_connectivity> legacy_hconn(mesh.halfedges.size());
+    std::vector<legacy_vertex_connectivity> legacy_vconn(mesh.vertices.size());
+    for (const auto h : mesh.halfedges) {
+        legacy_hconn[h].v = legacy_handle(mesh.hconn[h].v.idx);
+        legacy_hconn[h].nh = legacy_handle(mesh.hconn[h].nh.idx);
+        legacy_hconn[h].ph = legacy_handle(mesh.hconn[h].ph.idx);
+        legacy_hconn[h].f = legacy_handle(mesh.hconn[h].f.idx);
+    }
+    for (const auto v : mesh.vertices) {
+        legacy_vconn[v].h = legacy_handle(mesh.vconn[v].h.is_valid() ? mesh.vconn[v].h.idx : BCG_INVALID_ID);
+    }
+
+    timer = Timer();
+    size_t check_legacy = sum_valences(legacy_hconn, legacy_vconn);
+    benchmark_report("one-ring traversal legacy layout", timer, mesh.halfedges.size());
+    size_t check = sum_valences(mesh.hconn.vector(), mesh.vconn.vector());
+    benchmark_report("one-ring traversal packed layout", timer, mesh.halfedges.size());
+    size_t check_circulator = sum_valences(mesh);
+    benchmark_report("one-ring traversal circulators", timer, mesh.halfedges.size());
+    if (check != check_legacy || check != check_circulator) {
+        std::cout << "  traversal mismatch: " << check << " != " << check_legacy << "\n";
+    }
+}
+
+}
@@ -0,0 +1,63 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <random>
+
+#include "bcg_benchmarks.h"
+#include "bcg_library/geometry/point_cloud/bcg_point_cloud.h"
+#include "bcg_library/geometry/kdtree/bcg_kdtree.h"
+
+namespace bcg {
+
+void benchmark_kdtree(const benchmark_args &args) {
+    size_t n = args.size * 1000;
+    point_cloud pc;
+    pc.vertices.reserve(n);
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<bcg_scalar_t> dist(0, 1);
+    for (size_t i = 0; i < n; ++i) {
+        pc.add_vertex(VectorS<3>(dist(gen), dist(gen), dist(gen)));
+    }
+
+    using dataset_t = kdtree_property<bcg_scalar_t>::DatasetAdaptor;
+    dataset_t dataset(pc.positions);
+    Timer timer;
+    using nanoflann_t = nanoflann::KDTreeSingleIndexAdaptor<nanoflann::L2_Adaptor<bcg_scalar_t, dataset_t>, dataset_t, 3, bcg_index_t>;
+    nanoflann_t reference(3, dataset, nanoflann::KDTreeSingleIndexAdaptorParams(10));
+    reference.buildIndex();
+    benchmark_report("build nanoflann index", timer, n);
+
+    kdtree_property<bcg_scalar_t> kdtree(pc.positions);
+    benchmark_report("build kdtree_index", timer, n);
+
+    // a smoothing step: every point moves a little
+    std::normal_distribution<bcg_scalar_t> noise(0, 1e-4);
+    for (size_t i = 0; i < n; ++i) {
+        pc.positions[i] += VectorS<3>(noise(gen), noise(gen), noise(gen));
+    }
+    timer = Timer();
+    kdtree.update();
+    benchmark_report("update after small moves (refit)", timer, n);
+    kdtree.build(pc.positions);
+    benchmark_report("rebuild after small moves", timer, n);
+
+    size_t num_added = n / 100;
+    for (size_t i = 0; i < num_added; ++i) {
+        pc.add_vertex(VectorS<3>(dist(gen), dist(gen), dist(gen)));
+    }
+    timer = Timer();
+    kdtree.update();
+    benchmark_report("update after appending 1% (insert)", timer, num_added);
+
+    size_t checks = 0;
+    for (size_t i = 0; i < 1000; ++i) {
+        VectorS<3> query(dist(gen), dist(gen), dist(gen));
+        auto result = kdtree.query_knn(query, 8);
+        checks += result.indices[0];
+    }
+    benchmark_report("1000 knn queries after updates", timer, 1000);
+    std::cout << "  check: " << checks << "\n";
+}
+
+}
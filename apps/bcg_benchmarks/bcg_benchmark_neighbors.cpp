@@ -0,0 +1,80 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <random>
+
+#include "bcg_benchmarks.h"
+#include "bcg_library/geometry/point_cloud/bcg_point_cloud.h"
+#include "bcg_library/geometry/kdtree/bcg_neighbors_cache.h"
+#include "tbb/tbb.h"
+
+namespace bcg {
+
+void benchmark_neighbors(const benchmark_args &args) {
+    size_t n = args.size * 1000;
+    int num_closest = 16;
+    bcg_scalar_t radius = 1e-4;
+
+    point_cloud pc;
+    pc.vertices.reserve(n);
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<bcg_scalar_t> dist(0, 1);
+    for (size_t i = 0; i < n; ++i) {
+        pc.add_vertex(VectorS<3>(dist(gen), dist(gen), dist(gen)));
+    }
+
+    Timer timer;
+    kdtree_property<bcg_scalar_t> kdtree(pc.positions);
+    benchmark_report("build kdtree", timer, n);
+
+    // per point queries as the vertex kernels did before
+    std::vector<size_t> counts(n);
+    tbb::parallel_for(
+            tbb::blocked_range<uint32_t>(0u, (uint32_t) n, 1024),
+            [&](const tbb::blocked_range<uint32_t> &range) {
+                for (uint32_t i = range.begin(); i != range.end(); ++i) {
+                    counts[i] = kdtree.query_knn(pc.positions[i], num_closest).indices.size();
+                }
+            }
+    );
+    benchmark_report("knn per point queries", timer, n);
+
+    neighbors_batch batch;
+    kdtree.query_knn_batch(pc.positions, num_closest, batch);
+    benchmark_report("knn batch query", timer, n);
+    kdtree.query_knn_batch(pc.positions, num_closest, batch);
+    benchmark_report("knn batch query, reused buffer", timer, n);
+
+    tbb::parallel_for(
+            tbb::blocked_range<uint32_t>(0u, (uint32_t) n, 1024),
+            [&](const tbb::blocked_range<uint32_t> &range) {
+                for (uint32_t i = range.begin(); i != range.end(); ++i) {
+                    counts[i] = kdtree.query_radius(pc.positions[i], radius).indices.size();
+                }
+            }
+    );
+    benchmark_report("radius per point queries", timer, n);
+
+    kdtree.query_radius_batch(pc.positions, radius, batch);
+    benchmark_report("radius batch query", timer, n);
+    kdtree.query_radius_batch(pc.positions, radius, batch);
+    benchmark_report("radius batch query, reused buffer", timer, n);
+
+    // a pipeline of operators on unchanged positions queries once
+    vertex_neighbors_knn(&pc.vertices, kdtree, num_closest);
+    benchmark_report("knn neighbors cache, first operator", timer, n);
+    for (int i = 0; i < 4; ++i) {
+        vertex_neighbors_knn(&pc.vertices, kdtree, num_closest);
+    }
+    benchmark_report("knn neighbors cache, four more operators", timer, n);
+
+    size_t total = 0;
+    for (const auto count : counts) {
+        total += count;
+    }
+    std::cout << "  average radius neighbors: " << bcg_scalar_t(batch.indices.size()) / n;
+    std::cout << (total == batch.indices.size() ? "" : " (mismatch)") << "\n";
+}
+
+}
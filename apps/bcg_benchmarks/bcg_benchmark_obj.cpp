@@ -0,0 +1,37 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <cmath>
+#include <cstdio>
+
+#include "bcg_benchmarks.h"
+#include "bcg_library/utils/bcg_mapped_file.h"
+#include "bcg_library/geometry/mesh/bcg_meshio.h"
+#include "bcg_library/geometry/mesh/bcg_mesh_factory.h"
+
+namespace bcg {
+
+void benchmark_obj(const benchmark_args &args) {
+    auto side = size_t(std::sqrt(double(args.size * 1000)));
+    halfedge_mesh mesh = mesh_factory().make_grid(side, side);
+    for (const auto v : mesh.vertices) {
+        mesh.positions[v][2] = 0.01 * VectorS<1>::Random()[0];
+    }
+
+    Timer timer;
+    meshio obj("bcg_benchmark_file.obj", meshio_flags());
+    obj.write(mesh);
+    benchmark_report("write obj", timer, mesh.num_vertices());
+    std::cout << "  " << mapped_file("bcg_benchmark_file.obj").size() / double(1 << 20) << " MB, vertices: "
+              << mesh.num_vertices() << ", faces: " << mesh.num_faces() << "\n";
+
+    timer = Timer();
+    halfedge_mesh result;
+    obj.read(result);
+    benchmark_report("read obj", timer, result.num_vertices());
+    std::cout << "  vertices: " << result.num_vertices() << ", faces: " << result.num_faces() << "\n";
+    std::remove("bcg_benchmark_file.obj");
+}
+
+}
@@ -0,0 +1,56 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <random>
+
+#include "bcg_benchmarks.h"
+#include "bcg_library/geometry/point_cloud/bcg_point_cloud.h"
+#include "bcg_library/geometry/octree/bcg_octree.h"
+#include "bcg_library/geometry/kdtree/bcg_kdtree.h"
+
+namespace bcg {
+
+void benchmark_octree(const benchmark_args &args) {
+    size_t n = args.size * 1000;
+    point_cloud pc;
+    pc.vertices.reserve(n);
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<bcg_scalar_t> dist(0, 1);
+    for (size_t i = 0; i < n; ++i) {
+        pc.add_vertex(VectorS<3>(dist(gen), dist(gen), dist(gen)));
+    }
+
+    Timer timer;
+    octree index(pc.positions, 16);
+    benchmark_report("build octree", timer, n);
+    std::cout << "  nodes: " << index.storage.size() << "\n";
+    kdtree_property<bcg_scalar_t> kdtree(pc.positions, 16);
+    benchmark_report("build kdtree (reference)", timer, n);
+
+    size_t num_queries = std::min<size_t>(n, 100000);
+    size_t checks = 0;
+    tbb::enumerable_thread_specific<size_t> sums(0);
+    tbb::parallel_for(size_t(0), num_queries, [&](size_t i) {
+        sums.local() += index.query_knn(pc.positions[i], 8).indices.back();
+    });
+    benchmark_report("octree knn (k = 8), parallel", timer, num_queries);
+    checks += sums.combine(std::plus<size_t>());
+    sums.clear();
+    tbb::parallel_for(size_t(0), num_queries, [&](size_t i) {
+        sums.local() += kdtree.query_knn(pc.positions[i], 8).indices.back();
+    });
+    benchmark_report("kdtree knn (k = 8), parallel", timer, num_queries);
+    checks -= sums.combine(std::plus<size_t>());
+
+    bcg_scalar_t radius = std::cbrt(bcg_scalar_t(16) * 3 / (4 * pi * n));
+    sums.clear();
+    tbb::parallel_for(size_t(0), num_queries, [&](size_t i) {
+        sums.local() += index.query_radius(pc.positions[i], radius).indices.size();
+    });
+    benchmark_report("octree radius (~16 points), parallel", timer, num_queries);
+    std::cout << "  found: " << sums.combine(std::plus<size_t>()) / num_queries << " per query, check: " << checks
+              << "\n";
+}
+
+}
@@ -0,0 +1,74 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <random>
+#include <fstream>
+#include <cstdio>
+
+#include "bcg_benchmarks.h"
+#include "bcg_library/geometry/point_cloud/bcg_point_cloudio.h"
+#include "bcg_library/utils/bcg_file.h"
+#include "bcg_library/utils/bcg_string_utils.h"
+
+namespace bcg {
+
+void benchmark_parse(const benchmark_args &args) {
+    std::string filename = args.filename;
+    size_t n = args.size * 1000;
+    if (filename.empty()) {
+        filename = "bcg_benchmark_parse.xyz";
+        std::ofstream out(filename);
+        std::mt19937 gen(0);
+        std::uniform_real_distribution<double> dist(-100, 100);
+        out.precision(9);
+        for (size_t i = 0; i < n; ++i) {
+            out << dist(gen) << " " << dist(gen) << " " << dist(gen) << "\n";
+        }
+    }
+    size_t bytes = 0;
+    {
+        std::ifstream in(filename, std::ios::binary | std::ios::ate);
+        bytes = size_t(in.tellg());
+    }
+    std::cout << "  file: " << filename << ", " << bytes / 1000000.0 << " MB\n";
+    auto report = [&](const std::string &name, Timer &timer) {
+        auto micros = timer.measure<MICROSECONDS>();
+        std::cout << "  " << name << ": " << micros / 1000.0 << " ms (" << bytes / (micros / 1000000.0) / 1e9
+                  << " GB/s)\n";
+        timer = Timer();
+    };
+
+    // the previous reader: whole file into a string, a callback per number, add_vertex per point
+    Timer timer;
+    point_cloud reference;
+    {
+        std::string txt;
+        file_stream(filename).load_text(txt);
+        vertex_handle v;
+        parse_numbers<bcg_scalar_t>(txt, [](const char *, size_t) {}, [&](bcg_scalar_t x, size_t, size_t column) {
+            if (column == 0) {
+                v = reference.add_vertex(zero3s);
+            }
+            if (column < 3) {
+                reference.positions[v][column] = x;
+            }
+        });
+    }
+    report("load_text + parse_numbers + add_vertex", timer);
+
+    point_cloud pc;
+    point_cloudio(filename, point_cloudio_flags()).read(pc);
+    report("point_cloudio (mapped, parallel chunks)", timer);
+
+    size_t mismatches = reference.vertices.size() != pc.vertices.size();
+    for (size_t i = 0; !mismatches && i < pc.vertices.size(); ++i) {
+        mismatches += reference.positions[i] != pc.positions[i];
+    }
+    std::cout << "  points: " << pc.vertices.size() << ", mismatches: " << mismatches << "\n";
+    if (args.filename.empty()) {
+        std::remove(filename.c_str());
+    }
+}
+
+}
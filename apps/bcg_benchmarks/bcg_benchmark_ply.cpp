@@ -0,0 +1,40 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <cstdio>
+
+#include "bcg_benchmarks.h"
+#include "bcg_library/utils/bcg_mapped_file.h"
+#include "bcg_library/geometry/point_cloud/bcg_point_cloudio.h"
+
+namespace bcg {
+
+void benchmark_ply(const benchmark_args &args) {
+    size_t n = args.size * 1000;
+    point_cloud pc;
+    pc.vertices.resize(n);
+    auto normals = pc.vertices.get_or_add<VectorS<3>, 3>("v_normal", VectorS<3>::UnitZ());
+    auto colors = pc.vertices.get_or_add<VectorS<3>, 3>("v_color", VectorS<3>(0.5, 0.5, 0.5));
+    auto quality = pc.vertices.get_or_add<bcg_scalar_t, 1>("v_quality", 1);
+    for (size_t i = 0; i < n; ++i) {
+        pc.positions[i] = VectorS<3>::Random();
+    }
+    std::cout << "  points: " << n << ", properties: " << pc.vertices.num_properties() << "\n";
+
+    point_cloudio io("bcg_benchmark_file.ply", point_cloudio_flags());
+    Timer timer;
+    io.write(pc);
+    benchmark_report("write binary ply", timer, n);
+    point_cloud result;
+    io.read(result);
+    benchmark_report("read binary ply", timer, n);
+
+    auto result_normals = result.vertices.get<VectorS<3>, 3>("v_normal");
+    std::cout << "  file size: " << mapped_file("bcg_benchmark_file.ply").size() / (1 << 20) << " MB, equal positions: "
+              << (result.positions.vector() == pc.positions.vector()) << ", equal normals: "
+              << (result_normals && result_normals.vector() == normals.vector()) << "\n";
+    std::remove("bcg_benchmark_file.ply");
+}
+
+}
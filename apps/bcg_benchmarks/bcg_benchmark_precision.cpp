@@ -0,0 +1,52 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include "bcg_benchmarks.h"
+#include "bcg_library/geometry/point_cloud/bcg_point_cloud.h"
+
+namespace bcg {
+
+void benchmark_precision(const benchmark_args &args) {
+    size_t n = args.size * 1000;
+    std::cout << "  bcg_scalar_t: " << (sizeof(bcg_scalar_t) == sizeof(float) ? "float" : "double") << ", "
+              << 2 * sizeof(VectorS<3>) << " bytes per point for positions and normals\n";
+
+    Timer timer;
+    point_cloud pc;
+    pc.vertices.reserve(n);
+    auto normals = pc.vertices.get_or_add<VectorS<3>, 3>("v_normal");
+    for (size_t i = 0; i < n; ++i) {
+        auto v = pc.add_vertex(VectorS<3>(i % 1000, (i / 1000) % 1000, i / 1000000));
+        normals[v] = VectorS<3>(1, i % 7, i % 3);
+    }
+    benchmark_report("build point cloud", timer, n);
+
+    VectorS<3> center = zero3s;
+    for (const auto &p : pc.positions.vector()) {
+        center += p;
+    }
+    center /= bcg_scalar_t(n);
+    benchmark_report("centroid", timer, n);
+
+    VectorS<3> min = pc.positions[0], max = pc.positions[0];
+    for (const auto &p : pc.positions.vector()) {
+        min = min.cwiseMin(p);
+        max = max.cwiseMax(p);
+    }
+    benchmark_report("bounding box", timer, n);
+
+    for (auto &normal : normals.vector()) {
+        normal.normalize();
+    }
+    benchmark_report("normalize normals", timer, n);
+
+    bcg_scalar_t sum = 0;
+    for (const auto v : pc.vertices) {
+        sum += (pc.positions[v] - center).dot(normals[v]);
+    }
+    benchmark_report("signed distances to centroid planes", timer, n);
+    std::cout << "  check: " << (max - min).norm() + sum << "\n";
+}
+
+}
@@ -0,0 +1,48 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include "bcg_benchmarks.h"
+#include "bcg_library/geometry/mesh/bcg_mesh_factory.h"
+
+namespace bcg {
+
+void benchmark_properties(const benchmark_args &args) {
+    mesh_factory factory;
+    auto mesh = factory.make_grid(args.size, args.size);
+    auto curvature = mesh.vertices.get_or_add<bcg_scalar_t, 1>("v_curvature", 1.0);
+    size_t lookups = mesh.vertices.size();
+
+    Timer timer;
+    bcg_scalar_t sum = 0;
+    for (size_t i = 0; i < lookups; ++i) {
+        sum += mesh.vertices.get<bcg_scalar_t, 1>("v_curvature")[i];
+    }
+    benchmark_report("lookup by name", timer, lookups);
+
+    auto key = mesh.vertices.key<bcg_scalar_t, 1>("v_curvature");
+    for (size_t i = 0; i < lookups; ++i) {
+        sum += mesh.vertices.get(key)[i];
+    }
+    benchmark_report("lookup by key", timer, lookups);
+
+    for (size_t i = 0; i < lookups; ++i) {
+        sum += curvature[i];
+    }
+    benchmark_report("cached property", timer, lookups);
+
+    size_t count = 0;
+    for (size_t i = 0; i < 1000; ++i) {
+        for (const auto f : mesh.faces) {
+            count += f.idx & 1;
+            break;
+        }
+    }
+    benchmark_report("iterator construction", timer, 1000);
+
+    if (sum != 3 * lookups || count != 0) {
+        std::cout << "  lookup mismatch: " << sum << "\n";
+    }
+}
+
+}
@@ -0,0 +1,59 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <cmath>
+
+#include "bcg_benchmarks.h"
+#include "bcg_library/geometry/mesh/bcg_meshio.h"
+#include "bcg_library/geometry/mesh/bcg_mesh_factory.h"
+#include "bcg_library/geometry/mesh/bcg_mesh_simplification.h"
+#include "bcg_library/geometry/bvh/bcg_triangle_bvh.h"
+
+namespace bcg {
+
+// max and mean distance of the original points to the simplified surface
+static void report_error(const halfedge_mesh &mesh, const std::vector<VectorS<3>> &points) {
+    auto nearest = triangle_bvh(mesh).nearest_batch(points);
+    bcg_scalar_t max_error = 0, sum_error = 0;
+    for (const auto &nn : nearest) {
+        max_error = std::max(max_error, nn.result.distance);
+        sum_error += nn.result.distance;
+    }
+    std::cout << "  vertices: " << mesh.num_vertices() << ", faces: " << mesh.num_faces() << ", max error: "
+              << max_error << ", mean error: " << sum_error / points.size() << "\n";
+}
+
+void benchmark_simplification(const benchmark_args &args) {
+    halfedge_mesh original;
+    if (!args.filename.empty()) {
+        meshio io(args.filename, meshio_flags());
+        io.read(original);
+    } else {
+        auto side = size_t(std::sqrt(double(args.size * 1000)));
+        original = mesh_factory().make_grid(side, side);
+        for (const auto v : original.vertices) {
+            auto &p = original.positions[v];
+            p[2] = 0.1 * std::sin(8 * p[0]) * std::cos(8 * p[1]) + 0.001 * VectorS<1>::Random()[0];
+        }
+    }
+    std::vector<VectorS<3>> points(original.positions.vector().begin(), original.positions.vector().end());
+    auto n_vertices = (unsigned int) (original.num_vertices() / 10);
+    std::cout << "  vertices: " << original.num_vertices() << " -> " << n_vertices << "\n";
+
+    halfedge_mesh serial;
+    serial.assign(original);
+    Timer timer;
+    mesh_simplification(serial, n_vertices, 5, 0, 10, 0, 0);
+    benchmark_report("serial", timer, original.num_vertices() - serial.num_vertices());
+    report_error(serial, points);
+
+    halfedge_mesh parallel;
+    parallel.assign(original);
+    timer = Timer();
+    mesh_simplification_parallel(parallel, n_vertices, 5, 0, 10, 0, 0);
+    benchmark_report("parallel", timer, original.num_vertices() - parallel.num_vertices());
+    report_error(parallel, points);
+}
+
+}
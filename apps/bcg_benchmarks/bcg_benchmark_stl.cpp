@@ -0,0 +1,78 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <random>
+
+#include "bcg_benchmarks.h"
+#include "bcg_library/geometry/mesh/bcg_meshio.h"
+#include "bcg_library/geometry/mesh/bcg_mesh_factory.h"
+#include "bcg_library/geometry/mesh/bcg_mesh_face_normals.h"
+#include "bcg_library/geometry/mesh/bcg_mesh_vertex_welding.h"
+
+namespace bcg {
+
+void benchmark_stl(const benchmark_args &args) {
+    auto side = size_t(std::sqrt(double(args.size * 500)));
+    halfedge_mesh mesh = mesh_factory().make_grid(side, side);
+    face_normals(mesh);
+    std::vector<VectorS<3>> corners;
+    corners.reserve(3 * mesh.num_faces());
+    for (const auto f : mesh.faces) {
+        for (const auto v : mesh.get_vertices(f)) {
+            corners.push_back(mesh.positions[v]);
+        }
+    }
+    std::cout << "  vertices: " << mesh.num_vertices() << ", triangles: " << mesh.num_faces() << "\n";
+
+    // exported soups are rarely in mesh order, shuffle the triangles
+    std::mt19937 rng(42);
+    for (size_t t = corners.size() / 3; t > 1; --t) {
+        size_t s = rng() % t;
+        for (size_t i = 0; i < 3; ++i) {
+            std::swap(corners[3 * (t - 1) + i], corners[3 * s + i]);
+        }
+    }
+
+    // welding as the reader did before, with an ordered map of positions
+    Timer timer;
+    auto less = [](const VectorS<3> &a, const VectorS<3> &b) {
+        return std::lexicographical_compare(a.data(), a.data() + 3, b.data(), b.data() + 3);
+    };
+    std::map<VectorS<3>, bcg_index_t, decltype(less)> map(less);
+    std::vector<bcg_index_t> map_indices(corners.size());
+    for (size_t c = 0; c < corners.size(); ++c) {
+        map_indices[c] = map.emplace(corners[c], bcg_index_t(map.size())).first->second;
+    }
+    benchmark_report("weld with std::map", timer, corners.size());
+
+    std::vector<VectorS<3>> points;
+    auto indices = weld_vertices(corners, 0, points);
+    benchmark_report("weld_vertices (hashing)", timer, corners.size());
+    std::cout << "  vertices: " << map.size() << " / " << points.size() << ", equal: " << (map_indices == indices)
+              << "\n";
+
+    meshio_flags flags;
+    flags.use_binary = true;
+    meshio binary("bcg_benchmark_file.stl", flags);
+    binary.write(mesh);
+    timer = Timer();
+    halfedge_mesh from_binary;
+    binary.read(from_binary);
+    benchmark_report("read binary stl", timer, mesh.num_faces());
+
+    meshio ascii("bcg_benchmark_file.stl", meshio_flags());
+    ascii.write(mesh);
+    timer = Timer();
+    halfedge_mesh from_ascii;
+    ascii.read(from_ascii);
+    benchmark_report("read ascii stl", timer, mesh.num_faces());
+    std::cout << "  vertices: " << from_binary.num_vertices() << " / " << from_ascii.num_vertices() << ", faces: "
+              << from_binary.num_faces() << " / " << from_ascii.num_faces() << "\n";
+    std::remove("bcg_benchmark_file.stl");
+}
+
+}
@@ -0,0 +1,61 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include "bcg_benchmarks.h"
+#include "bcg_library/geometry/point_cloud/bcg_point_cloud.h"
+
+namespace bcg {
+
+namespace {
+// a point cloud as written by the readers: positions plus a dozen per-point attributes
+size_t fill(point_cloud &pc, size_t n, bool reserve) {
+    auto normals = pc.vertices.get_or_add<VectorS<3>, 3>("v_normal");
+    auto colors = pc.vertices.get_or_add<VectorS<3>, 3>("v_color");
+    for (int i = 0; i < 9; ++i) {
+        pc.vertices.get_or_add<bcg_scalar_t, 1>("v_attribute_" + std::to_string(i));
+    }
+    if (reserve) {
+        pc.vertices.reserve(n);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        auto v = pc.add_vertex(VectorS<3>::Constant(i));
+        normals[v] = VectorS<3>::UnitZ();
+        colors[v] = VectorS<3>::Ones();
+    }
+    return pc.vertices.num_properties();
+}
+}
+
+void benchmark_storage(const benchmark_args &args) {
+    size_t n = args.size * 1000;
+    Timer timer;
+    {
+        point_cloud pc;
+        fill(pc, n, false);
+        benchmark_report("build point cloud, heap, growing", timer, n);
+    }
+    {
+        point_cloud pc;
+        auto num_properties = fill(pc, n, true);
+        benchmark_report("build point cloud, heap, reserved (" + std::to_string(num_properties) + " properties)",
+                         timer, n);
+    }
+    {
+        point_cloud pc;
+        pc.vertices.use_arena();
+        fill(pc, n, true);
+        benchmark_report("build point cloud, arena, reserved", timer, n);
+        std::cout << "  arena blocks: " << pc.vertices.get_arena()->num_blocks() << " capacity: "
+                  << pc.vertices.get_arena()->capacity() / (1024.0 * 1024.0) << " MiB\n";
+        timer = Timer();
+    }
+    {
+        point_cloud pc;
+        pc.vertices.use_arena(true);
+        fill(pc, n, true);
+        benchmark_report("build point cloud, arena + huge pages, reserved", timer, n);
+    }
+}
+
+}
@@ -0,0 +1,74 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <cstdio>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "bcg_benchmarks.h"
+#include "bcg_library/geometry/point_cloud/bcg_point_cloudio.h"
+#include "bcg_library/geometry/point_cloud/bcg_point_cloud_stream.h"
+
+namespace bcg {
+
+static size_t peak_memory_mb() {
+#ifndef _WIN32
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return size_t(usage.ru_maxrss) / 1024;
+#else
+    return 0;
+#endif
+}
+
+void benchmark_stream(const benchmark_args &args) {
+    size_t n = args.size * 1000;
+    {
+        // written in blocks, so that generating the file does not raise the peak memory
+        FILE *out = fopen("bcg_benchmark_stream.ply", "wb");
+        fprintf(out, "ply\nformat binary_little_endian 1.0\nelement vertex %zu\nproperty float x\nproperty float y\n"
+                     "property float z\nproperty float nx\nproperty float ny\nproperty float nz\nend_header\n", n);
+        std::vector<float> block;
+        for (size_t i = 0; i < n; i += 1 << 16) {
+            block.clear();
+            for (size_t j = i; j < std::min(n, i + (1 << 16)); ++j) {
+                VectorS<3> p = VectorS<3>::Random();
+                block.insert(block.end(), {float(p[0]), float(p[1]), float(p[2]), 0, 0, 1});
+            }
+            fwrite(block.data(), sizeof(float), block.size(), out);
+        }
+        fclose(out);
+    }
+    std::cout << "  points: " << n << ", peak memory after writing: " << peak_memory_mb() << " MB\n";
+
+    // streaming first, the peak memory only grows
+    Timer timer;
+    point_stream_statistics stats;
+    point_cloud batch;
+    for (point_cloud_stream stream("bcg_benchmark_stream.ply", 1 << 22); stream.next(batch);) {
+        stats.push(batch.positions);
+    }
+    sample_mean_grid streamed(VectorI<3>(64, 64, 64), stats.aabb);
+    for (point_cloud_stream stream("bcg_benchmark_stream.ply", 1 << 22); stream.next(batch);) {
+        streamed.insert_points(batch.positions, stream.num_points_read() - batch.vertices.size());
+    }
+    batch = point_cloud();
+    benchmark_report("stream bounds + mean grid", timer, n);
+    std::cout << "  samples: " << streamed.get_occupied_sample_points().size() << ", peak memory: "
+              << peak_memory_mb() << " MB\n";
+
+    timer = Timer();
+    point_cloud pc;
+    point_cloudio("bcg_benchmark_stream.ply", point_cloudio_flags()).read(pc);
+    sample_mean_grid whole(VectorI<3>(64, 64, 64), aligned_box3(pc.positions.vector()));
+    whole.build(pc.positions);
+    benchmark_report("read whole + mean grid", timer, n);
+    std::cout << "  samples: " << whole.get_occupied_sample_points().size() << ", peak memory: "
+              << peak_memory_mb() << " MB, equal samples: "
+              << (whole.get_occupied_sample_points() == streamed.get_occupied_sample_points()) << "\n";
+    std::remove("bcg_benchmark_stream.ply");
+}
+
+}
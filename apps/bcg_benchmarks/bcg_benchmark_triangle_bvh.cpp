@@ -0,0 +1,110 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <cmath>
+#include <random>
+
+#include "bcg_benchmarks.h"
+#include "bcg_library/geometry/mesh/bcg_meshio.h"
+#include "bcg_library/geometry/mesh/bcg_mesh_factory.h"
+#include "bcg_library/geometry/kdtree/bcg_triangle_kdtree.h"
+#include "bcg_library/geometry/bvh/bcg_triangle_bvh.h"
+
+namespace bcg {
+
+void benchmark_triangle_bvh(const benchmark_args &args) {
+    halfedge_mesh mesh;
+    if (!args.filename.empty()) {
+        meshio io(args.filename, meshio_flags());
+        io.read(mesh);
+    } else {
+        auto side = size_t(std::sqrt(double(args.size * 100)));
+        mesh = mesh_factory().make_grid(side, side);
+        for (const auto v : mesh.vertices) {
+            auto &p = mesh.positions[v];
+            p[2] = 0.1 * std::sin(8 * p[0]) * std::cos(8 * p[1]);
+        }
+    }
+    std::cout << "  faces: " << mesh.num_faces() << "\n";
+
+    Timer timer;
+    triangle_kdtree kdtree(mesh, 10);
+    benchmark_report("build triangle_kdtree", timer, mesh.num_faces());
+    triangle_bvh bvh(mesh);
+    benchmark_report("build triangle_bvh", timer, mesh.num_faces());
+    std::cout << "  bvh nodes: " << bvh.num_nodes() << "\n";
+
+    // projection during remeshing: queries close to the surface
+    std::mt19937 gen(0);
+    aligned_box3 box;
+    for (const auto v : mesh.vertices) {
+        box.grow(mesh.positions[v]);
+    }
+    std::normal_distribution<bcg_scalar_t> noise(0, 1e-3 * box.diagonal().norm());
+    std::vector<VectorS<3>> near;
+    near.reserve(mesh.num_vertices());
+    for (const auto v : mesh.vertices) {
+        near.emplace_back(mesh.positions[v] + VectorS<3>(noise(gen), noise(gen), noise(gen)));
+    }
+    // distance queries from anywhere in the enlarged bounding box
+    std::uniform_real_distribution<bcg_scalar_t> dist(-0.5, 1.5);
+    std::vector<VectorS<3>> far(std::min<size_t>(near.size(), 1000));
+    for (auto &p : far) {
+        p = box.min + box.diagonal().cwiseProduct(VectorS<3>(dist(gen), dist(gen), dist(gen)));
+    }
+
+    size_t kd_tests = 0, bvh_tests = 0, mismatches = 0;
+    std::vector<triangle_kdtree::NearestNeighbor> kd_result;
+    kd_result.reserve(near.size());
+    timer = Timer();
+    for (const auto &p : near) {
+        kd_result.push_back(kdtree.nearest(p));
+    }
+    benchmark_report("nearest near surface, triangle_kdtree", timer, near.size());
+    for (size_t i = 0; i < near.size(); ++i) {
+        auto nn = bvh.nearest(near[i]);
+        bvh_tests += nn.tests;
+        mismatches += nn.result.distance != kd_result[i].result.distance;
+    }
+    benchmark_report("nearest near surface, triangle_bvh", timer, near.size());
+    auto batch = bvh.nearest_batch(near);
+    benchmark_report("nearest near surface, triangle_bvh batch", timer, near.size());
+    for (const auto &nn : kd_result) {
+        kd_tests += nn.tests;
+    }
+    std::cout << "  triangle tests per query: kdtree " << double(kd_tests) / near.size() << ", bvh "
+              << double(bvh_tests) / near.size() << ", mismatches: " << mismatches << "\n";
+
+    kd_tests = bvh_tests = 0;
+    timer = Timer();
+    for (const auto &p : far) {
+        kd_tests += kdtree.nearest(p).tests;
+    }
+    benchmark_report("nearest in bounding box, triangle_kdtree", timer, far.size());
+    for (const auto &p : far) {
+        bvh_tests += bvh.nearest(p).tests;
+    }
+    benchmark_report("nearest in bounding box, triangle_bvh", timer, far.size());
+    std::cout << "  triangle tests per query: kdtree " << double(kd_tests) / far.size() << ", bvh "
+              << double(bvh_tests) / far.size() << "\n";
+
+    // rays from the enlarged bounding box towards random points of it
+    std::vector<VectorS<3>> origins(near.size()), directions(near.size());
+    for (size_t i = 0; i < origins.size(); ++i) {
+        origins[i] = box.min + box.diagonal().cwiseProduct(VectorS<3>(dist(gen), dist(gen), dist(gen)));
+        directions[i] = box.min + box.diagonal().cwiseProduct(VectorS<3>(dist(gen), dist(gen), dist(gen))) -
+                        origins[i];
+    }
+    size_t hits = 0;
+    timer = Timer();
+    for (size_t i = 0; i < origins.size(); ++i) {
+        hits += bvh.intersect(origins[i], directions[i]).face.is_valid();
+    }
+    benchmark_report("ray intersection, triangle_bvh", timer, origins.size());
+    auto ray_batch = bvh.intersect_batch(origins, directions);
+    benchmark_report("ray intersection, triangle_bvh batch", timer, origins.size());
+    std::cout << "  hits: " << hits << " of " << origins.size() << "\n";
+}
+
+}
@@ -0,0 +1,71 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#ifndef BCG_GRAPHICS_BCG_BENCHMARKS_H
+#define BCG_GRAPHICS_BCG_BENCHMARKS_H
+
+#include <string>
+#include <iostream>
+#include "bcg_library/utils/bcg_timer.h"
+
+namespace bcg {
+
+struct benchmark_args {
+    size_t size = 1000;
+    std::string filename;
+};
+
+inline void benchmark_report(const std::string &name, Timer &timer, size_t items = 0) {
+    auto micros = timer.measure<MICROSECONDS>();
+    std::cout << "  " << name << ": " << micros / 1000.0 << " ms";
+    if (items > 0 && micros > 0) {
+        std::cout << " (" << items / (micros / 1000000.0) / 1000000.0 << " M/s)";
+    }
+    std::cout << "\n";
+    timer = Timer();
+}
+
+void benchmark_handles(const benchmark_args &args);
+
+void benchmark_properties(const benchmark_args &args);
+
+void benchmark_deletion(const benchmark_args &args);
+
+void benchmark_storage(const benchmark_args &args);
+
+void benchmark_precision(const benchmark_args &args);
+
+void benchmark_neighbors(const benchmark_args &args);
+
+void benchmark_kdtree(const benchmark_args &args);
+
+void benchmark_closest(const benchmark_args &args);
+
+void benchmark_octree(const benchmark_args &args);
+
+void benchmark_parse(const benchmark_args &args);
+
+void benchmark_bcg_file(const benchmark_args &args);
+
+void benchmark_build_faces(const benchmark_args &args);
+
+void benchmark_stl(const benchmark_args &args);
+
+void benchmark_ply(const benchmark_args &args);
+
+void benchmark_stream(const benchmark_args &args);
+
+void benchmark_compression(const benchmark_args &args);
+
+void benchmark_checkpoint(const benchmark_args &args);
+
+void benchmark_obj(const benchmark_args &args);
+
+void benchmark_simplification(const benchmark_args &args);
+
+void benchmark_triangle_bvh(const benchmark_args &args);
+
+}
+
+#endif //BCG_GRAPHICS_BCG_BENCHMARKS_H
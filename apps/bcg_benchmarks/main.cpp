@@ -0,0 +1,52 @@
+#include <map>
+#include <functional>
+
+#include "bcg_benchmarks.h"
+
+int main(int argc, char **argv) {
+    using namespace bcg;
+
+    std::map<std::string, std::function<void(const benchmark_args &)>> benchmarks = {
+            {"handles", benchmark_handles},
+            {"properties", benchmark_properties},
+            {"deletion", benchmark_deletion},
+            {"storage", benchmark_storage},
+            {"precision", benchmark_precision},
+            {"neighbors", benchmark_neighbors},
+            {"kdtree", benchmark_kdtree},
+            {"closest", benchmark_closest},
+            {"octree", benchmark_octree},
+            {"parse", benchmark_parse},
+            {"bcg_file", benchmark_bcg_file},
+            {"build_faces", benchmark_build_faces},
+            {"stl", benchmark_stl},
+            {"ply", benchmark_ply},
+            {"stream", benchmark_stream},
+            {"compression", benchmark_compression},
+            {"checkpoint", benchmark_checkpoint},
+            {"obj", benchmark_obj},
+            {"simplification", benchmark_simplification},
+            {"triangle_bvh", benchmark_triangle_bvh},
+    };
+
+    if (argc < 2) {
+        std::cout << "usage: bcg_benchmarks <name|all> [size] [filename]\n";
+        for (const auto &item : benchmarks) {
+            std::cout << "  " << item.first << "\n";
+        }
+        return 0;
+    }
+
+    benchmark_args args;
+    if (argc > 2) args.size = std::stoul(argv[2]);
+    if (argc > 3) args.filename = argv[3];
+
+    std::string name = argv[1];
+    for (const auto &item : benchmarks) {
+        if (name == "all" || name == item.first) {
+            std::cout << item.first << " (size " << args.size << ")\n";
+            item.second(args);
+        }
+    }
+    return 0;
+}
@@ -20,7 +20,8 @@ struct aligned_box {
 
     aligned_box(const VectorS<N> &min, const VectorS<N> &max) : min(min), max(max) {}
 
-    explicit aligned_box(const std::vector<VectorS<N>> &points) : aligned_box() {
+    template<typename Alloc>
+    explicit aligned_box(const std::vector<VectorS<N>, Alloc> &points) : aligned_box() {
         for (const auto &p : points) {
             grow(p);
         }
@@ -58,7 +59,7 @@ struct aligned_box {
     }
 
     inline aligned_box merge(const aligned_box &other) const {
-        return aligned_box(min.min(other.min), max.max(other.max));
+        return aligned_box(min.cwiseMin(other.min), max.cwiseMax(other.max));
     }
 
     inline void make_cubic() {
@@ -0,0 +1,38 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#ifndef BCG_GRAPHICS_BCG_LAZY_INDEX_H
+#define BCG_GRAPHICS_BCG_LAZY_INDEX_H
+
+#include <memory>
+#include <mutex>
+
+namespace bcg {
+
+// Spatial index owned by a geometry object, built on the first query and brought up to date by later ones. Index may
+// be incomplete where the owner is declared. Copies start empty, so a copied object never queries an index over the
+// properties of the original.
+template<typename Index>
+struct lazy_index {
+    std::shared_ptr<Index> index;
+    std::mutex mutex;
+
+    lazy_index() = default;
+
+    lazy_index(const lazy_index &) {}
+
+    lazy_index &operator=(const lazy_index &) {
+        reset();
+        return *this;
+    }
+
+    inline void reset() {
+        std::lock_guard<std::mutex> lock(mutex);
+        index.reset();
+    }
+};
+
+}
+
+#endif //BCG_GRAPHICS_BCG_LAZY_INDEX_H
@@ -19,6 +19,38 @@ struct neighbors_query {
     std::vector<bcg_scalar_t> distances;
 };
 
+struct neighbors_view {
+    const bcg_index_t *indices;
+    const bcg_scalar_t *distances;
+    size_t size;
+};
+
+// Neighborhoods of many query points in one buffer (CSR): the neighbors of query i are stored at
+// [offsets[i], offsets[i + 1]) of indices and distances. Reusing a batch across queries reuses its memory.
+struct neighbors_batch {
+    std::vector<size_t> offsets;
+    std::vector<bcg_index_t> indices;
+    std::vector<bcg_scalar_t> distances;
+
+    [[nodiscard]] inline size_t size() const {
+        return offsets.empty() ? 0 : offsets.size() - 1;
+    }
+
+    [[nodiscard]] inline size_t num_neighbors(size_t i) const {
+        return offsets[i + 1] - offsets[i];
+    }
+
+    [[nodiscard]] inline neighbors_view operator[](size_t i) const {
+        return {indices.data() + offsets[i], distances.data() + offsets[i], num_neighbors(i)};
+    }
+
+    inline void clear() {
+        offsets.clear();
+        indices.clear();
+        distances.clear();
+    }
+};
+
 }
 
 #endif //BCG_GRAPHICS_BCG_NEIGHBORS_QUERY_H
@@ -0,0 +1,575 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include "bcg_ply_io.h"
+#include "math/vector/bcg_vector.h"
+#include "utils/bcg_mapped_file.h"
+#include "tbb/tbb.h"
+
+namespace bcg {
+
+namespace {
+
+ply_type parse_type(const std::string &name) {
+    if (name == "char" || name == "int8") return ply_type::INT8;
+    if (name == "uchar" || name == "uint8") return ply_type::UINT8;
+    if (name == "short" || name == "int16") return ply_type::INT16;
+    if (name == "ushort" || name == "uint16") return ply_type::UINT16;
+    if (name == "int" || name == "int32") return ply_type::INT32;
+    if (name == "uint" || name == "uint32") return ply_type::UINT32;
+    if (name == "float" || name == "float32") return ply_type::FLOAT32;
+    if (name == "double" || name == "float64") return ply_type::FLOAT64;
+    return ply_type::INVALID;
+}
+
+const char *type_name(ply_type type) {
+    switch (type) {
+        case ply_type::INT8:
+            return "char";
+        case ply_type::UINT8:
+            return "uchar";
+        case ply_type::INT16:
+            return "short";
+        case ply_type::UINT16:
+            return "ushort";
+        case ply_type::INT32:
+            return "int";
+        case ply_type::UINT32:
+            return "uint";
+        case ply_type::FLOAT32:
+            return "float";
+        case ply_type::FLOAT64:
+            return "double";
+        default:
+            return "";
+    }
+}
+
+template<typename T>
+inline double read_raw(const char *data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return double(value);
+}
+
+inline double read_value(const char *data, ply_type type) {
+    switch (type) {
+        case ply_type::INT8:
+            return read_raw<int8_t>(data);
+        case ply_type::UINT8:
+            return read_raw<uint8_t>(data);
+        case ply_type::INT16:
+            return read_raw<int16_t>(data);
+        case ply_type::UINT16:
+            return read_raw<uint16_t>(data);
+        case ply_type::INT32:
+            return read_raw<int32_t>(data);
+        case ply_type::UINT32:
+            return read_raw<uint32_t>(data);
+        case ply_type::FLOAT32:
+            return read_raw<float>(data);
+        case ply_type::FLOAT64:
+            return read_raw<double>(data);
+        default:
+            return 0;
+    }
+}
+
+// moves pen behind the records of element and calls func(record, property index, data, count) for each property of
+// each record, unless the element has a fixed stride and no func is needed. False if the data ends early.
+template<typename Func>
+bool scan_element(const ply_element &element, const char *&pen, const char *end, Func &&func) {
+    for (size_t i = 0; i < element.count; ++i) {
+        for (size_t j = 0; j < element.properties.size(); ++j) {
+            const auto &property = element.properties[j];
+            size_t count = 1;
+            if (property.count_type != ply_type::INVALID) {
+                size_t count_size = ply_type_size(property.count_type);
+                if (size_t(end - pen) < count_size) return false;
+                double value = read_value(pen, property.count_type);
+                if (value < 0) return false;
+                count = size_t(value);
+                pen += count_size;
+            }
+            size_t size = ply_type_size(property.type);
+            if (size_t(end - pen) / size < count) return false;
+            func(i, j, pen, count);
+            pen += count * size;
+        }
+    }
+    return true;
+}
+
+bool skip_element(const ply_element &element, const char *&pen, const char *end) {
+    if (element.stride > 0) {
+        if (size_t(end - pen) / element.stride < element.count) return false;
+        pen += element.count * element.stride;
+        return true;
+    }
+    return scan_element(element, pen, end, [](size_t, size_t, const char *, size_t) {});
+}
+
+template<int N>
+bcg_scalar_t *column_data(property_container &container, const std::string &name) {
+    auto prop = container.get_or_add<Vector<bcg_scalar_t, N>, N>(name);
+    if (!prop || prop.vector().empty()) return nullptr;
+    return prop.vector()[0].data();
+}
+
+// adds a property of dims scalars, returns its data or nullptr if it is empty or the name is taken by another type
+bcg_scalar_t *column_data(property_container &container, const std::string &name, size_t dims) {
+    switch (dims) {
+        case 1: {
+            auto prop = container.get_or_add<bcg_scalar_t, 1>(name);
+            if (!prop || prop.vector().empty()) return nullptr;
+            return prop.vector().data();
+        }
+        case 2:
+            return column_data<2>(container, name);
+        case 3:
+            return column_data<3>(container, name);
+        case 4:
+            return column_data<4>(container, name);
+        case 5:
+            return column_data<5>(container, name);
+        case 6:
+            return column_data<6>(container, name);
+        default:
+            return nullptr;
+    }
+}
+
+// vertex attribute j of the file goes to component of a property with dims scalars
+struct vertex_column {
+    size_t j = 0, target = 0, component = 0;
+    bcg_scalar_t scale = 1;
+};
+
+struct vertex_target {
+    std::string name;
+    size_t dims = 1;
+    bcg_scalar_t *data = nullptr;
+};
+
+void map_vertex_columns(const ply_element &element, std::vector<vertex_target> &targets,
+                        std::vector<vertex_column> &columns) {
+    const std::pair<const char *, std::array<const char *, 3>> known[] = {{"v_position", {"x", "y", "z"}},
+                                                                          {"v_normal", {"nx", "ny", "nz"}},
+                                                                          {"v_color", {"red", "green", "blue"}}};
+    auto target_index = [&targets](const std::string &name, size_t dims) {
+        for (size_t t = 0; t < targets.size(); ++t) {
+            if (targets[t].name == name) return t;
+        }
+        targets.push_back({name, dims, nullptr});
+        return targets.size() - 1;
+    };
+
+    const auto &properties = element.properties;
+    for (size_t j = 0; j < properties.size();) {
+        const auto &property = properties[j];
+        if (property.count_type != ply_type::INVALID) {
+            ++j;
+            continue;
+        }
+        bool is_known = false;
+        for (const auto &item : known) {
+            for (size_t i = 0; i < 3 && !is_known; ++i) {
+                if (property.name != item.second[i]) continue;
+                vertex_column column{j, target_index(item.first, 3), i, 1};
+                if (std::string(item.first) == "v_color") {
+                    if (property.type == ply_type::UINT8) column.scale = bcg_scalar_t(1) / 255;
+                    if (property.type == ply_type::UINT16) column.scale = bcg_scalar_t(1) / 65535;
+                }
+                columns.push_back(column);
+                is_known = true;
+            }
+        }
+        if (is_known) {
+            ++j;
+            continue;
+        }
+
+        // name_0, ..., name_k of one type form a vector "name"
+        size_t dims = 1;
+        auto split = property.name.rfind('_');
+        std::string base = property.name.substr(0, split);
+        if (split != std::string::npos && property.name.substr(split + 1) == "0") {
+            while (j + dims < properties.size() && dims < 6 &&
+                   properties[j + dims].name == base + "_" + std::to_string(dims) &&
+                   properties[j + dims].type == property.type &&
+                   properties[j + dims].count_type == ply_type::INVALID) {
+                ++dims;
+            }
+        }
+        if (dims == 1) {
+            columns.push_back({j, target_index(property.name, 1), 0, 1});
+        } else {
+            size_t t = target_index(base, dims);
+            for (size_t i = 0; i < dims; ++i) {
+                columns.push_back({j + i, t, i, 1});
+            }
+        }
+        j += dims;
+    }
+}
+
+// adds the vertex properties of the element, resized to count, and maps the attributes of the file to them
+void prepare_vertices(const ply_element &element, size_t count, property_container &vertices,
+                      std::vector<vertex_target> &targets, std::vector<vertex_column> &columns) {
+    map_vertex_columns(element, targets, columns);
+    for (const auto &target : targets) {
+        column_data(vertices, target.name, target.dims);
+    }
+    vertices.resize(count);
+    for (auto &target : targets) {
+        target.data = column_data(vertices, target.name, target.dims);
+        if (auto *prop = vertices.get_base_ptr(target.name)) {
+            prop->set_dirty();
+        }
+    }
+}
+
+inline void store_vertex(const ply_element &element, const std::vector<vertex_target> &targets, size_t i,
+                         const vertex_column &column, const char *data) {
+    const auto &target = targets[column.target];
+    if (target.data) {
+        target.data[i * target.dims + column.component] =
+                bcg_scalar_t(read_value(data, element.properties[column.j].type)) * column.scale;
+    }
+}
+
+bool read_vertices(const ply_element &element, const char *&pen, const char *end, property_container &vertices) {
+    if (element.stride > 0) {
+        if (size_t(end - pen) / element.stride < element.count) return false;
+        read_ply_vertices(element, pen, element.count, vertices);
+        pen += element.count * element.stride;
+        return true;
+    }
+
+    // records of different sizes, read in order
+    std::vector<vertex_target> targets;
+    std::vector<vertex_column> columns;
+    prepare_vertices(element, element.count, vertices, targets, columns);
+    std::vector<int> column_of(element.properties.size(), -1);
+    for (size_t c = 0; c < columns.size(); ++c) {
+        column_of[columns[c].j] = int(c);
+    }
+    return scan_element(element, pen, end, [&](size_t i, size_t j, const char *data, size_t) {
+        if (column_of[j] >= 0) store_vertex(element, targets, i, columns[column_of[j]], data);
+    });
+}
+
+bool read_faces(const ply_element &element, const char *&pen, const char *end, std::vector<bcg_index_t> &indices,
+                std::vector<bcg_index_t> &offsets) {
+    size_t list = element.properties.size();
+    for (size_t j = 0; j < element.properties.size(); ++j) {
+        const auto &property = element.properties[j];
+        if (property.count_type != ply_type::INVALID &&
+            (property.name == "vertex_indices" || property.name == "vertex_index")) {
+            list = j;
+        }
+    }
+    offsets.assign(1, 0);
+    offsets.reserve(element.count + 1);
+    indices.clear();
+    indices.reserve(3 * element.count);
+    bool direct = list < element.properties.size() &&
+                  (element.properties[list].type == ply_type::INT32 ||
+                   element.properties[list].type == ply_type::UINT32);
+    return scan_element(element, pen, end, [&](size_t, size_t j, const char *data, size_t count) {
+        if (j != list) return;
+        size_t offset = indices.size();
+        indices.resize(offset + count);
+        if (direct) {
+            std::memcpy(indices.data() + offset, data, count * sizeof(bcg_index_t));
+        } else {
+            for (size_t k = 0; k < count; ++k) {
+                indices[offset + k] = bcg_index_t(read_value(data + k * ply_type_size(element.properties[j].type),
+                                                             element.properties[j].type));
+            }
+        }
+        offsets.push_back(indices.size());
+    });
+}
+
+}
+
+size_t ply_type_size(ply_type type) {
+    switch (type) {
+        case ply_type::INT8:
+        case ply_type::UINT8:
+            return 1;
+        case ply_type::INT16:
+        case ply_type::UINT16:
+            return 2;
+        case ply_type::INT32:
+        case ply_type::UINT32:
+        case ply_type::FLOAT32:
+            return 4;
+        case ply_type::FLOAT64:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+bool parse_ply_header(const char *begin, const char *end, ply_header &header) {
+    const char marker[] = "end_header";
+    const char *header_end = std::search(begin, end, marker, marker + sizeof(marker) - 1);
+    if (end - begin < 3 || std::string(begin, 3) != "ply" || header_end == end) {
+        return false;
+    }
+    const char *data = std::find(header_end, end, '\n');
+    header.data_offset = data == end ? size_t(end - begin) : size_t(data - begin) + 1;
+    header.elements.clear();
+
+    std::istringstream stream(std::string(begin, header_end));
+    std::string line, keyword;
+    std::getline(stream, line);
+    while (std::getline(stream, line)) {
+        std::istringstream tokens(line);
+        tokens >> keyword;
+        if (keyword == "format") {
+            std::string format;
+            tokens >> format;
+            if (format == "ascii") {
+                header.format = ply_header::format::ASCII;
+            } else if (format == "binary_little_endian") {
+                header.format = ply_header::format::BINARY_LITTLE_ENDIAN;
+            } else if (format == "binary_big_endian") {
+                header.format = ply_header::format::BINARY_BIG_ENDIAN;
+            } else {
+                return false;
+            }
+        } else if (keyword == "element") {
+            ply_element element;
+            if (!(tokens >> element.name >> element.count)) return false;
+            header.elements.push_back(element);
+        } else if (keyword == "property") {
+            if (header.elements.empty()) return false;
+            ply_property property;
+            std::string type;
+            tokens >> type;
+            if (type == "list") {
+                std::string count_type;
+                tokens >> count_type >> type;
+                property.count_type = parse_type(count_type);
+                if (property.count_type == ply_type::INVALID) return false;
+            }
+            property.type = parse_type(type);
+            if (property.type == ply_type::INVALID || !(tokens >> property.name)) return false;
+            header.elements.back().properties.push_back(property);
+        }
+    }
+
+    for (auto &element : header.elements) {
+        size_t offset = 0;
+        bool fixed = true;
+        for (auto &property : element.properties) {
+            property.offset = offset;
+            fixed = fixed && property.count_type == ply_type::INVALID;
+            offset += ply_type_size(property.type);
+        }
+        element.stride = fixed ? offset : 0;
+    }
+    return true;
+}
+
+bool read_ply_vertices(const ply_element &element, const char *records, size_t count, property_container &vertices) {
+    if (element.stride == 0) return false;
+    std::vector<vertex_target> targets;
+    std::vector<vertex_column> columns;
+    prepare_vertices(element, count, vertices, targets, columns);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, count, 1 << 14), [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i != range.end(); ++i) {
+            const char *record = records + i * element.stride;
+            for (const auto &column : columns) {
+                store_vertex(element, targets, i, column, record + element.properties[column.j].offset);
+            }
+        }
+    });
+    return true;
+}
+
+bool read_ply_binary(const std::string &filename, property_container &vertices,
+                     std::vector<bcg_index_t> *face_indices, std::vector<bcg_index_t> *face_offsets) {
+    mapped_file file(filename);
+    ply_header header;
+    if (!file || !parse_ply_header(file.begin(), file.end(), header) ||
+        header.format != ply_header::format::BINARY_LITTLE_ENDIAN) {
+        return false;
+    }
+    const char *pen = file.begin() + header.data_offset;
+    for (const auto &element : header.elements) {
+        bool ok;
+        if (element.name == "vertex") {
+            ok = read_vertices(element, pen, file.end(), vertices);
+        } else if (element.name == "face" && face_indices && face_offsets) {
+            ok = read_faces(element, pen, file.end(), *face_indices, *face_offsets);
+        } else {
+            ok = skip_element(element, pen, file.end());
+        }
+        if (!ok) {
+            std::cerr << filename << ": ply element " << element.name << " ends early\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool write_ply_binary(const std::string &filename, const property_container &vertices,
+                      const std::vector<bcg_index_t> *face_indices, const std::vector<bcg_index_t> *face_offsets) {
+    // arithmetic properties, position, normal and color first and the others sorted by name
+    struct column {
+        const base_property *prop;
+        std::vector<std::string> names;
+        ply_type type;
+        bool color;
+    };
+    std::vector<std::string> names;
+    for (const auto &item : vertices.properties()) {
+        names.push_back(item.first);
+    }
+    std::sort(names.begin(), names.end(), [](const std::string &a, const std::string &b) {
+        auto rank = [](const std::string &name) {
+            return name == "v_position" ? 0 : name == "v_normal" ? 1 : name == "v_color" ? 2 : 3;
+        };
+        return rank(a) != rank(b) ? rank(a) < rank(b) : a < b;
+    });
+
+    std::vector<column> columns;
+    size_t stride = 0;
+    for (const auto &name : names) {
+        const auto *prop = vertices.get_base_ptr(name);
+        ply_type type;
+        switch (prop->type()) {
+            case property_types::Type::FLOAT:
+                type = ply_type::FLOAT32;
+                break;
+            case property_types::Type::DOUBLE:
+                type = ply_type::FLOAT64;
+                break;
+            case property_types::Type::INT:
+                type = ply_type::INT32;
+                break;
+            case property_types::Type::UNSIGNED_INT:
+                type = ply_type::UINT32;
+                break;
+            default:
+                continue;
+        }
+        size_t dims = prop->dims();
+        if ((prop->raw_data() == nullptr && prop->size() > 0) || dims > 6 ||
+            prop->element_size_bytes() != dims * ply_type_size(type)) {
+            continue;
+        }
+        column item{prop, {}, type, name == "v_color" && dims == 3 && (type == ply_type::FLOAT32 ||
+                                                                       type == ply_type::FLOAT64)};
+        if (name == "v_position" && dims == 3) {
+            item.names = {"x", "y", "z"};
+        } else if (name == "v_normal" && dims == 3) {
+            item.names = {"nx", "ny", "nz"};
+        } else if (item.color) {
+            item.names = {"red", "green", "blue"};
+        } else if (dims == 1) {
+            item.names = {name};
+        } else {
+            for (size_t i = 0; i < dims; ++i) {
+                item.names.push_back(name + "_" + std::to_string(i));
+            }
+        }
+        stride += item.color ? 3 : prop->element_size_bytes();
+        columns.push_back(std::move(item));
+    }
+
+    // deleted vertices are skipped, the face indices are mapped to the written vertices
+    std::vector<bcg_index_t> rows;
+    rows.reserve(vertices.size());
+    for (const auto v : vertices) {
+        rows.push_back(bcg_index_t(v.idx));
+    }
+    std::vector<bcg_index_t> written_index;
+    if (rows.size() != vertices.size()) {
+        written_index.assign(vertices.size(), bcg_index_t(-1));
+        for (size_t i = 0; i < rows.size(); ++i) {
+            written_index[rows[i]] = bcg_index_t(i);
+        }
+    }
+
+    size_t num_vertices = rows.size();
+    size_t num_faces = face_offsets && !face_offsets->empty() ? face_offsets->size() - 1 : 0;
+    size_t max_valence = 0;
+    for (size_t i = 0; i < num_faces; ++i) {
+        max_valence = std::max<size_t>(max_valence, (*face_offsets)[i + 1] - (*face_offsets)[i]);
+    }
+    ply_type count_type = max_valence > 255 ? ply_type::INT32 : ply_type::UINT8;
+
+    std::ostringstream header;
+    header << "ply\nformat binary_little_endian 1.0\ncomment File written with bcg-library\n";
+    header << "element vertex " << num_vertices << "\n";
+    for (const auto &item : columns) {
+        for (const auto &name : item.names) {
+            header << "property " << type_name(item.color ? ply_type::UINT8 : item.type) << " " << name << "\n";
+        }
+    }
+    if (num_faces > 0) {
+        header << "element face " << num_faces << "\n";
+        header << "property list " << type_name(count_type) << " int vertex_indices\n";
+    }
+    header << "end_header\n";
+
+    std::vector<char> buffer(num_vertices * stride);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_vertices, 1 << 14),
+                      [&](const tbb::blocked_range<size_t> &range) {
+                          for (size_t i = range.begin(); i != range.end(); ++i) {
+                              char *record = buffer.data() + i * stride;
+                              for (const auto &item : columns) {
+                                  size_t size = item.prop->element_size_bytes();
+                                  const char *data = static_cast<const char *>(item.prop->raw_data()) +
+                                                     rows[i] * size;
+                                  if (!item.color) {
+                                      std::memcpy(record, data, size);
+                                      record += size;
+                                      continue;
+                                  }
+                                  for (size_t k = 0; k < 3; ++k) {
+                                      double value = read_value(data + k * ply_type_size(item.type), item.type);
+                                      *record++ = char(uint8_t(std::clamp(value, 0.0, 1.0) * 255 + 0.5));
+                                  }
+                              }
+                          }
+                      });
+
+    FILE *out = fopen(filename.c_str(), "wb");
+    if (!out) {
+        return false;
+    }
+    std::string text = header.str();
+    bool ok = fwrite(text.data(), 1, text.size(), out) == text.size();
+    ok = ok && fwrite(buffer.data(), 1, buffer.size(), out) == buffer.size();
+    if (num_faces > 0) {
+        buffer.clear();
+        for (size_t i = 0; i < num_faces; ++i) {
+            auto begin = (*face_offsets)[i], end = (*face_offsets)[i + 1];
+            int32_t count = int32_t(end - begin);
+            buffer.insert(buffer.end(), reinterpret_cast<const char *>(&count),
+                          reinterpret_cast<const char *>(&count) + ply_type_size(count_type));
+            for (auto c = begin; c != end; ++c) {
+                bcg_index_t idx = written_index.empty() ? (*face_indices)[c] : written_index[(*face_indices)[c]];
+                buffer.insert(buffer.end(), reinterpret_cast<const char *>(&idx),
+                              reinterpret_cast<const char *>(&idx) + sizeof(idx));
+            }
+        }
+        ok = ok && fwrite(buffer.data(), 1, buffer.size(), out) == buffer.size();
+    }
+    ok = fclose(out) == 0 && ok;
+    return ok;
+}
+
+}
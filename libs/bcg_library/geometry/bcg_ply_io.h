@@ -0,0 +1,69 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#ifndef BCG_GRAPHICS_BCG_PLY_IO_H
+#define BCG_GRAPHICS_BCG_PLY_IO_H
+
+#include <string>
+#include <vector>
+#include "bcg_property.h"
+#include "math/bcg_math_common.h"
+
+namespace bcg {
+
+enum class ply_type : uint8_t {
+    INVALID, INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64
+};
+
+struct ply_property {
+    std::string name;
+    ply_type type = ply_type::INVALID;
+    ply_type count_type = ply_type::INVALID; // valid for list properties
+    size_t offset = 0;                       // in the record, if all properties before have a fixed size
+};
+
+struct ply_element {
+    std::string name;
+    size_t count = 0;
+    std::vector<ply_property> properties;
+    size_t stride = 0;                       // record size, 0 if the element has list properties
+};
+
+struct ply_header {
+    enum class format {
+        ASCII, BINARY_LITTLE_ENDIAN, BINARY_BIG_ENDIAN
+    } format = format::ASCII;
+    std::vector<ply_element> elements;
+    size_t data_offset = 0;                  // first byte after end_header
+};
+
+size_t ply_type_size(ply_type type);
+
+// false if [begin, end) does not start with a valid ply header.
+bool parse_ply_header(const char *begin, const char *end, ply_header &header);
+
+// Reads binary little endian ply files without per value callbacks. The vertex element is read in parallel with a
+// fixed stride: x, y, z go to v_position, nx, ny, nz to v_normal and red, green, blue to v_color (integers scaled to
+// [0, 1]). All other vertex attributes become properties of bcg_scalar_t, name_0 ... name_k as one vector property
+// "name". If face_indices and face_offsets are given, the vertex_indices (or vertex_index) lists of the face element
+// are copied to them, in the layout of halfedge_mesh::build_from_faces. Returns false if the file is missing, not
+// binary little endian or malformed, readers can fall back to rply then.
+bool read_ply_binary(const std::string &filename, property_container &vertices,
+                     std::vector<bcg_index_t> *face_indices = nullptr,
+                     std::vector<bcg_index_t> *face_offsets = nullptr);
+
+// Reads count fixed size records of a vertex element, as read_ply_binary does, into vertices resized to count. Used to
+// read the vertex element in batches. Returns false if the element has list properties.
+bool read_ply_vertices(const ply_element &element, const char *records, size_t count, property_container &vertices);
+
+// Writes all arithmetic vertex properties as binary little endian ply, with the names read_ply_binary maps back. Faces
+// are given as for halfedge_mesh::build_from_faces, with offsets. Deleted vertices are skipped and the face indices
+// are mapped to the written vertices, faces must not use deleted vertices.
+bool write_ply_binary(const std::string &filename, const property_container &vertices,
+                      const std::vector<bcg_index_t> *face_indices = nullptr,
+                      const std::vector<bcg_index_t> *face_offsets = nullptr);
+
+}
+
+#endif //BCG_GRAPHICS_BCG_PLY_IO_H
@@ -14,25 +14,32 @@
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
 
 #include "bcg_property_eigen_trait.h"
+#include "utils/bcg_bit_vector.h"
+#include "utils/bcg_aligned_allocator.h"
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
 
 namespace bcg {
 
 constexpr size_t BCG_INVALID_ID = std::numeric_limits<size_t>::max();
 
-struct base_handle {
-    size_t idx;
+using handle_index_t = std::uint32_t;
 
-    base_handle(size_t idx = BCG_INVALID_ID) : idx(idx) {
+constexpr handle_index_t BCG_INVALID_HANDLE_ID = std::numeric_limits<handle_index_t>::max();
 
-    }
+// Element handles are plain 32-bit indices without a vtable, so they are trivially copyable and the
+// connectivity records built from them stay densely packed (see halfedge_graph::halfedge_connectivity).
+struct base_handle {
+    handle_index_t idx;
 
-    virtual ~base_handle() = default;
+    base_handle(size_t idx = BCG_INVALID_ID) : idx(idx >= BCG_INVALID_HANDLE_ID ? BCG_INVALID_HANDLE_ID
+                                                                                 : handle_index_t(idx)) {
 
-    virtual base_handle &operator=(const base_handle &other) {
-        idx = other.idx;
-        return *this;
     }
 
     [[nodiscard]] inline operator size_t() const {
@@ -40,7 +47,7 @@ struct base_handle {
     }
 
     [[nodiscard]] inline bool is_valid() const {
-        return idx != BCG_INVALID_ID;
+        return idx != BCG_INVALID_HANDLE_ID;
     }
 
     [[nodiscard]] inline bool operator==(const base_handle &other) const {
@@ -71,7 +78,7 @@ struct base_handle {
 struct vertex_handle : public base_handle {
     using base_handle::base_handle;
 
-    vertex_handle &operator=(const base_handle &other) override {
+    vertex_handle &operator=(const base_handle &other) {
         idx = other.idx;
         return *this;
     }
@@ -80,7 +87,7 @@ struct vertex_handle : public base_handle {
 struct halfedge_handle : public base_handle {
     using base_handle::base_handle;
 
-    halfedge_handle &operator=(const base_handle &other) override {
+    halfedge_handle &operator=(const base_handle &other) {
         idx = other.idx;
         return *this;
     }
@@ -89,7 +96,7 @@ struct halfedge_handle : public base_handle {
 struct edge_handle : public base_handle {
     using base_handle::base_handle;
 
-    edge_handle &operator=(const base_handle &other) override {
+    edge_handle &operator=(const base_handle &other) {
         idx = other.idx;
         return *this;
     }
@@ -98,14 +105,25 @@ struct edge_handle : public base_handle {
 struct face_handle : public base_handle {
     using base_handle::base_handle;
 
-    face_handle &operator=(const base_handle &other) override {
+    face_handle &operator=(const base_handle &other) {
         idx = other.idx;
         return *this;
     }
 };
 
+static_assert(sizeof(vertex_handle) == sizeof(handle_index_t), "handles must stay 32 bit wide");
+static_assert(sizeof(halfedge_handle) == sizeof(handle_index_t), "handles must stay 32 bit wide");
+static_assert(sizeof(edge_handle) == sizeof(handle_index_t), "handles must stay 32 bit wide");
+static_assert(sizeof(face_handle) == sizeof(handle_index_t), "handles must stay 32 bit wide");
+static_assert(std::is_trivially_copyable<vertex_handle>::value, "handles must be trivially copyable");
+static_assert(std::is_trivially_copyable<halfedge_handle>::value, "handles must be trivially copyable");
+static_assert(std::is_trivially_copyable<edge_handle>::value, "handles must be trivially copyable");
+static_assert(std::is_trivially_copyable<face_handle>::value, "handles must be trivially copyable");
+
 struct property_container;
 
+struct neighbors_cache;
+
 namespace property_types {
     enum class Type {
         BOOL,
@@ -226,6 +244,10 @@ struct base_property {
 
     [[nodiscard]] virtual bool is_dirty() const = 0;
 
+    // counts set_dirty() calls. Unlike the dirty flag it is never reset, so caches derived from the data can tell
+    // whether it changed since they were built, independent of who cleans the flag.
+    [[nodiscard]] virtual size_t version() const = 0;
+
     [[nodiscard]] virtual property_types::Type type() const = 0;
 
     virtual void set_name(const std::string &name) = 0;
@@ -236,6 +258,9 @@ struct base_property {
 
     virtual void swap(size_t i0, size_t i1) = 0;
 
+    // keeps the elements at the increasing indices kept, in their order
+    virtual void compact(const std::vector<handle_index_t> &kept) = 0;
+
     virtual void clear() = 0;
 
     virtual void free_unused_memory() = 0;
@@ -245,6 +270,22 @@ struct base_property {
     virtual void resize(size_t n) = 0;
 
     virtual void push_back() = 0;
+
+    // moves the data into buffers taken from arena (or the heap if arena is null)
+    virtual void set_arena(const std::shared_ptr<AlignedArena> &arena) = 0;
+
+    // raw bytes of the storage for binary files (bool properties expose their 64-bit words). Null if the elements
+    // can not be copied as bytes, see is_raw_copyable.
+    [[nodiscard]] virtual const void *raw_data() const = 0;
+
+    // writable raw bytes, to decode into the storage in place. Call set_dirty() after writing. Null for bool
+    // properties, whose words carry extra state.
+    [[nodiscard]] virtual void *raw_data() = 0;
+
+    [[nodiscard]] virtual size_t raw_size_bytes() const = 0;
+
+    // resizes to n elements and copies raw_size_bytes() bytes from data. False if the elements are not raw copyable.
+    virtual bool assign_raw(const void *data, size_t n) = 0;
 };
 
 inline std::ostream &operator<<(std::ostream &stream, const base_property &property) {
@@ -253,18 +294,110 @@ inline std::ostream &operator<<(std::ostream &stream, const base_property &prope
     return stream;
 }
 
+// elements that can be stored and restored as plain bytes: trivially copyable types and fixed size Eigen matrices
+// of arithmetic scalars (which are not trivially copyable by the standard trait).
+template<typename T, typename = void>
+struct is_raw_copyable : std::is_trivially_copyable<T> {
+};
+
+template<typename T>
+struct is_raw_copyable<T, std::enable_if_t<std::is_base_of<Eigen::EigenBase<T>, T>::value>>
+        : std::integral_constant<bool, T::SizeAtCompileTime != Eigen::Dynamic &&
+                                       std::is_arithmetic<typename T::Scalar>::value> {
+};
+
+// property data lives in 64-byte aligned buffers, optionally carved from an arena shared by a container.
+template<typename T>
+using property_buffer = std::vector<T, AlignedAllocator<T>>;
+
+template<typename T>
+struct property_storage {
+    using type = property_buffer<T>;
+
+    static type make(const std::shared_ptr<AlignedArena> &arena) {
+        return type(AlignedAllocator<T>(arena));
+    }
+
+    static size_t raw_size_bytes(const type &container) {
+        return container.size() * sizeof(T);
+    }
+
+    static void assign_raw(type &container, const void *data, size_t n) {
+        container.resize(n);
+        if (n > 0) {
+            std::memcpy(static_cast<void *>(container.data()), data, raw_size_bytes(container));
+        }
+    }
+
+    // gathers into a new buffer, in parallel over ranges
+    static void compact(type &container, const std::vector<handle_index_t> &kept) {
+        type result(kept.size(), T(), container.get_allocator());
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, kept.size(), 1 << 14),
+                          [&](const tbb::blocked_range<size_t> &range) {
+                              for (size_t i = range.begin(); i != range.end(); ++i) {
+                                  result[i] = std::move(container[kept[i]]);
+                              }
+                          });
+        container.swap(result);
+    }
+};
+
+// bool properties are stored as 64-bit words instead of std::vector<bool>, so masks can be scanned word-wise.
+template<>
+struct property_storage<bool> {
+    using type = BitVector;
+
+    static type make(const std::shared_ptr<AlignedArena> &) {
+        return type();
+    }
+
+    static size_t raw_size_bytes(const type &container) {
+        return container.num_words() * sizeof(*container.data());
+    }
+
+    static void assign_raw(type &container, const void *data, size_t n) {
+        container.resize(n);
+        if (n > 0) {
+            std::memcpy(container.data(), data, raw_size_bytes(container));
+        }
+        container.update_maybe_any();
+    }
+
+    // whole words of the result per task, so tasks never share a word
+    static void compact(type &container, const std::vector<handle_index_t> &kept) {
+        type result(kept.size());
+        auto *words = result.data();
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, result.num_words(), 1 << 8),
+                          [&](const tbb::blocked_range<size_t> &range) {
+                              for (size_t w = range.begin(); w != range.end(); ++w) {
+                                  type::word_t word = 0;
+                                  size_t last = std::min(kept.size(), (w + 1) * type::word_bits);
+                                  for (size_t i = w * type::word_bits; i < last; ++i) {
+                                      word |= type::word_t(container.test(kept[i])) << (i % type::word_bits);
+                                  }
+                                  words[w] = word;
+                              }
+                          });
+        result.update_maybe_any();
+        container = std::move(result);
+    }
+};
+
 template<typename T, int N>
 struct property_vector : public base_property {
-    using iterator_t = typename std::vector<T>::iterator;
-    using const_iterator_t = typename std::vector<T>::const_iterator;
-    using reference_t = typename std::vector<T>::reference;
-    using const_reference_t = typename std::vector<T>::const_reference;
-
-    explicit property_vector(std::string name, T t = T()) : base_property(),
-                                                            property_name(std::move(name)),
-                                                            default_value(t),
-                                                            dirty(false),
-                                                            container() {
+    using container_t = typename property_storage<T>::type;
+    using iterator_t = typename container_t::iterator;
+    using const_iterator_t = typename container_t::const_iterator;
+    using reference_t = typename container_t::reference;
+    using const_reference_t = typename container_t::const_reference;
+
+    explicit property_vector(std::string name, T t = T(), const std::shared_ptr<AlignedArena> &arena = nullptr)
+            : base_property(),
+              property_name(std::move(name)),
+              default_value(t),
+              dirty(false),
+              num_changes(0),
+              container(property_storage<T>::make(arena)) {
 
     };
 
@@ -285,6 +418,11 @@ struct property_vector : public base_property {
         set_dirty();
     }
 
+    inline void compact(const std::vector<handle_index_t> &kept) override {
+        property_storage<T>::compact(container, kept);
+        set_dirty();
+    }
+
     inline void clear() override {
         container.clear();
         set_dirty();
@@ -312,7 +450,38 @@ struct property_vector : public base_property {
         set_dirty();
     }
 
-    inline void set_dirty() override { dirty = true; }
+    inline void set_arena(const std::shared_ptr<AlignedArena> &arena) override {
+        auto other = property_storage<T>::make(arena);
+        other.reserve(container.capacity());
+        other.insert(other.end(), container.begin(), container.end());
+        container = std::move(other);
+    }
+
+    [[nodiscard]] inline const void *raw_data() const override {
+        return is_raw_copyable<T>::value ? (const void *) container.data() : nullptr;
+    }
+
+    [[nodiscard]] inline void *raw_data() override {
+        return is_raw_copyable<T>::value && !std::is_same<T, bool>::value ? (void *) container.data() : nullptr;
+    }
+
+    [[nodiscard]] inline size_t raw_size_bytes() const override {
+        return is_raw_copyable<T>::value ? property_storage<T>::raw_size_bytes(container) : 0;
+    }
+
+    inline bool assign_raw(const void *data, size_t n) override {
+        if constexpr (is_raw_copyable<T>::value) {
+            property_storage<T>::assign_raw(container, data, n);
+            set_dirty();
+            return true;
+        }
+        return false;
+    }
+
+    inline void set_dirty() override {
+        dirty = true;
+        ++num_changes;
+    }
 
     inline void set_clean() override { dirty = false; }
 
@@ -332,6 +501,8 @@ struct property_vector : public base_property {
 
     [[nodiscard]] inline bool is_dirty() const override { return dirty; }
 
+    [[nodiscard]] inline size_t version() const override { return num_changes; }
+
     [[nodiscard]] inline property_types::Type type() const override {
         return property_types::get_property_type(data());
     }
@@ -344,9 +515,9 @@ struct property_vector : public base_property {
 
     [[nodiscard]] inline const_reference_t operator[](size_t i) const { return container[i]; }
 
-    [[nodiscard]] inline T &back() { return container.back(); }
+    [[nodiscard]] inline reference_t back() { return container.back(); }
 
-    [[nodiscard]] inline const T &back() const { return container.back(); }
+    [[nodiscard]] inline const_reference_t back() const { return container.back(); }
 
     [[nodiscard]] inline iterator_t begin() { return container.begin(); }
 
@@ -356,15 +527,16 @@ struct property_vector : public base_property {
 
     [[nodiscard]] inline const_iterator_t end() const { return container.end(); }
 
-    [[nodiscard]] inline std::vector<T> &vector() { return container; }
+    [[nodiscard]] inline container_t &vector() { return container; }
 
-    [[nodiscard]] inline const std::vector<T> &vector() const { return container; }
+    [[nodiscard]] inline const container_t &vector() const { return container; }
 
 protected:
     std::string property_name;
     T default_value;
     bool dirty;
-    std::vector<T> container;
+    size_t num_changes;
+    container_t container;
 };
 
 // specialization for bool properties
@@ -386,16 +558,18 @@ struct property {
         return sptr != nullptr;
     }
 
-    bool set(const std::vector<T> &vector) {
+    template<typename Vector>
+    bool set(const Vector &vector) {
         if (*this) {
-            sptr->vector() = vector;
+            sptr->vector().assign(vector.begin(), vector.end());
             sptr->set_dirty();
             return true;
         }
         return false;
     }
 
-    bool append(const std::vector<T> &vector) {
+    template<typename Vector>
+    bool append(const Vector &vector) {
         if (*this) {
             sptr->vector().insert(sptr->end(), vector.begin(), vector.end());
             sptr->set_dirty();
@@ -408,6 +582,10 @@ struct property {
         return sptr->is_dirty();
     }
 
+    [[nodiscard]] inline size_t version() const {
+        return sptr->version();
+    }
+
     inline void set_dirty() {
         sptr->set_dirty();
     }
@@ -421,7 +599,7 @@ struct property {
     }
 
     void reset(T value) {
-        sptr->vector() = std::vector<T>(sptr->size(), value);
+        sptr->vector().assign(sptr->size(), value);
         sptr->set_dirty();
     }
 
@@ -446,19 +624,19 @@ struct property {
     }
 
     [[nodiscard]] inline size_t size() const {
-        return std::const_pointer_cast<const property_vector<T, N>>(sptr)->size();
+        return static_cast<const property_vector<T, N> &>(*sptr).size();
     }
 
     [[nodiscard]] inline size_t size_bytes() const {
-        return std::const_pointer_cast<const property_vector<T, N>>(sptr)->size_bytes();
+        return static_cast<const property_vector<T, N> &>(*sptr).size_bytes();
     }
 
     [[nodiscard]] inline size_t capacity() const {
-        return std::const_pointer_cast<const property_vector<T, N>>(sptr)->capacity();
+        return static_cast<const property_vector<T, N> &>(*sptr).capacity();
     }
 
     [[nodiscard]] inline bool empty() const {
-        return std::const_pointer_cast<const property_vector<T, N>>(sptr)->empty();
+        return static_cast<const property_vector<T, N> &>(*sptr).empty();
     }
 
     inline void reset_ptr() {
@@ -466,7 +644,7 @@ struct property {
     }
 
     [[nodiscard]] const void *void_ptr() const {
-        return std::const_pointer_cast<const property_vector<T, N>>(sptr)->void_ptr();
+        return static_cast<const property_vector<T, N> &>(*sptr).void_ptr();
     }
 
     [[nodiscard]] inline T *data() {
@@ -474,7 +652,7 @@ struct property {
     }
 
     [[nodiscard]] inline const T *data() const {
-        return std::const_pointer_cast<const property_vector<T, N>>(sptr)->data();
+        return static_cast<const property_vector<T, N> &>(*sptr).data();
     }
 
     [[nodiscard]] inline reference_t operator[](size_t i) {
@@ -482,7 +660,7 @@ struct property {
     }
 
     [[nodiscard]] inline const_reference_t operator[](size_t i) const {
-        return std::const_pointer_cast<const property_vector<T, N>>(sptr)->operator[](i);
+        return static_cast<const property_vector<T, N> &>(*sptr)[i];
     }
 
     [[nodiscard]] inline reference_t operator[](base_handle handle) {
@@ -490,15 +668,15 @@ struct property {
     }
 
     [[nodiscard]] inline const_reference_t operator[](base_handle handle) const {
-        return std::const_pointer_cast<const property_vector<T, N>>(sptr)->operator[](handle.idx);
+        return static_cast<const property_vector<T, N> &>(*sptr)[handle.idx];
     }
 
-    [[nodiscard]] inline T &back() {
+    [[nodiscard]] inline reference_t back() {
         return sptr->back();
     }
 
-    [[nodiscard]]  inline const T &back() const {
-        return std::const_pointer_cast<const property_vector<T, N>>(sptr)->back();
+    [[nodiscard]]  inline const_reference_t back() const {
+        return static_cast<const property_vector<T, N> &>(*sptr).back();
     }
 
     [[nodiscard]] inline iterator_t begin() {
@@ -510,19 +688,19 @@ struct property {
     }
 
     [[nodiscard]] inline const_iterator_t begin() const {
-        return std::const_pointer_cast<const property_vector<T, N>>(sptr)->begin();
+        return static_cast<const property_vector<T, N> &>(*sptr).begin();
     }
 
     [[nodiscard]] inline const_iterator_t end() const {
-        return std::const_pointer_cast<const property_vector<T, N>>(sptr)->end();
+        return static_cast<const property_vector<T, N> &>(*sptr).end();
     }
 
-    [[nodiscard]] inline std::vector<T> &vector() {
+    [[nodiscard]] inline typename property_vector<T, N>::container_t &vector() {
         return sptr->vector();
     }
 
-    [[nodiscard]] inline const std::vector<T> &vector() const {
-        return std::const_pointer_cast<const property_vector<T, N>>(sptr)->vector();
+    [[nodiscard]] inline const typename property_vector<T, N>::container_t &vector() const {
+        return static_cast<const property_vector<T, N> &>(*sptr).vector();
     }
 
     [[nodiscard]] inline std::shared_ptr<base_property> shared_ptr() {
@@ -613,13 +791,10 @@ struct property_iterator {
                                const Container *container = nullptr,
                                property<bool, 1> deleted = {}) : handle(handle),
                                                                  deleted(deleted),
+                                                                 mask(deleted ? &deleted.vector() : nullptr),
                                                                  container(container) {
         if (container) {
-            if (deleted) {
-                while (container->is_valid(handle) && deleted[handle]) {
-                    ++handle;
-                }
-            }
+            skip_deleted();
         }
     }
 
@@ -637,9 +812,7 @@ struct property_iterator {
 
     inline property_iterator &operator++() {
         ++handle;
-        while (deleted && container->is_valid(handle) && deleted[handle]) {
-            ++handle;
-        }
+        skip_deleted();
         return *this;
     }
 
@@ -653,22 +826,44 @@ struct property_iterator {
     }
 
 private:
+    // jumps over runs of deleted elements a word at a time. Without garbage this is a plain index range.
+    inline void skip_deleted() {
+        if (mask && mask->maybe_any() && handle.idx < mask->size() && mask->test(handle.idx)) {
+            handle = Handle(mask->find_next_unset(handle.idx));
+        }
+    }
+
     Handle handle;
     property<bool, 1> deleted;
+    const BitVector *mask;
     const Container *container;
 };
 
+template<typename T, int N>
+struct property_key {
+    // slot of the property in its container and the stamp of the insertion it was resolved to, so that a key to
+    // a removed property never resolves to a different one that reuses the slot.
+    size_t index = BCG_INVALID_ID;
+    size_t stamp = 0;
+
+    inline operator bool() const {
+        return index != BCG_INVALID_ID;
+    }
+};
+
 struct property_container {
     std::string name;
     std::unordered_map<std::string, std::shared_ptr<base_property>> container;
 
-    property_container() : name("property_container") {}
+    property_container() : name("property_container"), deleted_name("deleted") {}
 
-    explicit property_container(std::string name) : name(std::move(name)) {}
+    explicit property_container(std::string name, std::string deleted_name = "deleted") : name(std::move(name)),
+                                                                                           deleted_name(std::move(
+                                                                                                   deleted_name)) {}
 
     void link(property_container &other) {
         for (const auto &item : other.container) {
-            container[item.first] = item.second;
+            insert(item.first, item.second);
         }
 
         if (has("v_connectivity")) {
@@ -684,11 +879,47 @@ struct property_container {
     };
 
     [[nodiscard]] inline Iterator begin() const {
-        return Iterator(base_handle(0), get<bool, 1>("deleted"), this);
+        return Iterator(base_handle(0), deleted, this);
     }
 
     [[nodiscard]] inline Iterator end() const {
-        return Iterator(base_handle(size()), get<bool, 1>("deleted"), this);
+        return Iterator(base_handle(size()), deleted, this);
+    }
+
+    // resolves name and type once, afterwards get(key) is a bounds and identity check without hashing or rtti.
+    template<typename T, int N>
+    property_key<T, N> key(const std::string &name) const {
+        auto iter = container.find(name);
+        if (iter == container.end() || !std::dynamic_pointer_cast<property_vector<T, N>>(iter->second)) {
+            return property_key<T, N>();
+        }
+        auto index = slot_of(iter->second.get());
+        return {index, slots[index].stamp};
+    }
+
+    template<typename T, int N>
+    property_key<T, N> key(const property<T, N> &prop) const {
+        if (!prop) {
+            return property_key<T, N>();
+        }
+        auto index = slot_of(prop.sptr.get());
+        if (index == BCG_INVALID_ID) {
+            return property_key<T, N>();
+        }
+        return {index, slots[index].stamp};
+    }
+
+    template<typename T, int N>
+    bool has(const property_key<T, N> &key) const {
+        return key && key.index < slots.size() && slots[key.index].stamp == key.stamp && slots[key.index].sptr;
+    }
+
+    template<typename T, int N>
+    property<T, N> get(const property_key<T, N> &key) const {
+        if (!has(key)) {
+            return property<T, N>();
+        }
+        return std::static_pointer_cast<property_vector<T, N>>(slots[key.index].sptr);
     }
 
     template<typename T, int N>
@@ -715,7 +946,7 @@ struct property_container {
         if (iter != container.end()) {
             return property<T, N>();
         }
-        auto sptr = std::make_shared<property_vector<T, N>>(name, t);
+        auto sptr = std::make_shared<property_vector<T, N>>(name, t, arena);
         auto n = size();
         if (n > 0) {
             sptr->reserve(n);
@@ -723,8 +954,8 @@ struct property_container {
                 sptr->push_back();
             }
         }
-        container[name] = sptr;
-        return std::dynamic_pointer_cast<property_vector<T, N>>(sptr);
+        insert(name, sptr);
+        return property<T, N>(sptr);
     }
 
     template<typename T, int N>
@@ -733,8 +964,8 @@ struct property_container {
         if (iter != container.end()) {
             return std::dynamic_pointer_cast<property_vector<T, N>>(iter->second);
         }
-        container[other.name()] = other.shared_ptr();
-        return std::dynamic_pointer_cast<property_vector<T, N>>(container[other.name()]);
+        insert(other.name(), other.shared_ptr());
+        return other;
     }
 
     template<typename T, int N>
@@ -763,8 +994,28 @@ struct property_container {
     inline void remove(const std::string &name) {
         auto iter = container.find(name);
         if (iter != container.end()) {
+            auto index = slot_of(iter->second.get());
+            if (index != BCG_INVALID_ID) {
+                slots[index].sptr.reset();
+            }
             container.erase(iter);
+            if (name == deleted_name) {
+                deleted = property<bool, 1>();
+            }
+        }
+    }
+
+    inline bool rename(const std::string &old_name, const std::string &new_name) {
+        auto iter = container.find(old_name);
+        if (iter == container.end() || old_name == new_name || has(new_name)) {
+            return false;
         }
+        auto sptr = iter->second;
+        container.erase(iter);
+        sptr->set_name(new_name);
+        container[new_name] = sptr;
+        update_deleted();
+        return true;
     }
 
     template<typename T, int N>
@@ -777,42 +1028,90 @@ struct property_container {
 
     inline void remove_all() {
         container.clear();
+        slots.clear();
+        deleted = property<bool, 1>();
     }
 
     inline void swap(size_t i0, size_t i1) {
-        std::for_each(container.begin(), container.end(), [i0, i1](auto &p) {
-            p.second->swap(i0, i1);
+        for (const auto &p : slots) {
+            if (p.sptr) {
+                p.sptr->swap(i0, i1);
+            }
+        }
+    }
+
+    // keeps the elements at the increasing indices kept, in their order. One gather per property, properties and
+    // ranges of elements run in parallel.
+    inline void compact(const std::vector<handle_index_t> &kept) {
+        tbb::parallel_for(size_t(0), slots.size(), [&](size_t i) {
+            if (slots[i].sptr) {
+                slots[i].sptr->compact(kept);
+            }
         });
     }
 
     inline void clear() {
-        std::for_each(container.begin(), container.end(), [](auto &p) {
-            p.second->clear();
-        });
+        for (const auto &p : slots) {
+            if (p.sptr) {
+                p.sptr->clear();
+            }
+        }
     }
 
     inline void free_unused_memory() {
-        std::for_each(container.begin(), container.end(), [](auto &p) {
-            p.second->free_unused_memory();
-        });
+        for (const auto &p : slots) {
+            if (p.sptr) {
+                p.sptr->free_unused_memory();
+            }
+        }
+    }
+
+    // all properties added afterwards, and the existing ones, take their buffers from one arena. Reserving then
+    // costs a single allocation for the whole container.
+    inline void use_arena(bool huge_pages = false) {
+        arena = std::make_shared<AlignedArena>(huge_pages);
+        for (const auto &p : slots) {
+            if (p.sptr) {
+                p.sptr->set_arena(arena);
+            }
+        }
+    }
+
+    [[nodiscard]] inline const std::shared_ptr<AlignedArena> &get_arena() const {
+        return arena;
     }
 
     inline void reserve(size_t n) {
-        std::for_each(container.begin(), container.end(), [&n](auto &p) {
-            p.second->reserve(n);
-        });
+        if (arena) {
+            size_t bytes = 0;
+            for (const auto &p : slots) {
+                if (p.sptr && p.sptr->capacity() < n) {
+                    bytes += align_up(n * p.sptr->element_size_bytes());
+                }
+            }
+            arena->reserve(bytes);
+        }
+        for (const auto &p : slots) {
+            if (p.sptr) {
+                p.sptr->reserve(n);
+            }
+        }
     }
 
     inline void resize(size_t n) {
-        std::for_each(container.begin(), container.end(), [&n](auto &p) {
-            p.second->resize(n);
-        });
+        for (const auto &p : slots) {
+            if (p.sptr) {
+                p.sptr->resize(n);
+            }
+        }
     }
 
     inline void push_back() {
-        std::for_each(container.begin(), container.end(), [](auto &p) {
-            p.second->push_back();
-        });
+        for (const auto &p : slots) {
+            if (p.sptr) {
+                p.sptr->push_back();
+            }
+        }
     }
 
     [[nodiscard]] inline bool empty() const {
@@ -896,6 +1195,56 @@ struct property_container {
     [[nodiscard]] inline size_t num_properties() const {
         return container.size();
     }
+
+protected:
+    struct slot {
+        std::shared_ptr<base_property> sptr;
+        size_t stamp = 0;
+    };
+
+    // properties in insertion order, addressed by property_key. Freed slots are reused by later insertions.
+    std::vector<slot> slots;
+    size_t num_insertions = 0;
+    std::shared_ptr<AlignedArena> arena;
+    std::string deleted_name;
+    // the deleted flags are resolved whenever properties are added or removed, so that begin() and end() are
+    // free of lookups and safe to call concurrently.
+    property<bool, 1> deleted;
+
+    inline size_t slot_of(const base_property *ptr) const {
+        for (size_t i = 0; i < slots.size(); ++i) {
+            if (slots[i].sptr.get() == ptr) {
+                return i;
+            }
+        }
+        return BCG_INVALID_ID;
+    }
+
+    inline void insert(const std::string &name, const std::shared_ptr<base_property> &sptr) {
+        auto iter = container.find(name);
+        if (iter != container.end()) {
+            auto index = slot_of(iter->second.get());
+            if (index != BCG_INVALID_ID) {
+                slots[index].sptr.reset();
+            }
+        }
+        container[name] = sptr;
+        auto index = slot_of(nullptr);
+        if (index == BCG_INVALID_ID) {
+            slots.push_back({sptr, ++num_insertions});
+        } else {
+            slots[index] = {sptr, ++num_insertions};
+        }
+        if (name == deleted_name) {
+            update_deleted();
+        }
+    }
+
+    inline void update_deleted() {
+        auto iter = container.find(deleted_name);
+        deleted = iter == container.end() ? property<bool, 1>()
+                                           : std::dynamic_pointer_cast<property_vector<bool, 1>>(iter->second);
+    }
 };
 
 inline std::ostream &operator<<(std::ostream &stream, const property_container &container) {
@@ -910,7 +1259,10 @@ struct vertex_container : public property_container {
     /*using property_container::property_container;
 
     */
-    vertex_container() : property_container("vertices") {}
+    vertex_container() : property_container("vertices", "v_deleted") {}
+
+    // neighborhoods shared by the point cloud operators, see bcg_neighbors_cache.h
+    std::shared_ptr<neighbors_cache> neighborhoods;
 
     struct vertex_iterator : public property_iterator<vertex_iterator, vertex_handle, vertex_container> {
         explicit vertex_iterator(vertex_handle v = vertex_handle(),
@@ -920,16 +1272,16 @@ struct vertex_container : public property_container {
                                                                                                   std::move(deleted)) {}
     };
 
-    inline vertex_iterator begin() const { return vertex_iterator(0, get<bool, 1>("v_deleted"), this); }
+    inline vertex_iterator begin() const { return vertex_iterator(0, deleted, this); }
 
-    inline vertex_iterator end() const { return vertex_iterator(size(), get<bool, 1>("v_deleted"), this); }
+    inline vertex_iterator end() const { return vertex_iterator(size(), deleted, this); }
 };
 
 struct halfedge_container : public property_container {
     /*using property_container::property_container;
 
     */
-    halfedge_container() : property_container("halfedges") {}
+    halfedge_container() : property_container("halfedges", "h_deleted") {}
 
     struct halfedge_iterator : public property_iterator<halfedge_iterator, halfedge_handle, halfedge_container> {
         explicit halfedge_iterator(halfedge_handle h = halfedge_handle(),
@@ -938,16 +1290,16 @@ struct halfedge_container : public property_container {
                                                                                                       deleted) {}
     };
 
-    inline halfedge_iterator begin() const { return halfedge_iterator(0, get<bool, 1>("h_deleted"), this); }
+    inline halfedge_iterator begin() const { return halfedge_iterator(0, deleted, this); }
 
-    inline halfedge_iterator end() const { return halfedge_iterator(size(), get<bool, 1>("h_deleted"), this); }
+    inline halfedge_iterator end() const { return halfedge_iterator(size(), deleted, this); }
 };
 
 struct edge_container : public property_container {
     /*using property_container::property_container;
 
     */
-    edge_container() : property_container("edges") {}
+    edge_container() : property_container("edges", "e_deleted") {}
 
     struct edge_iterator : public property_iterator<edge_iterator, edge_handle, edge_container> {
         explicit edge_iterator(edge_handle e = edge_handle(),
@@ -956,16 +1308,16 @@ struct edge_container : public property_container {
                                                                                               std::move(deleted)) {}
     };
 
-    inline edge_iterator begin() const { return edge_iterator(0, get<bool, 1>("e_deleted"), this); }
+    inline edge_iterator begin() const { return edge_iterator(0, deleted, this); }
 
-    inline edge_iterator end() const { return edge_iterator(size(), get<bool, 1>("e_deleted"), this); }
+    inline edge_iterator end() const { return edge_iterator(size(), deleted, this); }
 };
 
 struct face_container : public property_container {
     /*using property_container::property_container;
 
     */
-    face_container() : property_container("faces") {}
+    face_container() : property_container("faces", "f_deleted") {}
 
     struct face_iterator : public property_iterator<face_iterator, face_handle, face_container> {
         explicit face_iterator(face_handle f = face_handle(),
@@ -974,11 +1326,60 @@ struct face_container : public property_container {
                                                                                               std::move(deleted)) {}
     };
 
-    inline face_iterator begin() const { return face_iterator(0, get<bool, 1>("f_deleted"), this); }
+    inline face_iterator begin() const { return face_iterator(0, deleted, this); }
 
-    inline face_iterator end() const { return face_iterator(size(), get<bool, 1>("f_deleted"), this); }
+    inline face_iterator end() const { return face_iterator(size(), deleted, this); }
 };
 
+// Indices of the elements not flagged in deleted, increasing. A prefix sum over the counts of blocks of words gives
+// each block its first output position, blocks are counted and written in parallel.
+inline std::vector<handle_index_t> kept_indices(const BitVector &deleted) {
+    constexpr size_t block_words = 1 << 10;
+    size_t num_blocks = (deleted.num_words() + block_words - 1) / block_words;
+    std::vector<size_t> offsets(num_blocks + 1, 0);
+    auto kept_word = [&deleted](size_t w) {
+        BitVector::word_t word = ~deleted.data()[w];
+        size_t bits = deleted.size() - w * BitVector::word_bits;
+        return bits < BitVector::word_bits ? word & ~(~BitVector::word_t(0) << bits) : word;
+    };
+    tbb::parallel_for(size_t(0), num_blocks, [&](size_t b) {
+        size_t count = 0;
+        for (size_t w = b * block_words; w < std::min(deleted.num_words(), (b + 1) * block_words); ++w) {
+            count += COUNTSETBITS(kept_word(w));
+        }
+        offsets[b + 1] = count;
+    });
+    for (size_t b = 0; b < num_blocks; ++b) {
+        offsets[b + 1] += offsets[b];
+    }
+    std::vector<handle_index_t> kept(offsets.back());
+    tbb::parallel_for(size_t(0), num_blocks, [&](size_t b) {
+        size_t out = offsets[b];
+        for (size_t w = b * block_words; w < std::min(deleted.num_words(), (b + 1) * block_words); ++w) {
+            for (auto word = kept_word(w); word != 0; word &= word - 1) {
+                kept[out++] = handle_index_t(w * BitVector::word_bits + ctz(word));
+            }
+        }
+    });
+    return kept;
+}
+
+// new index of each of size elements after compacting to kept, BCG_INVALID_HANDLE_ID for removed ones
+inline std::vector<handle_index_t> compaction_map(const std::vector<handle_index_t> &kept, size_t size) {
+    std::vector<handle_index_t> map(size, BCG_INVALID_HANDLE_ID);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, kept.size(), 1 << 14), [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i != range.end(); ++i) {
+            map[kept[i]] = handle_index_t(i);
+        }
+    });
+    return map;
+}
+
+// maps an index with compaction_map, invalid ones stay invalid
+inline handle_index_t map_index(const std::vector<handle_index_t> &map, handle_index_t index) {
+    return index < map.size() ? map[index] : BCG_INVALID_HANDLE_ID;
+}
+
 }
 
 #endif //BCG_GRAPHICS_BCG_PROPERTY_H
@@ -0,0 +1,582 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <cstdio>
+#include <cmath>
+#include <functional>
+#include "bcg_property_io.h"
+#include "math/vector/bcg_vector.h"
+#include "geometry/aligned_box/bcg_aligned_box.h"
+#include "utils/bcg_mapped_file.h"
+#include "utils/bcg_delta_coding.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace bcg {
+
+namespace {
+
+struct column_entry {
+    std::string name;
+    uint32_t type = 0;
+    uint32_t dims = 0;
+    uint64_t element_size = 0;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    uint32_t encoding = 0;
+};
+
+// how a payload is stored, see property_file_compression
+enum column_encoding : uint32_t {
+    RAW = 0, DELTA = 1, QUANTIZED_POSITIONS = 2
+};
+
+// prefix of QUANTIZED_POSITIONS payloads, followed by the delta coded quantized coordinates
+struct quantization {
+    double min[3];
+    double step[3];
+};
+
+struct container_entry {
+    std::string name;
+    uint64_t size = 0;
+    std::vector<column_entry> columns;
+};
+
+constexpr uint64_t payload_alignment = 64;
+
+inline uint64_t align_payload(uint64_t offset) {
+    return (offset + payload_alignment - 1) / payload_alignment * payload_alignment;
+}
+
+template<typename T>
+void append(std::string &buffer, const T &value) {
+    buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+void append(std::string &buffer, const std::string &value) {
+    append(buffer, uint32_t(value.size()));
+    buffer.append(value);
+}
+
+// bounds checked reading of the table of contents
+struct toc_reader {
+    const char *pen, *end;
+
+    template<typename T>
+    bool read(T &value) {
+        if (size_t(end - pen) < sizeof(T)) return false;
+        std::memcpy(&value, pen, sizeof(T));
+        pen += sizeof(T);
+        return true;
+    }
+
+    bool read(std::string &value) {
+        uint32_t length = 0;
+        if (!read(length) || size_t(end - pen) < length) return false;
+        value.assign(pen, length);
+        pen += length;
+        return true;
+    }
+};
+
+template<typename S>
+std::shared_ptr<base_property> add_column(property_container &container, const std::string &name, size_t dims,
+                                          size_t element_size) {
+    if (element_size % sizeof(S) != 0) return nullptr;
+    size_t components = element_size / sizeof(S);
+    if (components == 1 && dims == 1) return container.add<S, 1>(name).shared_ptr();
+    if (components == dims) {
+        switch (dims) {
+            case 2:
+                return container.add<Vector<S, 2>, 2>(name).shared_ptr();
+            case 3:
+                return container.add<Vector<S, 3>, 3>(name).shared_ptr();
+            case 4:
+                return container.add<Vector<S, 4>, 4>(name).shared_ptr();
+            case 5:
+                return container.add<Vector<S, 5>, 5>(name).shared_ptr();
+            case 6:
+                return container.add<Vector<S, 6>, 6>(name).shared_ptr();
+            default:
+                return nullptr;
+        }
+    }
+    if (dims == 1) {
+        switch (components) {
+            case 4:
+                return container.add<Matrix<S, 2, 2>, 1>(name).shared_ptr();
+            case 9:
+                return container.add<Matrix<S, 3, 3>, 1>(name).shared_ptr();
+            case 16:
+                return container.add<Matrix<S, 4, 4>, 1>(name).shared_ptr();
+            default:
+                return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<base_property> add_column(property_container &container, const column_entry &column) {
+    switch (property_types::Type(column.type)) {
+        case property_types::Type::BOOL:
+            return column.dims == 1 ? container.add<bool, 1>(column.name).shared_ptr() : nullptr;
+        case property_types::Type::FLOAT:
+            return add_column<float>(container, column.name, column.dims, column.element_size);
+        case property_types::Type::DOUBLE:
+            return add_column<double>(container, column.name, column.dims, column.element_size);
+        case property_types::Type::INT:
+            return add_column<int>(container, column.name, column.dims, column.element_size);
+        case property_types::Type::UNSIGNED_INT:
+            return add_column<unsigned int>(container, column.name, column.dims, column.element_size);
+        case property_types::Type::LONG:
+            return add_column<long>(container, column.name, column.dims, column.element_size);
+        case property_types::Type::UNSIGNED_LONG:
+            return add_column<unsigned long>(container, column.name, column.dims, column.element_size);
+        default:
+            return nullptr;
+    }
+}
+
+inline uint64_t spread_bits(uint64_t x) {
+    x &= 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffff;
+    x = (x | x << 16) & 0x1f0000ff0000ff;
+    x = (x | x << 8) & 0x100f00f00f00f00f;
+    x = (x | x << 4) & 0x10c30c30c30c30c3;
+    x = (x | x << 2) & 0x1249249249249249;
+    return x;
+}
+
+// element order along a morton curve through the bounding box, so that consecutive points are close
+std::vector<bcg_index_t> morton_order(const property<VectorS<3>, 3> &positions) {
+    aligned_box3 aabb(positions.vector());
+    VectorS<3> scale = VectorS<3>::Constant(bcg_scalar_t((1 << 21) - 1)).cwiseQuotient(
+            aabb.diagonal().cwiseMax(VectorS<3>::Constant(scalar_eps)));
+    std::vector<std::pair<uint64_t, bcg_index_t>> codes(positions.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, codes.size(), 1 << 16), [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i != range.end(); ++i) {
+            VectorS<3> cell = (positions[i] - aabb.min).cwiseProduct(scale);
+            codes[i] = {spread_bits(uint64_t(cell[0])) | spread_bits(uint64_t(cell[1])) << 1 |
+                        spread_bits(uint64_t(cell[2])) << 2, bcg_index_t(i)};
+        }
+    });
+    tbb::parallel_sort(codes.begin(), codes.end());
+    std::vector<bcg_index_t> order(codes.size());
+    for (size_t i = 0; i < codes.size(); ++i) {
+        order[i] = codes[i].second;
+    }
+    return order;
+}
+
+// raw bytes of the property with its elements in the given order
+std::string gather(const base_property &prop, const std::vector<bcg_index_t> &order) {
+    std::string buffer(prop.raw_size_bytes(), '\0');
+    const char *data = static_cast<const char *>(prop.raw_data());
+    if (prop.type() == property_types::Type::BOOL) {
+        // 64 bit words of a bitset
+        auto *words = reinterpret_cast<uint64_t *>(&buffer[0]);
+        for (size_t i = 0; i < order.size(); ++i) {
+            uint64_t word;
+            std::memcpy(&word, data + order[i] / 64 * sizeof(uint64_t), sizeof(word));
+            words[i / 64] |= ((word >> (order[i] % 64)) & 1u) << (i % 64);
+        }
+        return buffer;
+    }
+    size_t element_size = prop.element_size_bytes();
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, order.size(), 1 << 16), [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i != range.end(); ++i) {
+            std::memcpy(&buffer[i * element_size], data + order[i] * element_size, element_size);
+        }
+    });
+    return buffer;
+}
+
+// integers and connectivity, stored as 32-bit lanes
+bool is_index_like(const base_property &prop) {
+    switch (prop.type()) {
+        case property_types::Type::INT:
+        case property_types::Type::UNSIGNED_INT:
+        case property_types::Type::LONG:
+        case property_types::Type::UNSIGNED_LONG:
+        case property_types::Type::UNKNOWN:
+            return prop.element_size_bytes() % sizeof(uint32_t) == 0 && prop.size() > 0;
+        default:
+            return false;
+    }
+}
+
+std::string encode_quantized(const VectorS<3> *points, size_t count, unsigned int bits) {
+    aligned_box3 aabb;
+    for (size_t i = 0; i < count; ++i) {
+        aabb.grow(points[i]);
+    }
+    quantization prefix{};
+    for (int j = 0; j < 3; ++j) {
+        prefix.min[j] = count > 0 ? double(aabb.min[j]) : 0.0;
+        double extent = count > 0 ? double(aabb.max[j]) - prefix.min[j] : 0.0;
+        prefix.step[j] = extent > 0 ? extent / double((uint64_t(1) << bits) - 1) : 1.0;
+    }
+    std::vector<uint32_t> cells(count * 3);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, count, 1 << 16), [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i != range.end(); ++i) {
+            for (int j = 0; j < 3; ++j) {
+                cells[i * 3 + j] = uint32_t(std::llround((double(points[i][j]) - prefix.min[j]) / prefix.step[j]));
+            }
+        }
+    });
+    std::string encoded(reinterpret_cast<const char *>(&prefix), sizeof(prefix));
+    encoded += delta_encode(cells.data(), count, 3);
+    return encoded;
+}
+
+// decodes or copies the payload of a column into prop, resized to count elements
+bool read_column(const char *payload, const column_entry &column, size_t count, base_property &prop) {
+    switch (column.encoding) {
+        case RAW: {
+            size_t expected = column.type == uint32_t(property_types::Type::BOOL) ? (count + 63) / 64 * 8
+                                                                                   : count * column.element_size;
+            return column.size == expected && prop.assign_raw(payload, count);
+        }
+        case DELTA: {
+            size_t lanes = column.element_size / sizeof(uint32_t);
+            delta_coded_header header;
+            if (column.element_size % sizeof(uint32_t) != 0 ||
+                !delta_decode_header(payload, payload + column.size, header) || header.count != count ||
+                header.lanes != lanes) {
+                return false;
+            }
+            prop.resize(count);
+            auto *values = static_cast<char *>(prop.raw_data());
+            if (values == nullptr) return false;
+            prop.set_dirty();
+            return delta_decode(payload, payload + column.size, [&](size_t i, const uint32_t *lane_values) {
+                std::memcpy(values + i * column.element_size, lane_values, column.element_size);
+            });
+        }
+        case QUANTIZED_POSITIONS: {
+            quantization prefix{};
+            delta_coded_header header;
+            if (column.element_size != sizeof(VectorS<3>) || column.size < sizeof(prefix) ||
+                !delta_decode_header(payload + sizeof(prefix), payload + column.size, header) ||
+                header.count != count || header.lanes != 3) {
+                return false;
+            }
+            std::memcpy(&prefix, payload, sizeof(prefix));
+            prop.resize(count);
+            auto *points = static_cast<VectorS<3> *>(prop.raw_data());
+            if (points == nullptr) return false;
+            prop.set_dirty();
+            return delta_decode(payload + sizeof(prefix), payload + column.size, [&](size_t i, const uint32_t *cell) {
+                for (int j = 0; j < 3; ++j) {
+                    points[i][j] = bcg_scalar_t(prefix.min[j] + cell[j] * prefix.step[j]);
+                }
+            });
+        }
+        default:
+            return false;
+    }
+}
+
+// maps the file and reads its table of contents
+bool read_toc(const mapped_file &file, const std::string &filename, std::vector<container_entry> &entries) {
+    property_file_header header;
+    if (!file || file.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, file.begin(), sizeof(header));
+    if (std::memcmp(header.magic, property_file_header().magic, sizeof(header.magic)) != 0) {
+        return false;
+    }
+    if (header.version != 1 && header.version != property_file_header().version) {
+        std::cerr << filename << ": unsupported property file version " << header.version << "\n";
+        return false;
+    }
+    if (header.toc_offset > file.size() || header.toc_size > file.size() - header.toc_offset) {
+        return false;
+    }
+
+    toc_reader toc{file.begin() + header.toc_offset, file.begin() + header.toc_offset + header.toc_size};
+    entries.assign(header.num_containers, container_entry());
+    for (auto &entry : entries) {
+        uint64_t num_columns = 0;
+        if (!toc.read(entry.name) || !toc.read(entry.size) || !toc.read(num_columns)) {
+            return false;
+        }
+        for (uint64_t i = 0; i < num_columns; ++i) {
+            column_entry column;
+            if (!toc.read(column.name) || !toc.read(column.type) || !toc.read(column.dims) ||
+                !toc.read(column.element_size) || !toc.read(column.offset) || !toc.read(column.size) ||
+                (header.version > 1 && !toc.read(column.encoding))) {
+                return false;
+            }
+            if (column.offset > file.size() || column.size > file.size() - column.offset) {
+                return false;
+            }
+            entry.columns.push_back(std::move(column));
+        }
+    }
+    return true;
+}
+
+// writes payloads at 64-byte aligned offsets after the current end
+struct payload_writer {
+    FILE *out;
+    uint64_t written;
+    bool ok = true;
+
+    uint64_t write(const void *data, uint64_t size) {
+        const char zeros[payload_alignment] = {};
+        uint64_t offset = align_payload(written);
+        ok = ok && fwrite(zeros, 1, offset - written, out) == offset - written;
+        ok = ok && fwrite(data, 1, size, out) == size;
+        written = offset + size;
+        return offset;
+    }
+};
+
+// writes the payloads of the properties for which changed is true, or which have no column in entry yet, and sets
+// entry to the columns of the container. Columns of removed properties are dropped.
+void write_container(payload_writer &writer, const property_container &container,
+                     const property_file_compression &compression,
+                     const std::function<bool(const base_property &)> &changed, container_entry &entry) {
+    auto positions = container.get<VectorS<3>, 3>("v_position");
+    bool reorder = compression.morton_order && positions && positions.size() == container.size();
+    // the old payloads have a different size or element order
+    bool rewrite = entry.size != container.size() || (reorder && changed(*positions.shared_ptr()));
+
+    std::vector<column_entry> columns;
+    std::vector<const base_property *> pending;
+    for (const auto &item : container.properties()) {
+        const auto *prop = item.second.get();
+        if (prop->raw_data() == nullptr && prop->size() > 0) {
+            // not raw copyable
+            continue;
+        }
+        auto old = std::find_if(entry.columns.begin(), entry.columns.end(), [prop](const column_entry &column) {
+            return column.name == prop->name();
+        });
+        if (!rewrite && old != entry.columns.end() && !changed(*prop)) {
+            columns.push_back(*old);
+        } else {
+            pending.push_back(prop);
+        }
+    }
+
+    std::vector<bcg_index_t> order;
+    if (reorder && !pending.empty()) {
+        order = morton_order(positions);
+    }
+    for (const auto *prop : pending) {
+        column_entry column{prop->name(), uint32_t(prop->type()), uint32_t(prop->dims()),
+                            prop->element_size_bytes(), 0, prop->raw_size_bytes(), RAW};
+        std::string buffer;
+        const char *data = static_cast<const char *>(prop->raw_data());
+        if (!order.empty()) {
+            buffer = gather(*prop, order);
+            data = buffer.data();
+        }
+
+        std::string encoded;
+        if (compression.position_bits > 0 && positions && prop->name() == "v_position") {
+            encoded = encode_quantized(reinterpret_cast<const VectorS<3> *>(data), prop->size(),
+                                       std::min(compression.position_bits, 31u));
+            column.encoding = QUANTIZED_POSITIONS;
+        } else if (compression.delta_code && is_index_like(*prop)) {
+            encoded = delta_encode(reinterpret_cast<const uint32_t *>(data), prop->size(),
+                                   prop->element_size_bytes() / sizeof(uint32_t));
+            column.encoding = encoded.size() < column.size ? DELTA : RAW;
+        }
+        if (column.encoding != RAW) {
+            column.offset = writer.write(encoded.data(), encoded.size());
+            column.size = encoded.size();
+        } else {
+            column.offset = writer.write(data, column.size);
+        }
+        columns.push_back(std::move(column));
+    }
+    entry.size = container.size();
+    entry.columns = std::move(columns);
+}
+
+// flushes the stream and waits until its data reached the disk
+bool sync_file(FILE *out) {
+    if (fflush(out) != 0) return false;
+#ifdef _WIN32
+    return _commit(_fileno(out)) == 0;
+#elif defined(__APPLE__)
+    return fsync(fileno(out)) == 0;
+#else
+    return fdatasync(fileno(out)) == 0;
+#endif
+}
+
+// appends the table of contents and then overwrites the header, which makes the new contents visible at once
+bool write_toc(payload_writer &writer, const std::vector<container_entry> &entries) {
+    std::string toc;
+    for (const auto &entry : entries) {
+        append(toc, entry.name);
+        append(toc, entry.size);
+        append(toc, uint64_t(entry.columns.size()));
+        for (const auto &column : entry.columns) {
+            append(toc, column.name);
+            append(toc, column.type);
+            append(toc, column.dims);
+            append(toc, column.element_size);
+            append(toc, column.offset);
+            append(toc, column.size);
+            append(toc, column.encoding);
+        }
+    }
+    property_file_header header;
+    header.num_containers = uint32_t(entries.size());
+    header.toc_offset = writer.write(toc.data(), toc.size());
+    header.toc_size = toc.size();
+    // payloads and table of contents are on disk before the header points to them
+    writer.ok = writer.ok && sync_file(writer.out);
+    writer.ok = writer.ok && fseek(writer.out, 0, SEEK_SET) == 0 &&
+                fwrite(&header, sizeof(header), 1, writer.out) == 1;
+    writer.ok = writer.ok && sync_file(writer.out);
+    writer.ok = fclose(writer.out) == 0 && writer.ok;
+    return writer.ok;
+}
+
+}
+
+bool write_property_containers(const std::string &filename,
+                               const std::vector<const property_container *> &containers,
+                               const property_file_compression &compression) {
+    FILE *out = fopen(filename.c_str(), "wb");
+    if (!out) {
+        return false;
+    }
+    // the header is written last, when the table of contents is known
+    property_file_header header;
+    payload_writer writer{out, sizeof(header)};
+    writer.ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    std::vector<container_entry> entries;
+    for (const auto *container : containers) {
+        entries.push_back({container->name, container->size(), {}});
+        write_container(writer, *container, compression, [](const base_property &) { return true; },
+                        entries.back());
+    }
+    return write_toc(writer, entries);
+}
+
+bool read_property_containers(const std::string &filename, const std::vector<property_container *> &containers) {
+    mapped_file file(filename);
+    std::vector<container_entry> entries;
+    if (!read_toc(file, filename, entries)) {
+        return false;
+    }
+
+    for (auto *container : containers) {
+        auto entry = std::find_if(entries.begin(), entries.end(), [container](const container_entry &item) {
+            return item.name == container->name;
+        });
+        if (entry == entries.end()) {
+            continue;
+        }
+        for (const auto &column : entry->columns) {
+            auto prop = container->get_base_ptr(column.name);
+            if (prop == nullptr) {
+                auto sptr = add_column(*container, column);
+                prop = sptr.get();
+            }
+            if (prop == nullptr || uint32_t(prop->type()) != column.type || prop->dims() != column.dims ||
+                prop->element_size_bytes() != column.element_size) {
+                std::cerr << filename << ": skipped property " << column.name << ", unknown or different layout\n";
+                continue;
+            }
+            if (!read_column(file.begin() + column.offset, column, entry->size, *prop)) {
+                std::cerr << filename << ": skipped property " << column.name << "\n";
+            }
+        }
+        container->resize(entry->size);
+    }
+    return true;
+}
+
+bool read_property_container_sizes(const std::string &filename,
+                                   std::vector<std::pair<std::string, size_t>> &sizes) {
+    mapped_file file(filename);
+    std::vector<container_entry> entries;
+    if (!read_toc(file, filename, entries)) {
+        return false;
+    }
+    sizes.clear();
+    for (const auto &entry : entries) {
+        sizes.emplace_back(entry.name, entry.size);
+    }
+    return true;
+}
+
+property_checkpoint::property_checkpoint(std::string filename, const property_file_compression &compression)
+        : filename(std::move(filename)), compression(compression) {}
+
+bool property_checkpoint::save(const std::vector<const property_container *> &containers) {
+    std::vector<container_entry> entries;
+    if (saved.empty()) {
+        return compact(containers);
+    }
+    {
+        mapped_file file(filename);
+        if (!read_toc(file, filename, entries)) {
+            return compact(containers);
+        }
+    }
+    FILE *out = fopen(filename.c_str(), "r+b");
+    if (!out || fseek(out, 0, SEEK_END) != 0) {
+        if (out) fclose(out);
+        return false;
+    }
+    payload_writer writer{out, uint64_t(ftell(out))};
+    uint64_t start = writer.written;
+    for (const auto *container : containers) {
+        auto entry = std::find_if(entries.begin(), entries.end(), [container](const container_entry &item) {
+            return item.name == container->name;
+        });
+        if (entry == entries.end()) {
+            entry = entries.insert(entries.end(), {container->name, container->size(), {}});
+        }
+        write_container(writer, *container, compression, [&](const base_property &prop) {
+            return !is_saved(container->name, prop);
+        }, *entry);
+    }
+    if (!write_toc(writer, entries)) {
+        return false;
+    }
+    last_save_bytes = writer.written - start;
+    mark_saved(containers);
+    return true;
+}
+
+bool property_checkpoint::compact(const std::vector<const property_container *> &containers) {
+    if (!write_property_containers(filename, containers, compression)) {
+        return false;
+    }
+    last_save_bytes = mapped_file(filename).size();
+    saved.clear();
+    mark_saved(containers);
+    return true;
+}
+
+void property_checkpoint::mark_saved(const std::vector<const property_container *> &containers) {
+    for (const auto *container : containers) {
+        for (const auto &item : container->properties()) {
+            saved[{container->name, item.first}] = {item.second, item.second->version()};
+        }
+    }
+}
+
+bool property_checkpoint::is_saved(const std::string &container, const base_property &prop) const {
+    auto iter = saved.find({container, prop.name()});
+    return iter != saved.end() && iter->second.prop.lock().get() == &prop && iter->second.version == prop.version();
+}
+
+}
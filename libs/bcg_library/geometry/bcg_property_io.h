@@ -0,0 +1,96 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#ifndef BCG_GRAPHICS_BCG_PROPERTY_IO_H
+#define BCG_GRAPHICS_BCG_PROPERTY_IO_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "bcg_property.h"
+
+namespace bcg {
+
+// Native binary format storing whole property containers column by column:
+//
+//   header       property_file_header, at offset 0
+//   payloads     raw bytes of each property (base_property::raw_data), each starting at a 64-byte aligned offset
+//   toc          per container: name, size, number of columns. Per column: name, property_types::Type, dims,
+//                element size, offset and size of the payload, encoding (since version 2)
+//
+// Reading maps the file and copies each payload with one memcpy into the property storage. Containers are matched by
+// name, properties by name and layout. Missing properties are created for scalars, vectors and square matrices of the
+// scalar types in property_types, properties of other types (connectivity, ...) are only read into existing ones.
+// All numbers are stored in host byte order, element layouts are those of the writing build. Payloads can be compressed,
+// see property_file_compression, compressed ones are decoded in parallel blocks. Version 1 files have no encodings.
+struct property_file_header {
+    char magic[8] = {'B', 'C', 'G', 'P', 'R', 'O', 'P', '\0'};
+    uint32_t version = 2;
+    uint32_t num_containers = 0;
+    uint64_t toc_offset = 0;
+    uint64_t toc_size = 0;
+    uint8_t padding[32] = {};
+};
+
+static_assert(sizeof(property_file_header) == 64, "the header is one aligned block");
+
+struct property_file_compression {
+    // lossless, integer and connectivity properties as varint coded differences of consecutive elements (delta_encode)
+    bool delta_code = false;
+    // lossy, v_position quantized to this many bits per axis in its bounding box and delta coded. 0 stores it exactly.
+    unsigned int position_bits = 0;
+    // elements of containers with v_position are sorted along a morton curve first, which makes the position deltas
+    // small. Only for containers no other property refers to by index, like point cloud vertices.
+    bool morton_order = false;
+};
+
+bool write_property_containers(const std::string &filename, const std::vector<const property_container *> &containers,
+                               const property_file_compression &compression = {});
+
+// containers not in the file are left untouched. Returns false if the file is missing or not a valid property file.
+bool read_property_containers(const std::string &filename, const std::vector<property_container *> &containers);
+
+// name and size of each container in the file, reads only the table of contents
+bool read_property_container_sizes(const std::string &filename,
+                                   std::vector<std::pair<std::string, size_t>> &sizes);
+
+// Saves containers to one property file repeatedly, writing only the properties changed since the previous save. A
+// save appends their payloads and a new table of contents, unchanged properties keep referring to their earlier
+// payloads, so read_property_containers reads the latest version of each. The appended data is synced to disk before
+// the header is overwritten, so a save interrupted by a crash or power loss leaves the previous state readable. This
+// does not hold for compact() and the first save, which rewrite the file. Changes are detected by
+// base_property::version(), so writes through operator[] count once set_dirty() was called. The dirty flag itself is
+// cleaned by others, like the renderer after uploading to the gpu.
+struct property_checkpoint {
+    explicit property_checkpoint(std::string filename, const property_file_compression &compression = {});
+
+    // the first save writes the whole file, later ones append. Containers are matched by name.
+    bool save(const std::vector<const property_container *> &containers);
+
+    // rewrites the file without the payloads replaced by later saves
+    bool compact(const std::vector<const property_container *> &containers);
+
+    // records the current versions as saved, for containers just read from the file
+    void mark_saved(const std::vector<const property_container *> &containers);
+
+    std::string filename;
+    property_file_compression compression;
+    // bytes written to the file by the last save
+    size_t last_save_bytes = 0;
+
+private:
+    struct saved_property {
+        std::weak_ptr<base_property> prop;
+        size_t version = 0;
+    };
+
+    bool is_saved(const std::string &container, const base_property &prop) const;
+
+    // by container and property name
+    std::map<std::pair<std::string, std::string>, saved_property> saved;
+};
+
+}
+
+#endif //BCG_GRAPHICS_BCG_PROPERTY_IO_H
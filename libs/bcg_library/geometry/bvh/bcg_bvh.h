@@ -0,0 +1,206 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#ifndef BCG_GRAPHICS_BCG_BVH_H
+#define BCG_GRAPHICS_BCG_BVH_H
+
+#include <vector>
+#include <queue>
+#include <numeric>
+#include <algorithm>
+#include "tbb/tbb.h"
+#include "aligned_box/bcg_aligned_box.h"
+#include "bcg_neighbors_query.h"
+
+namespace bcg {
+
+// Bounding volume hierarchy over primitives with an extent (edges, faces). Primitives are given by id and bounding
+// box, queries take the exact squared distance of a primitive to the query point and return ids with squared
+// distances, sorted by distance. Moved primitives are handled by refit(), which keeps the topology.
+struct bvh {
+    struct node {
+        aligned_box3 box;
+        // inner nodes: children left and left + 1. leaves: ids [begin, end).
+        bcg_index_t left = 0;
+        bcg_index_t begin = 0, end = 0;
+
+        [[nodiscard]] inline bool is_leaf() const { return left == 0; }
+    };
+
+    std::vector<node> nodes;
+    std::vector<bcg_index_t> ids;
+    size_t leaf_size = 4;
+
+    // bounds(id) returns the aligned_box3 of primitive id.
+    template<typename Bounds>
+    void build(const std::vector<bcg_index_t> &primitives, Bounds &&bounds, size_t leaf_max_size = 4) {
+        leaf_size = std::max<size_t>(leaf_max_size, 1);
+        ids = primitives;
+        nodes.clear();
+        if (ids.empty()) {
+            return;
+        }
+        std::vector<aligned_box3> boxes(ids.size());
+        std::vector<VectorS<3>> centers(ids.size());
+        tbb::parallel_for(size_t(0), ids.size(), [&](size_t i) {
+            boxes[i] = bounds(ids[i]);
+            centers[i] = boxes[i].center();
+        });
+        std::vector<bcg_index_t> order(ids.size());
+        std::iota(order.begin(), order.end(), 0);
+        nodes.reserve(2 * (ids.size() / leaf_size + 1));
+        nodes.emplace_back();
+        build(0, 0, order.size(), order, boxes, centers);
+        std::vector<bcg_index_t> sorted(ids.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            sorted[i] = ids[order[i]];
+        }
+        ids.swap(sorted);
+    }
+
+    // recomputes all boxes after the primitives moved.
+    template<typename Bounds>
+    void refit(Bounds &&bounds) {
+        // children are stored after their parent, so a reverse sweep visits them first.
+        for (size_t i = nodes.size(); i-- > 0;) {
+            auto &nd = nodes[i];
+            if (nd.is_leaf()) {
+                nd.box = aligned_box3();
+                for (bcg_index_t j = nd.begin; j < nd.end; ++j) {
+                    nd.box = nd.box.merge(bounds(ids[j]));
+                }
+            } else {
+                nd.box = nodes[nd.left].box.merge(nodes[nd.left + 1].box);
+            }
+        }
+    }
+
+    [[nodiscard]] inline size_t size() const {
+        return ids.size();
+    }
+
+    // the k closest primitives. distance(id, point) returns the squared distance.
+    template<typename Distance>
+    neighbors_query query_knn(const VectorS<3> &point, size_t num_closest, Distance &&distance) const {
+        std::vector<std::pair<bcg_scalar_t, bcg_index_t>> heap;
+        num_closest = std::min(num_closest, ids.size());
+        if (num_closest == 0) {
+            return neighbors_query();
+        }
+        auto worst = [&]() {
+            return heap.size() < num_closest ? scalar_max : heap.front().first;
+        };
+        best_first(point, worst, [&](bcg_index_t id) {
+            bcg_scalar_t dist = distance(id, point);
+            if (dist < worst()) {
+                if (heap.size() == num_closest) {
+                    std::pop_heap(heap.begin(), heap.end());
+                    heap.pop_back();
+                }
+                heap.emplace_back(dist, id);
+                std::push_heap(heap.begin(), heap.end());
+            }
+        });
+        std::sort_heap(heap.begin(), heap.end());
+        return to_query(heap);
+    }
+
+    // all primitives with squared distance <= sqr_radius.
+    template<typename Distance>
+    neighbors_query query_radius(const VectorS<3> &point, bcg_scalar_t sqr_radius, Distance &&distance) const {
+        std::vector<std::pair<bcg_scalar_t, bcg_index_t>> items;
+        if (nodes.empty()) {
+            return neighbors_query();
+        }
+        std::vector<bcg_index_t> stack{0};
+        while (!stack.empty()) {
+            const auto &nd = nodes[stack.back()];
+            stack.pop_back();
+            if (sqr_distance(nd.box, point) > sqr_radius) {
+                continue;
+            }
+            if (!nd.is_leaf()) {
+                stack.push_back(nd.left);
+                stack.push_back(nd.left + 1);
+                continue;
+            }
+            for (bcg_index_t i = nd.begin; i < nd.end; ++i) {
+                bcg_scalar_t dist = distance(ids[i], point);
+                if (dist <= sqr_radius) {
+                    items.emplace_back(dist, ids[i]);
+                }
+            }
+        }
+        std::sort(items.begin(), items.end());
+        return to_query(items);
+    }
+
+    static inline bcg_scalar_t sqr_distance(const aligned_box3 &box, const VectorS<3> &point) {
+        return (box.min - point).cwiseMax(point - box.max).cwiseMax(0).squaredNorm();
+    }
+
+private:
+    void build(bcg_index_t id, size_t begin, size_t end, std::vector<bcg_index_t> &order,
+               const std::vector<aligned_box3> &boxes, const std::vector<VectorS<3>> &centers) {
+        aligned_box3 box, center_box;
+        for (size_t i = begin; i < end; ++i) {
+            box = box.merge(boxes[order[i]]);
+            center_box.grow(centers[order[i]]);
+        }
+        nodes[id].box = box;
+        if (end - begin <= leaf_size) {
+            nodes[id].begin = bcg_index_t(begin);
+            nodes[id].end = bcg_index_t(end);
+            return;
+        }
+        int axis;
+        center_box.diagonal().maxCoeff(&axis);
+        size_t mid = begin + (end - begin) / 2;
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                         [&](bcg_index_t a, bcg_index_t b) { return centers[a][axis] < centers[b][axis]; });
+        auto left = bcg_index_t(nodes.size());
+        nodes[id].left = left;
+        nodes.emplace_back();
+        nodes.emplace_back();
+        build(left, begin, mid, order, boxes, centers);
+        build(left + 1, mid, end, order, boxes, centers);
+    }
+
+    // visits leaves in order of their box distance until no box can beat worst().
+    template<typename Worst, typename Visit>
+    void best_first(const VectorS<3> &point, Worst &&worst, Visit &&visit) const {
+        using entry = std::pair<bcg_scalar_t, bcg_index_t>;
+        std::priority_queue<entry, std::vector<entry>, std::greater<>> queue;
+        if (!nodes.empty()) {
+            queue.emplace(sqr_distance(nodes[0].box, point), 0);
+        }
+        while (!queue.empty() && queue.top().first < worst()) {
+            const auto &nd = nodes[queue.top().second];
+            queue.pop();
+            if (nd.is_leaf()) {
+                for (bcg_index_t i = nd.begin; i < nd.end; ++i) {
+                    visit(ids[i]);
+                }
+            } else {
+                queue.emplace(sqr_distance(nodes[nd.left].box, point), nd.left);
+                queue.emplace(sqr_distance(nodes[nd.left + 1].box, point), nd.left + 1);
+            }
+        }
+    }
+
+    static neighbors_query to_query(const std::vector<std::pair<bcg_scalar_t, bcg_index_t>> &items) {
+        neighbors_query result;
+        result.indices.reserve(items.size());
+        result.distances.reserve(items.size());
+        for (const auto &item : items) {
+            result.distances.push_back(item.first);
+            result.indices.push_back(item.second);
+        }
+        return result;
+    }
+};
+
+}
+
+#endif //BCG_GRAPHICS_BCG_BVH_H
@@ -0,0 +1,544 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <cmath>
+#include <memory>
+#include <algorithm>
+#include "bcg_triangle_bvh.h"
+#include "tbb/tbb.h"
+
+namespace bcg {
+
+struct triangle_bvh::build_node {
+    aligned_box3 box;
+    size_t begin = 0, end = 0;
+    std::unique_ptr<build_node> children[2];
+};
+
+namespace {
+
+constexpr int num_bins = 16;
+// cost of visiting a node relative to testing one triangle
+constexpr bcg_scalar_t traversal_cost = 2.0;
+// below this depth nodes are split in the middle, which bounds the depth and the traversal stacks
+constexpr int max_sah_depth = 64;
+constexpr int stack_size = 128;
+
+inline bcg_scalar_t surface_area(const aligned_box3 &box) {
+    VectorS<3> d = box.diagonal().cwiseMax(0);
+    return 2 * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
+}
+
+inline bcg_scalar_t sqr_distance(const aligned_box3 &box, const VectorS<3> &point) {
+    return (box.min - point).cwiseMax(point - box.max).cwiseMax(0).squaredNorm();
+}
+
+// entry and exit of the ray into the box, empty if t_enter > t_exit
+inline std::pair<bcg_scalar_t, bcg_scalar_t> slab(const aligned_box3 &box, const VectorS<3> &origin,
+                                                  const VectorS<3> &inv_direction, bcg_scalar_t t_max) {
+    VectorS<3> t0 = (box.min - origin).cwiseProduct(inv_direction);
+    VectorS<3> t1 = (box.max - origin).cwiseProduct(inv_direction);
+    return {std::max<bcg_scalar_t>(t0.cwiseMin(t1).maxCoeff(), 0), std::min(t0.cwiseMax(t1).minCoeff(), t_max)};
+}
+
+struct bounds {
+    aligned_box3 box, centers;
+
+    void join(const bounds &other) {
+        box = box.merge(other.box);
+        centers = centers.merge(other.centers);
+    }
+};
+
+struct bins {
+    aligned_box3 boxes[num_bins];
+    size_t counts[num_bins] = {};
+
+    void join(const bins &other) {
+        for (int i = 0; i < num_bins; ++i) {
+            boxes[i] = boxes[i].merge(other.boxes[i]);
+            counts[i] += other.counts[i];
+        }
+    }
+};
+
+// runs func over [begin, end) in parallel for large ranges and joins the partial results
+template<typename T, typename Func>
+T reduce(size_t begin, size_t end, size_t parallel_grain_size, Func &&func) {
+    if (end - begin <= 8 * parallel_grain_size) {
+        T result;
+        func(begin, end, result);
+        return result;
+    }
+    return tbb::parallel_reduce(tbb::blocked_range<size_t>(begin, end, parallel_grain_size), T(),
+                                [&](const tbb::blocked_range<size_t> &range, T result) {
+                                    func(range.begin(), range.end(), result);
+                                    return result;
+                                }, [](T a, const T &b) {
+                a.join(b);
+                return a;
+            });
+}
+
+struct builder {
+    std::vector<bcg_index_t> &order;
+    const std::vector<aligned_box3> &boxes;
+    const std::vector<VectorS<3>> &centers;
+    size_t max_leaf_size;
+    size_t parallel_grain_size;
+
+    template<typename Node>
+    void build(Node &bn, int depth) const {
+        auto b = reduce<bounds>(bn.begin, bn.end, parallel_grain_size, [&](size_t begin, size_t end, bounds &result) {
+            for (size_t i = begin; i < end; ++i) {
+                result.box = result.box.merge(boxes[order[i]]);
+                result.centers.grow(centers[order[i]]);
+            }
+        });
+        bn.box = b.box;
+        size_t count = bn.end - bn.begin;
+        if (count <= 1) {
+            return;
+        }
+
+        int axis;
+        bcg_scalar_t extent = b.centers.diagonal().maxCoeff(&axis);
+        size_t mid = bn.begin;
+        if (extent > 0 && depth < max_sah_depth) {
+            bcg_scalar_t lower = b.centers.min[axis];
+            bcg_scalar_t factor = num_bins * (1 - 1e-6) / extent;
+            auto bin_of = [&](bcg_index_t i) {
+                return std::min(int((centers[i][axis] - lower) * factor), num_bins - 1);
+            };
+            auto binned = reduce<bins>(bn.begin, bn.end, parallel_grain_size,
+                                       [&](size_t begin, size_t end, bins &result) {
+                                           for (size_t i = begin; i < end; ++i) {
+                                               int bin = bin_of(order[i]);
+                                               result.boxes[bin] = result.boxes[bin].merge(boxes[order[i]]);
+                                               ++result.counts[bin];
+                                           }
+                                       });
+
+            // sweep from the right to get the cost of all right sides, then from the left
+            bcg_scalar_t right_cost[num_bins];
+            aligned_box3 right;
+            size_t right_count = 0;
+            for (int i = num_bins - 1; i > 0; --i) {
+                right = right.merge(binned.boxes[i]);
+                right_count += binned.counts[i];
+                right_cost[i] = surface_area(right) * right_count;
+            }
+            aligned_box3 left;
+            size_t left_count = 0;
+            bcg_scalar_t best_cost = scalar_max;
+            int best_split = -1;
+            for (int i = 1; i < num_bins; ++i) {
+                left = left.merge(binned.boxes[i - 1]);
+                left_count += binned.counts[i - 1];
+                if (left_count == 0 || left_count == count) continue;
+                bcg_scalar_t cost = surface_area(left) * left_count + right_cost[i];
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_split = i;
+                }
+            }
+
+            bcg_scalar_t area = surface_area(bn.box);
+            bcg_scalar_t leaf_cost = area * count;
+            best_cost += traversal_cost * area;
+            if (count <= max_leaf_size && leaf_cost <= best_cost) {
+                return;
+            }
+            if (best_split > 0) {
+                mid = std::partition(order.begin() + bn.begin, order.begin() + bn.end, [&](bcg_index_t i) {
+                    return bin_of(i) < best_split;
+                }) - order.begin();
+            }
+        } else if (count <= max_leaf_size) {
+            return;
+        }
+        if (extent == 0) {
+            axis = 0;
+        }
+        if (mid == bn.begin || mid == bn.end) {
+            // all centers in one bin, split in the middle
+            mid = bn.begin + count / 2;
+            std::nth_element(order.begin() + bn.begin, order.begin() + mid, order.begin() + bn.end,
+                             [&](bcg_index_t a, bcg_index_t b) { return centers[a][axis] < centers[b][axis]; });
+        }
+
+        for (auto &child : bn.children) {
+            child = std::make_unique<Node>();
+        }
+        bn.children[0]->begin = bn.begin;
+        bn.children[0]->end = mid;
+        bn.children[1]->begin = mid;
+        bn.children[1]->end = bn.end;
+        if (count > parallel_grain_size) {
+            tbb::parallel_invoke([&]() { build(*bn.children[0], depth + 1); },
+                                 [&]() { build(*bn.children[1], depth + 1); });
+        } else {
+            build(*bn.children[0], depth + 1);
+            build(*bn.children[1], depth + 1);
+        }
+    }
+};
+
+inline bool closer(const triangle_bvh::NearestNeighbor &a, const triangle_bvh::NearestNeighbor &b) {
+    return a.result.sqr_distance < b.result.sqr_distance;
+}
+
+// largest float <= x and smallest float >= x
+inline float round_down(bcg_scalar_t x) {
+    auto f = float(x);
+    return f > x ? std::nextafter(f, -std::numeric_limits<float>::infinity()) : f;
+}
+
+inline float round_up(bcg_scalar_t x) {
+    auto f = float(x);
+    return f < x ? std::nextafter(f, std::numeric_limits<float>::infinity()) : f;
+}
+
+}
+
+// the boxes are dequantized on the fly, per axis without temporaries since this runs for every visited node
+inline bcg_scalar_t triangle_bvh::node::sqr_distance(int child, const VectorS<3> &point) const {
+    bcg_scalar_t result = 0;
+    for (int i = 0; i < 3; ++i) {
+        bcg_scalar_t lo = bcg_scalar_t(origin[i]) + bcg_scalar_t(lower[child][i]) * bcg_scalar_t(scale[i]);
+        bcg_scalar_t hi = bcg_scalar_t(origin[i]) + bcg_scalar_t(upper[child][i]) * bcg_scalar_t(scale[i]);
+        bcg_scalar_t d = std::max<bcg_scalar_t>(std::max(lo - point[i], point[i] - hi), 0);
+        result += d * d;
+    }
+    return result;
+}
+
+inline std::pair<bcg_scalar_t, bcg_scalar_t> triangle_bvh::node::slab(int child, const VectorS<3> &origin,
+                                                                      const VectorS<3> &inv_direction,
+                                                                      bcg_scalar_t t_max) const {
+    bcg_scalar_t enter = 0, exit = t_max;
+    for (int i = 0; i < 3; ++i) {
+        bcg_scalar_t lo = bcg_scalar_t(this->origin[i]) + bcg_scalar_t(lower[child][i]) * bcg_scalar_t(scale[i]);
+        bcg_scalar_t hi = bcg_scalar_t(this->origin[i]) + bcg_scalar_t(upper[child][i]) * bcg_scalar_t(scale[i]);
+        bcg_scalar_t t0 = (lo - origin[i]) * inv_direction[i];
+        bcg_scalar_t t1 = (hi - origin[i]) * inv_direction[i];
+        enter = std::max(enter, std::min(t0, t1));
+        exit = std::min(exit, std::max(t0, t1));
+    }
+    return {enter, exit};
+}
+
+triangle_bvh::triangle_bvh(const halfedge_mesh &mesh, unsigned int max_leaf_size, size_t parallel_grain_size)
+        : size_faces(0), parallel_grain_size(parallel_grain_size) {
+    // collect triangles
+    std::vector<triangle3> triangles;
+    std::vector<face_handle> faces;
+    triangles.reserve(mesh.num_faces());
+    faces.reserve(mesh.num_faces());
+    for (const auto f : mesh.faces) {
+        auto vfit = mesh.get_vertices(f);
+        const VectorS<3> p0 = mesh.positions[*vfit];
+        const VectorS<3> p1 = mesh.positions[*(++vfit)];
+        const VectorS<3> p2 = mesh.positions[*(++vfit)];
+        triangles.emplace_back(p0, p1, p2);
+        faces.push_back(f);
+    }
+    size_faces = faces.size();
+    if (faces.empty()) {
+        return;
+    }
+
+    std::vector<aligned_box3> boxes(size_faces);
+    std::vector<VectorS<3>> centers(size_faces);
+    std::vector<bcg_index_t> order(size_faces);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, size_faces, parallel_grain_size),
+                      [&](const tbb::blocked_range<size_t> &range) {
+                          for (size_t i = range.begin(); i != range.end(); ++i) {
+                              aligned_box3 box;
+                              for (const auto &p : triangles[i].points) {
+                                  box.grow(p);
+                              }
+                              boxes[i] = box;
+                              centers[i] = box.center();
+                              order[i] = bcg_index_t(i);
+                          }
+                      });
+
+    build_node root;
+    root.begin = 0;
+    root.end = size_faces;
+    builder{order, boxes, centers, std::max<size_t>(max_leaf_size, 1), std::max<size_t>(parallel_grain_size, 1)}.build(
+            root, 0);
+    root_box = root.box;
+
+    nodes.reserve(2 * size_faces);
+    nodes.emplace_back();
+    flatten(root, 0, order, triangles, faces);
+}
+
+void triangle_bvh::flatten(const build_node &bn, bcg_index_t id, const std::vector<bcg_index_t> &order,
+                           const std::vector<triangle3> &triangles, const std::vector<face_handle> &faces) {
+    if (!bn.children[0]) {
+        size_t count = bn.end - bn.begin;
+        auto first = bcg_index_t(blocks.size());
+        nodes[id].index = first;
+        nodes[id].count = bcg_index_t((count + lane_width - 1) / lane_width);
+        blocks.resize(first + nodes[id].count);
+        for (size_t i = 0; i < nodes[id].count * lane_width; ++i) {
+            auto t = order[bn.begin + std::min(i, count - 1)];
+            auto &b = blocks[first + i / lane_width];
+            size_t lane = i % lane_width;
+            const auto &points = triangles[t].points;
+            VectorS<3> normal = (points[1] - points[0]).cross(points[2] - points[0]);
+            bcg_scalar_t length = normal.norm();
+            if (length > 0) {
+                normal /= length;
+            }
+            for (int k = 0; k < 3; ++k) {
+                for (int c = 0; c < 3; ++c) {
+                    b.points[k][c][lane] = points[k][c];
+                }
+                b.normals[k][lane] = normal[k];
+            }
+            b.faces[lane] = faces[t];
+        }
+        return;
+    }
+
+    // quantize the child boxes conservatively in the frame of this node
+    const aligned_box3 &box = bn.box;
+    auto &nd = nodes[id];
+    for (int i = 0; i < 3; ++i) {
+        nd.origin[i] = round_down(box.min[i]);
+        nd.scale[i] = round_up((box.max[i] - bcg_scalar_t(nd.origin[i])) / 255);
+        for (int child = 0; child < 2; ++child) {
+            const auto &child_box = bn.children[child]->box;
+            if (nd.scale[i] > 0) {
+                bcg_scalar_t lo = std::floor((child_box.min[i] - bcg_scalar_t(nd.origin[i])) / nd.scale[i]);
+                bcg_scalar_t hi = std::ceil((child_box.max[i] - bcg_scalar_t(nd.origin[i])) / nd.scale[i]);
+                // step once more if rounding of the division ended up inside the child box
+                if (nd.origin[i] + lo * nd.scale[i] > child_box.min[i]) lo -= 1;
+                if (nd.origin[i] + hi * nd.scale[i] < child_box.max[i]) hi += 1;
+                nd.lower[child][i] = std::uint8_t(std::clamp<bcg_scalar_t>(lo, 0, 255));
+                nd.upper[child][i] = std::uint8_t(std::clamp<bcg_scalar_t>(hi, 0, 255));
+            } else {
+                nd.lower[child][i] = nd.upper[child][i] = 0;
+            }
+        }
+    }
+
+    auto left = bcg_index_t(nodes.size());
+    nodes[id].index = left;
+    nodes.emplace_back();
+    nodes.emplace_back();
+    flatten(*bn.children[0], left, order, triangles, faces);
+    flatten(*bn.children[1], left + 1, order, triangles, faces);
+}
+
+//-----------------------------------------------------------------------------
+
+template<typename Bound, typename Visit>
+void triangle_bvh::visit_closest(const VectorS<3> &p, Bound &&bound, Visit &&visit) const {
+    if (nodes.empty()) {
+        return;
+    }
+
+    std::pair<bcg_scalar_t, bcg_index_t> stack[stack_size];
+    int size = 0;
+    stack[size++] = {sqr_distance(root_box, p), 0};
+    while (size > 0) {
+        auto[node_bound, id] = stack[--size];
+        if (node_bound >= bound()) {
+            continue;
+        }
+        const auto &nd = nodes[id];
+        if (!nd.is_leaf()) {
+            bcg_scalar_t d0 = nd.sqr_distance(0, p);
+            bcg_scalar_t d1 = nd.sqr_distance(1, p);
+            bcg_scalar_t current = bound();
+            // near child on top
+            if (d0 <= d1) {
+                if (d1 < current) stack[size++] = {d1, nd.index + 1};
+                if (d0 < current) stack[size++] = {d0, nd.index};
+            } else {
+                if (d0 < current) stack[size++] = {d0, nd.index};
+                if (d1 < current) stack[size++] = {d1, nd.index + 1};
+            }
+            continue;
+        }
+
+        for (bcg_index_t bi = nd.index; bi < nd.index + nd.count; ++bi) {
+            const auto &b = blocks[bi];
+            // the distance to the plane is a lower bound of the distance to the triangle
+            bcg_scalar_t plane[lane_width];
+            for (size_t l = 0; l < lane_width; ++l) {
+                bcg_scalar_t d = (p[0] - b.points[0][0][l]) * b.normals[0][l] +
+                                 (p[1] - b.points[0][1][l]) * b.normals[1][l] +
+                                 (p[2] - b.points[0][2][l]) * b.normals[2][l];
+                plane[l] = d * d;
+            }
+            for (size_t l = 0; l < lane_width; ++l) {
+                if (plane[l] >= bound() || (l > 0 && b.faces[l] == b.faces[l - 1])) {
+                    continue;
+                }
+                visit(triangle3(VectorS<3>(b.points[0][0][l], b.points[0][1][l], b.points[0][2][l]),
+                                VectorS<3>(b.points[1][0][l], b.points[1][1][l], b.points[1][2][l]),
+                                VectorS<3>(b.points[2][0][l], b.points[2][1][l], b.points[2][2][l])), b.faces[l]);
+            }
+        }
+    }
+}
+
+triangle_bvh::NearestNeighbor triangle_bvh::nearest(const VectorS<3> &p) const {
+    NearestNeighbor data;
+    data.tests = 0;
+    distance_point3_triangle3 distance;
+    visit_closest(p, [&]() { return data.result.sqr_distance; }, [&](const triangle3 &t, face_handle f) {
+        auto result = distance(p, t);
+        ++data.tests;
+        if (result.sqr_distance < data.result.sqr_distance) {
+            data.result = result;
+            data.face = f;
+        }
+    });
+    return data;
+}
+
+std::vector<triangle_bvh::NearestNeighbor> triangle_bvh::nearest_k(const VectorS<3> &p, size_t k) const {
+    std::vector<NearestNeighbor> heap;
+    k = std::min(k, size_faces);
+    if (k == 0) {
+        return heap;
+    }
+    heap.reserve(k);
+    distance_point3_triangle3 distance;
+    auto worst = [&]() { return heap.size() < k ? scalar_max : heap.front().result.sqr_distance; };
+    visit_closest(p, worst, [&](const triangle3 &t, face_handle f) {
+        NearestNeighbor item{distance(p, t), f, 1};
+        if (item.result.sqr_distance < worst()) {
+            if (heap.size() == k) {
+                std::pop_heap(heap.begin(), heap.end(), closer);
+                heap.pop_back();
+            }
+            heap.push_back(item);
+            std::push_heap(heap.begin(), heap.end(), closer);
+        }
+    });
+    std::sort_heap(heap.begin(), heap.end(), closer);
+    return heap;
+}
+
+std::vector<triangle_bvh::NearestNeighbor> triangle_bvh::nearest_radius(const VectorS<3> &p,
+                                                                        bcg_scalar_t radius) const {
+    std::vector<NearestNeighbor> items;
+    // faces at exactly radius are included
+    bcg_scalar_t bound = std::nextafter(radius * radius, scalar_max);
+    distance_point3_triangle3 distance;
+    visit_closest(p, [bound]() { return bound; }, [&](const triangle3 &t, face_handle f) {
+        NearestNeighbor item{distance(p, t), f, 1};
+        if (item.result.sqr_distance < bound) {
+            items.push_back(item);
+        }
+    });
+    std::sort(items.begin(), items.end(), closer);
+    return items;
+}
+
+std::vector<triangle_bvh::NearestNeighbor> triangle_bvh::nearest_batch(const std::vector<VectorS<3>> &points) const {
+    std::vector<NearestNeighbor> result(points.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, points.size(), parallel_grain_size),
+                      [&](const tbb::blocked_range<size_t> &range) {
+                          for (size_t i = range.begin(); i != range.end(); ++i) {
+                              result[i] = nearest(points[i]);
+                          }
+                      });
+    return result;
+}
+
+triangle_bvh::RayHit triangle_bvh::intersect(const VectorS<3> &origin, const VectorS<3> &direction,
+                                             bcg_scalar_t t_max) const {
+    RayHit hit;
+    hit.t = t_max;
+    if (nodes.empty()) {
+        return hit;
+    }
+
+    VectorS<3> inv_direction = direction.cwiseInverse();
+    std::pair<bcg_scalar_t, bcg_index_t> stack[stack_size];
+    int size = 0;
+    auto root = slab(root_box, origin, inv_direction, hit.t);
+    if (root.first <= root.second) {
+        stack[size++] = {root.first, 0};
+    }
+    while (size > 0) {
+        auto[enter, id] = stack[--size];
+        if (enter > hit.t) {
+            continue;
+        }
+        const auto &nd = nodes[id];
+        if (!nd.is_leaf()) {
+            auto s0 = nd.slab(0, origin, inv_direction, hit.t);
+            auto s1 = nd.slab(1, origin, inv_direction, hit.t);
+            bool h0 = s0.first <= s0.second, h1 = s1.first <= s1.second;
+            // near child on top
+            if (s0.first <= s1.first) {
+                if (h1) stack[size++] = {s1.first, nd.index + 1};
+                if (h0) stack[size++] = {s0.first, nd.index};
+            } else {
+                if (h0) stack[size++] = {s0.first, nd.index};
+                if (h1) stack[size++] = {s1.first, nd.index + 1};
+            }
+            continue;
+        }
+
+        for (bcg_index_t bi = nd.index; bi < nd.index + nd.count; ++bi) {
+            const auto &b = blocks[bi];
+            // Moeller-Trumbore on all lanes
+            bcg_scalar_t t[lane_width], u[lane_width], v[lane_width];
+            bool valid[lane_width];
+            for (size_t l = 0; l < lane_width; ++l) {
+                bcg_scalar_t e1[3], e2[3], s[3];
+                for (int c = 0; c < 3; ++c) {
+                    e1[c] = b.points[1][c][l] - b.points[0][c][l];
+                    e2[c] = b.points[2][c][l] - b.points[0][c][l];
+                    s[c] = origin[c] - b.points[0][c][l];
+                }
+                bcg_scalar_t pv[3] = {direction[1] * e2[2] - direction[2] * e2[1],
+                                      direction[2] * e2[0] - direction[0] * e2[2],
+                                      direction[0] * e2[1] - direction[1] * e2[0]};
+                bcg_scalar_t qv[3] = {s[1] * e1[2] - s[2] * e1[1],
+                                      s[2] * e1[0] - s[0] * e1[2],
+                                      s[0] * e1[1] - s[1] * e1[0]};
+                bcg_scalar_t det = e1[0] * pv[0] + e1[1] * pv[1] + e1[2] * pv[2];
+                bcg_scalar_t inv_det = det != 0 ? 1 / det : 0;
+                u[l] = (s[0] * pv[0] + s[1] * pv[1] + s[2] * pv[2]) * inv_det;
+                v[l] = (direction[0] * qv[0] + direction[1] * qv[1] + direction[2] * qv[2]) * inv_det;
+                t[l] = (e2[0] * qv[0] + e2[1] * qv[1] + e2[2] * qv[2]) * inv_det;
+                valid[l] = det != 0 && u[l] >= 0 && v[l] >= 0 && u[l] + v[l] <= 1 && t[l] >= 0;
+            }
+            for (size_t l = 0; l < lane_width; ++l) {
+                if (valid[l] && t[l] < hit.t) {
+                    hit.t = t[l];
+                    hit.barycentric_coords = VectorS<3>(1 - u[l] - v[l], u[l], v[l]);
+                    hit.face = b.faces[l];
+                }
+            }
+        }
+    }
+    return hit;
+}
+
+std::vector<triangle_bvh::RayHit> triangle_bvh::intersect_batch(const std::vector<VectorS<3>> &origins,
+                                                                const std::vector<VectorS<3>> &directions) const {
+    std::vector<RayHit> result(origins.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, origins.size(), parallel_grain_size),
+                      [&](const tbb::blocked_range<size_t> &range) {
+                          for (size_t i = range.begin(); i != range.end(); ++i) {
+                              result[i] = intersect(origins[i], directions[i]);
+                          }
+                      });
+    return result;
+}
+
+}
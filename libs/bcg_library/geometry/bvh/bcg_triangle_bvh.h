@@ -0,0 +1,109 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#ifndef BCG_GRAPHICS_BCG_TRIANGLE_BVH_H
+#define BCG_GRAPHICS_BCG_TRIANGLE_BVH_H
+
+#include <cstdint>
+#include "mesh/bcg_mesh.h"
+#include "aligned_box/bcg_aligned_box.h"
+#include "distance_query/bcg_distance_triangle_point.h"
+
+namespace bcg {
+
+// Bounding volume hierarchy over the triangles of a mesh, built top down with the surface area heuristic. Nodes live
+// in one array, children are stored next to each other and their boxes are quantized to 8 bit in the frame of the
+// parent. Leaf triangles are stored in blocks of lane_width triangles as structure of arrays, so the plane and ray
+// tests of a block run over contiguous coordinates. The tree is immutable, all queries are const and thread safe.
+struct triangle_bvh {
+    explicit triangle_bvh(const halfedge_mesh &mesh, unsigned int max_leaf_size = 8,
+                          size_t parallel_grain_size = 1024);
+
+    //! nearest neighbor information
+    struct NearestNeighbor {
+        distance_point3_triangle3::result result;
+        face_handle face;
+        int tests;
+    };
+
+    //! first hit of a ray, face is invalid if the ray misses
+    struct RayHit {
+        bcg_scalar_t t = scalar_max;
+        VectorS<3> barycentric_coords = VectorS<3>::Zero();
+        face_handle face;
+    };
+
+    //! Return handle of the nearest neighbor
+    NearestNeighbor nearest(const VectorS<3> &p) const;
+
+    std::vector<NearestNeighbor> nearest_batch(const std::vector<VectorS<3>> &points) const;
+
+    //! The k nearest faces, sorted by distance
+    std::vector<NearestNeighbor> nearest_k(const VectorS<3> &p, size_t k) const;
+
+    //! All faces within radius of p, sorted by distance
+    std::vector<NearestNeighbor> nearest_radius(const VectorS<3> &p, bcg_scalar_t radius) const;
+
+    //! First intersection of origin + t * direction with t in [0, t_max]
+    RayHit intersect(const VectorS<3> &origin, const VectorS<3> &direction, bcg_scalar_t t_max = scalar_max) const;
+
+    std::vector<RayHit> intersect_batch(const std::vector<VectorS<3>> &origins,
+                                        const std::vector<VectorS<3>> &directions) const;
+
+    [[nodiscard]] inline size_t num_nodes() const { return nodes.size(); }
+
+    [[nodiscard]] inline size_t num_faces() const { return size_faces; }
+
+    static constexpr size_t lane_width = 4;
+
+private:
+    struct node {
+        // frame of the child boxes: box = origin + quantized * scale
+        float origin[3];
+        float scale[3];
+        std::uint8_t lower[2][3];
+        std::uint8_t upper[2][3];
+        // inner nodes: children index and index + 1. leaves: blocks [index, index + count).
+        bcg_index_t index = 0;
+        bcg_index_t count = 0;
+
+        [[nodiscard]] inline bool is_leaf() const { return count > 0; }
+
+        // squared distance of point to the box of child
+        [[nodiscard]] bcg_scalar_t sqr_distance(int child, const VectorS<3> &point) const;
+
+        // entry and exit of the ray into the box of child, empty if entry > exit
+        [[nodiscard]] std::pair<bcg_scalar_t, bcg_scalar_t> slab(int child, const VectorS<3> &origin,
+                                                                 const VectorS<3> &inv_direction,
+                                                                 bcg_scalar_t t_max) const;
+    };
+
+    // lane_width triangles, coordinate c of corner k of lane l at points[k][c][l]. normals are unit length, short
+    // leaves are padded by repeating their last triangle.
+    struct block {
+        bcg_scalar_t points[3][3][lane_width];
+        bcg_scalar_t normals[3][lane_width];
+        face_handle faces[lane_width];
+    };
+
+    struct build_node;
+
+    // visits the triangles of all leaves whose box is closer to p than bound(), near children first. The bound is
+    // read again before each node and triangle, so visit can shrink it.
+    template<typename Bound, typename Visit>
+    void visit_closest(const VectorS<3> &p, Bound &&bound, Visit &&visit) const;
+
+    void flatten(const build_node &bn, bcg_index_t id, const std::vector<bcg_index_t> &order,
+                 const std::vector<triangle3> &triangles, const std::vector<face_handle> &faces);
+
+    size_t size_faces;
+    size_t parallel_grain_size;
+    aligned_box3 root_box;
+    std::vector<node> nodes;
+    std::vector<block> blocks;
+};
+
+}
+
+#endif //BCG_GRAPHICS_BCG_TRIANGLE_BVH_H
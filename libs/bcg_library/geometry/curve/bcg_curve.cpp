@@ -14,7 +14,7 @@ VectorS<3> curve::evaluate(bcg_scalar_t t) const { return VectorS<3>::Zero(); }
 
 VectorS<3> curve::derivative_vector(bcg_scalar_t t, int order) const { return VectorS<3>::Zero(); }
 
-const std::vector<VectorS<3>> &curve::control_points() const { return positions.vector(); };
+std::vector<VectorS<3>> curve::control_points() const { return {positions.begin(), positions.end()}; };
 
 VectorS<3> curve::first_derivative(bcg_scalar_t t) const {
     return derivative_vector(t, 1);
@@ -20,7 +20,7 @@ struct curve : public halfedge_graph{
 
     virtual VectorS<3> derivative_vector(bcg_scalar_t t, int order) const;
 
-    const std::vector<VectorS<3>> &control_points() const;
+    std::vector<VectorS<3>> control_points() const;
 
     VectorS<3> first_derivative(bcg_scalar_t t) const;
 
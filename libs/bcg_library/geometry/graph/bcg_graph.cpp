@@ -6,6 +6,7 @@
 #include "bcg_graph.h"
 #include "utils/bcg_stl_utils.h"
 #include "distance_query/bcg_distance_segment_point.h"
+#include "bvh/bcg_bvh.h"
 
 namespace bcg {
 
@@ -106,96 +107,40 @@ bool halfedge_graph::has_garbage() const {
 void halfedge_graph::garbage_collection() {
     if (!has_garbage()) return;
 
-    size_t nV = vertices.size();
-    size_t nE = edges.size();
-    size_t nH = halfedges.size();
-
-    auto vmap = vertices.add<vertex_handle, 1>("v_garbage_collection");
-    auto hmap = halfedges.add<halfedge_handle, 1>("h_garbage_collection");
-
-    for (size_t i = 0; i < nV; ++i) {
-        vmap[i] = vertex_handle(i);
-    }
-
-    for (size_t i = 0; i < nH; ++i) {
-        hmap[i] = halfedge_handle(i);
-    }
-
-    if (nV > 0) {
-        size_t i0 = 0;
-        size_t i1 = nV - 1;
-
-        while (true) {
-            // find first deleted and last un-deleted
-            while (!vertices_deleted[i0] && i0 < i1) {
-                ++i0;
-            }
-            while (vertices_deleted[i1] && i0 < i1) {
-                --i1;
-            }
-            if (i0 >= i1) break;
-
-            // swap
-            vertices.swap(i0, i1);
-        }
-
-        // remember new size
-        nV = vertices_deleted[i0] ? i0 : i0 + 1;
-    }
-
-    if (nE > 0) {
-        size_t i0 = 0;
-        size_t i1 = nE - 1;
-
-        while (true) {
-            // find first deleted and last un-deleted
-            while (!edges_deleted[i0] && i0 < i1) {
-                ++i0;
-            }
-            while (edges_deleted[i1] && i0 < i1) {
-                --i1;
-            }
-            if (i0 >= i1) break;
-
-            // swap
-            edges.swap(i0, i1);
-            halfedges.swap(2 * i0, 2 * i1);
-            halfedges.swap(2 * i0 + 1, 2 * i1 + 1);
-        }
+    // surviving elements keep their order, the halfedges of an edge stay next to each other
+    auto kept_vertices = kept_indices(vertices_deleted.vector());
+    auto kept_edges = kept_indices(edges_deleted.vector());
+    std::vector<handle_index_t> kept_halfedges(2 * kept_edges.size());
+    tbb::parallel_for(size_t(0), kept_edges.size(), [&](size_t i) {
+        kept_halfedges[2 * i] = 2 * kept_edges[i];
+        kept_halfedges[2 * i + 1] = 2 * kept_edges[i] + 1;
+    });
+    auto vmap = compaction_map(kept_vertices, vertices.size());
+    auto hmap = compaction_map(kept_halfedges, halfedges.size());
 
-        // remember new size
-        nE = edges_deleted[i0] ? i0 : i0 + 1;
-        nH = 2 * nE;
-    }
+    vertices.compact(kept_vertices);
+    halfedges.compact(kept_halfedges);
+    edges.compact(kept_edges);
 
-    // update vertex connectivity
-    for (size_t v = 0; v < nV; ++v) {
-        if (!is_isolated(v)) {
-            set_halfedge(v, hmap[get_halfedge(v)]);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, vertices.size()), [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t v = range.begin(); v != range.end(); ++v) {
+            vconn[v].h = halfedge_handle(map_index(hmap, vconn[v].h.idx));
         }
-    }
-
-    for (size_t h = 0; h < nH; ++h) {
-        set_vertex(h, vmap[get_to_vertex(h).idx]);
-        auto next = get_next(h);
-        if (halfedges.is_valid(next)) {
-            set_next(h, hmap[next]);
+    });
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, halfedges.size()), [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t h = range.begin(); h != range.end(); ++h) {
+            auto &connectivity = hconn[h];
+            connectivity.v = vertex_handle(map_index(vmap, connectivity.v.idx));
+            connectivity.nh = halfedge_handle(map_index(hmap, connectivity.nh.idx));
+            connectivity.ph = halfedge_handle(map_index(hmap, connectivity.ph.idx));
         }
-    }
-
-    vertices.remove(vmap);
-    halfedges.remove(hmap);
-
-    vertices.resize(nV);
-    vertices.free_unused_memory();
-    halfedges.resize(nH);
-    halfedges.free_unused_memory();
-    edges.resize(nE);
-    edges.free_unused_memory();
+    });
 
     size_vertices_deleted = 0;
     size_halfedges_deleted = 0;
     size_edges_deleted = 0;
+    vertex_index_cache.reset();
+    edge_index_cache.reset();
     assert(!has_garbage());
     assert(vertices.is_dirty());
     assert(edges.is_dirty());
@@ -380,6 +325,7 @@ void halfedge_graph::remove_edge(edge_handle e) {
         }
     }
 
+    hconn.set_dirty();
     mark_edge_deleted(e);
 }
 
@@ -551,72 +497,88 @@ void halfedge_graph::mark_edge_deleted(edge_handle e) {
     edges_deleted.set_dirty();
 }
 
-edge_handle halfedge_graph::find_closest_edge(const halfedge_graph::position_t &point) {
-    edge_handle closest_yet;
-    distance_point3_segment3 distance;
-    bcg_scalar_t min_dist_yet = scalar_max;
-    for (const auto e : edges) {
-        segment3 seg(positions[get_vertex(e, 0)], positions[get_vertex(e, 1)]);
-
-        bcg_scalar_t dist = distance(point, seg).distance;
-        if (dist < min_dist_yet) {
-            min_dist_yet = dist;
-            closest_yet = e;
+struct halfedge_graph::edge_index {
+    bvh tree;
+    const base_property *positions = nullptr;
+    size_t version = 0;
+    size_t connectivity_version = 0;
+    size_t size = 0;
+    size_t num_deleted = 0;
+};
+
+std::shared_ptr<const halfedge_graph::edge_index> halfedge_graph::get_edge_index() const {
+    std::lock_guard<std::mutex> lock(edge_index_cache.mutex);
+    auto &index = edge_index_cache.index;
+    auto *base = vertices.get_base_ptr("v_position");
+    auto bounds = [this](bcg_index_t e) {
+        aligned_box3 box;
+        box.grow(positions[get_vertex(edge_handle(e), 0)]);
+        box.grow(positions[get_vertex(edge_handle(e), 1)]);
+        return box;
+    };
+    if (!index || index->positions != base || index->connectivity_version != hconn.version() ||
+        index->size != edges.size() || index->num_deleted != size_edges_deleted) {
+        std::vector<bcg_index_t> ids;
+        ids.reserve(num_edges());
+        for (const auto e : edges) {
+            ids.push_back(bcg_index_t(e.idx));
         }
+        index = std::make_shared<edge_index>();
+        index->tree.build(ids, bounds);
+        index->positions = base;
+        index->connectivity_version = hconn.version();
+        index->size = edges.size();
+        index->num_deleted = size_edges_deleted;
+    } else if (index->version != positions.version()) {
+        index->tree.refit(bounds);
     }
-    return closest_yet;
+    index->version = positions.version();
+    return index;
 }
 
-std::vector<edge_handle> halfedge_graph::find_closest_k_edges(const halfedge_graph::position_t &point, size_t k) {
-    using DistIndex = std::pair<bcg_scalar_t, edge_handle>;
-    distance_point3_segment3 distance;
-    std::vector<DistIndex> closest_k;
-    for (const auto e : edges) {
-        segment3 seg(positions[get_vertex(e, 0)], positions[get_vertex(e, 1)]);
+static std::vector<edge_handle> to_edge_handles(const neighbors_query &result) {
+    return std::vector<edge_handle>(result.indices.begin(), result.indices.end());
+}
 
-        bcg_scalar_t dist = distance(point, seg).distance;
-        if (closest_k.size() < k + 1) {
-            closest_k.emplace_back(dist, e);
-            if (closest_k.size() == k) {
-                std::sort(closest_k.begin(), closest_k.end(), [](const DistIndex &lhs, const DistIndex &rhs) {
-                    return lhs.first < rhs.first;
-                });
-                break;
-            }
-            continue;
-        }
+static bcg_scalar_t sqr_distance(const halfedge_graph &graph, bcg_index_t e, const point_cloud::position_t &point) {
+    segment3 seg(graph.positions[graph.get_vertex(edge_handle(e), 0)],
+                 graph.positions[graph.get_vertex(edge_handle(e), 1)]);
+    return distance_point3_segment3()(point, seg).sqr_distance;
+}
 
-        if (dist < closest_k.back().first) {
-            closest_k.back() = std::make_pair(dist, e);
-            std::sort(closest_k.begin(), closest_k.end(), [](const DistIndex &lhs, const DistIndex &rhs) {
-                return lhs.first < rhs.first;
-            });
-        }
-    }
-    std::vector<edge_handle> indices;
-    unzip<bcg_scalar_t, edge_handle>(closest_k, nullptr, &indices);
-    return indices;
+edge_handle halfedge_graph::find_closest_edge(const halfedge_graph::position_t &point) const {
+    auto result = find_closest_k_edges(point, 1);
+    return result.empty() ? edge_handle() : result[0];
 }
 
-std::vector<edge_handle>
-halfedge_graph::find_closest_edges_radius(const halfedge_graph::position_t &point, bcg_scalar_t radius) {
-    using DistIndex = std::pair<bcg_scalar_t, edge_handle>;
-    distance_point3_segment3 distance;
-    std::vector<DistIndex> closest;
-    for (const auto e : edges) {
-        segment3 seg(positions[get_vertex(e, 0)], positions[get_vertex(e, 1)]);
+std::vector<edge_handle> halfedge_graph::find_closest_k_edges(const halfedge_graph::position_t &point, size_t k) const {
+    return to_edge_handles(get_edge_index()->tree.query_knn(point, k, [this](bcg_index_t e, const position_t &p) {
+        return sqr_distance(*this, e, p);
+    }));
+}
 
-        bcg_scalar_t dist = distance(point, seg).distance;
-        if (dist <= radius) {
-            closest.emplace_back(dist, e);
+std::vector<edge_handle>
+halfedge_graph::find_closest_edges_radius(const halfedge_graph::position_t &point, bcg_scalar_t radius) const {
+    return to_edge_handles(get_edge_index()->tree.query_radius(point, radius * radius,
+                                                               [this](bcg_index_t e, const position_t &p) {
+                                                                   return sqr_distance(*this, e, p);
+                                                               }));
+}
+
+std::vector<edge_handle> halfedge_graph::find_closest_edge_batch(const std::vector<position_t> &points) const {
+    auto index = get_edge_index();
+    std::vector<edge_handle> closest(points.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, points.size(), 256), [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i != range.end(); ++i) {
+            auto result = index->tree.query_knn(points[i], 1, [this](bcg_index_t e, const position_t &p) {
+                return sqr_distance(*this, e, p);
+            });
+            if (!result.indices.empty()) {
+                closest[i] = edge_handle(result.indices[0]);
+            }
         }
-    }
-    std::sort(closest.begin(), closest.end(), [](const DistIndex &lhs, const DistIndex &rhs) {
-        return lhs.first < rhs.first;
     });
-    std::vector<edge_handle> indices;
-    unzip<bcg_scalar_t, edge_handle>(closest, nullptr, &indices);
-    return indices;
+    return closest;
 }
 
 edge_handle halfedge_graph::find_closest_edge_in_neighborhood(vertex_handle v,
@@ -38,6 +38,9 @@ struct halfedge_graph : public point_cloud {
         }
     };
 
+    static_assert(sizeof(vertex_connectivity) == 4, "vertex_connectivity must stay packed");
+    static_assert(sizeof(halfedge_connectivity) == 16, "halfedge_connectivity must stay packed");
+
     halfedge_container halfedges;
     edge_container edges;
     property<vertex_connectivity, 1> vconn;
@@ -51,6 +54,10 @@ struct halfedge_graph : public point_cloud {
 
     ~halfedge_graph() override = default;
 
+    halfedge_graph(const halfedge_graph &) = default;
+
+    halfedge_graph(halfedge_graph &&) = default;
+
     void assign(const halfedge_graph &other);
 
     halfedge_graph &operator=(const halfedge_graph &other);
@@ -183,17 +190,28 @@ struct halfedge_graph : public point_cloud {
     halfedge_handle new_edge(vertex_handle v0, vertex_handle v1);
 
 
-    edge_handle find_closest_edge(const halfedge_graph::position_t &point);
+    // closest edge queries are answered by a bvh over the edges, built on the first query. Later queries refit it if
+    // vertices moved and rebuild it if edges were added, deleted or reconnected (see base_property::version()).
+    edge_handle find_closest_edge(const halfedge_graph::position_t &point) const;
+
+    std::vector<edge_handle> find_closest_k_edges(const halfedge_graph::position_t &point, size_t k) const;
 
-    std::vector<edge_handle> find_closest_k_edges(const halfedge_graph::position_t &point, size_t k);
+    std::vector<edge_handle> find_closest_edges_radius(const halfedge_graph::position_t &point,
+                                                       bcg_scalar_t radius) const;
 
-    std::vector<edge_handle> find_closest_edges_radius(const halfedge_graph::position_t &point, bcg_scalar_t radius);
+    std::vector<edge_handle> find_closest_edge_batch(const std::vector<position_t> &points) const;
 
     edge_handle find_closest_edge_in_neighborhood(vertex_handle v, const halfedge_graph::position_t &point);
 
     std::string to_string() const override;
+
+    struct edge_index;
+    mutable lazy_index<edge_index> edge_index_cache;
+
 protected:
     void mark_edge_deleted(edge_handle e);
+
+    std::shared_ptr<const edge_index> get_edge_index() const;
 };
 
 std::ostream &operator<<(std::ostream &stream, const halfedge_graph &graph);
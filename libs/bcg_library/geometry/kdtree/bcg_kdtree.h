@@ -6,14 +6,138 @@
 #define BCG_GRAPHICS_BCG_KDTREE_H
 
 #include <memory>
+#include <type_traits>
+#include <algorithm>
+#include "tbb/tbb.h"
 #include "nanoflann.hpp"
 #include "math/bcg_linalg.h"
 #include "bcg_neighbors_query.h"
+#include "bcg_kdtree_index.h"
 #include "bcg_property.h"
 #include "utils/bcg_stl_utils.h"
 
 namespace bcg {
 
+// The index may be built in a different precision than bcg_scalar_t, e.g. a float kdtree_property over double
+// positions. Queries are converted to the precision of the index and results reported in bcg_scalar_t.
+template<typename Real, typename Index, int D>
+inline neighbors_query kdtree_query_knn(const Index &index, const VectorS<D> &query_point, size_t num_closest) {
+    neighbors_query result(num_closest);
+    if (num_closest == 0) {
+        return result;
+    }
+    nanoflann::KNNResultSet<Real, bcg_index_t> resultSet(num_closest);
+    if constexpr (std::is_same<Real, bcg_scalar_t>::value) {
+        resultSet.init(result.indices.data(), result.distances.data());
+        index.findNeighbors(resultSet, query_point.data(), nanoflann::SearchParams());
+    } else {
+        Vector<Real, D> query = query_point.template cast<Real>();
+        std::vector<Real> distances(num_closest, 0);
+        resultSet.init(result.indices.data(), distances.data());
+        index.findNeighbors(resultSet, query.data(), nanoflann::SearchParams());
+        std::copy(distances.begin(), distances.end(), result.distances.begin());
+    }
+    return result;
+}
+
+template<typename Real, typename Index, int D>
+inline neighbors_query kdtree_query_radius(const Index &index, const VectorS<D> &query_point, bcg_scalar_t radius) {
+    neighbors_query result;
+    std::vector<std::pair<bcg_index_t, Real>> items;
+    nanoflann::RadiusResultSet<Real, bcg_index_t> resultSet(Real(radius), items);
+    resultSet.init();
+    Vector<Real, D> query = query_point.template cast<Real>();
+    index.findNeighbors(resultSet, query.data(), nanoflann::SearchParams());
+    if constexpr (std::is_same<Real, bcg_scalar_t>::value) {
+        unzip(items, &result.indices, &result.distances);
+    } else {
+        result.indices.reserve(items.size());
+        result.distances.reserve(items.size());
+        for (const auto &item : items) {
+            result.indices.push_back(item.first);
+            result.distances.push_back(item.second);
+        }
+    }
+    return result;
+}
+
+// Batched queries: one call for all query points, results in one neighbors_batch. Queries run in parallel, each
+// thread writes into the output directly (knn) or into per-range buffers (radius), so there is no allocation per query.
+template<typename Real, int D, typename Index, typename Points>
+inline void kdtree_query_knn_batch(const Index &index, size_t num_points, const Points &query_points, size_t num_closest,
+                                   neighbors_batch &result, size_t parallel_grain_size) {
+    size_t n = query_points.size();
+    num_closest = std::min(num_closest, num_points);
+    result.offsets.resize(n + 1);
+    result.indices.resize(n * num_closest);
+    result.distances.resize(n * num_closest);
+    if (num_closest == 0) {
+        std::fill(result.offsets.begin(), result.offsets.end(), 0);
+        return;
+    }
+    tbb::enumerable_thread_specific<std::vector<Real>> scratch;
+    tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, n, parallel_grain_size),
+            [&](const tbb::blocked_range<size_t> &range) {
+                auto &distances = scratch.local();
+                distances.resize(num_closest);
+                nanoflann::KNNResultSet<Real, bcg_index_t> resultSet(num_closest);
+                for (size_t i = range.begin(); i != range.end(); ++i) {
+                    size_t offset = i * num_closest;
+                    result.offsets[i] = offset;
+                    Vector<Real, D> query = query_points[i].template cast<Real>();
+                    if constexpr (std::is_same<Real, bcg_scalar_t>::value) {
+                        resultSet.init(result.indices.data() + offset, result.distances.data() + offset);
+                        index.findNeighbors(resultSet, query.data(), nanoflann::SearchParams());
+                    } else {
+                        resultSet.init(result.indices.data() + offset, distances.data());
+                        index.findNeighbors(resultSet, query.data(), nanoflann::SearchParams());
+                        std::copy(distances.begin(), distances.end(), result.distances.begin() + offset);
+                    }
+                }
+            }
+    );
+    result.offsets[n] = n * num_closest;
+}
+
+template<typename Real, int D, typename Index, typename Points>
+inline void kdtree_query_radius_batch(const Index &index, const Points &query_points, bcg_scalar_t radius,
+                                      neighbors_batch &result, size_t parallel_grain_size) {
+    size_t n = query_points.size();
+    parallel_grain_size = std::max<size_t>(parallel_grain_size, 1);
+    size_t num_ranges = (n + parallel_grain_size - 1) / parallel_grain_size;
+    std::vector<neighbors_query> ranges(num_ranges);
+    result.offsets.resize(n + 1);
+    tbb::enumerable_thread_specific<std::vector<std::pair<bcg_index_t, Real>>> scratch;
+    tbb::parallel_for(size_t(0), num_ranges, [&](size_t r) {
+        auto &items = scratch.local();
+        auto &out = ranges[r];
+        size_t end = std::min(n, (r + 1) * parallel_grain_size);
+        for (size_t i = r * parallel_grain_size; i < end; ++i) {
+            nanoflann::RadiusResultSet<Real, bcg_index_t> resultSet(Real(radius), items);
+            resultSet.init();
+            Vector<Real, D> query = query_points[i].template cast<Real>();
+            index.findNeighbors(resultSet, query.data(), nanoflann::SearchParams());
+            result.offsets[i + 1] = items.size();
+            for (const auto &item : items) {
+                out.indices.push_back(item.first);
+                out.distances.push_back(item.second);
+            }
+        }
+    });
+    result.offsets[0] = 0;
+    for (size_t i = 0; i < n; ++i) {
+        result.offsets[i + 1] += result.offsets[i];
+    }
+    result.indices.resize(result.offsets[n]);
+    result.distances.resize(result.offsets[n]);
+    tbb::parallel_for(size_t(0), num_ranges, [&](size_t r) {
+        size_t offset = result.offsets[r * parallel_grain_size];
+        std::copy(ranges[r].indices.begin(), ranges[r].indices.end(), result.indices.begin() + offset);
+        std::copy(ranges[r].distances.begin(), ranges[r].distances.end(), result.distances.begin() + offset);
+    });
+}
+
 template<typename Real, int M = -1, int D = 3, class Distance = nanoflann::metric_L2>
 struct kdtree_matrix {
     struct DatasetAdaptor {
@@ -62,26 +186,32 @@ struct kdtree_matrix {
     }
 
     inline neighbors_query query_knn(const VectorS<D> &query_point, const size_t num_closest) const {
-        neighbors_query result(num_closest);
-        nanoflann::KNNResultSet<Real, bcg_index_t> resultSet(num_closest);
-        resultSet.init(result.indices.data(), result.distances.data());
-        index->findNeighbors(resultSet, query_point.data(), nanoflann::SearchParams());
-        return result;
+        return kdtree_query_knn<Real>(*index, query_point, num_closest);
     }
 
     inline neighbors_query query_radius(const VectorS<D> &query_point, const bcg_scalar_t radius) const {
-        neighbors_query result;
-        std::vector<std::pair<bcg_index_t, bcg_scalar_t>> items;
-        nanoflann::RadiusResultSet<Real, bcg_index_t> resultSet(radius, items);
-        resultSet.init();
-        index->findNeighbors(resultSet, query_point.data(), nanoflann::SearchParams());
-        unzip(items, &result.indices, &result.distances);
-        return result;
+        return kdtree_query_radius<Real>(*index, query_point, radius);
+    }
+
+    template<typename Points>
+    inline void query_knn_batch(const Points &query_points, size_t num_closest, neighbors_batch &result,
+                                size_t parallel_grain_size = 1024) const {
+        kdtree_query_knn_batch<Real, D>(*index, dataset->kdtree_get_point_count(), query_points, num_closest, result,
+                                     parallel_grain_size);
+    }
+
+    template<typename Points>
+    inline void query_radius_batch(const Points &query_points, bcg_scalar_t radius, neighbors_batch &result,
+                                   size_t parallel_grain_size = 1024) const {
+        kdtree_query_radius_batch<Real, D>(*index, query_points, radius, result, parallel_grain_size);
     }
 };
 
 template<typename Real, int M = -1, int D = 3, class Distance = nanoflann::metric_L2>
 struct kdtree_property {
+    static_assert(std::is_same<Distance, nanoflann::metric_L2>::value,
+                  "kdtree_property only supports nanoflann::metric_L2, use kdtree_matrix for other metrics");
+
     struct DatasetAdaptor {
         DatasetAdaptor() = default;
 
@@ -104,8 +234,8 @@ struct kdtree_property {
         }
     };
 
-    typedef typename Distance::template traits<Real, DatasetAdaptor>::distance_t metric_t;
-    typedef nanoflann::KDTreeSingleIndexAdaptor<metric_t, DatasetAdaptor, D, bcg_index_t> index_t;
+    // built in parallel and updatable in place, see bcg_kdtree_index.h. Only the L2 metric is supported.
+    typedef kdtree_index<Real, D, DatasetAdaptor> index_t;
 
     std::shared_ptr<index_t> index;
     std::shared_ptr<DatasetAdaptor> dataset;
@@ -113,36 +243,59 @@ struct kdtree_property {
 
     kdtree_property() = default;
 
-    explicit kdtree_property(property<VectorS<D>, D> positions, int leaf_max_size = 10) : dataset(
-            std::make_shared<DatasetAdaptor>(positions)), leaf_size(leaf_max_size) {
-        index = std::make_shared<index_t>(static_cast<int>(D), *dataset,
-                                          nanoflann::KDTreeSingleIndexAdaptorParams(leaf_max_size));
-        index->buildIndex();
+    explicit kdtree_property(property<VectorS<D>, D> positions, int leaf_max_size = 10) {
+        build(positions, leaf_max_size);
     }
 
     void build(const property<VectorS<D>, D> &positions, int leaf_max_size = 10) {
         dataset = std::make_shared<DatasetAdaptor>(positions);
-        index = std::make_shared<index_t>(static_cast<int>(D), *dataset,
-                                          nanoflann::KDTreeSingleIndexAdaptorParams(leaf_max_size));
-        index->buildIndex();
+        leaf_size = leaf_max_size;
+        index = std::make_shared<index_t>(*dataset, leaf_max_size);
+        index->build();
+    }
+
+    // brings the tree up to date after the positions were edited: moved points refit the existing nodes, appended
+    // points are inserted. Rebuilds if points were dropped from the end or the tree grew by more than half since the
+    // last build.
+    void update() {
+        size_t n = dataset->kdtree_get_point_count();
+        if (n < index->size() || n - index->size_at_build() > index->size_at_build() / 2) {
+            build(dataset->positions, leaf_size);
+            return;
+        }
+        index->refit();
+        for (size_t i = index->size(); i < n; ++i) {
+            index->insert(bcg_index_t(i));
+        }
+    }
+
+    inline void insert(bcg_index_t idx) {
+        index->insert(idx);
+    }
+
+    inline void remove(bcg_index_t idx) {
+        index->remove(idx);
     }
 
     inline neighbors_query query_knn(const VectorS<D> &query_point, const size_t num_closest) const {
-        neighbors_query result(num_closest);
-        nanoflann::KNNResultSet<Real, bcg_index_t> resultSet(num_closest);
-        resultSet.init(result.indices.data(), result.distances.data());
-        index->findNeighbors(resultSet, query_point.data(), nanoflann::SearchParams());
-        return result;
+        return kdtree_query_knn<Real>(*index, query_point, num_closest);
     }
 
     inline neighbors_query query_radius(const VectorS<D> &query_point, const bcg_scalar_t radius) const {
-        neighbors_query result;
-        std::vector<std::pair<bcg_index_t, bcg_scalar_t>> items;
-        nanoflann::RadiusResultSet<Real, bcg_index_t> resultSet(radius, items);
-        resultSet.init();
-        index->findNeighbors(resultSet, query_point.data(), nanoflann::SearchParams());
-        unzip(items, &result.indices, &result.distances);
-        return result;
+        return kdtree_query_radius<Real>(*index, query_point, radius);
+    }
+
+    template<typename Points>
+    inline void query_knn_batch(const Points &query_points, size_t num_closest, neighbors_batch &result,
+                                size_t parallel_grain_size = 1024) const {
+        kdtree_query_knn_batch<Real, D>(*index, index->num_points(), query_points, num_closest, result,
+                                     parallel_grain_size);
+    }
+
+    template<typename Points>
+    inline void query_radius_batch(const Points &query_points, bcg_scalar_t radius, neighbors_batch &result,
+                                   size_t parallel_grain_size = 1024) const {
+        kdtree_query_radius_batch<Real, D>(*index, query_points, radius, result, parallel_grain_size);
     }
 };
 
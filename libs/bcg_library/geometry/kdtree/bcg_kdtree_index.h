@@ -0,0 +1,421 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#ifndef BCG_GRAPHICS_BCG_KDTREE_INDEX_H
+#define BCG_GRAPHICS_BCG_KDTREE_INDEX_H
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include "tbb/tbb.h"
+#include "math/bcg_math_common.h"
+#include "utils/bcg_bit_vector.h"
+
+namespace bcg {
+
+// Kd-tree over the points of a nanoflann style dataset (kdtree_get_point_count, kdtree_get_pt), searched with
+// nanoflann result sets. Unlike nanoflann's index it is built in parallel and can be kept up to date after edits:
+// refit() adapts the split bounds to moved points, insert() and remove() add and drop single points. Edits must not
+// run concurrently with queries.
+template<typename Real, int D, class Dataset>
+struct kdtree_index {
+    static constexpr bcg_index_t invalid = std::numeric_limits<bcg_index_t>::max();
+
+    struct node {
+        // inner nodes: all points of child1 have coordinate divfeat <= divlow, all of child2 >= divhigh.
+        bcg_index_t child1 = invalid, child2 = invalid;
+        int divfeat = 0;
+        Real divlow = 0, divhigh = 0;
+        // leaves: points [begin, end) of indices plus the points inserted later. Inner nodes built at once keep the
+        // range of their subtree.
+        bcg_index_t begin = 0, end = 0;
+        bcg_index_t bucket = invalid;
+
+        [[nodiscard]] inline bool is_leaf() const { return child1 == invalid; }
+    };
+
+    struct bounds {
+        Real low[D], high[D];
+    };
+
+    kdtree_index(const Dataset &dataset, size_t leaf_max_size = 10, size_t parallel_grain_size = 1 << 15)
+            : dataset(dataset), leaf_max_size(std::max<size_t>(leaf_max_size, 1)),
+              parallel_grain_size(parallel_grain_size) {}
+
+    void build() {
+        size_t n = dataset.kdtree_get_point_count();
+        indices.resize(n);
+        std::iota(indices.begin(), indices.end(), 0);
+        buckets.clear();
+        removed.assign(n, false);
+        num_removed = 0;
+        num_built = n;
+        nodes.clear();
+        if (n == 0) {
+            return;
+        }
+        scratch.resize(n);
+        nodes.resize(count_nodes(n));
+        num_nodes = 0;
+        bounds box = compute_bounds(0, n);
+        build(allocate_node(), 0, n, box);
+        nodes.resize(num_nodes);
+        scratch.clear();
+        scratch.shrink_to_fit();
+        refit();
+    }
+
+    // recomputes the split bounds after points moved. The topology is kept, so queries stay exact but get slower
+    // the further points moved away from their initial cells.
+    void refit() {
+        if (!nodes.empty()) {
+            refit(0);
+        }
+    }
+
+    // adds the point idx of the dataset, usually one that was appended since the last build.
+    void insert(bcg_index_t idx) {
+        if (idx >= removed.size()) {
+            removed.resize(idx + 1);
+        }
+        if (nodes.empty()) {
+            nodes.emplace_back();
+            nodes[0].bucket = new_bucket();
+        }
+        bcg_index_t id = 0;
+        while (!nodes[id].is_leaf()) {
+            auto &nd = nodes[id];
+            Real value = dataset.kdtree_get_pt(idx, nd.divfeat);
+            if (2 * value < nd.divlow + nd.divhigh) {
+                nd.divlow = std::max(nd.divlow, value);
+                id = nd.child1;
+            } else {
+                nd.divhigh = std::min(nd.divhigh, value);
+                id = nd.child2;
+            }
+        }
+        if (nodes[id].bucket == invalid) {
+            nodes[id].bucket = new_bucket();
+        }
+        buckets[nodes[id].bucket].push_back(idx);
+        if (leaf_size(nodes[id]) > 2 * leaf_max_size) {
+            split_leaf(id);
+        }
+    }
+
+    // drops the point idx from the results. Its slot stays in the tree until the next build.
+    void remove(bcg_index_t idx) {
+        if (idx < removed.size() && !removed.test(idx)) {
+            removed.set(idx);
+            ++num_removed;
+        }
+    }
+
+    // number of points that can be found.
+    [[nodiscard]] inline size_t num_points() const {
+        return size() - num_removed;
+    }
+
+    // number of point slots, including removed ones.
+    [[nodiscard]] inline size_t size() const {
+        return removed.size();
+    }
+
+    // number of points at the last build.
+    [[nodiscard]] inline size_t size_at_build() const {
+        return num_built;
+    }
+
+    template<typename ResultSet, typename SearchParams>
+    bool findNeighbors(ResultSet &result, const Real *query, const SearchParams &) const {
+        if (nodes.empty()) {
+            return false;
+        }
+        search(result, query, 0);
+        return result.full();
+    }
+
+    const Dataset &dataset;
+    size_t leaf_max_size;
+    size_t parallel_grain_size;
+    std::vector<node> nodes;
+    std::vector<bcg_index_t> indices;
+    std::vector<std::vector<bcg_index_t>> buckets;
+    BitVector removed;
+    size_t num_removed = 0;
+    size_t num_built = 0;
+
+private:
+    // median splits of m points produce the same tree shape for every point set of that size
+    size_t count_nodes(size_t m) const {
+        if (m <= leaf_max_size) {
+            return 1;
+        }
+        return 1 + count_nodes(m / 2) + count_nodes(m - m / 2);
+    }
+
+    inline bcg_index_t allocate_node() {
+        return num_nodes.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    inline bcg_index_t new_bucket() {
+        buckets.emplace_back();
+        return bcg_index_t(buckets.size() - 1);
+    }
+
+    inline size_t leaf_size(const node &nd) const {
+        return nd.end - nd.begin + (nd.bucket == invalid ? 0 : buckets[nd.bucket].size());
+    }
+
+    inline Real coordinate(bcg_index_t idx, int dim) const {
+        return dataset.kdtree_get_pt(idx, dim);
+    }
+
+    inline void extend(bounds &box, bcg_index_t idx) const {
+        for (int k = 0; k < D; ++k) {
+            Real value = coordinate(idx, k);
+            box.low[k] = std::min(box.low[k], value);
+            box.high[k] = std::max(box.high[k], value);
+        }
+    }
+
+    static inline bounds empty_bounds() {
+        bounds box;
+        for (int k = 0; k < D; ++k) {
+            box.low[k] = std::numeric_limits<Real>::max();
+            box.high[k] = std::numeric_limits<Real>::lowest();
+        }
+        return box;
+    }
+
+    static inline void merge(bounds &box, const bounds &other) {
+        for (int k = 0; k < D; ++k) {
+            box.low[k] = std::min(box.low[k], other.low[k]);
+            box.high[k] = std::max(box.high[k], other.high[k]);
+        }
+    }
+
+    bounds compute_bounds(size_t begin, size_t end) const {
+        return tbb::parallel_reduce(
+                tbb::blocked_range<size_t>(begin, end, parallel_grain_size), empty_bounds(),
+                [&](const tbb::blocked_range<size_t> &range, bounds box) {
+                    for (size_t i = range.begin(); i != range.end(); ++i) {
+                        extend(box, indices[i]);
+                    }
+                    return box;
+                },
+                [](bounds a, const bounds &b) {
+                    merge(a, b);
+                    return a;
+                });
+    }
+
+    // moves the median of [begin, end) along dim to mid with everything smaller before it. Large ranges are first
+    // partitioned in parallel around the median of a sample, only the part that contains mid is then selected
+    // serially.
+    void select_median(size_t begin, size_t mid, size_t end, int dim) {
+        auto less = [&](bcg_index_t a, bcg_index_t b) { return coordinate(a, dim) < coordinate(b, dim); };
+        if (end - begin <= parallel_grain_size) {
+            std::nth_element(indices.begin() + begin, indices.begin() + mid, indices.begin() + end, less);
+            return;
+        }
+        size_t m = end - begin;
+        std::vector<Real> sample(std::min<size_t>(m, 1024));
+        for (size_t i = 0; i < sample.size(); ++i) {
+            sample[i] = coordinate(indices[begin + i * m / sample.size()], dim);
+        }
+        std::nth_element(sample.begin(), sample.begin() + sample.size() / 2, sample.end());
+        Real pivot = sample[sample.size() / 2];
+
+        size_t num_blocks = (m + parallel_grain_size - 1) / parallel_grain_size;
+        std::vector<size_t> num_less(num_blocks + 1, 0);
+        tbb::parallel_for(size_t(0), num_blocks, [&](size_t b) {
+            size_t count = 0;
+            size_t last = std::min(end, begin + (b + 1) * parallel_grain_size);
+            for (size_t i = begin + b * parallel_grain_size; i < last; ++i) {
+                count += coordinate(indices[i], dim) < pivot;
+            }
+            num_less[b + 1] = count;
+        });
+        std::partial_sum(num_less.begin(), num_less.end(), num_less.begin());
+        size_t split = begin + num_less[num_blocks];
+        tbb::parallel_for(size_t(0), num_blocks, [&](size_t b) {
+            size_t first = begin + b * parallel_grain_size;
+            size_t last = std::min(end, first + parallel_grain_size);
+            size_t lower = begin + num_less[b];
+            size_t upper = split + (first - begin) - num_less[b];
+            for (size_t i = first; i < last; ++i) {
+                bcg_index_t idx = indices[i];
+                scratch[coordinate(idx, dim) < pivot ? lower++ : upper++] = idx;
+            }
+        });
+        tbb::parallel_for(tbb::blocked_range<size_t>(begin, end, parallel_grain_size),
+                          [&](const tbb::blocked_range<size_t> &range) {
+                              std::copy(scratch.begin() + range.begin(), scratch.begin() + range.end(),
+                                        indices.begin() + range.begin());
+                          });
+        if (mid < split) {
+            std::nth_element(indices.begin() + begin, indices.begin() + mid, indices.begin() + split, less);
+        } else if (mid > split) {
+            std::nth_element(indices.begin() + split, indices.begin() + mid, indices.begin() + end, less);
+        }
+    }
+
+    void build(bcg_index_t id, size_t begin, size_t end, const bounds &box) {
+        auto &nd = nodes[id];
+        nd.begin = bcg_index_t(begin);
+        nd.end = bcg_index_t(end);
+        if (end - begin <= leaf_max_size) {
+            return;
+        }
+        int dim = 0;
+        for (int k = 1; k < D; ++k) {
+            if (box.high[k] - box.low[k] > box.high[dim] - box.low[dim]) {
+                dim = k;
+            }
+        }
+        size_t mid = begin + (end - begin) / 2;
+        select_median(begin, mid, end, dim);
+        Real cut = coordinate(indices[mid], dim);
+        nd.divfeat = dim;
+        nd.child1 = allocate_node();
+        nd.child2 = allocate_node();
+        bounds left = box, right = box;
+        left.high[dim] = cut;
+        right.low[dim] = cut;
+        bcg_index_t child1 = nd.child1, child2 = nd.child2;
+        if (end - begin > parallel_grain_size) {
+            tbb::parallel_invoke([&] { build(child1, begin, mid, left); },
+                                 [&] { build(child2, mid, end, right); });
+        } else {
+            build(child1, begin, mid, left);
+            build(child2, mid, end, right);
+        }
+    }
+
+    bounds refit(bcg_index_t id) {
+        auto &nd = nodes[id];
+        if (nd.is_leaf()) {
+            bounds box = empty_bounds();
+            for (bcg_index_t i = nd.begin; i < nd.end; ++i) {
+                extend(box, indices[i]);
+            }
+            if (nd.bucket != invalid) {
+                for (const auto idx : buckets[nd.bucket]) {
+                    extend(box, idx);
+                }
+            }
+            return box;
+        }
+        bounds left, right;
+        if (nd.end - nd.begin > parallel_grain_size) {
+            tbb::parallel_invoke([&] { left = refit(nd.child1); }, [&] { right = refit(nd.child2); });
+        } else {
+            left = refit(nd.child1);
+            right = refit(nd.child2);
+        }
+        nd.divlow = left.high[nd.divfeat];
+        nd.divhigh = right.low[nd.divfeat];
+        merge(left, right);
+        return left;
+    }
+
+    // turns an overfull leaf into an inner node with two new leaves holding its points in buckets.
+    void split_leaf(bcg_index_t id) {
+        std::vector<bcg_index_t> points(indices.begin() + nodes[id].begin, indices.begin() + nodes[id].end);
+        auto &bucket = buckets[nodes[id].bucket];
+        points.insert(points.end(), bucket.begin(), bucket.end());
+        bucket.clear();
+
+        bounds box = empty_bounds();
+        for (const auto idx : points) {
+            extend(box, idx);
+        }
+        int dim = 0;
+        for (int k = 1; k < D; ++k) {
+            if (box.high[k] - box.low[k] > box.high[dim] - box.low[dim]) {
+                dim = k;
+            }
+        }
+        size_t mid = points.size() / 2;
+        std::nth_element(points.begin(), points.begin() + mid, points.end(), [&](bcg_index_t a, bcg_index_t b) {
+            return coordinate(a, dim) < coordinate(b, dim);
+        });
+
+        node child1, child2;
+        child1.bucket = nodes[id].bucket;
+        child2.bucket = new_bucket();
+        buckets[child1.bucket].assign(points.begin(), points.begin() + mid);
+        buckets[child2.bucket].assign(points.begin() + mid, points.end());
+        Real divlow = std::numeric_limits<Real>::lowest();
+        for (size_t i = 0; i < mid; ++i) {
+            divlow = std::max(divlow, coordinate(points[i], dim));
+        }
+
+        auto &nd = nodes[id];
+        nd.divfeat = dim;
+        nd.divlow = divlow;
+        nd.divhigh = coordinate(points[mid], dim);
+        nd.begin = nd.end = 0;
+        nd.bucket = invalid;
+        nd.child1 = bcg_index_t(nodes.size());
+        nd.child2 = bcg_index_t(nodes.size() + 1);
+        nodes.push_back(child1);
+        nodes.push_back(child2);
+    }
+
+    template<typename ResultSet>
+    inline void add_point(ResultSet &result, const Real *query, bcg_index_t idx) const {
+        if (num_removed && removed.test(idx)) {
+            return;
+        }
+        Real dist = 0;
+        for (int k = 0; k < D; ++k) {
+            Real diff = query[k] - coordinate(idx, k);
+            dist += diff * diff;
+        }
+        if (dist < result.worstDist()) {
+            result.addPoint(dist, idx);
+        }
+    }
+
+    template<typename ResultSet>
+    void search(ResultSet &result, const Real *query, bcg_index_t id) const {
+        const auto &nd = nodes[id];
+        if (nd.is_leaf()) {
+            for (bcg_index_t i = nd.begin; i < nd.end; ++i) {
+                add_point(result, query, indices[i]);
+            }
+            if (nd.bucket != invalid) {
+                for (const auto idx : buckets[nd.bucket]) {
+                    add_point(result, query, idx);
+                }
+            }
+            return;
+        }
+        Real value = query[nd.divfeat];
+        if (2 * value < nd.divlow + nd.divhigh) {
+            search(result, query, nd.child1);
+            Real diff = nd.divhigh - value;
+            if (diff <= 0 || diff * diff < result.worstDist()) {
+                search(result, query, nd.child2);
+            }
+        } else {
+            search(result, query, nd.child2);
+            Real diff = value - nd.divlow;
+            if (diff <= 0 || diff * diff < result.worstDist()) {
+                search(result, query, nd.child1);
+            }
+        }
+    }
+
+    std::vector<bcg_index_t> scratch;
+    std::atomic<bcg_index_t> num_nodes{0};
+};
+
+}
+
+#endif //BCG_GRAPHICS_BCG_KDTREE_INDEX_H
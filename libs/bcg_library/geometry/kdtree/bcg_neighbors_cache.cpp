@@ -0,0 +1,72 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include "bcg_neighbors_cache.h"
+
+namespace bcg {
+
+void neighbors_cache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    knn = entry();
+    radius = entry();
+}
+
+static neighbors_cache &get_cache(vertex_container *vertices) {
+    if (!vertices->neighborhoods) {
+        vertices->neighborhoods = std::make_shared<neighbors_cache>();
+    }
+    return *vertices->neighborhoods;
+}
+
+static bool is_current(const neighbors_cache::entry &entry, const base_property *positions, const void *index) {
+    return entry.neighbors && entry.positions == positions && entry.version == positions->version() &&
+           entry.size == positions->size() && entry.index == index;
+}
+
+static void stamp(neighbors_cache::entry &entry, const base_property *positions, const void *index) {
+    entry.positions = positions;
+    entry.version = positions->version();
+    entry.size = positions->size();
+    entry.index = index;
+}
+
+std::shared_ptr<const neighbors_batch> vertex_neighbors_knn(vertex_container *vertices,
+                                                            const kdtree_property<bcg_scalar_t> &index,
+                                                            size_t num_closest, size_t parallel_grain_size) {
+    auto positions = vertices->get<VectorS<3>, 3>("v_position");
+    auto *base = vertices->get_base_ptr("v_position");
+    auto &cache = get_cache(vertices);
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto &entry = cache.knn;
+    if (is_current(entry, base, index.index.get()) && entry.num_closest == num_closest) {
+        return entry.neighbors;
+    }
+    auto neighbors = std::make_shared<neighbors_batch>();
+    index.query_knn_batch(positions, num_closest, *neighbors, parallel_grain_size);
+    stamp(entry, base, index.index.get());
+    entry.num_closest = num_closest;
+    entry.neighbors = neighbors;
+    return neighbors;
+}
+
+std::shared_ptr<const neighbors_batch> vertex_neighbors_radius(vertex_container *vertices,
+                                                               const kdtree_property<bcg_scalar_t> &index,
+                                                               bcg_scalar_t radius, size_t parallel_grain_size) {
+    auto positions = vertices->get<VectorS<3>, 3>("v_position");
+    auto *base = vertices->get_base_ptr("v_position");
+    auto &cache = get_cache(vertices);
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto &entry = cache.radius;
+    if (is_current(entry, base, index.index.get()) && entry.radius == radius) {
+        return entry.neighbors;
+    }
+    auto neighbors = std::make_shared<neighbors_batch>();
+    index.query_radius_batch(positions, radius, *neighbors, parallel_grain_size);
+    stamp(entry, base, index.index.get());
+    entry.radius = radius;
+    entry.neighbors = neighbors;
+    return neighbors;
+}
+
+}
@@ -0,0 +1,47 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#ifndef BCG_GRAPHICS_BCG_NEIGHBORS_CACHE_H
+#define BCG_GRAPHICS_BCG_NEIGHBORS_CACHE_H
+
+#include <memory>
+#include <mutex>
+#include "bcg_kdtree.h"
+
+namespace bcg {
+
+// Vertex neighborhoods shared by all point cloud operators. Stored on the vertex_container and reused as long as
+// positions, kdtree and query parameters are unchanged. Positions count as changed once set_dirty() was called on
+// them (see base_property::version()).
+struct neighbors_cache {
+    struct entry {
+        const base_property *positions = nullptr;
+        size_t version = 0;
+        size_t size = 0;
+        const void *index = nullptr;
+        size_t num_closest = 0;
+        bcg_scalar_t radius = 0;
+        std::shared_ptr<const neighbors_batch> neighbors;
+    };
+
+    entry knn;
+    entry radius;
+    std::mutex mutex;
+
+    void clear();
+};
+
+// kNN neighborhoods of all vertices, computed with index on a cache miss.
+std::shared_ptr<const neighbors_batch> vertex_neighbors_knn(vertex_container *vertices,
+                                                            const kdtree_property<bcg_scalar_t> &index,
+                                                            size_t num_closest, size_t parallel_grain_size = 1024);
+
+// radius neighborhoods of all vertices, computed with index on a cache miss.
+std::shared_ptr<const neighbors_batch> vertex_neighbors_radius(vertex_container *vertices,
+                                                               const kdtree_property<bcg_scalar_t> &index,
+                                                               bcg_scalar_t radius, size_t parallel_grain_size = 1024);
+
+}
+
+#endif //BCG_GRAPHICS_BCG_NEIGHBORS_CACHE_H
@@ -85,6 +85,9 @@ halfedge_mesh marching_cubes::reconstruct(bcg_scalar_t isovalue, const VectorS<3
     size_t size = capacity();
     halfedge_mesh mesh;
     auto f_normals = mesh.faces.get_or_add<VectorS<3>, 3>("f_normal");
+    // triangle soup, each triangle has its own vertices
+    std::vector<VectorS<3>> points, normals;
+    std::vector<bcg_index_t> indices;
     auto edges = get_edges_mc(aabb);
     Vector<double, 8> sdf;
     for (size_t idx = 0; idx < size; ++idx) {
@@ -118,17 +121,20 @@ halfedge_mesh marching_cubes::reconstruct(bcg_scalar_t isovalue, const VectorS<3
         }
 
         for (int j = 0; triangle_table[cubeindex][j] != -1; j += 3) {
-            std::vector<vertex_handle> face(3);
             for (int k = 0; k < 3; ++k) {
-                face[k] = mesh.add_vertex(vertex_list[triangle_table[cubeindex][j + k]].cast<bcg_scalar_t>());
+                indices.push_back(points.size());
+                points.push_back(vertex_list[triangle_table[cubeindex][j + k]].cast<bcg_scalar_t>());
             }
-            mesh.add_face(face);
-            f_normals.back() = normal(
-                    triangle3(mesh.positions[face[0]], mesh.positions[face[1]], mesh.positions[face[2]]));
-
+            normals.push_back(normal(triangle3(points[points.size() - 3], points[points.size() - 2], points.back())));
         }
     }
 
+    auto faces = mesh.build_from_faces(points, indices);
+    for (size_t i = 0; i < faces.size(); ++i) {
+        if (faces[i].is_valid()) {
+            f_normals[faces[i]] = normals[i];
+        }
+    }
     return mesh;
 }
 
@@ -2,11 +2,14 @@
 // Created by alex on 13.10.20.
 //
 
+#include <unordered_map>
 #include "bcg_mesh.h"
+#include "tbb/tbb.h"
 #include "triangle/bcg_triangle.h"
 #include "distance_query/bcg_distance_triangle_point.h"
 #include "math/vector/bcg_vector_map_eigen.h"
 #include "utils/bcg_stl_utils.h"
+#include "bvh/bcg_triangle_bvh.h"
 
 namespace bcg {
 
@@ -35,6 +38,7 @@ void halfedge_mesh::assign(const halfedge_mesh &other) {
 
         // allocate standard properties
         fconn = faces.get_or_add<face_connectivity, 1>("f_connectivity");
+        faces_deleted = faces.get_or_add<bool, 1>("f_deleted");
 
         // copy properties from other mesh
         fconn.vector() = other.fconn.vector();
@@ -108,140 +112,53 @@ bool halfedge_mesh::has_garbage() const {
 }
 
 void halfedge_mesh::garbage_collection() {
-    size_t nV = vertices.size();
-    size_t nE = edges.size();
-    size_t nH = halfedges.size();
-    size_t nF = faces.size();
-
-    auto vmap = vertices.add<vertex_handle, 1>("v_garbage_collection");
-    auto hmap = halfedges.add<halfedge_handle, 1>("h_garbage_collection");
-    auto fmap = faces.add<face_handle, 1>("f_garbage_collection");
-
-    for (size_t i = 0; i < nV; ++i) {
-        vmap[i] = vertex_handle(i);
-    }
-    for (size_t i = 0; i < nH; ++i) {
-        hmap[i] = halfedge_handle(i);
-    }
-    for (size_t i = 0; i < nF; ++i) {
-        fmap[i] = face_handle(i);
-    }
-
-    if (nV > 0) {
-        size_t i0 = 0;
-        size_t i1 = nV - 1;
-
-        while (true) {
-            // find first deleted and last un-deleted
-            while (!vertices_deleted[i0] && i0 < i1) {
-                ++i0;
-            }
-            while (vertices_deleted[i1] && i0 < i1) {
-                --i1;
-            }
-            if (i0 >= i1) break;
-
-            // swap
-            vertices.swap(i0, i1);
-        }
-
-        // remember new size
-        nV = vertices_deleted[i0] ? i0 : i0 + 1;
-    }
-
-    if (nE > 0) {
-        size_t i0 = 0;
-        size_t i1 = nE - 1;
-
-        while (true) {
-            // find first deleted and last un-deleted
-            while (!edges_deleted[i0] && i0 < i1) {
-                ++i0;
-            }
-            while (edges_deleted[i1] && i0 < i1) {
-                --i1;
-            }
-            if (i0 >= i1) break;
-
-            // swap
-            edges.swap(i0, i1);
-            halfedges.swap(2 * i0, 2 * i1);
-            halfedges.swap(2 * i0 + 1, 2 * i1 + 1);
-        }
-
-        // remember new size
-        nE = edges_deleted[i0] ? i0 : i0 + 1;
-        nH = 2 * nE;
-    }
-
-    if (nF > 0) {
-        size_t i0 = 0;
-        size_t i1 = nF - 1;
-
-        while (true) {
-            // find 1st deleted and last un-deleted
-            while (!faces_deleted[i0] && i0 < i1) {
-                ++i0;
-            }
-            while (faces_deleted[i1] && i0 < i1) {
-                --i1;
-            }
-            if (i0 >= i1) break;
-
-            // swap
-            faces.swap(i0, i1);
+    if (!has_garbage()) return;
+
+    // surviving elements keep their order, the halfedges of an edge stay next to each other
+    auto kept_vertices = kept_indices(vertices_deleted.vector());
+    auto kept_edges = kept_indices(edges_deleted.vector());
+    auto kept_faces = kept_indices(faces_deleted.vector());
+    std::vector<handle_index_t> kept_halfedges(2 * kept_edges.size());
+    tbb::parallel_for(size_t(0), kept_edges.size(), [&](size_t i) {
+        kept_halfedges[2 * i] = 2 * kept_edges[i];
+        kept_halfedges[2 * i + 1] = 2 * kept_edges[i] + 1;
+    });
+    auto vmap = compaction_map(kept_vertices, vertices.size());
+    auto hmap = compaction_map(kept_halfedges, halfedges.size());
+    auto fmap = compaction_map(kept_faces, faces.size());
+
+    vertices.compact(kept_vertices);
+    halfedges.compact(kept_halfedges);
+    edges.compact(kept_edges);
+    faces.compact(kept_faces);
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, vertices.size()), [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t v = range.begin(); v != range.end(); ++v) {
+            vconn[v].h = halfedge_handle(map_index(hmap, vconn[v].h.idx));
         }
-
-        // remember new size
-        nF = faces_deleted[i0] ? i0 : i0 + 1;
-    }
-
-    // update vertex connectivity
-    vertex_handle v;
-    for (size_t i = 0; i < nV; ++i) {
-        v = vertex_handle(i);
-        if (!is_isolated(v)) {
-            halfedge_graph::set_halfedge(v, hmap[halfedge_graph::get_halfedge(v)]);
+    });
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, halfedges.size()), [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t h = range.begin(); h != range.end(); ++h) {
+            auto &connectivity = hconn[h];
+            connectivity.v = vertex_handle(map_index(vmap, connectivity.v.idx));
+            connectivity.nh = halfedge_handle(map_index(hmap, connectivity.nh.idx));
+            connectivity.ph = halfedge_handle(map_index(hmap, connectivity.ph.idx));
+            connectivity.f = face_handle(map_index(fmap, connectivity.f.idx));
         }
-    }
-
-    // update halfedge connectivity
-    halfedge_handle h;
-    for (size_t i = 0; i < nH; ++i) {
-        h = halfedge_handle(i);
-        halfedge_graph::set_vertex(h, vmap[halfedge_graph::get_to_vertex(h)]);
-        halfedge_graph::set_next(h, hmap[halfedge_graph::get_next(h)]);
-        if (!is_boundary(h)) {
-            set_face(h, fmap[get_face(h)]);
+    });
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, faces.size()), [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t f = range.begin(); f != range.end(); ++f) {
+            fconn[f].h = halfedge_handle(map_index(hmap, fconn[f].h.idx));
         }
-    }
-
-    // update handles of faces
-    face_handle f;
-    for (size_t i = 0; i < nF; ++i) {
-        f = face_handle(i);
-        set_halfedge(f, hmap[get_halfedge(f)]);
-    }
-
-    // remove handle maps
-    vertices.remove(vmap);
-    halfedges.remove(hmap);
-    faces.remove(fmap);
-
-    // finally resize arrays
-    vertices.resize(nV);
-    vertices.free_unused_memory();
-    halfedges.resize(nH);
-    halfedges.free_unused_memory();
-    edges.resize(nE);
-    edges.free_unused_memory();
-    faces.resize(nF);
-    faces.free_unused_memory();
+    });
 
     size_faces_deleted = 0;
     size_edges_deleted = 0;
     size_halfedges_deleted = 0;
     size_vertices_deleted = 0;
+    vertex_index_cache.reset();
+    edge_index_cache.reset();
+    face_index_cache.reset();
 
     assert(!has_garbage());
     assert(vertices.is_dirty());
@@ -639,6 +556,260 @@ face_handle halfedge_mesh::add_quad(vertex_handle v0, vertex_handle v1, vertex_h
     return add_face({v0, v1, v2, v3});
 }
 
+std::vector<face_handle> halfedge_mesh::build_from_faces(const std::vector<position_t> &points,
+                                                         const std::vector<bcg_index_t> &indices,
+                                                         const std::vector<bcg_index_t> &offsets) {
+    vertices.clear();
+    vertices.resize(points.size());
+    positions.vector().assign(points.begin(), points.end());
+    positions.set_dirty();
+    return build_from_faces(indices, offsets);
+}
+
+std::vector<face_handle> halfedge_mesh::build_from_faces(const std::vector<bcg_index_t> &indices,
+                                                         const std::vector<bcg_index_t> &offsets) {
+    size_t num_input_faces = offsets.empty() ? indices.size() / 3 : offsets.size() - 1;
+    auto first = [&offsets](size_t i) -> size_t { return offsets.empty() ? 3 * i : offsets[i]; };
+    size_t nv = vertices.size();
+
+    std::vector<uint8_t> skipped(num_input_faces, 0);
+    tbb::parallel_for(size_t(0), num_input_faces, [&](size_t i) {
+        size_t begin = first(i), end = first(i + 1);
+        if (end < begin + 3 || end > indices.size()) {
+            skipped[i] = 1;
+            return;
+        }
+        for (size_t c = begin; c < end; ++c) {
+            if (indices[c] >= nv || vertices_deleted[vertex_handle(indices[c])] ||
+                std::find(indices.begin() + c + 1, indices.begin() + end, indices[c]) != indices.begin() + end) {
+                skipped[i] = 1;
+                return;
+            }
+        }
+    });
+
+    // every failed pass skips at least one more face
+    while (!build_connectivity(indices, offsets, skipped)) {}
+
+    std::vector<face_handle> result(num_input_faces);
+    size_t num_skipped = 0;
+    for (size_t i = 0, f = 0; i < num_input_faces; ++i) {
+        if (skipped[i]) {
+            ++num_skipped;
+        } else {
+            result[i] = face_handle(f++);
+        }
+    }
+    if (num_skipped > 0) {
+        std::cerr << "build_from_faces: skipped " << num_skipped << " degenerate or non-manifold faces!\n";
+    }
+    return result;
+}
+
+bool halfedge_mesh::build_connectivity(const std::vector<bcg_index_t> &indices,
+                                       const std::vector<bcg_index_t> &offsets, std::vector<uint8_t> &skipped) {
+    size_t num_input_faces = skipped.size();
+    auto first = [&offsets](size_t i) -> size_t { return offsets.empty() ? 3 * i : offsets[i]; };
+    size_t nv = vertices.size();
+
+    halfedges.clear();
+    edges.clear();
+    faces.clear();
+    // deleted vertices stay deleted, faces using them were skipped
+    vconn.reset(vertex_connectivity());
+    size_vertices_deleted = vertices_deleted.vector().count();
+    size_halfedges_deleted = size_edges_deleted = size_faces_deleted = 0;
+    edge_index_cache.reset();
+    face_index_cache.reset();
+
+    // corners of kept faces, in input order
+    std::vector<size_t> face_ids(num_input_faces + 1, 0);
+    for (size_t i = 0; i < num_input_faces; ++i) {
+        face_ids[i + 1] = face_ids[i] + !skipped[i];
+    }
+    std::vector<bcg_index_t> corner_face(indices.size(), BCG_INVALID_HANDLE_ID);
+    tbb::parallel_for(size_t(0), num_input_faces, [&](size_t i) {
+        if (!skipped[i]) {
+            std::fill(corner_face.begin() + first(i), corner_face.begin() + first(i + 1), bcg_index_t(i));
+        }
+    });
+    auto next_corner = [&](size_t c) {
+        size_t i = corner_face[c];
+        return c + 1 == first(i + 1) ? first(i) : c + 1;
+    };
+
+    // directed edges sorted by undirected edge and corner: a counting sort by the smaller vertex, then each (small)
+    // bucket is sorted by the larger vertex. Corners of skipped faces are left out.
+    std::vector<size_t> bucket_offsets(nv + 1, 0);
+    for (size_t c = 0; c < indices.size(); ++c) {
+        if (corner_face[c] != BCG_INVALID_HANDLE_ID) {
+            ++bucket_offsets[std::min(indices[c], indices[next_corner(c)]) + 1];
+        }
+    }
+    for (size_t v = 0; v < nv; ++v) {
+        bucket_offsets[v + 1] += bucket_offsets[v];
+    }
+    std::vector<std::pair<uint64_t, bcg_index_t>> keys(bucket_offsets.back());
+    {
+        std::vector<size_t> cursor(bucket_offsets.begin(), bucket_offsets.end() - 1);
+        for (size_t c = 0; c < indices.size(); ++c) {
+            if (corner_face[c] == BCG_INVALID_HANDLE_ID) continue;
+            uint64_t v0 = indices[c], v1 = indices[next_corner(c)];
+            keys[cursor[std::min(v0, v1)]++] = {std::min(v0, v1) << 32u | std::max(v0, v1), bcg_index_t(c)};
+        }
+    }
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, nv, 1 << 12), [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t v = range.begin(); v != range.end(); ++v) {
+            std::sort(keys.begin() + bucket_offsets[v], keys.begin() + bucket_offsets[v + 1]);
+        }
+    });
+
+    // the first corner of an edge takes its even halfedge, the first corner in opposite direction the odd one. All
+    // further corners would make the edge non-manifold or flip the orientation of a face. Edges are numbered in the
+    // order of their first corner, as add_face would create them.
+    std::vector<bcg_index_t> corner_halfedge(indices.size());
+    std::vector<uint8_t> is_first_corner(indices.size(), 0);
+    size_t num_edges = 0;
+    bool consistent = true;
+    for (size_t i = 0; i < keys.size(); ++num_edges) {
+        auto c0 = keys[i].second;
+        bool forward = indices[c0] < indices[next_corner(c0)];
+        corner_halfedge[c0] = 2 * num_edges;
+        is_first_corner[c0] = 1;
+        bool is_boundary = true;
+        size_t j = i + 1;
+        for (; j < keys.size() && keys[j].first == keys[i].first; ++j) {
+            auto c = keys[j].second;
+            if (is_boundary && (indices[c] < indices[next_corner(c)]) != forward) {
+                corner_halfedge[c] = 2 * num_edges + 1;
+                is_boundary = false;
+            } else {
+                skipped[corner_face[c]] = 1;
+                consistent = false;
+            }
+        }
+        i = j;
+    }
+    if (!consistent) {
+        return false;
+    }
+    std::vector<bcg_index_t> edge_ids(num_edges);
+    std::vector<uint8_t> edge_is_boundary(num_edges, 1);
+    for (size_t c = 0, e = 0; c < indices.size(); ++c) {
+        if (is_first_corner[c]) edge_ids[corner_halfedge[c] / 2] = e++;
+    }
+    for (size_t c = 0; c < indices.size(); ++c) {
+        if (corner_face[c] == BCG_INVALID_HANDLE_ID) continue;
+        auto h = corner_halfedge[c];
+        corner_halfedge[c] = 2 * edge_ids[h / 2] + h % 2;
+        if (h % 2) edge_is_boundary[edge_ids[h / 2]] = 0;
+    }
+
+    halfedges.resize(2 * num_edges);
+    edges.resize(num_edges);
+    faces.resize(face_ids.back());
+
+    // face cycles, each face writes only its own halfedges and the opposite boundary halfedges
+    tbb::parallel_for(size_t(0), num_input_faces, [&](size_t i) {
+        if (skipped[i]) return;
+        face_handle f(face_ids[i]);
+        size_t begin = first(i), end = first(i + 1);
+        for (size_t c = begin; c < end; ++c) {
+            size_t cn = c + 1 == end ? begin : c + 1;
+            halfedge_handle h(corner_halfedge[c]), nh(corner_halfedge[cn]);
+            hconn[h].v = vertex_handle(indices[cn]);
+            hconn[h].f = f;
+            hconn[h].nh = nh;
+            hconn[nh].ph = h;
+            if (edge_is_boundary[h.idx / 2]) {
+                hconn[h.idx + 1].v = vertex_handle(indices[c]);
+            }
+        }
+        fconn[f].h = halfedge_handle(corner_halfedge[end - 1]);
+    });
+
+    // outgoing halfedges of the vertices, in the first face or on the boundary where there is one. Written serially,
+    // a vertex is shared by many faces.
+    std::vector<bcg_index_t> num_corners(nv, 0);
+    for (size_t c = 0; c < indices.size(); ++c) {
+        if (corner_face[c] != BCG_INVALID_HANDLE_ID) {
+            if (num_corners[indices[c]]++ == 0) vconn[indices[c]].h = halfedge_handle(corner_halfedge[c]);
+        }
+    }
+    std::vector<std::pair<bcg_index_t, bcg_index_t>> boundary;
+    for (size_t e = 0; e < num_edges; ++e) {
+        if (edge_is_boundary[e]) {
+            halfedge_handle o(2 * e + 1);
+            vertex_handle v = get_from_vertex(o);
+            vconn[v].h = o;
+            boundary.emplace_back(v.idx, o.idx);
+        }
+    }
+
+    // close the boundary loops. At a vertex with several fans, the incoming boundary halfedge of each fan is linked
+    // to the outgoing one of the next fan, so that one rotation around the vertex visits all of them.
+    tbb::parallel_sort(boundary.begin(), boundary.end());
+    auto incoming_boundary = [this](halfedge_handle o, size_t &num_faces) {
+        halfedge_handle h = get_opposite(o);
+        for (num_faces = 1; num_faces <= halfedges.size(); ++num_faces) {
+            halfedge_handle oh = get_opposite(hconn[h].nh);
+            if (!hconn[oh].f.is_valid()) return oh;
+            h = oh;
+        }
+        return halfedge_handle();
+    };
+    std::vector<size_t> runs;
+    for (size_t i = 0; i < boundary.size(); ++i) {
+        if (i == 0 || boundary[i].first != boundary[i - 1].first) runs.push_back(i);
+    }
+    runs.push_back(boundary.size());
+    std::vector<uint8_t> non_manifold(nv, 0);
+    tbb::parallel_for(size_t(0), runs.size() - 1, [&](size_t r) {
+        size_t num_faces = 0, total = 0;
+        for (size_t i = runs[r]; i < runs[r + 1]; ++i) {
+            halfedge_handle in = incoming_boundary(halfedge_handle(boundary[i].second), num_faces);
+            halfedge_handle out(boundary[i + 1 == runs[r + 1] ? runs[r] : i + 1].second);
+            hconn[in].nh = out;
+            hconn[out].ph = in;
+            total += num_faces;
+        }
+        non_manifold[boundary[runs[r]].first] = total != num_corners[boundary[runs[r]].first];
+    });
+
+    // interior vertices have a single closed fan
+    tbb::parallel_for(size_t(0), nv, [&](size_t v) {
+        halfedge_handle h = vconn[v].h;
+        if (!h.is_valid() || !hconn[h].f.is_valid() || !hconn[get_opposite(h)].f.is_valid()) return;
+        size_t count = 0;
+        do {
+            h = hconn[get_opposite(h)].nh;
+        } while (++count <= num_corners[v] && h != vconn[v].h);
+        non_manifold[v] = count != num_corners[v];
+    });
+
+    // faces at non-manifold vertices that are not in the fan(s) reachable from the vertex's halfedge are skipped
+    std::unordered_map<bcg_index_t, std::vector<bcg_index_t>> reached;
+    for (size_t v = 0; v < nv; ++v) {
+        if (!non_manifold[v]) continue;
+        auto &fans = reached[v];
+        halfedge_handle h = vconn[v].h;
+        for (size_t count = 0; count <= num_corners[v]; ++count) {
+            if (hconn[h].f.is_valid()) fans.push_back(hconn[h].f.idx);
+            h = hconn[get_opposite(h)].nh;
+            if (h == vconn[v].h) break;
+        }
+    }
+    for (size_t c = 0; c < indices.size() && !reached.empty(); ++c) {
+        if (corner_face[c] == BCG_INVALID_HANDLE_ID || !non_manifold[indices[c]]) continue;
+        const auto &fans = reached[indices[c]];
+        if (std::find(fans.begin(), fans.end(), face_ids[corner_face[c]]) == fans.end()) {
+            skipped[corner_face[c]] = 1;
+            consistent = false;
+        }
+    }
+    return consistent;
+}
+
 void halfedge_mesh::adjust_outgoing_halfedge(vertex_handle v) {
     halfedge_handle h = halfedge_graph::get_halfedge(v);
     const halfedge_handle hh = h;
@@ -740,6 +911,7 @@ void halfedge_mesh::delete_face(face_handle f) {
         adjust_outgoing_halfedge(*vit);
     }
 
+    mark_connectivity_changed();
     assert(has_garbage());
 }
 
@@ -785,6 +957,7 @@ void halfedge_mesh::remove_edge(edge_handle e) {
     mark_face_deleted(f0);
     mark_edge_deleted(e);
 
+    mark_connectivity_changed();
     assert(has_garbage());
 }
 
@@ -1021,6 +1194,7 @@ void halfedge_mesh::triangulate(face_handle f) {
     halfedge_graph::set_next(halfedge_graph::get_next(nh), h);
 
     set_face(h, f);
+    mark_connectivity_changed();
 }
 
 void halfedge_mesh::collapse(halfedge_handle h0) {
@@ -1040,12 +1214,47 @@ void halfedge_mesh::collapse(halfedge_handle h0) {
         remove_loop_helper(o1);
     }
 
+    mark_connectivity_changed();
     assert(faces.is_dirty());
     assert(edges.is_dirty());
     assert(has_garbage());
 }
 
-void halfedge_mesh::remove_edge_helper(halfedge_handle h) {
+void halfedge_mesh::removed_elements::clear() {
+    vertices.clear();
+    edges.clear();
+    faces.clear();
+}
+
+void halfedge_mesh::collapse(halfedge_handle h0, removed_elements &removed) {
+    halfedge_handle h1 = halfedge_graph::get_prev(h0);
+    halfedge_handle o0 = halfedge_graph::get_opposite(h0);
+    halfedge_handle o1 = halfedge_graph::get_next(o0);
+
+    remove_edge_helper(h0, &removed);
+
+    if (halfedge_graph::get_next(halfedge_graph::get_next(h1)) == h1) {
+        remove_loop_helper(h1, &removed);
+    }
+    if (halfedge_graph::get_next(halfedge_graph::get_next(o1)) == o1) {
+        remove_loop_helper(o1, &removed);
+    }
+}
+
+void halfedge_mesh::mark_deleted(const removed_elements &removed) {
+    for (const auto v : removed.vertices) {
+        mark_vertex_deleted(v);
+    }
+    for (const auto e : removed.edges) {
+        mark_edge_deleted(e);
+    }
+    for (const auto f : removed.faces) {
+        mark_face_deleted(f);
+    }
+    mark_connectivity_changed();
+}
+
+void halfedge_mesh::remove_edge_helper(halfedge_handle h, removed_elements *removed) {
     halfedge_handle hn = halfedge_graph::get_next(h);
     halfedge_handle hp = halfedge_graph::get_prev(h);
 
@@ -1085,13 +1294,18 @@ void halfedge_mesh::remove_edge_helper(halfedge_handle h) {
     adjust_outgoing_halfedge(vh);
     halfedge_graph::set_halfedge(vo, halfedge_handle());
 
+    if (removed) {
+        removed->vertices.push_back(vo);
+        removed->edges.push_back(halfedge_graph::get_edge(h));
+        return;
+    }
     mark_vertex_deleted(vo);
     mark_edge_deleted(halfedge_graph::get_edge(h));
 
     assert(has_garbage());
 }
 
-void halfedge_mesh::remove_loop_helper(halfedge_handle h0) {
+void halfedge_mesh::remove_loop_helper(halfedge_handle h0, removed_elements *removed) {
     halfedge_handle h1 = halfedge_graph::get_next(h0);
 
     halfedge_handle o0 = halfedge_graph::get_opposite(h0);
@@ -1125,6 +1339,13 @@ void halfedge_mesh::remove_loop_helper(halfedge_handle h0) {
     }
 
     // delete stuff
+    if (removed) {
+        if (fh.is_valid()) {
+            removed->faces.push_back(fh);
+        }
+        removed->edges.push_back(halfedge_graph::get_edge(h0));
+        return;
+    }
     if (fh.is_valid()) {
         mark_face_deleted(fh);
     }
@@ -1175,7 +1396,8 @@ vertex_handle halfedge_mesh::split(face_handle f, vertex_handle v) {
 
     set_face(hold, f);
 
-    halfedge_graph::set_halfedge(v, hold);;
+    halfedge_graph::set_halfedge(v, hold);
+    mark_connectivity_changed();
     assert(faces.is_dirty());
     assert(edges.is_dirty());
     return v;
@@ -1272,6 +1494,7 @@ halfedge_handle halfedge_mesh::split(edge_handle e, vertex_handle v) {
         halfedge_graph::set_halfedge(v2, t1);
     }
 
+    mark_connectivity_changed();
     return t1;
 }
 
@@ -1334,7 +1557,7 @@ halfedge_handle halfedge_mesh::insert_vertex(halfedge_handle h0, vertex_handle v
         set_halfedge(fo, o1);
     }
 
-    fconn.set_dirty();
+    mark_connectivity_changed();
     assert(vertices.is_dirty());
     assert(edges.is_dirty());
     assert(halfedges.is_dirty());
@@ -1370,12 +1593,20 @@ halfedge_handle halfedge_mesh::insert_edge(halfedge_handle h0, halfedge_handle h
         h = halfedge_graph::get_next(h);
     } while (h != h2);
 
+    mark_connectivity_changed();
     assert(edges.is_dirty());
     assert(faces.is_dirty());
     return h4;
 }
 
 void halfedge_mesh::flip(edge_handle e) {
+    flip_deferred(e);
+    mark_connectivity_changed();
+    assert(faces.is_dirty());
+    assert(edges.is_dirty());
+}
+
+void halfedge_mesh::flip_deferred(edge_handle e) {
     assert(is_flip_ok(e));
 
     halfedge_handle a0 = halfedge_graph::get_halfedge(e, 0);
@@ -1419,9 +1650,11 @@ void halfedge_mesh::flip(edge_handle e) {
     if (halfedge_graph::get_halfedge(vb0) == a0) {
         halfedge_graph::set_halfedge(vb0, b1);
     }
+}
 
-    assert(faces.is_dirty());
-    assert(edges.is_dirty());
+void halfedge_mesh::mark_connectivity_changed() {
+    hconn.set_dirty();
+    fconn.set_dirty();
 }
 
 property<VectorI<3>, 3> halfedge_mesh::get_triangles() {
@@ -1464,87 +1697,57 @@ property<VectorI<6>, 6> halfedge_mesh::get_triangles_adjacencies() {
     return triangle_adjacencies;
 }
 
-face_handle halfedge_mesh::find_closest_face(const position_t &point) const {
-    distance_point3_triangle3 distance;
-    face_handle closest_yet;
-    bcg_scalar_t min_distance = scalar_max;
-    for (const auto f : faces) {
-        halfedge_handle h = get_halfedge(f);
+struct halfedge_mesh::face_index {
+    std::unique_ptr<triangle_bvh> tree;
+    const base_property *positions = nullptr;
+    size_t version = 0;
+    size_t connectivity_version = 0;
+    size_t size = 0;
+    size_t num_deleted = 0;
+};
 
-        triangle3 triangle(positions[halfedge_graph::get_to_vertex(halfedge_graph::get_next(h))],
-                           positions[halfedge_graph::get_to_vertex(h)],
-                           positions[halfedge_graph::get_from_vertex(h)]);
-
-        bcg_scalar_t dist = distance(point, triangle).distance;
-        if (dist < min_distance) {
-            min_distance = dist;
-            closest_yet = f;
-        }
-        if (dist == 0) break;
+std::shared_ptr<const halfedge_mesh::face_index> halfedge_mesh::get_face_index() const {
+    std::lock_guard<std::mutex> lock(face_index_cache.mutex);
+    auto &index = face_index_cache.index;
+    auto *base = vertices.get_base_ptr("v_position");
+    size_t connectivity_version = hconn.version() + fconn.version();
+    if (!index || index->positions != base || index->version != positions.version() ||
+        index->connectivity_version != connectivity_version || index->size != faces.size() ||
+        index->num_deleted != size_faces_deleted) {
+        index = std::make_shared<face_index>();
+        index->tree = std::make_unique<triangle_bvh>(*this);
+        index->positions = base;
+        index->version = positions.version();
+        index->connectivity_version = connectivity_version;
+        index->size = faces.size();
+        index->num_deleted = size_faces_deleted;
     }
-    return closest_yet;
+    return index;
 }
 
-std::vector<face_handle> halfedge_mesh::find_closest_k_face(const position_t &point, size_t k) const {
-    distance_point3_triangle3 distance;
-    using DistIndex = std::pair<bcg_scalar_t, face_handle>;
-    std::vector<DistIndex> closest_k;
-
-    for (const auto f : faces) {
-        halfedge_handle h = get_halfedge(f);
-
-        triangle3 triangle(positions[halfedge_graph::get_to_vertex(halfedge_graph::get_next(h))],
-                           positions[halfedge_graph::get_to_vertex(h)],
-                           positions[halfedge_graph::get_from_vertex(h)]);
-
-        bcg_scalar_t dist = distance(point, triangle).distance;
-        if (closest_k.size() < k + 1) {
-            closest_k.emplace_back(dist, f);
-            if (closest_k.size() == k) {
-                std::sort(closest_k.begin(), closest_k.end(), [](const DistIndex &lhs, const DistIndex &rhs) {
-                    return lhs.first < rhs.first;
-                });
-                break;
-            }
-            continue;
-        }
+static std::vector<face_handle> to_face_handles(const std::vector<triangle_bvh::NearestNeighbor> &result) {
+    std::vector<face_handle> faces;
+    faces.reserve(result.size());
+    for (const auto &item : result) {
+        faces.push_back(item.face);
+    }
+    return faces;
+}
 
-        if (dist < closest_k.back().first) {
-            closest_k.back() = std::make_pair(dist, f);
-            std::sort(closest_k.begin(), closest_k.end(), [](const DistIndex &lhs, const DistIndex &rhs) {
-                return lhs.first < rhs.first;
-            });
-        }
+face_handle halfedge_mesh::find_closest_face(const position_t &point) const {
+    return get_face_index()->tree->nearest(point).face;
+}
 
-    }
-    std::vector<face_handle> indices;
-    unzip<bcg_scalar_t, face_handle>(closest_k, nullptr, &indices);
-    return indices;
+std::vector<face_handle> halfedge_mesh::find_closest_k_face(const position_t &point, size_t k) const {
+    return to_face_handles(get_face_index()->tree->nearest_k(point, k));
 }
 
 std::vector<face_handle> halfedge_mesh::find_closest_faces(const position_t &point, bcg_scalar_t radius) const {
-    distance_point3_triangle3 distance;
-    using DistIndex = std::pair<bcg_scalar_t, face_handle>;
-    std::vector<DistIndex> closest;
-    for (const auto v : this->vertices) {
-        for (const auto h : halfedge_graph::get_halfedges(v)) {
-            triangle3 triangle(positions[halfedge_graph::get_to_vertex(halfedge_graph::get_next(h))],
-                               positions[halfedge_graph::get_to_vertex(h)],
-                               positions[halfedge_graph::get_from_vertex(h)]);
-
-            auto dist = distance(point, triangle).distance;
-            if (dist <= radius) {
-                closest.emplace_back(dist, get_face(h));
-            }
-        }
-    }
+    return to_face_handles(get_face_index()->tree->nearest_radius(point, radius));
+}
 
-    std::sort(closest.begin(), closest.end(), [](const DistIndex &lhs, const DistIndex &rhs) {
-        return lhs.first < rhs.first;
-    });
-    std::vector<face_handle> indices;
-    unzip<bcg_scalar_t, face_handle>(closest, nullptr, &indices);
-    return indices;
+std::vector<face_handle> halfedge_mesh::find_closest_face_batch(const std::vector<position_t> &points) const {
+    return to_face_handles(get_face_index()->tree->nearest_batch(points));
 }
 
 face_handle halfedge_mesh::find_closest_face_in_neighborhood(vertex_handle v, const position_t &point) const {
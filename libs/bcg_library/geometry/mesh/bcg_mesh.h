@@ -23,6 +23,8 @@ struct halfedge_mesh : public halfedge_graph {
         }
     };
 
+    static_assert(sizeof(face_connectivity) == 4, "face_connectivity must stay packed");
+
     face_container faces;
     property<face_connectivity, 1> fconn;
     property<bool, 1> faces_deleted;
@@ -32,6 +34,10 @@ struct halfedge_mesh : public halfedge_graph {
 
     ~halfedge_mesh() override = default;
 
+    halfedge_mesh(const halfedge_mesh &) = default;
+
+    halfedge_mesh(halfedge_mesh &&) = default;
+
     void assign(const halfedge_mesh &other);
 
     halfedge_mesh &operator=(const halfedge_mesh &other);
@@ -88,6 +94,19 @@ struct halfedge_mesh : public halfedge_graph {
 
     face_handle add_quad(vertex_handle v0, vertex_handle v1, vertex_handle v2, vertex_handle v3);
 
+    // Builds all faces at once: face i has the vertices indices[offsets[i], offsets[i + 1]), or indices[3 * i, 3 * i + 3)
+    // if offsets is empty. Replaces edges and faces and keeps the vertices. Halfedges are paired by sorting the
+    // directed edges, edges are numbered as add_face would create them. Degenerate faces and faces that would make an
+    // edge or vertex non-manifold are skipped, where earlier faces win. Deleted vertices stay deleted and faces using
+    // them are skipped. Returns the face of each input face, invalid if it was skipped.
+    std::vector<face_handle> build_from_faces(const std::vector<bcg_index_t> &indices,
+                                              const std::vector<bcg_index_t> &offsets = {});
+
+    // replaces the vertices by points as well.
+    std::vector<face_handle> build_from_faces(const std::vector<position_t> &points,
+                                              const std::vector<bcg_index_t> &indices,
+                                              const std::vector<bcg_index_t> &offsets = {});
+
     void adjust_outgoing_halfedge(vertex_handle v);
 
     void delete_face(face_handle f);
@@ -179,9 +198,26 @@ struct halfedge_mesh : public halfedge_graph {
 
     void collapse(halfedge_handle h);
 
-    void remove_edge_helper(halfedge_handle h);
+    //! elements removed by collapses that are not marked deleted yet
+    struct removed_elements {
+        std::vector<vertex_handle> vertices;
+        std::vector<edge_handle> edges;
+        std::vector<face_handle> faces;
+
+        void clear();
+    };
+
+    // Collapses h like collapse(h), but appends the removed elements to removed instead of marking them deleted. It
+    // only changes the connectivity of the faces around both vertices of h, so collapses whose vertices and their
+    // neighbors are disjoint can run concurrently, each thread with its own removed_elements.
+    void collapse(halfedge_handle h, removed_elements &removed);
+
+    //! marks the elements recorded by collapse(h, removed) deleted and calls mark_connectivity_changed()
+    void mark_deleted(const removed_elements &removed);
 
-    void remove_loop_helper(halfedge_handle h);
+    void remove_edge_helper(halfedge_handle h, removed_elements *removed = nullptr);
+
+    void remove_loop_helper(halfedge_handle h, removed_elements *removed = nullptr);
 
     vertex_handle split(face_handle f, const position_t &point);
 
@@ -201,24 +237,46 @@ struct halfedge_mesh : public halfedge_graph {
 
     void flip(edge_handle e);
 
+    // Flips e like flip(e), but does not bump the versions of hconn and fconn. It only changes the two faces of e and
+    // the outgoing halfedges of their vertices, so flips whose vertices are disjoint can run concurrently. Call
+    // mark_connectivity_changed() once they are done.
+    void flip_deferred(edge_handle e);
+
+    //! bumps the versions of hconn and fconn, which tells the cached spatial indices to rebuild
+    void mark_connectivity_changed();
+
     property<VectorI<3>, 3> get_triangles();
 
     property<VectorI<6>, 6> get_triangles_adjacencies();
 
+    // closest face queries are answered by a triangle_bvh over the faces, built on the first query. Later queries
+    // rebuild it if vertices moved or faces were added, deleted or reconnected (see base_property::version()).
     face_handle find_closest_face(const position_t &point) const;
 
     std::vector<face_handle> find_closest_k_face(const position_t &point, size_t k) const;
 
     std::vector<face_handle> find_closest_faces(const position_t &point, bcg_scalar_t radius) const;
 
+    std::vector<face_handle> find_closest_face_batch(const std::vector<position_t> &points) const;
+
     face_handle find_closest_face_in_neighborhood(vertex_handle v, const position_t &point) const;
 
     std::string to_string() const override;
+
+    struct face_index;
+    mutable lazy_index<face_index> face_index_cache;
+
 protected:
     face_handle new_face();
 
+    std::shared_ptr<const face_index> get_face_index() const;
+
     void mark_face_deleted(face_handle f);
 
+    // one pass of build_from_faces over the faces not yet skipped. False if it had to skip more faces.
+    bool build_connectivity(const std::vector<bcg_index_t> &indices, const std::vector<bcg_index_t> &offsets,
+                            std::vector<uint8_t> &skipped);
+
     std::vector<halfedge_handle> m_add_face_halfedges;
     std::vector<bool> m_add_face_is_new;
     std::vector<bool> m_add_face_needs_adjust;
@@ -105,16 +105,18 @@ std::vector<halfedge_mesh> mesh_connected_components_split(halfedge_mesh &mesh)
         v_new = parts[cc].add_vertex(mesh.positions[v]);
     }
 
-    face_handle f_new;
+    std::vector<std::vector<bcg_index_t>> indices(num_connected_components), offsets(num_connected_components, {0});
     for (const auto f : mesh.faces) {
-        std::vector<vertex_handle> face;
         int component = -1;
         for (const auto v : mesh.get_vertices(f)) {
-            face.emplace_back(index_map[v]);
             component = connected_components[v];
+            indices[component].push_back(index_map[v]);
         }
         if (component == -1) std::abort();
-        f_new = parts[component].add_face(face);
+        offsets[component].push_back(indices[component].size());
+    }
+    for (size_t i = 0; i < num_connected_components; ++i) {
+        parts[i].build_from_faces(indices[i], offsets[i]);
     }
 
     mesh.vertices.remove(index_map);
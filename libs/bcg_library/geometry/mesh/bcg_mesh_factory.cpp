@@ -112,4 +112,26 @@ halfedge_mesh mesh_factory::make_box(const aligned_box3 &aabb) {
     return mesh;
 }
 
+halfedge_mesh mesh_factory::make_grid(size_t rows, size_t cols) {
+    halfedge_mesh mesh;
+    mesh.vertices.reserve((rows + 1) * (cols + 1));
+    for (size_t i = 0; i <= rows; ++i) {
+        for (size_t j = 0; j <= cols; ++j) {
+            mesh.add_vertex(VectorS<3>(bcg_scalar_t(j) / cols, bcg_scalar_t(i) / rows, 0));
+        }
+    }
+
+    for (size_t i = 0; i < rows; ++i) {
+        for (size_t j = 0; j < cols; ++j) {
+            vertex_handle v0(i * (cols + 1) + j);
+            vertex_handle v1(i * (cols + 1) + j + 1);
+            vertex_handle v2((i + 1) * (cols + 1) + j + 1);
+            vertex_handle v3((i + 1) * (cols + 1) + j);
+            mesh.add_triangle(v0, v1, v2);
+            mesh.add_triangle(v0, v2, v3);
+        }
+    }
+    return mesh;
+}
+
 }
\ No newline at end of file
@@ -27,6 +27,8 @@ namespace bcg{
         halfedge_mesh make_box();
 
         halfedge_mesh make_box(const aligned_box3 &aabb);
+
+        halfedge_mesh make_grid(size_t rows, size_t cols);
     };
 }
 
@@ -0,0 +1,129 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <algorithm>
+#include "bcg_mesh_progressive.h"
+
+namespace bcg {
+
+size_t progressive_mesh::num_faces() const {
+    if (num_vertices == positions.size()) return indices.size() / 3;
+    return splits[positions.size() - 1 - num_vertices].num_faces;
+}
+
+static void replace_corner(std::vector<bcg_index_t> &indices, bcg_index_t f, bcg_index_t from, bcg_index_t to) {
+    for (size_t k = 3 * f; k < 3 * f + 3; ++k) {
+        if (indices[k] == from) {
+            indices[k] = to;
+            return;
+        }
+    }
+}
+
+void progressive_mesh::set_num_vertices(size_t n) {
+    n = std::max(num_base_vertices, std::min(n, positions.size()));
+    auto replay = [this](size_t i, bcg_index_t from, bcg_index_t to) {
+        size_t end = i + 1 < splits.size() ? splits[i + 1].begin : split_faces.size();
+        for (size_t k = splits[i].begin; k < end; ++k) {
+            replace_corner(indices, split_faces[k], from, to);
+        }
+    };
+    // coarsen, newest vertex first
+    while (num_vertices > n) {
+        size_t i = positions.size() - num_vertices;
+        replay(i, bcg_index_t(num_vertices - 1), splits[i].v1);
+        --num_vertices;
+    }
+    // refine, oldest removed vertex first
+    while (num_vertices < n) {
+        size_t i = positions.size() - 1 - num_vertices;
+        replay(i, splits[i].v1, bcg_index_t(num_vertices));
+        ++num_vertices;
+    }
+}
+
+void progressive_mesh::extract(halfedge_mesh &mesh) const {
+    std::vector<VectorS<3>> points(positions.begin(), positions.begin() + num_vertices);
+    std::vector<bcg_index_t> triangles(indices.begin(), indices.begin() + 3 * num_faces());
+    mesh.build_from_faces(points, triangles);
+}
+
+progressive_mesh_recorder::progressive_mesh_recorder(const halfedge_mesh &mesh) {
+    positions.assign(mesh.positions.vector().begin(), mesh.positions.vector().end());
+    triangles.reserve(3 * mesh.faces.size());
+    for (size_t i = 0; i < mesh.faces.size(); ++i) {
+        for (const auto v : mesh.get_vertices(face_handle(i))) {
+            triangles.push_back(v.idx);
+        }
+    }
+}
+
+void progressive_mesh_recorder::record(const halfedge_mesh &mesh, halfedge_handle v0v1) {
+    collapse c{};
+    c.v0 = mesh.get_from_vertex(v0v1).idx;
+    c.v1 = mesh.get_to_vertex(v0v1).idx;
+    auto fl = mesh.get_face(v0v1);
+    auto fr = mesh.get_face(mesh.get_opposite(v0v1));
+    c.fl = fl.idx;
+    c.fr = fr.idx;
+    c.begin = bcg_index_t(faces.size());
+    for (const auto f : mesh.get_faces(mesh.get_from_vertex(v0v1))) {
+        if (f != fl && f != fr) {
+            faces.push_back(f.idx);
+        }
+    }
+    collapses.push_back(c);
+}
+
+void progressive_mesh_recorder::finish(progressive_mesh &result) const {
+    size_t num_vertices = positions.size();
+    size_t num_faces = triangles.size() / 3;
+
+    // base elements keep their order, removed ones follow in reverse order of removal
+    std::vector<bcg_index_t> vmap(num_vertices, BCG_INVALID_HANDLE_ID);
+    std::vector<bcg_index_t> fmap(num_faces, BCG_INVALID_HANDLE_ID);
+    for (size_t i = 0; i < collapses.size(); ++i) {
+        vmap[collapses[i].v0] = bcg_index_t(num_vertices - 1 - i);
+    }
+    bcg_index_t next = 0;
+    for (size_t v = 0; v < num_vertices; ++v) {
+        if (vmap[v] == BCG_INVALID_HANDLE_ID) vmap[v] = next++;
+    }
+    bcg_index_t next_removed = bcg_index_t(num_faces);
+    for (const auto &c : collapses) {
+        if (c.fl != BCG_INVALID_HANDLE_ID) fmap[c.fl] = --next_removed;
+        if (c.fr != BCG_INVALID_HANDLE_ID) fmap[c.fr] = --next_removed;
+    }
+    next = 0;
+    for (size_t f = 0; f < num_faces; ++f) {
+        if (fmap[f] == BCG_INVALID_HANDLE_ID) fmap[f] = next++;
+    }
+
+    result.positions.resize(num_vertices);
+    for (size_t v = 0; v < num_vertices; ++v) {
+        result.positions[vmap[v]] = positions[v];
+    }
+    result.indices.resize(triangles.size());
+    for (size_t f = 0; f < num_faces; ++f) {
+        for (size_t k = 0; k < 3; ++k) {
+            result.indices[3 * fmap[f] + k] = vmap[triangles[3 * f + k]];
+        }
+    }
+    result.splits.resize(collapses.size());
+    result.split_faces.resize(faces.size());
+    size_t active_faces = num_faces;
+    for (size_t i = 0; i < collapses.size(); ++i) {
+        const auto &c = collapses[i];
+        active_faces -= (c.fl != BCG_INVALID_HANDLE_ID) + (c.fr != BCG_INVALID_HANDLE_ID);
+        result.splits[i] = {vmap[c.v1], bcg_index_t(active_faces), c.begin};
+    }
+    for (size_t i = 0; i < faces.size(); ++i) {
+        result.split_faces[i] = fmap[faces[i]];
+    }
+    result.num_base_vertices = num_vertices - collapses.size();
+    result.num_vertices = num_vertices;
+    result.set_num_vertices(result.num_base_vertices);
+}
+
+}
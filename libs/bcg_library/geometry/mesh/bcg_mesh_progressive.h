@@ -0,0 +1,71 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#ifndef BCG_GRAPHICS_BCG_MESH_PROGRESSIVE_H
+#define BCG_GRAPHICS_BCG_MESH_PROGRESSIVE_H
+
+#include <vector>
+#include "bcg_mesh.h"
+
+namespace bcg {
+
+// Triangle mesh between a simplified base mesh and the full mesh it was simplified from. Vertices are numbered base
+// vertices first, then in reverse order of their removal, faces likewise, so every level is a prefix of positions
+// and of indices. Halfedge collapses keep the positions, a level only differs in the face corners. Moving between
+// levels replays the recorded collapses or their vertex splits, linear in the number of levels passed.
+struct progressive_mesh {
+    // undoes the collapse that removed vertex v0 into v1: the faces whose corner v1 goes back to v0
+    struct vertex_split {
+        bcg_index_t v1;
+        // faces active once the vertex is removed
+        bcg_index_t num_faces;
+        // into split_faces
+        bcg_index_t begin;
+    };
+
+    std::vector<VectorS<3>> positions;
+    // 3 per face, corners of the current level
+    std::vector<bcg_index_t> indices;
+    // per collapse in the order they were applied, collapse i removes vertex positions.size() - 1 - i
+    std::vector<vertex_split> splits;
+    std::vector<bcg_index_t> split_faces;
+
+    size_t num_base_vertices = 0;
+    size_t num_vertices = 0;
+
+    [[nodiscard]] size_t num_faces() const;
+
+    // moves to the level with n vertices, clamped to the base and the full mesh
+    void set_num_vertices(size_t n);
+
+    // the current level as halfedge mesh
+    void extract(halfedge_mesh &mesh) const;
+};
+
+// Collects halfedge collapses in the ids of the full mesh while it is simplified.
+struct progressive_mesh_recorder {
+    // stores the positions and triangles of the full triangle mesh
+    explicit progressive_mesh_recorder(const halfedge_mesh &mesh);
+
+    // call before v0v1 is collapsed
+    void record(const halfedge_mesh &mesh, halfedge_handle v0v1);
+
+    // renumbers by removal order, result is at the base level
+    void finish(progressive_mesh &result) const;
+
+    struct collapse {
+        bcg_index_t v0, v1, fl, fr;
+        bcg_index_t begin;
+    };
+
+    std::vector<VectorS<3>> positions;
+    std::vector<bcg_index_t> triangles;
+    std::vector<collapse> collapses;
+    // faces around v0 except fl and fr, their corner v0 becomes v1
+    std::vector<bcg_index_t> faces;
+};
+
+}
+
+#endif //BCG_GRAPHICS_BCG_MESH_PROGRESSIVE_H
@@ -7,13 +7,14 @@
 #include "bcg_mesh_curvature_taubin.h"
 #include "bcg_mesh_edge_cotan.h"
 #include "bcg_mesh_triangle_area_from_metric.h"
-#include "kdtree/bcg_triangle_kdtree.h"
+#include "bvh/bcg_triangle_bvh.h"
 #include "tbb/tbb.h"
+#include <atomic>
 
 namespace bcg {
 
 struct remeshing {
-    remeshing(halfedge_mesh &mesh) : mesh(mesh), refmesh(nullptr), kd_tree(nullptr) {
+    remeshing(halfedge_mesh &mesh) : mesh(mesh), refmesh(nullptr), tree(nullptr) {
         points = mesh.positions;
 
         vertex_normals(mesh, vertex_normal_area_angle);
@@ -25,8 +26,11 @@ struct remeshing {
 
     size_t parallel_grain_size = 1024;
 
+    // rounds of independent collapses or flips per call
+    int max_rounds = 100;
+
     bool use_projection;
-    triangle_kdtree *kd_tree;
+    triangle_bvh *tree;
     //kdtree_property<bcg_scalar_t> *kdtreeProperty;
 
     bool uniform;
@@ -61,8 +65,14 @@ struct remeshing {
 
     void remove_caps();
 
+    // edge e too short and which of its halfedges to collapse, invalid if none
+    halfedge_handle collapse_target(edge_handle e) const;
+
+    // the reference is only read, vertices are projected in parallel
     void project_to_reference(vertex_handle v);
 
+    void project_to_reference(const std::vector<vertex_handle> &vertices);
+
     bool is_too_long(vertex_handle v0, vertex_handle v1) const {
         return (points[v0] - points[v1]).norm() >
                4.0 / 3.0 * std::min(vsizing[v0], vsizing[v1]);
@@ -300,22 +310,21 @@ void remeshing::preprocessing() {
             refsizing[v] = vsizing[v];
         }*/
 
-        // build kd-tree
-        kd_tree = new triangle_kdtree(*refmesh, 10);
+        // build bvh
+        tree = new triangle_bvh(*refmesh, 8, parallel_grain_size);
         //kdtreeProperty = new kdtree_property<bcg_scalar_t >(refpoints, 10);
     }
 }
 
 void remeshing::postprocessing() {
-// delete kd-tree and reference mesh
+// delete bvh and reference mesh
     if (use_projection) {
-        delete kd_tree;
+        delete tree;
         delete refmesh;
     }
 
     auto lines = mesh.edges.get_or_add<VectorI<2>, 2>("edges");
-    lines.vector() = mesh.get_connectivity();
-    lines.set_dirty();
+    lines.set(mesh.get_connectivity());
 
     auto triangles = mesh.edges.get_or_add<VectorI<3>, 3>("triangles");
     triangles = mesh.get_triangles();
@@ -327,189 +336,336 @@ void remeshing::postprocessing() {
     mesh.vertices.remove(vsizing);
 }
 
-void remeshing::split_long_edges() {
-    vertex_handle vnew, v0, v1;
-    edge_handle enew, e0, e1;
-    face_handle f0, f1, f2, f3;
-    bool ok, is_feature, is_boundary;
-    int i;
-
-    for (ok = false, i = 0; !ok && i < 10; ++i) {
-        ok = true;
-
-        halfedge_handle h_;
-        for (const auto e : mesh.edges) {
-            v0 = mesh.get_vertex(e, 0);
-            v1 = mesh.get_vertex(e, 1);
-
-            if (!elocked[e] && is_too_long(v0, v1)) {
-                const VectorS<3> &p0 = points[v0];
-                const VectorS<3> &p1 = points[v1];
-
-                is_feature = efeature[e];
-                is_boundary = mesh.is_boundary(e);
-
-                vnew = mesh.add_vertex((p0 + p1) * 0.5f);
-                h_ = mesh.split(e, vnew);
-
-                // need normal or sizing for adaptive refinement
-                vnormal[vnew] = vertex_normal_area_angle(mesh, vnew);
-                vsizing[vnew] = 0.5f * (vsizing[v0] + vsizing[v1]);
-
-                if (is_feature) {
-                    enew = is_boundary ? edge_handle(mesh.num_edges() - 2)
-                                       : edge_handle(mesh.num_edges() - 3);
-                    efeature[enew] = true;
-                    vfeature[vnew] = true;
-                } else {
-                    project_to_reference(vnew);
-                }
+// Picks candidates that do not conflict: candidate i claims the vertices it reads or changes (given by region) with
+// its rank i, the candidates owning all of their vertices are independent of each other. Rank 0 always wins.
+template<typename Region>
+static std::vector<unsigned char> independent_candidates(size_t count, size_t num_vertices, Region &&region,
+                                                         size_t parallel_grain_size) {
+    std::vector<std::atomic<handle_index_t>> claims(num_vertices);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_vertices, parallel_grain_size),
+                      [&](const tbb::blocked_range<size_t> &range) {
+                          for (size_t i = range.begin(); i != range.end(); ++i) {
+                              claims[i].store(BCG_INVALID_HANDLE_ID, std::memory_order_relaxed);
+                          }
+                      });
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, count, parallel_grain_size),
+                      [&](const tbb::blocked_range<size_t> &range) {
+                          for (size_t i = range.begin(); i != range.end(); ++i) {
+                              auto rank = handle_index_t(i);
+                              region(i, [&](vertex_handle v) {
+                                  auto &claim = claims[v.idx];
+                                  auto current = claim.load(std::memory_order_relaxed);
+                                  while (rank < current && !claim.compare_exchange_weak(current, rank)) {}
+                              });
+                          }
+                      });
+    std::vector<unsigned char> winner(count, 0);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, count, parallel_grain_size),
+                      [&](const tbb::blocked_range<size_t> &range) {
+                          for (size_t i = range.begin(); i != range.end(); ++i) {
+                              bool owns = true;
+                              region(i, [&](vertex_handle v) {
+                                  owns &= claims[v.idx].load(std::memory_order_relaxed) == i;
+                              });
+                              winner[i] = owns;
+                          }
+                      });
+    return winner;
+}
 
-                ok = false;
+// Orders candidates by a hash of their index. Like the serial sweep in edge order the result does not depend on the
+// thread count, but neighboring candidates get unrelated ranks so that each round finds a large independent set.
+template<typename T, typename Index>
+static void rank_candidates(std::vector<T> &candidates, Index &&index, size_t parallel_grain_size) {
+    auto hash = [](handle_index_t x) {
+        x = ((x >> 16) ^ x) * 0x45d9f3bu;
+        x = ((x >> 16) ^ x) * 0x45d9f3bu;
+        return (x >> 16) ^ x;
+    };
+    std::vector<std::pair<handle_index_t, T>> keyed(candidates.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, candidates.size(), parallel_grain_size),
+                      [&](const tbb::blocked_range<size_t> &range) {
+                          for (size_t i = range.begin(); i != range.end(); ++i) {
+                              keyed[i] = {hash(index(candidates[i])), candidates[i]};
+                          }
+                      });
+    tbb::parallel_sort(keyed.begin(), keyed.end(), [&](const auto &a, const auto &b) {
+        return a.first < b.first || (a.first == b.first && index(a.second) < index(b.second));
+    });
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        candidates[i] = keyed[i].second;
+    }
+}
+
+void remeshing::split_long_edges() {
+    std::vector<edge_handle> long_edges;
+    std::vector<vertex_handle> new_vertices;
+    tbb::enumerable_thread_specific<std::vector<edge_handle>> local_edges;
+
+    for (int i = 0; i < 10; ++i) {
+        // find the edges to split in parallel, splitting one edge leaves the others valid
+        tbb::parallel_for(tbb::blocked_range<uint32_t>(0u, (uint32_t) mesh.edges.size(), parallel_grain_size),
+                          [&](const tbb::blocked_range<uint32_t> &range) {
+                              auto &local = local_edges.local();
+                              for (uint32_t i = range.begin(); i != range.end(); ++i) {
+                                  auto e = edge_handle(i);
+                                  if (!mesh.edges_deleted[e] && !elocked[e] &&
+                                      is_too_long(mesh.get_vertex(e, 0), mesh.get_vertex(e, 1))) {
+                                      local.push_back(e);
+                                  }
+                              }
+                          });
+        long_edges.clear();
+        for (auto &local : local_edges) {
+            long_edges.insert(long_edges.end(), local.begin(), local.end());
+            local.clear();
+        }
+        if (long_edges.empty()) break;
+        std::sort(long_edges.begin(), long_edges.end());
+
+        // splits add elements and are cheap, they run serially
+        new_vertices.clear();
+        for (const auto e : long_edges) {
+            auto v0 = mesh.get_vertex(e, 0);
+            auto v1 = mesh.get_vertex(e, 1);
+            bool is_feature = efeature[e];
+            bool is_boundary = mesh.is_boundary(e);
+
+            auto vnew = mesh.add_vertex((points[v0] + points[v1]) * 0.5f);
+            mesh.split(e, vnew);
+            vsizing[vnew] = 0.5f * (vsizing[v0] + vsizing[v1]);
+
+            if (is_feature) {
+                auto enew = is_boundary ? edge_handle(mesh.num_edges() - 2)
+                                        : edge_handle(mesh.num_edges() - 3);
+                efeature[enew] = true;
+                vfeature[vnew] = true;
             }
+            new_vertices.push_back(vnew);
         }
+
+        // need normal or sizing for adaptive refinement
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, new_vertices.size(), parallel_grain_size),
+                          [&](const tbb::blocked_range<size_t> &range) {
+                              for (size_t i = range.begin(); i != range.end(); ++i) {
+                                  vnormal[new_vertices[i]] = vertex_normal_area_angle(mesh, new_vertices[i]);
+                              }
+                          });
+        new_vertices.erase(std::remove_if(new_vertices.begin(), new_vertices.end(), [&](vertex_handle v) {
+            return vfeature[v];
+        }), new_vertices.end());
+        project_to_reference(new_vertices);
     }
 }
 
-void remeshing::collapse_short_edges() {
-    vertex_handle v0, v1;
-    halfedge_handle h0, h1, h01, h10;
-    bool ok, b0, b1, l0, l1, f0, f1;
-    int i;
-    bool hcol01, hcol10;
-
-    for (ok = false, i = 0; !ok && i < 10; ++i) {
-        ok = true;
-
-        for (const auto e : mesh.edges) {
-            if (!mesh.edges_deleted[e] && !elocked[e]) {
-                h10 = mesh.halfedge_graph::get_halfedge(e, 0);
-                h01 = mesh.halfedge_graph::get_halfedge(e, 1);
-                v0 = mesh.get_to_vertex(h10);
-                v1 = mesh.get_to_vertex(h01);
-
-                if (is_too_short(v0, v1)) {
-                    // get status
-                    b0 = mesh.is_boundary(v0);
-                    b1 = mesh.is_boundary(v1);
-                    l0 = vlocked[v0];
-                    l1 = vlocked[v1];
-                    f0 = vfeature[v0];
-                    f1 = vfeature[v1];
-                    hcol01 = hcol10 = true;
-
-                    // boundary rules
-                    if (b0 && b1) {
-                        if (!mesh.is_boundary(e)) {
-                            continue;
-                        }
-                    } else if (b0) {
-                        hcol01 = false;
-                    } else if (b1) {
-                        hcol10 = false;
-                    }
+halfedge_handle remeshing::collapse_target(edge_handle e) const {
+    halfedge_handle h0, h1;
+    halfedge_handle h10 = mesh.halfedge_graph::get_halfedge(e, 0);
+    halfedge_handle h01 = mesh.halfedge_graph::get_halfedge(e, 1);
+    vertex_handle v0 = mesh.get_to_vertex(h10);
+    vertex_handle v1 = mesh.get_to_vertex(h01);
 
-                    // locked rules
-                    if (l0 && l1) {
-                        continue;
-                    } else if (l0) {
-                        hcol01 = false;
-                    } else if (l1) {
-                        hcol10 = false;
-                    }
+    if (!is_too_short(v0, v1)) {
+        return halfedge_handle();
+    }
 
-                    // feature rules
-                    if (f0 && f1) {
-                        // edge must be feature
-                        if (!efeature[e]) {
-                            continue;
-                        }
+    // get status
+    bool b0 = mesh.is_boundary(v0);
+    bool b1 = mesh.is_boundary(v1);
+    bool l0 = vlocked[v0];
+    bool l1 = vlocked[v1];
+    bool f0 = vfeature[v0];
+    bool f1 = vfeature[v1];
+    bool hcol01 = true, hcol10 = true;
+
+    // boundary rules
+    if (b0 && b1) {
+        if (!mesh.is_boundary(e)) {
+            return halfedge_handle();
+        }
+    } else if (b0) {
+        hcol01 = false;
+    } else if (b1) {
+        hcol10 = false;
+    }
 
-                        // the other two edges removed by collapse must not be features
-                        h0 = mesh.get_prev(h01);
-                        h1 = mesh.get_next(h10);
-                        if (efeature[mesh.get_edge(h0)] || efeature[mesh.get_edge(h1)]) {
-                            hcol01 = false;
-                        }
-                        // the other two edges removed by collapse must not be features
-                        h0 = mesh.get_prev(h10);
-                        h1 = mesh.get_next(h01);
-                        if (efeature[mesh.get_edge(h0)] || efeature[mesh.get_edge(h1)]) {
-                            hcol10 = false;
-                        }
-                    } else if (f0) {
-                        hcol01 = false;
-                    } else if (f1) {
-                        hcol10 = false;
-                    }
+    // locked rules
+    if (l0 && l1) {
+        return halfedge_handle();
+    } else if (l0) {
+        hcol01 = false;
+    } else if (l1) {
+        hcol10 = false;
+    }
 
-                    // topological rules
-                    bool collapse_ok = mesh.is_collapse_ok(h01);
+    // feature rules
+    if (f0 && f1) {
+        // edge must be feature
+        if (!efeature[e]) {
+            return halfedge_handle();
+        }
 
-                    if (hcol01) {
-                        hcol01 = collapse_ok;
-                    }
-                    if (hcol10) {
-                        hcol10 = collapse_ok;
-                    }
+        // the other two edges removed by collapse must not be features
+        h0 = mesh.get_prev(h01);
+        h1 = mesh.get_next(h10);
+        if (efeature[mesh.get_edge(h0)] || efeature[mesh.get_edge(h1)]) {
+            hcol01 = false;
+        }
+        // the other two edges removed by collapse must not be features
+        h0 = mesh.get_prev(h10);
+        h1 = mesh.get_next(h01);
+        if (efeature[mesh.get_edge(h0)] || efeature[mesh.get_edge(h1)]) {
+            hcol10 = false;
+        }
+    } else if (f0) {
+        hcol01 = false;
+    } else if (f1) {
+        hcol10 = false;
+    }
 
-                    // both collapses possible: collapse into vertex w/ higher valence
-                    if (hcol01 && hcol10) {
-                        if (mesh.halfedge_graph::get_valence(v0) < mesh.halfedge_graph::get_valence(v1)) {
-                            hcol10 = false;
-                        } else {
-                            hcol01 = false;
-                        }
-                    }
+    // topological rules
+    bool collapse_ok = mesh.is_collapse_ok(h01);
 
-                    // try v1 -> v0
-                    if (hcol10) {
-                        // don't create too long edges
-                        for (const auto vv : mesh.halfedge_graph::get_vertices(v1)) {
-                            if (is_too_long(v0, vv)) {
-                                hcol10 = false;
-                                break;
-                            }
-                        }
+    if (hcol01) {
+        hcol01 = collapse_ok;
+    }
+    if (hcol10) {
+        hcol10 = collapse_ok;
+    }
 
-                        if (hcol10) {
-                            mesh.collapse(h10);
-                            ok = false;
-                        }
-                    }
+    // both collapses possible: collapse into vertex w/ higher valence
+    if (hcol01 && hcol10) {
+        if (mesh.halfedge_graph::get_valence(v0) < mesh.halfedge_graph::get_valence(v1)) {
+            hcol10 = false;
+        } else {
+            hcol01 = false;
+        }
+    }
 
-                        // try v0 -> v1
-                    else if (hcol01) {
-                        // don't create too long edges
-                        for (const auto vv : mesh.halfedge_graph::get_vertices(v0)) {
-                            if (is_too_long(v1, vv)) {
-                                hcol01 = false;
-                                break;
-                            }
-                        }
+    // try v1 -> v0
+    if (hcol10) {
+        // don't create too long edges
+        for (const auto vv : mesh.halfedge_graph::get_vertices(v1)) {
+            if (is_too_long(v0, vv)) {
+                return halfedge_handle();
+            }
+        }
+        return h10;
+    }
 
-                        if (hcol01) {
-                            mesh.collapse(h01);
-                            ok = false;
-                        }
-                    }
-                }
+        // try v0 -> v1
+    else if (hcol01) {
+        // don't create too long edges
+        for (const auto vv : mesh.halfedge_graph::get_vertices(v0)) {
+            if (is_too_long(v1, vv)) {
+                return halfedge_handle();
+            }
+        }
+        return h01;
+    }
+    return halfedge_handle();
+}
+
+void remeshing::collapse_short_edges() {
+    std::vector<edge_handle> active(mesh.edges.size());
+    for (size_t i = 0; i < active.size(); ++i) {
+        active[i] = edge_handle(i);
+    }
+    std::vector<halfedge_handle> candidates, collapses;
+    std::vector<vertex_handle> remaining;
+    tbb::enumerable_thread_specific<std::vector<halfedge_handle>> local_candidates;
+    tbb::enumerable_thread_specific<halfedge_mesh::removed_elements> local_removed;
+    tbb::enumerable_thread_specific<std::vector<edge_handle>> local_active;
+
+    // rounds of independent collapses, until no short edge can be collapsed
+    for (int round = 0; round < max_rounds && !active.empty(); ++round) {
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, active.size(), parallel_grain_size),
+                          [&](const tbb::blocked_range<size_t> &range) {
+                              auto &local = local_candidates.local();
+                              for (size_t i = range.begin(); i != range.end(); ++i) {
+                                  auto e = active[i];
+                                  if (!mesh.edges_deleted[e] && !elocked[e]) {
+                                      auto h = collapse_target(e);
+                                      if (h.is_valid()) {
+                                          local.push_back(h);
+                                      }
+                                  }
+                              }
+                          });
+        candidates.clear();
+        for (auto &local : local_candidates) {
+            candidates.insert(candidates.end(), local.begin(), local.end());
+            local.clear();
+        }
+        if (candidates.empty()) break;
+
+        rank_candidates(candidates, [](halfedge_handle h) { return h.idx; }, parallel_grain_size);
+
+        // a collapse reads and changes the one-rings of both vertices
+        auto winner = independent_candidates(candidates.size(), mesh.vertices.size(), [&](size_t i, auto &&func) {
+            auto v0 = mesh.get_from_vertex(candidates[i]);
+            auto v1 = mesh.get_to_vertex(candidates[i]);
+            func(v0);
+            func(v1);
+            for (const auto v : mesh.halfedge_graph::get_vertices(v0)) {
+                func(v);
+            }
+            for (const auto v : mesh.halfedge_graph::get_vertices(v1)) {
+                func(v);
+            }
+        }, parallel_grain_size);
+
+        // the next round only looks at the losers and at the edges whose rules may have changed, those around the
+        // remaining vertex
+        active.clear();
+        collapses.clear();
+        remaining.clear();
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (winner[i]) {
+                collapses.push_back(candidates[i]);
+                remaining.push_back(mesh.get_to_vertex(candidates[i]));
+            } else {
+                active.push_back(mesh.get_edge(candidates[i]));
             }
         }
+
+        // the winners own their one-rings, so their collapses change disjoint faces and run concurrently. Deleted
+        // elements are collected per thread and marked afterwards, the deletion masks share words and counters.
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, collapses.size(), parallel_grain_size),
+                          [&](const tbb::blocked_range<size_t> &range) {
+                              auto &removed = local_removed.local();
+                              for (size_t i = range.begin(); i != range.end(); ++i) {
+                                  mesh.collapse(collapses[i], removed);
+                              }
+                          });
+        for (auto &removed : local_removed) {
+            mesh.mark_deleted(removed);
+            removed.clear();
+        }
+
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, remaining.size(), parallel_grain_size),
+                          [&](const tbb::blocked_range<size_t> &range) {
+                              auto &local = local_active.local();
+                              for (size_t i = range.begin(); i != range.end(); ++i) {
+                                  for (const auto h : mesh.halfedge_graph::get_halfedges(remaining[i])) {
+                                      for (const auto hh : mesh.halfedge_graph::get_halfedges(mesh.get_to_vertex(h))) {
+                                          local.push_back(mesh.get_edge(hh));
+                                      }
+                                  }
+                              }
+                          });
+        for (auto &local : local_active) {
+            active.insert(active.end(), local.begin(), local.end());
+            local.clear();
+        }
+        tbb::parallel_sort(active.begin(), active.end());
+        active.erase(std::unique(active.begin(), active.end()), active.end());
     }
 
     mesh.garbage_collection();
 }
 
 void remeshing::flip_edges() {
-    vertex_handle v0, v1, v2, v3;
-    halfedge_handle h;
-    int val0, val1, val2, val3;
-    int val_opt0, val_opt1, val_opt2, val_opt3;
-    int ve0, ve1, ve2, ve3, ve_before, ve_after;
-    bool ok;
-    int i;
-
     // precompute valences
     auto valence = mesh.vertices.get_or_add<int, 1>("valence");
     tbb::parallel_for(
@@ -521,268 +677,218 @@ void remeshing::flip_edges() {
                 }
             }
     );
-/*    for (const auto v : mesh.vertices) {
-        valence[v] = mesh.halfedge_graph::get_valence(v);
-    }*/
 
-    for (ok = false, i = 0; !ok && i < 10; ++i) {
-        ok = true;
-
-        for (const auto e : mesh.edges) {
-            if (!elocked[e] && !efeature[e]) {
-                h = mesh.halfedge_graph::get_halfedge(e, 0);
-                v0 = mesh.get_to_vertex(h);
-                v2 = mesh.get_to_vertex(mesh.get_next(h));
-                h = mesh.halfedge_graph::get_halfedge(e, 1);
-                v1 = mesh.get_to_vertex(h);
-                v3 = mesh.get_to_vertex(mesh.get_next(h));
-
-                if (!vlocked[v0] && !vlocked[v1] && !vlocked[v2] &&
-                    !vlocked[v3]) {
-                    val0 = valence[v0];
-                    val1 = valence[v1];
-                    val2 = valence[v2];
-                    val3 = valence[v3];
-
-                    val_opt0 = (mesh.is_boundary(v0) ? 4 : 6);
-                    val_opt1 = (mesh.is_boundary(v1) ? 4 : 6);
-                    val_opt2 = (mesh.is_boundary(v2) ? 4 : 6);
-                    val_opt3 = (mesh.is_boundary(v3) ? 4 : 6);
-
-                    ve0 = (val0 - val_opt0);
-                    ve1 = (val1 - val_opt1);
-                    ve2 = (val2 - val_opt2);
-                    ve3 = (val3 - val_opt3);
-
-                    ve0 *= ve0;
-                    ve1 *= ve1;
-                    ve2 *= ve2;
-                    ve3 *= ve3;
-
-                    ve_before = ve0 + ve1 + ve2 + ve3;
-
-                    --val0;
-                    --val1;
-                    ++val2;
-                    ++val3;
-
-                    ve0 = (val0 - val_opt0);
-                    ve1 = (val1 - val_opt1);
-                    ve2 = (val2 - val_opt2);
-                    ve3 = (val3 - val_opt3);
-
-                    ve0 *= ve0;
-                    ve1 *= ve1;
-                    ve2 *= ve2;
-                    ve3 *= ve3;
-
-                    ve_after = ve0 + ve1 + ve2 + ve3;
-
-                    if (ve_before > ve_after && mesh.is_flip_ok(e)) {
-                        mesh.flip(e);
-                        --valence[v0];
-                        --valence[v1];
-                        ++valence[v2];
-                        ++valence[v3];
-                        ok = false;
-                    }
-                }
+    // the four vertices of the two triangles of e, v0 and v1 lose an edge, v2 and v3 gain one
+    auto flip_vertices = [&](edge_handle e) {
+        auto h0 = mesh.halfedge_graph::get_halfedge(e, 0);
+        auto h1 = mesh.halfedge_graph::get_halfedge(e, 1);
+        return std::array<vertex_handle, 4>{mesh.get_to_vertex(h0), mesh.get_to_vertex(h1),
+                                            mesh.get_to_vertex(mesh.get_next(h0)),
+                                            mesh.get_to_vertex(mesh.get_next(h1))};
+    };
+
+    std::vector<edge_handle> active(mesh.edges.size());
+    for (size_t i = 0; i < active.size(); ++i) {
+        active[i] = edge_handle(i);
+    }
+    std::vector<std::pair<edge_handle, int>> candidates;
+    std::vector<edge_handle> flips;
+    tbb::enumerable_thread_specific<std::vector<std::pair<edge_handle, int>>> local_candidates;
+    tbb::enumerable_thread_specific<std::vector<edge_handle>> local_active;
+
+    // rounds of independent flips, until no flip reduces the valence deviation
+    for (int round = 0; round < max_rounds && !active.empty(); ++round) {
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, active.size(), parallel_grain_size),
+                          [&](const tbb::blocked_range<size_t> &range) {
+                              auto &local = local_candidates.local();
+                              for (size_t i = range.begin(); i != range.end(); ++i) {
+                                  auto e = active[i];
+                                  if (elocked[e] || efeature[e] || mesh.is_boundary(e)) continue;
+
+                                  auto v = flip_vertices(e);
+                                  if (vlocked[v[0]] || vlocked[v[1]] || vlocked[v[2]] || vlocked[v[3]]) continue;
+
+                                  int ve_before = 0, ve_after = 0;
+                                  for (size_t k = 0; k < 4; ++k) {
+                                      int val_opt = (mesh.is_boundary(v[k]) ? 4 : 6);
+                                      int val = valence[v[k]] - val_opt;
+                                      int val_flipped = val + (k < 2 ? -1 : 1);
+                                      ve_before += val * val;
+                                      ve_after += val_flipped * val_flipped;
+                                  }
+
+                                  if (ve_before > ve_after && mesh.is_flip_ok(e)) {
+                                      local.emplace_back(e, ve_before - ve_after);
+                                  }
+                              }
+                          });
+        candidates.clear();
+        for (auto &local : local_candidates) {
+            candidates.insert(candidates.end(), local.begin(), local.end());
+            local.clear();
+        }
+        if (candidates.empty()) break;
+
+        rank_candidates(candidates, [](const std::pair<edge_handle, int> &c) { return c.first.idx; },
+                        parallel_grain_size);
+
+        auto winner = independent_candidates(candidates.size(), mesh.vertices.size(), [&](size_t i, auto &&func) {
+            for (const auto v : flip_vertices(candidates[i].first)) {
+                func(v);
+            }
+        }, parallel_grain_size);
+
+        // the next round only looks at the losers and at the edges of the faces around changed valences
+        active.clear();
+        flips.clear();
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (winner[i]) {
+                flips.push_back(candidates[i].first);
+            } else {
+                active.push_back(candidates[i].first);
             }
         }
+
+        // the winners own their four vertices, so their flips change disjoint faces and valences and run
+        // concurrently. The connectivity versions are bumped once afterwards.
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, flips.size(), parallel_grain_size),
+                          [&](const tbb::blocked_range<size_t> &range) {
+                              for (size_t i = range.begin(); i != range.end(); ++i) {
+                                  auto v = flip_vertices(flips[i]);
+                                  mesh.flip_deferred(flips[i]);
+                                  --valence[v[0]];
+                                  --valence[v[1]];
+                                  ++valence[v[2]];
+                                  ++valence[v[3]];
+                              }
+                          });
+        mesh.mark_connectivity_changed();
+
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, flips.size(), parallel_grain_size),
+                          [&](const tbb::blocked_range<size_t> &range) {
+                              auto &local = local_active.local();
+                              for (size_t i = range.begin(); i != range.end(); ++i) {
+                                  for (const auto vv : flip_vertices(flips[i])) {
+                                      for (const auto h : mesh.halfedge_graph::get_halfedges(vv)) {
+                                          local.push_back(mesh.get_edge(h));
+                                          local.push_back(mesh.get_edge(mesh.get_next(h)));
+                                      }
+                                  }
+                              }
+                          });
+        for (auto &local : local_active) {
+            active.insert(active.end(), local.begin(), local.end());
+            local.clear();
+        }
+        tbb::parallel_sort(active.begin(), active.end());
+        active.erase(std::unique(active.begin(), active.end()), active.end());
     }
 
     mesh.vertices.remove(valence);
 }
 
 void remeshing::tangential_smoothing(unsigned int iterations) {
-    vertex_handle v1, v2, v3, vv;
-    edge_handle e;
-    bcg_scalar_t w, ww, area;
-    VectorS<3> u, n, t, b;
-
     // add property
     auto update = mesh.vertices.add<VectorS<3>, 3>("v_update");
 
-    // project at the beginning to get valid sizing values and normal vectors
-    // for vertices introduced by splitting
-    if (use_projection) {
-        for (const auto v : mesh.vertices) {
-            if (!mesh.is_boundary(v) && !vlocked[v]) {
-                project_to_reference(v);
-            }
+    std::vector<vertex_handle> movable;
+    for (const auto v : mesh.vertices) {
+        if (!mesh.is_boundary(v) && !vlocked[v]) {
+            movable.push_back(v);
         }
     }
 
-    for (unsigned int iters = 0; iters < iterations; ++iters) {
-        /*tbb::parallel_for(
-                tbb::blocked_range<uint32_t>(0u, (uint32_t) mesh.vertices.size(), parallel_grain_size),
-                [&](const tbb::blocked_range<uint32_t> &range) {
-                    for (uint32_t i = range.begin(); i != range.end(); ++i) {
-                        auto v = vertex_handle(i);
-                        if (!mesh.is_boundary(v) && !vlocked[v]) {
-                            if (vfeature[v]) {
-                                u = VectorS<3>::Zero();
-                                t = VectorS<3>::Zero();
-                                ww = 0;
-                                int c = 0;
-
-                                for (const auto h : mesh.halfedge_graph::get_halfedges(v)) {
-                                    if (efeature[mesh.get_edge(h)]) {
-                                        vv = mesh.get_to_vertex(h);
-
-                                        b = points[v];
-                                        b += points[vv];
-                                        b *= 0.5;
-
-                                        w = (points[v] - points[vv]).norm() / (0.5 * (vsizing[v] + vsizing[vv]));
-                                        ww += w;
-                                        u += w * b;
-
-                                        if (c == 0) {
-                                            t += (points[vv] - points[v]).normalized();
-                                            ++c;
-                                        } else {
-                                            ++c;
-                                            t -= (points[vv] - points[v]).normalized();
-                                        }
-                                    }
-                                }
-
-                                //assert(c == 2);
-
-                                u *= (1.0 / ww);
-                                u -= points[v];
-                                t = t.normalized();
-                                u = t * u.dot(t);
+    // project at the beginning to get valid sizing values and normal vectors
+    // for vertices introduced by splitting
+    project_to_reference(movable);
 
-                                update[v] = u;
-                            } else {
-                                u = VectorS<3>::Zero();
-                                t = VectorS<3>::Zero();
-                                ww = 0;
+    for (unsigned int iters = 0; iters < iterations; ++iters) {
+        tbb::parallel_for(
+                tbb::blocked_range<size_t>(0, movable.size(), parallel_grain_size),
+                [&](const tbb::blocked_range<size_t> &range) {
+                    for (size_t i = range.begin(); i != range.end(); ++i) {
+                        auto v = movable[i];
+                        VectorS<3> u = VectorS<3>::Zero();
+                        VectorS<3> t = VectorS<3>::Zero();
+                        bcg_scalar_t w, ww = 0;
 
-                                for (const auto h : mesh.halfedge_graph::get_halfedges(v)) {
-                                    v1 = v;
-                                    v2 = mesh.get_to_vertex(h);
-                                    v3 = mesh.get_to_vertex(mesh.get_next(h));
+                        if (vfeature[v]) {
+                            int c = 0;
 
-                                    b = points[v1];
-                                    b += points[v2];
-                                    b += points[v3];
-                                    b *= (1.0 / 3.0);
+                            for (const auto h : mesh.halfedge_graph::get_halfedges(v)) {
+                                if (efeature[mesh.get_edge(h)]) {
+                                    auto vv = mesh.get_to_vertex(h);
 
-                                    area = triangle_area_from_metric((points[v2] - points[v1]).norm(),
-                                                                     (points[v3] - points[v1]).norm(),
-                                                                     (points[v3] - points[v2]).norm());
-                                    w = area / pow((vsizing[v1] + vsizing[v2] + vsizing[v3]) / 3.0, 2.0);
+                                    VectorS<3> b = points[v];
+                                    b += points[vv];
+                                    b *= 0.5;
 
-                                    u += w * b;
+                                    w = (points[v] - points[vv]).norm() / (0.5 * (vsizing[v] + vsizing[vv]));
                                     ww += w;
+                                    u += w * b;
+
+                                    if (c == 0) {
+                                        t += (points[vv] - points[v]).normalized();
+                                        ++c;
+                                    } else {
+                                        ++c;
+                                        t -= (points[vv] - points[v]).normalized();
+                                    }
                                 }
+                            }
 
-                                u /= ww;
-                                u -= points[v];
-                                n = vnormal[v];
-                                u -= n * u.dot(n);
+                            //assert(c == 2);
 
-                                update[v] = u;
+                            u *= (1.0 / ww);
+                            u -= points[v];
+                            t = t.normalized();
+                            u = t * u.dot(t);
+                        } else {
+                            for (const auto h : mesh.halfedge_graph::get_halfedges(v)) {
+                                auto v1 = v;
+                                auto v2 = mesh.get_to_vertex(h);
+                                auto v3 = mesh.get_to_vertex(mesh.get_next(h));
+
+                                VectorS<3> b = points[v1];
+                                b += points[v2];
+                                b += points[v3];
+                                b *= (1.0 / 3.0);
+
+                                bcg_scalar_t area = triangle_area_from_metric((points[v2] - points[v1]).norm(),
+                                                                              (points[v3] - points[v1]).norm(),
+                                                                              (points[v3] - points[v2]).norm());
+                                w = area / pow((vsizing[v1] + vsizing[v2] + vsizing[v3]) / 3.0, 2.0);
+
+                                u += w * b;
+                                ww += w;
                             }
+
+                            u /= ww;
+                            u -= points[v];
+                            const VectorS<3> n = vnormal[v];
+                            u -= n * u.dot(n);
                         }
+                        update[v] = u;
                     }
                 }
-        );*/
-        for (const auto v : mesh.vertices) {
-            if (!mesh.is_boundary(v) && !vlocked[v]) {
-                if (vfeature[v]) {
-                    u = VectorS<3>::Zero();
-                    t = VectorS<3>::Zero();
-                    ww = 0;
-                    int c = 0;
-
-                    for (const auto h : mesh.halfedge_graph::get_halfedges(v)) {
-                        if (efeature[mesh.get_edge(h)]) {
-                            vv = mesh.get_to_vertex(h);
-
-                            b = points[v];
-                            b += points[vv];
-                            b *= 0.5;
-
-                            w = (points[v] - points[vv]).norm() / (0.5 * (vsizing[v] + vsizing[vv]));
-                            ww += w;
-                            u += w * b;
-
-                            if (c == 0) {
-                                t += (points[vv] - points[v]).normalized();
-                                ++c;
-                            } else {
-                                ++c;
-                                t -= (points[vv] - points[v]).normalized();
-                            }
-                        }
-                    }
-
-                    //assert(c == 2);
-
-                    u *= (1.0 / ww);
-                    u -= points[v];
-                    t = t.normalized();
-                    u = t * u.dot(t);
-
-                    update[v] = u;
-                } else {
-                    u = VectorS<3>::Zero();
-                    t = VectorS<3>::Zero();
-                    ww = 0;
-
-                    for (const auto h : mesh.halfedge_graph::get_halfedges(v)) {
-                        v1 = v;
-                        v2 = mesh.get_to_vertex(h);
-                        v3 = mesh.get_to_vertex(mesh.get_next(h));
-
-                        b = points[v1];
-                        b += points[v2];
-                        b += points[v3];
-                        b *= (1.0 / 3.0);
-
-                        area = triangle_area_from_metric((points[v2] - points[v1]).norm(),
-                                                         (points[v3] - points[v1]).norm(),
-                                                         (points[v3] - points[v2]).norm());
-                        w = area / pow((vsizing[v1] + vsizing[v2] + vsizing[v3]) / 3.0, 2.0);
+        );
 
-                        u += w * b;
-                        ww += w;
+        // update vertex positions
+        tbb::parallel_for(
+                tbb::blocked_range<size_t>(0, movable.size(), parallel_grain_size),
+                [&](const tbb::blocked_range<size_t> &range) {
+                    for (size_t i = range.begin(); i != range.end(); ++i) {
+                        points[movable[i]] += update[movable[i]];
                     }
-
-                    u /= ww;
-                    u -= points[v];
-                    n = vnormal[v];
-                    u -= n * u.dot(n);
-
-                    update[v] = u;
                 }
-            }
-        }
-
-        // update vertex positions
-
-        for (const auto v : mesh.vertices) {
-            if (!mesh.is_boundary(v) && !vlocked[v]) {
-                points[v] += update[v];
-            }
-        }
+        );
 
         // update normal vectors (if not done so through projection)
         vertex_normals(mesh, vertex_normal_area_angle);
     }
 
     // project at the end
-    if (use_projection) {
-        for (const auto v : mesh.vertices) {
-            if (!mesh.is_boundary(v) && !vlocked[v]) {
-                project_to_reference(v);
-            }
-        }
-    }
+    project_to_reference(movable);
 
     // remove property
     mesh.vertices.remove(update);
@@ -845,37 +951,36 @@ void remeshing::project_to_reference(vertex_handle v) {
     }
 
     // find closest triangle of reference mesh
-    triangle_kdtree::NearestNeighbor nn = kd_tree->nearest(points[v]);
+    triangle_bvh::NearestNeighbor nn = tree->nearest(points[v]);
     auto fvIt = refmesh->get_vertices(nn.face);
-    /*auto result = kdtreeProperty->query_knn(points[v], 1);
-
-    // get face data
-    vertex_handle vn = result.indices[0];
-    face_handle f = refmesh->find_closest_face_in_neighborhood(vn, points[v]);
-    auto fvIt = refmesh->get_vertices(f);*/
 
     vertex_handle v0 = (*fvIt);
     vertex_handle v1 = (*(++fvIt));
     vertex_handle v2 = (*(++fvIt));
 
-    triangle3 t(refpoints[v0], refpoints[v1], refpoints[2]);
-    auto barycentric_coords = to_barycentric_coordinates(t, points[v]);
-
     // set result
     points[v] = nn.result.closest;
-    triangle3 tn(refnormals[v0], refnormals[v1], refnormals[2]);
+    triangle3 tn(refnormals[v0], refnormals[v1], refnormals[v2]);
     vnormal[v] = from_barycentric_coords(tn, nn.result.barycentric_coords).normalized();
     vsizing[v] = refsizing[v0] * nn.result.barycentric_coords[0] + refsizing[v1] * nn.result.barycentric_coords[1] +
                  refsizing[v2] * nn.result.barycentric_coords[2];
+}
+
+void remeshing::project_to_reference(const std::vector<vertex_handle> &vertices) {
+    if (!use_projection) {
+        return;
+    }
 
-/*    triangle3 tn(refnormals[v0] ,refnormals[v1], refnormals[2]);
-    points[v] = from_barycentric_coords(t, barycentric_coords);
-    vnormal[v] = from_barycentric_coords(tn, barycentric_coords).normalized();
-    vsizing[v] = refsizing[v0] * barycentric_coords[0] + refsizing[v1] * barycentric_coords[1] + refsizing[v2] * barycentric_coords[2];*/
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, vertices.size(), parallel_grain_size),
+                      [&](const tbb::blocked_range<size_t> &range) {
+                          for (size_t i = range.begin(); i != range.end(); ++i) {
+                              project_to_reference(vertices[i]);
+                          }
+                      });
 }
 
 void mesh_remeshing_uniform(halfedge_mesh &mesh, bcg_scalar_t edge_length, unsigned int iterations,
-                            bool use_projection) {
+                            bool use_projection, size_t parallel_grain_size) {
 
     if (!mesh.is_triangle_mesh()) {
         std::cerr << "Not a triangle mesh!" << std::endl;
@@ -884,6 +989,7 @@ void mesh_remeshing_uniform(halfedge_mesh &mesh, bcg_scalar_t edge_length, unsig
 
     remeshing meshing(mesh);
 
+    meshing.parallel_grain_size = parallel_grain_size;
     meshing.uniform = true;
     meshing.use_projection = use_projection;
     meshing.target_edge_length = edge_length;
@@ -908,7 +1014,8 @@ void mesh_remeshing_uniform(halfedge_mesh &mesh, bcg_scalar_t edge_length, unsig
 }
 
 void mesh_remeshing_adaptive(halfedge_mesh &mesh, bcg_scalar_t min_edge_length, bcg_scalar_t max_edge_length,
-                             bcg_scalar_t approx_error, unsigned int iterations, bool use_projection) {
+                             bcg_scalar_t approx_error, unsigned int iterations, bool use_projection,
+                             size_t parallel_grain_size) {
     if (!mesh.is_triangle_mesh()) {
         std::cerr << "Not a triangle mesh!" << std::endl;
         return;
@@ -916,6 +1023,7 @@ void mesh_remeshing_adaptive(halfedge_mesh &mesh, bcg_scalar_t min_edge_length,
 
     remeshing meshing(mesh);
 
+    meshing.parallel_grain_size = parallel_grain_size;
     meshing.uniform = false;
     meshing.min_edge_length = min_edge_length;
     meshing.max_edge_length = max_edge_length;
@@ -9,11 +9,14 @@
 
 namespace bcg {
 
+// Splits, collapses and flips are found in parallel and applied in rounds of independent operations, smoothing and
+// projection run in parallel over the vertices.
 void mesh_remeshing_uniform(halfedge_mesh &mesh, bcg_scalar_t edge_length, unsigned int iterations = 10,
-                            bool use_projection = true);
+                            bool use_projection = true, size_t parallel_grain_size = 1024);
 
 void mesh_remeshing_adaptive(halfedge_mesh &mesh, bcg_scalar_t min_edge_length, bcg_scalar_t max_edge_length,
-                             bcg_scalar_t approx_error, unsigned int iterations = 10, bool use_projection = true);
+                             bcg_scalar_t approx_error, unsigned int iterations = 10, bool use_projection = true,
+                             size_t parallel_grain_size = 1024);
 
 }
 
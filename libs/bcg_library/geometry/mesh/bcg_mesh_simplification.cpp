@@ -4,10 +4,13 @@
 #include "bcg_mesh_simplification.h"
 
 #include <utility>
+#include <atomic>
+#include <algorithm>
 #include "bcg_mesh_face_normals.h"
 #include "distance_query/bcg_distance_triangle_point.h"
 #include "utils/bcg_heap.h"
 #include "geometry/quadric/bcg_quadric.h"
+#include "tbb/tbb.h"
 
 namespace bcg {
 
@@ -148,6 +151,9 @@ struct simplification {
 
     priority_queue *queue;
 
+    // records the collapses if set
+    progressive_mesh_recorder *recorder = nullptr;
+
     bool has_selection{};
     bool has_features{};
     bcg_scalar_t normal_deviation;
@@ -159,26 +165,57 @@ struct simplification {
     //! Simplify mesh to \p n vertices.
     void simplify(unsigned int n_vertices);
 
+    //! Simplify mesh to \p n vertices in rounds of independent collapses.
+    void simplify_parallel(unsigned int n_vertices, size_t parallel_grain_size);
+
 private:
     void enqueuevertex(vertex_handle v);
 
+    // best outgoing halfedge of v to collapse and its priority, invalid if there is none
+    halfedge_handle find_target(vertex_handle v, bcg_scalar_t &min_prio) const;
+
     // is collapsing the halfedge h allowed?
-    bool is_collapse_legal(const collapse_data &cd);
+    bool is_collapse_legal(const collapse_data &cd) const;
 
     // what is the priority of collapsing the halfedge h
-    bcg_scalar_t priority(const collapse_data &cd);
+    bcg_scalar_t priority(const collapse_data &cd) const;
 
     // postprocess halfedge collapse
     void postprocess_collapse(const collapse_data &cd);
 
+    // v0, v1 and their neighbors, every vertex a collapse reads or changes
+    template<typename Func>
+    void for_each_in_region(const collapse_data &cd, Func &&func) const;
+
+    // garbage collection and update of the derived properties
+    void finish();
+
+    // triangle of face f, with the vertex v moved to p
+    triangle3 get_triangle(face_handle f, vertex_handle v = vertex_handle(), const VectorS<3> &p = zero3s) const;
+
     // compute aspect ratio for face f
     bcg_scalar_t compute_aspect_ratio(face_handle f) const;
 
+    bcg_scalar_t compute_aspect_ratio(const triangle3 &t) const;
 
     // compute distance from p to triagle f
     bcg_scalar_t distance(face_handle f, const VectorS<3> &p) const;
+
+    bcg_scalar_t distance(const triangle3 &t, const VectorS<3> &p) const;
 };
 
+// candidates considered per round of simplify_parallel, as a fraction of all candidates, cheapest first
+static constexpr double batch_fraction = 0.1;
+
+// normalized area vector, the same as face_normal for a triangle face
+static VectorS<3> triangle_normal(const triangle3 &t) {
+    VectorS<3> vector_area = zero3s;
+    for (size_t i = 0; i < 3; ++i) {
+        vector_area += t.points[i].cross(t.points[(i + 1) % 3]) / 2;
+    }
+    return vector_area.normalized();
+}
+
 simplification::simplification(halfedge_mesh &mesh, bcg_scalar_t aspect_ratio,
                                bcg_scalar_t edge_length, unsigned int max_valence,
                                bcg_scalar_t normal_deviation, bcg_scalar_t hausdorff_error) : mesh(mesh),
@@ -319,6 +356,9 @@ void simplification::simplify(unsigned int n_vertices) {
         }
 
         // perform collapse
+        if (recorder) {
+            recorder->record(mesh, h);
+        }
         mesh.collapse(h);
 
         --nv;
@@ -335,26 +375,176 @@ void simplification::simplify(unsigned int n_vertices) {
 
     // clean up
     delete queue;
+    mesh.vertices.remove(heap_pos);
+    finish();
+}
+
+void simplification::simplify_parallel(unsigned int n_vertices, size_t parallel_grain_size) {
+    if (!mesh.is_triangle_mesh()) {
+        mesh.triangulate();
+        return;
+    }
+
+    size_t n = mesh.vertices.size();
+    size_t nv = n;
+
+    vpriority = mesh.vertices.add<bcg_scalar_t, 1>("v_prio");
+    vtarget = mesh.vertices.add<halfedge_handle, 1>("v_target");
+
+    // vertices whose best collapse has to be recomputed
+    std::vector<unsigned char> dirty(n, 1);
+    // per vertex the claim of the lowest ranked candidate of the current round whose collapse region contains it.
+    // The round is in the high bits so that claims of earlier rounds lose without being reset.
+    std::vector<std::atomic<std::uint64_t>> claims(n);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, n, parallel_grain_size),
+                      [&](const tbb::blocked_range<size_t> &range) {
+                          for (size_t i = range.begin(); i != range.end(); ++i) {
+                              claims[i].store(0, std::memory_order_relaxed);
+                          }
+                      });
+    auto claim_of = [](handle_index_t round, size_t rank) {
+        return (std::uint64_t(round) << 32u) | (BCG_INVALID_HANDLE_ID - handle_index_t(rank));
+    };
+
+    tbb::enumerable_thread_specific<std::vector<vertex_handle>> local_candidates;
+    std::vector<vertex_handle> candidates;
+    std::vector<unsigned char> winner;
+    std::vector<collapse_data> collapses;
+    tbb::enumerable_thread_specific<halfedge_mesh::removed_elements> local_removed;
+
+    for (handle_index_t round = 1; nv > n_vertices; ++round) {
+        // best collapse of every changed vertex
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, n, parallel_grain_size),
+                          [&](const tbb::blocked_range<size_t> &range) {
+                              auto &local = local_candidates.local();
+                              for (size_t i = range.begin(); i != range.end(); ++i) {
+                                  vertex_handle v(i);
+                                  if (mesh.vertices_deleted[v]) continue;
+                                  if (dirty[i]) {
+                                      bcg_scalar_t prio;
+                                      vtarget[v] = find_target(v, prio);
+                                      vpriority[v] = prio;
+                                      dirty[i] = 0;
+                                  }
+                                  if (vtarget[v].is_valid()) {
+                                      local.push_back(v);
+                                  }
+                              }
+                          });
+
+        candidates.clear();
+        for (auto &local : local_candidates) {
+            candidates.insert(candidates.end(), local.begin(), local.end());
+            local.clear();
+        }
+        if (candidates.empty()) break;
+
+        // cheapest first, ties by index so that rounds do not depend on the scheduling. Only the candidates of this
+        // round need to be in order.
+        auto cheaper = [&](vertex_handle a, vertex_handle b) {
+            return vpriority[a] < vpriority[b] || (vpriority[a] == vpriority[b] && a.idx < b.idx);
+        };
+        size_t count = std::max<size_t>(1, size_t(candidates.size() * batch_fraction));
+        count = std::min(count, nv - n_vertices);
+        std::nth_element(candidates.begin(), candidates.begin() + count - 1, candidates.end(), cheaper);
+        tbb::parallel_sort(candidates.begin(), candidates.begin() + count, cheaper);
+
+        // every candidate claims its region with its rank, the lowest rank wins
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, count, parallel_grain_size),
+                          [&](const tbb::blocked_range<size_t> &range) {
+                              for (size_t i = range.begin(); i != range.end(); ++i) {
+                                  auto key = claim_of(round, i);
+                                  for_each_in_region(collapse_data(mesh, vtarget[candidates[i]]),
+                                                     [&](vertex_handle v) {
+                                                         auto &claim = claims[v.idx];
+                                                         auto current = claim.load(std::memory_order_relaxed);
+                                                         while (key > current &&
+                                                                !claim.compare_exchange_weak(current, key)) {}
+                                                     });
+                              }
+                          });
+
+        // winners own their whole region, so their collapses are independent. They are checked again, a
+        // collapse nearby may have changed their region since they were evaluated.
+        winner.assign(count, 0);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, count, parallel_grain_size),
+                          [&](const tbb::blocked_range<size_t> &range) {
+                              for (size_t i = range.begin(); i != range.end(); ++i) {
+                                  auto key = claim_of(round, i);
+                                  auto v0 = candidates[i];
+                                  collapse_data cd(mesh, vtarget[v0]);
+                                  bool owns = true;
+                                  for_each_in_region(cd, [&](vertex_handle v) {
+                                      owns &= claims[v.idx].load(std::memory_order_relaxed) == key;
+                                  });
+                                  if (!owns) continue;
+                                  if (is_collapse_legal(cd)) {
+                                      winner[i] = 1;
+                                  } else {
+                                      dirty[v0.idx] = 1;
+                                  }
+                              }
+                          });
+
+        collapses.clear();
+        for (size_t i = 0; i < count; ++i) {
+            if (winner[i]) {
+                collapses.emplace_back(mesh, vtarget[candidates[i]]);
+            }
+        }
+        // recorded in rank order before any of them is applied, they do not change each others regions
+        if (recorder) {
+            for (const auto &cd : collapses) {
+                recorder->record(mesh, cd.v0v1);
+            }
+        }
+
+        // the regions are disjoint, so each collapse only writes connectivity, quadrics and flags no other collapse
+        // of the round touches. Deleted elements are collected per thread and marked afterwards, the deletion masks
+        // pack 64 elements into a word and share their counters.
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, collapses.size()),
+                          [&](const tbb::blocked_range<size_t> &range) {
+                              auto &removed = local_removed.local();
+                              for (size_t i = range.begin(); i != range.end(); ++i) {
+                                  const auto &cd = collapses[i];
+                                  // the vertices whose best collapse may have changed, as in simplify()
+                                  for (const auto v : mesh.halfedge_graph::get_vertices(cd.v0)) {
+                                      dirty[v.idx] = 1;
+                                  }
+                                  mesh.collapse(cd.v0v1, removed);
+                                  postprocess_collapse(cd);
+                              }
+                          });
+        for (auto &removed : local_removed) {
+            mesh.mark_deleted(removed);
+            removed.clear();
+        }
+        nv -= collapses.size();
+    }
+
+    finish();
+}
+
+void simplification::finish() {
     mesh.garbage_collection();
     mesh.vertices.remove(vpriority);
-    mesh.vertices.remove(heap_pos);
     mesh.vertices.remove(vtarget);
 
     vpoint.set_dirty();
     face_normals(mesh);
 
     auto lines = mesh.edges.get_or_add<VectorI<2>, 2>("edges");
-    lines.vector() = mesh.get_connectivity();
-    lines.set_dirty();
+    lines.set(mesh.get_connectivity());
 
     auto triangles = mesh.edges.get_or_add<VectorI<3>, 3>("triangles");
     triangles = mesh.get_triangles();
     triangles.set_dirty();
 }
 
-void simplification::enqueuevertex(vertex_handle v) {
-    bcg_scalar_t prio, min_prio(scalar_max);
+halfedge_handle simplification::find_target(vertex_handle v, bcg_scalar_t &min_prio) const {
+    bcg_scalar_t prio;
     halfedge_handle min_h;
+    min_prio = scalar_max;
 
     // find best out-going halfedge
     for (const auto h : mesh.halfedge_graph::get_halfedges(v)) {
@@ -367,6 +557,15 @@ void simplification::enqueuevertex(vertex_handle v) {
             }
         }
     }
+    if (!min_h.is_valid()) {
+        min_prio = -1;
+    }
+    return min_h;
+}
+
+void simplification::enqueuevertex(vertex_handle v) {
+    bcg_scalar_t min_prio;
+    halfedge_handle min_h = find_target(v, min_prio);
 
     // target found -> put vertex on heap
     if (min_h.is_valid()) {
@@ -391,7 +590,21 @@ void simplification::enqueuevertex(vertex_handle v) {
     }
 }
 
-bool simplification::is_collapse_legal(const collapse_data &cd) {
+template<typename Func>
+void simplification::for_each_in_region(const collapse_data &cd, Func &&func) const {
+    func(cd.v0);
+    func(cd.v1);
+    for (const auto v : mesh.halfedge_graph::get_vertices(cd.v0)) {
+        func(v);
+    }
+    for (const auto v : mesh.halfedge_graph::get_vertices(cd.v1)) {
+        func(v);
+    }
+}
+
+// the faces around v0 are evaluated with v0 moved to v1, without writing to the positions, so that vertices can
+// be tested concurrently
+bool simplification::is_collapse_legal(const collapse_data &cd) const {
     // test selected vertices
 
     if (has_selection && !vselected[cd.v0]) {
@@ -462,24 +675,19 @@ bool simplification::is_collapse_legal(const collapse_data &cd) {
 
     // check for flipping normals
     if (normal_deviation == 0.0) {
-        vpoint[cd.v0] = p1;
         for (const auto f : mesh.get_faces(cd.v0)) {
             if (f != cd.fl && f != cd.fr) {
                 VectorS<3> n0 = fnormal[f];
-                VectorS<3> n1 = face_normal(mesh, f);
+                VectorS<3> n1 = triangle_normal(get_triangle(f, cd.v0, p1));
                 if (n0.dot(n1) < 0.0) {
-                    vpoint[cd.v0] = p0;
                     return false;
                 }
             }
         }
-        vpoint[cd.v0] = p0;
     }
 
         // check normal cone
     else {
-        vpoint[cd.v0] = p1;
-
         face_handle fll, frr;
         if (cd.vl.is_valid()) {
             fll = mesh.get_face(mesh.get_opposite(mesh.get_prev(cd.v0v1)));
@@ -491,7 +699,7 @@ bool simplification::is_collapse_legal(const collapse_data &cd) {
         for (const auto f : mesh.get_faces(cd.v0)) {
             if (f != cd.fl && f != cd.fr) {
                 normal_cone nc = normal_cones[f];
-                nc.merge(face_normal(mesh, f));
+                nc.merge(triangle_normal(get_triangle(f, cd.v0, p1)));
 
                 if (f == fll) {
                     nc.merge(normal_cones[cd.fl]);
@@ -501,13 +709,10 @@ bool simplification::is_collapse_legal(const collapse_data &cd) {
                 }
 
                 if (nc.angle > 0.5 * normal_deviation) {
-                    vpoint[cd.v0] = p0;
                     return false;
                 }
             }
         }
-
-        vpoint[cd.v0] = p0;
     }
 
     // check aspect ratio
@@ -517,10 +722,8 @@ bool simplification::is_collapse_legal(const collapse_data &cd) {
         for (const auto f : mesh.get_faces(cd.v0)) {
             if (f != cd.fl && f != cd.fr) {
                 // worst aspect ratio after collapse
-                vpoint[cd.v0] = p1;
-                ar1 = std::max(ar1, compute_aspect_ratio(f));
+                ar1 = std::max(ar1, compute_aspect_ratio(get_triangle(f, cd.v0, p1)));
                 // worst aspect ratio before collapse
-                vpoint[cd.v0] = p0;
                 ar0 = std::max(ar0, compute_aspect_ratio(f));
             }
         }
@@ -540,16 +743,15 @@ bool simplification::is_collapse_legal(const collapse_data &cd) {
         for (const auto f : mesh.get_faces(cd.v0)) {
             std::copy(face_points[f].begin(), face_points[f].end(), std::back_inserter(p));
         }
-        p.push_back(vpoint[cd.v0]);
+        p.push_back(p0);
 
         // test points against all faces
-        vpoint[cd.v0] = p1;
         for (const auto &point : p) {
             ok = false;
 
             for (const auto f : mesh.get_faces(cd.v0)) {
                 if (f != cd.fl && f != cd.fr) {
-                    if (distance(f, point) < hausdorff_error) {
+                    if (distance(get_triangle(f, cd.v0, p1), point) < hausdorff_error) {
                         ok = true;
                         break;
                     }
@@ -557,11 +759,9 @@ bool simplification::is_collapse_legal(const collapse_data &cd) {
             }
 
             if (!ok) {
-                vpoint[cd.v0] = p0;
                 return false;
             }
         }
-        vpoint[cd.v0] = p0;
     }
 
     // collapse passed all tests -> ok
@@ -569,7 +769,7 @@ bool simplification::is_collapse_legal(const collapse_data &cd) {
 }
 
 // what is the priority of collapsing the halfedge h
-bcg_scalar_t simplification::priority(const collapse_data &cd) {
+bcg_scalar_t simplification::priority(const collapse_data &cd) const {
     // computer quadric error metric
     quadric Q = vquadric[cd.v0];
     Q += vquadric[cd.v1];
@@ -650,21 +850,29 @@ void simplification::postprocess_collapse(const collapse_data &cd) {
     }
 }
 
+triangle3 simplification::get_triangle(face_handle f, vertex_handle v, const VectorS<3> &p) const {
+    triangle3 t;
+    size_t i = 0;
+    for (const auto vf : mesh.get_vertices(f)) {
+        t.points[i++] = vf == v ? p : vpoint[vf];
+        if (i == 3) break;
+    }
+    return t;
+}
+
 // compute aspect ratio for face f
 bcg_scalar_t simplification::compute_aspect_ratio(face_handle f) const {
+    return compute_aspect_ratio(get_triangle(f));
+}
+
+bcg_scalar_t simplification::compute_aspect_ratio(const triangle3 &t) const {
     // min height is area/maxLength
     // aspect ratio = length / height
     //              = length * length / area
 
-    auto fvit = mesh.get_vertices(f);
-
-    const VectorS<3> p0 = vpoint[*fvit];
-    const VectorS<3> p1 = vpoint[*(++fvit)];
-    const VectorS<3> p2 = vpoint[*(++fvit)];
-
-    const VectorS<3> d0 = p0 - p1;
-    const VectorS<3> d1 = p1 - p2;
-    const VectorS<3> d2 = p2 - p0;
+    const VectorS<3> d0 = t.points[0] - t.points[1];
+    const VectorS<3> d1 = t.points[1] - t.points[2];
+    const VectorS<3> d2 = t.points[2] - t.points[0];
 
     const bcg_scalar_t l0 = d0.squaredNorm();
     const bcg_scalar_t l1 = d1.squaredNorm();
@@ -682,22 +890,45 @@ bcg_scalar_t simplification::compute_aspect_ratio(face_handle f) const {
 
 // compute distance from p to triagle f
 bcg_scalar_t simplification::distance(face_handle f, const VectorS<3> &p) const {
-    auto fvit = mesh.get_vertices(f);
-
-    const VectorS<3> p0 = vpoint[*fvit];
-    const VectorS<3> p1 = vpoint[*(++fvit)];
-    const VectorS<3> p2 = vpoint[*(++fvit)];
+    return distance(get_triangle(f), p);
+}
 
+bcg_scalar_t simplification::distance(const triangle3 &t, const VectorS<3> &p) const {
     distance_point3_triangle3 distance;
-    auto result = distance(p, triangle3(p0, p1, p2));
+    auto result = distance(p, t);
     return result.distance;
 }
 
 void mesh_simplification(halfedge_mesh &mesh, unsigned int n_vertices, bcg_scalar_t aspect_ratio,
                          bcg_scalar_t edge_length, unsigned int max_valence,
-                         bcg_scalar_t normal_deviation, bcg_scalar_t hausdorff_error) {
+                         bcg_scalar_t normal_deviation, bcg_scalar_t hausdorff_error,
+                         progressive_mesh *progressive) {
     simplification simplfy(mesh, aspect_ratio, edge_length, max_valence, normal_deviation, hausdorff_error);
+    if (!progressive) {
+        simplfy.simplify(n_vertices);
+        return;
+    }
+    mesh.garbage_collection();
+    progressive_mesh_recorder recorder(mesh);
+    simplfy.recorder = &recorder;
     simplfy.simplify(n_vertices);
+    recorder.finish(*progressive);
+}
+
+void mesh_simplification_parallel(halfedge_mesh &mesh, unsigned int n_vertices, bcg_scalar_t aspect_ratio,
+                                  bcg_scalar_t edge_length, unsigned int max_valence,
+                                  bcg_scalar_t normal_deviation, bcg_scalar_t hausdorff_error,
+                                  size_t parallel_grain_size, progressive_mesh *progressive) {
+    simplification simplfy(mesh, aspect_ratio, edge_length, max_valence, normal_deviation, hausdorff_error);
+    if (!progressive) {
+        simplfy.simplify_parallel(n_vertices, parallel_grain_size);
+        return;
+    }
+    mesh.garbage_collection();
+    progressive_mesh_recorder recorder(mesh);
+    simplfy.recorder = &recorder;
+    simplfy.simplify_parallel(n_vertices, parallel_grain_size);
+    recorder.finish(*progressive);
 }
 
 }
@@ -6,12 +6,22 @@
 #define BCG_GRAPHICS_BCG_MESH_SIMPLIFICATION_H
 
 #include "bcg_mesh.h"
+#include "bcg_mesh_progressive.h"
 
 namespace bcg {
 
+// With progressive set, the collapses are recorded into a progressive mesh from the result up to the input mesh.
 void mesh_simplification(halfedge_mesh &mesh, unsigned int n_vertices, bcg_scalar_t aspect_ratio = 0.0,
                          bcg_scalar_t edge_length = 0.0, unsigned int max_valence = 0,
-                         bcg_scalar_t normal_deviation = 0.0, bcg_scalar_t hausdorff_error = 0.0);
+                         bcg_scalar_t normal_deviation = 0.0, bcg_scalar_t hausdorff_error = 0.0,
+                         progressive_mesh *progressive = nullptr);
+
+// Same constraints, but collapses are applied in rounds: the cheapest candidates claim the vertices around their
+// collapse and those owning all of them are collapsed together.
+void mesh_simplification_parallel(halfedge_mesh &mesh, unsigned int n_vertices, bcg_scalar_t aspect_ratio = 0.0,
+                                  bcg_scalar_t edge_length = 0.0, unsigned int max_valence = 0,
+                                  bcg_scalar_t normal_deviation = 0.0, bcg_scalar_t hausdorff_error = 0.0,
+                                  size_t parallel_grain_size = 1024, progressive_mesh *progressive = nullptr);
 
 }
 
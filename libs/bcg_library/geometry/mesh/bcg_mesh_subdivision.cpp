@@ -15,8 +15,7 @@ void post_postprocessing(halfedge_mesh &mesh) {
     }
 
     auto lines = mesh.edges.get_or_add<VectorI<2>, 2>("edges");
-    lines.vector() = mesh.get_connectivity();
-    lines.set_dirty();
+    lines.set(mesh.get_connectivity());
     auto triangles = mesh.edges.get_or_add<VectorI<3>, 3>("triangles");
     triangles = mesh.get_triangles();
     triangles.set_dirty();
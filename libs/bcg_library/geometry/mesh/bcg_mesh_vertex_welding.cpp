@@ -0,0 +1,122 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include "bcg_mesh_vertex_welding.h"
+#include "tbb/tbb.h"
+
+namespace bcg {
+
+namespace {
+
+inline uint64_t hash_key(const std::array<int64_t, 3> &key) {
+    uint64_t h = 0;
+    for (const auto value : key) {
+        h = (h ^ uint64_t(value)) * 0x9E3779B97F4A7C15ull;
+        h ^= h >> 29u;
+    }
+    return h;
+}
+
+}
+
+std::vector<bcg_index_t> weld_vertices(const std::vector<VectorS<3>> &corners, bcg_scalar_t tolerance,
+                                       std::vector<VectorS<3>> &points, size_t parallel_grain_size) {
+    size_t n = corners.size();
+    std::vector<std::array<int64_t, 3>> keys(n);
+    std::vector<uint64_t> hashes(n);
+    tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, n, parallel_grain_size),
+            [&](const tbb::blocked_range<size_t> &range) {
+                for (size_t c = range.begin(); c != range.end(); ++c) {
+                    for (int i = 0; i < 3; ++i) {
+                        if (tolerance > 0) {
+                            keys[c][i] = int64_t(std::floor(corners[c][i] / tolerance));
+                        } else {
+                            // the bit pattern, adding 0 turns -0 into 0
+                            bcg_scalar_t value = corners[c][i] + bcg_scalar_t(0);
+                            int64_t bits = 0;
+                            std::memcpy(&bits, &value, sizeof(value));
+                            keys[c][i] = bits;
+                        }
+                    }
+                    hashes[c] = hash_key(keys[c]);
+                }
+            }
+    );
+
+    // corners are split by the high bits of their hash into partitions that are welded independently, each with its
+    // own open addressing table. Within a partition corners stay in input order, so the first corner of a vertex is
+    // the one that inserts it.
+    int partition_bits = 0;
+    while (partition_bits < 10 && (n >> partition_bits) > parallel_grain_size) {
+        ++partition_bits;
+    }
+    size_t num_partitions = size_t(1) << partition_bits;
+    auto partition_of = [partition_bits](uint64_t hash) {
+        return partition_bits == 0 ? 0 : size_t(hash >> (64 - partition_bits));
+    };
+    std::vector<size_t> offsets(num_partitions + 1, 0);
+    for (size_t c = 0; c < n; ++c) {
+        ++offsets[partition_of(hashes[c]) + 1];
+    }
+    for (size_t p = 0; p < num_partitions; ++p) {
+        offsets[p + 1] += offsets[p];
+    }
+    std::vector<bcg_index_t> partitioned(n);
+    {
+        std::vector<size_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (size_t c = 0; c < n; ++c) {
+            partitioned[cursor[partition_of(hashes[c])]++] = bcg_index_t(c);
+        }
+    }
+
+    std::vector<bcg_index_t> first_corner(n);
+    tbb::parallel_for(size_t(0), num_partitions, [&](size_t p) {
+        size_t capacity = 16;
+        while (capacity < 2 * (offsets[p + 1] - offsets[p])) {
+            capacity *= 2;
+        }
+        std::vector<bcg_index_t> table(capacity, std::numeric_limits<bcg_index_t>::max());
+        for (size_t i = offsets[p]; i < offsets[p + 1]; ++i) {
+            auto c = partitioned[i];
+            for (size_t slot = hashes[c] & (capacity - 1);; slot = (slot + 1) & (capacity - 1)) {
+                if (table[slot] == std::numeric_limits<bcg_index_t>::max()) {
+                    table[slot] = c;
+                    first_corner[c] = c;
+                    break;
+                }
+                if (hashes[table[slot]] == hashes[c] && keys[table[slot]] == keys[c]) {
+                    first_corner[c] = table[slot];
+                    break;
+                }
+            }
+        }
+    });
+
+    std::vector<bcg_index_t> vertex_ids(n);
+    points.clear();
+    for (size_t c = 0; c < n; ++c) {
+        if (first_corner[c] == c) {
+            vertex_ids[c] = bcg_index_t(points.size());
+            points.push_back(corners[c]);
+        }
+    }
+
+    std::vector<bcg_index_t> indices(n);
+    tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, n, parallel_grain_size),
+            [&](const tbb::blocked_range<size_t> &range) {
+                for (size_t c = range.begin(); c != range.end(); ++c) {
+                    indices[c] = vertex_ids[first_corner[c]];
+                }
+            }
+    );
+    return indices;
+}
+
+}
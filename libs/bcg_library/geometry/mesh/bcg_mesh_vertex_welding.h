@@ -0,0 +1,22 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#ifndef BCG_GRAPHICS_BCG_MESH_VERTEX_WELDING_H
+#define BCG_GRAPHICS_BCG_MESH_VERTEX_WELDING_H
+
+#include <vector>
+#include "math/vector/bcg_vector.h"
+
+namespace bcg {
+
+// Merges the corners of a triangle soup into shared vertices. With tolerance 0 corners with equal coordinates are
+// merged, otherwise corners in the same cell of a grid with spacing tolerance. Writes the unique vertices to points,
+// numbered in the order of their first corner and placed there, and returns the vertex of each corner. Corners are
+// hashed into partitions that are welded in parallel.
+std::vector<bcg_index_t> weld_vertices(const std::vector<VectorS<3>> &corners, bcg_scalar_t tolerance,
+                                       std::vector<VectorS<3>> &points, size_t parallel_grain_size = 1 << 16);
+
+}
+
+#endif //BCG_GRAPHICS_BCG_MESH_VERTEX_WELDING_H
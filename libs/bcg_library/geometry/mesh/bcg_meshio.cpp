@@ -2,12 +2,20 @@
 // Created by alex on 14.10.20.
 //
 
-#include <map>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <fstream>
+#include <limits>
 #include <utility>
 #include "rply/rply.h"
 #include "bcg_meshio.h"
 #include "utils/bcg_path.h"
+#include "bcg_property_io.h"
+#include "bcg_ply_io.h"
+#include "bcg_mesh_vertex_welding.h"
+#include "utils/bcg_mapped_file.h"
+#include "utils/bcg_number_table.h"
 
 namespace bcg {
 
@@ -36,6 +44,8 @@ bool meshio::read(halfedge_mesh &mesh) {
         return read_ply(mesh);
     } else if (ext == ".pmp") {
         return read_pmp(mesh);
+    } else if (ext == ".bcg") {
+        return read_bcg(mesh);
     } else if (ext == ".xyz") {
         return read_xyz(mesh);
     } else if (ext == ".agi") {
@@ -61,6 +71,8 @@ bool meshio::write(halfedge_mesh &mesh) {
         return write_ply(mesh);
     } else if (ext == ".pmp") {
         return write_pmp(mesh);
+    } else if (ext == ".bcg") {
+        return write_bcg(mesh);
     } else if (ext == ".xyz") {
         return write_xyz(mesh);
     }
@@ -99,9 +111,6 @@ bool read_off_ascii(halfedge_mesh &mesh, FILE *in, const bool has_normals,
     }
 
     mesh.vertices.reserve(nv);
-    mesh.halfedges.reserve(2 * std::max(3 * nv, ne));
-    mesh.edges.reserve(std::max(3 * nv, ne));
-    mesh.faces.reserve(nf);
 
     // read vertices: pos [normal] [color] [texcoord]
     for (i = 0; i < nv && !feof(in); ++i) {
@@ -147,8 +156,9 @@ bool read_off_ascii(halfedge_mesh &mesh, FILE *in, const bool has_normals,
     }
 
     // read faces: #N v[1] v[2] ... v[n-1]
-    std::vector<vertex_handle> vertices;
-    face_handle f;
+    std::vector<bcg_index_t> indices, offsets{0};
+    indices.reserve(3 * nf);
+    offsets.reserve(nf + 1);
     for (i = 0; i < nf; ++i) {
         // read line
         lp = fgets(line, 1000, in);
@@ -157,22 +167,23 @@ bool read_off_ascii(halfedge_mesh &mesh, FILE *in, const bool has_normals,
         // #vertices
         items = sscanf(lp, "%d%n", (int *) &nv, &nc);
         assert(items == 1);
-        vertices.resize(nv);
         lp += nc;
 
         // indices
         for (j = 0; j < nv; ++j) {
-            items = sscanf(lp, "%d%n", (int *) &idx, &nc);
-            assert(items == 1);
-            vertices[j] = vertex_handle(idx);
+            if (sscanf(lp, "%d%n", (int *) &idx, &nc) != 1) {
+                break;
+            }
+            indices.push_back(idx);
             lp += nc;
         }
-        if (vertices.size() == nv) {
-            f = mesh.add_face(vertices);
-        } else {
+        if (j != nv) {
             std::cerr << "OFF: fail to read face " << i;
+            indices.resize(offsets.back());
         }
+        offsets.push_back(indices.size());
     }
+    mesh.build_from_faces(indices, offsets);
 
     return true;
 }
@@ -226,9 +237,6 @@ bool read_off_binary(halfedge_mesh &mesh, FILE *in, const bool has_normals,
     tfread(in, nf);
     tfread(in, ne);
     mesh.vertices.reserve(nv);
-    mesh.halfedges.reserve(2 * std::max(3 * nv, ne));
-    mesh.edges.reserve(std::max(3 * nv, ne));
-    mesh.faces.reserve(nf);
 
     // read vertices: pos [normal] [color] [texcoord]
     for (i = 0; i < nv && !feof(in); ++i) {
@@ -251,17 +259,18 @@ bool read_off_binary(halfedge_mesh &mesh, FILE *in, const bool has_normals,
     }
 
     // read faces: #N v[1] v[2] ... v[n-1]
-    std::vector<vertex_handle> vertices;
-    face_handle f;
+    std::vector<bcg_index_t> indices, offsets{0};
+    indices.reserve(3 * nf);
+    offsets.reserve(nf + 1);
     for (i = 0; i < nf; ++i) {
         tfread(in, nv);
-        vertices.resize(nv);
         for (j = 0; j < nv; ++j) {
             tfread(in, idx);
-            vertices[j] = vertex_handle(idx);
+            indices.push_back(idx);
         }
-        f = mesh.add_face(vertices);
+        offsets.push_back(indices.size());
     }
+    mesh.build_from_faces(indices, offsets);
 
     return true;
 }
@@ -335,286 +344,291 @@ bool meshio::read_off(halfedge_mesh &mesh) {
     return ok;
 }
 
-bool meshio::read_obj(halfedge_mesh &mesh) {
-    char s[200];
-    float x, y, z;
-    std::vector<vertex_handle> vertices;
-    std::vector<VectorS<2>> all_tex_coords; //individual texture coordinates
-    std::vector<int> halfedge_tex_idx; //texture coordinates sorted for halfedges
-    property<VectorS<2>, 2> tex_coords = mesh.halfedges.get_or_add<VectorS<2>, 2>("v_tex");
-    bool with_tex_coord = false;
+namespace {
+
+// records of one chunk of an obj file. Corner indices are 0-based, relative ones (negative in the file) are resolved
+// against the records of the chunk and listed, so that the records of earlier chunks can be added later. Until then
+// they may have wrapped around below zero. Missing and invalid indices are -1.
+struct obj_chunk {
+    std::vector<VectorS<3>> positions, normals;
+    std::vector<VectorS<2>> tex_coords;
+    std::vector<bcg_index_t> v_idx, t_idx, n_idx;  // per corner, t_idx and n_idx stay empty if no corner has one
+    std::vector<size_t> relative_v, relative_t, relative_n;
+    std::vector<bcg_index_t> face_ends;        // one past the last corner of each face
+};
 
-    // open file (in ASCII mode)
-    FILE *in = fopen(filename.c_str(), "r");
-    if (!in) {
-        return false;
-    }
+inline void skip_blanks(const char *&pen, const char *end) {
+    while (pen != end && (*pen == ' ' || *pen == '\t')) ++pen;
+}
 
-    // clear line once
-    memset(&s, 0, 200);
+inline bool parse_obj_real(const char *&pen, const char *end, double &value) {
+    skip_blanks(pen, end);
+    bool neg = pen != end && *pen == '-';
+    if (pen != end && (*pen == '-' || *pen == '+')) ++pen;
+    if (pen == end || !(is_digit(*pen) || (*pen == '.' && pen + 1 != end && is_digit(pen[1])))) return false;
+    value = parse_unsigned<double>(pen, end);
+    value = neg ? -value : value;
+    return true;
+}
 
-    // parse line by line (currently only supports vertex positions & faces
-    vertex_handle v;
-    while (in && !feof(in) && fgets(s, 200, in)) {
-        // comment
-        if (s[0] == '#' || isspace(s[0])) {
-            continue;
-        }
+inline bool parse_obj_index(const char *&pen, const char *end, int64_t &value) {
+    bool neg = pen != end && *pen == '-';
+    if (neg) ++pen;
+    if (pen == end || !is_digit(*pen)) return false;
+    value = 0;
+    for (; pen != end && is_digit(*pen); ++pen) {
+        value = value * 10 + (*pen - '0');
+    }
+    value = neg ? -value : value;
+    return true;
+}
 
-            // vertex
-        else if (strncmp(s, "v ", 2) == 0) {
-            if (sscanf(s, "v %f %f %f", &x, &y, &z) == 3) {
-                v = mesh.add_vertex(VectorS<3>(x, y, z));
-            }
-        }
+// stores the 0-based index of a file index, count is the number of records of the chunk read so far
+inline void store_obj_index(int64_t index, size_t count, std::vector<bcg_index_t> &indices,
+                            std::vector<size_t> &relative) {
+    if (index < 0) {
+        relative.push_back(indices.size());
+        indices.push_back(bcg_index_t(int64_t(count) + index));
+    } else {
+        indices.push_back(index == 0 || index > std::numeric_limits<bcg_index_t>::max() ? bcg_index_t(-1)
+                                                                                      : bcg_index_t(index - 1));
+    }
+}
 
-            // normal
-        else if (strncmp(s, "vn ", 3) == 0) {
-            if (sscanf(s, "vn %f %f %f", &x, &y, &z) == 3) {
-                // problematic as it can be either a vertex property when interpolated
-                // or a halfedge property for hard edges
+void parse_obj_face(const char *pen, const char *end, obj_chunk &chunk) {
+    size_t first = chunk.v_idx.size();
+    while (true) {
+        skip_blanks(pen, end);
+        int64_t v;
+        if (!parse_obj_index(pen, end, v)) break;
+        store_obj_index(v, chunk.positions.size(), chunk.v_idx, chunk.relative_v);
+        // v/t, v//n or v/t/n
+        int64_t index;
+        for (int component = 1; component < 3 && pen != end && *pen == '/'; ++component) {
+            ++pen;
+            if (!parse_obj_index(pen, end, index)) continue;
+            auto &indices = component == 1 ? chunk.t_idx : chunk.n_idx;
+            indices.resize(chunk.v_idx.size() - 1, bcg_index_t(-1));
+            if (component == 1) {
+                store_obj_index(index, chunk.tex_coords.size(), indices, chunk.relative_t);
+            } else {
+                store_obj_index(index, chunk.normals.size(), indices, chunk.relative_n);
             }
         }
+        // anything else ends the corner
+        while (pen != end && *pen != ' ' && *pen != '\t') ++pen;
+    }
+    if (chunk.v_idx.size() > first) {
+        chunk.face_ends.push_back(bcg_index_t(chunk.v_idx.size()));
+    }
+}
 
-            // texture coordinate
-        else if (strncmp(s, "vt ", 3) == 0) {
-            auto result = sscanf(s, "vt %f %f", &x, &y);
-            if (result == 2) {
-                all_tex_coords.emplace_back(x, y);
+void parse_obj_chunk(const char *pen, const char *end, obj_chunk &chunk) {
+    while (pen != end) {
+        const char *line_end = static_cast<const char *>(std::memchr(pen, '\n', size_t(end - pen)));
+        line_end = line_end ? line_end : end;
+        skip_blanks(pen, line_end);
+        double x[3] = {0, 0, 0};
+        if (line_end - pen > 1 && pen[0] == 'v' && (pen[1] == ' ' || pen[1] == '\t')) {
+            pen += 1;
+            if (parse_obj_real(pen, line_end, x[0]) && parse_obj_real(pen, line_end, x[1]) &&
+                parse_obj_real(pen, line_end, x[2])) {
+                chunk.positions.emplace_back(x[0], x[1], x[2]);
             }
-        }
-
-            // face
-        else if (strncmp(s, "f ", 2) == 0) {
-            int component(0), nv(0);
-            bool end_of_vertex(false);
-            char *p0, *p1(s + 1);
-
-            vertices.clear();
-            halfedge_tex_idx.clear();
-
-            // skip white-spaces
-            while (*p1 == ' ') {
-                ++p1;
+        } else if (line_end - pen > 2 && pen[0] == 'v' && pen[1] == 't' && (pen[2] == ' ' || pen[2] == '\t')) {
+            pen += 2;
+            if (parse_obj_real(pen, line_end, x[0])) {
+                parse_obj_real(pen, line_end, x[1]);
+                chunk.tex_coords.emplace_back(x[0], x[1]);
             }
-
-            while (p1) {
-                p0 = p1;
-
-                // overwrite next separator
-
-                // skip '/', '\n', ' ', '\0', '\r' <-- don't forget Windows
-                while (*p1 != '/' && *p1 != '\r' && *p1 != '\n' && *p1 != ' ' && *p1 != '\0') {
-                    ++p1;
-                }
-
-                // detect end of vertex
-                if (*p1 != '/') {
-                    end_of_vertex = true;
-                }
-
-                // replace separator by '\0'
-                if (*p1 != '\0') {
-                    *p1 = '\0';
-                    p1++; // point to next token
-                }
-
-                // detect end of line and break
-                if (*p1 == '\0' || *p1 == '\n') {
-                    p1 = nullptr;
-                }
-
-                // read next vertex component
-                if (*p0 != '\0') {
-                    switch (component) {
-                        case 0: // vertex
-                        {
-                            vertices.emplace_back(atoi(p0) - 1);
-                            break;
-                        }
-                        case 1: // texture coord
-                        {
-                            int idx = atoi(p0) - 1;
-                            halfedge_tex_idx.push_back(idx);
-                            with_tex_coord = true;
-                            break;
-                        }
-                        case 2: // normal
-                            break;
-                    }
-                }
-
-                ++component;
-
-                if (end_of_vertex) {
-                    component = 0;
-                    nv++;
-                    end_of_vertex = false;
-                }
+        } else if (line_end - pen > 2 && pen[0] == 'v' && pen[1] == 'n' && (pen[2] == ' ' || pen[2] == '\t')) {
+            pen += 2;
+            if (parse_obj_real(pen, line_end, x[0]) && parse_obj_real(pen, line_end, x[1]) &&
+                parse_obj_real(pen, line_end, x[2])) {
+                chunk.normals.emplace_back(x[0], x[1], x[2]);
             }
+        } else if (line_end - pen > 1 && pen[0] == 'f' && (pen[1] == ' ' || pen[1] == '\t')) {
+            parse_obj_face(pen + 1, line_end, chunk);
+        }
+        pen = line_end == end ? end : line_end + 1;
+    }
+    if (!chunk.t_idx.empty()) chunk.t_idx.resize(chunk.v_idx.size(), bcg_index_t(-1));
+    if (!chunk.n_idx.empty()) chunk.n_idx.resize(chunk.v_idx.size(), bcg_index_t(-1));
+}
+
+}
 
-            face_handle f = mesh.add_face(vertices);
+bool meshio::read_obj(halfedge_mesh &mesh) {
+    mapped_file file(filename);
+    if (!file) {
+        return false;
+    }
 
-            // add texture coordinates
-            if (with_tex_coord && f.is_valid()) {
-                unsigned v_idx = 0;
-                for (const auto h : mesh.get_halfedges(f)) {
-                    tex_coords[h] = all_tex_coords[halfedge_tex_idx[v_idx]];
-                    ++v_idx;
+    // chunks end at line breaks and are parsed in parallel
+    const size_t chunk_size = 1 << 22;
+    std::vector<const char *> bounds{file.begin()};
+    while (bounds.back() != file.end()) {
+        const char *next = size_t(file.end() - bounds.back()) > chunk_size ? bounds.back() + chunk_size : file.end();
+        next = std::find(next, file.end(), '\n');
+        bounds.push_back(next == file.end() ? file.end() : next + 1);
+    }
+    std::vector<obj_chunk> chunks(bounds.size() - 1);
+    tbb::parallel_for(size_t(0), chunks.size(), [&](size_t c) {
+        parse_obj_chunk(bounds[c], bounds[c + 1], chunks[c]);
+    });
+
+    // records and corners of the chunks before each chunk
+    struct chunk_offsets {
+        size_t v = 0, t = 0, n = 0, corners = 0, faces = 0;
+    };
+    std::vector<chunk_offsets> offsets(chunks.size() + 1);
+    bool with_tex_coords = false, with_normals = false;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        offsets[c + 1].v = offsets[c].v + chunks[c].positions.size();
+        offsets[c + 1].t = offsets[c].t + chunks[c].tex_coords.size();
+        offsets[c + 1].n = offsets[c].n + chunks[c].normals.size();
+        offsets[c + 1].corners = offsets[c].corners + chunks[c].v_idx.size();
+        offsets[c + 1].faces = offsets[c].faces + chunks[c].face_ends.size();
+        with_tex_coords |= !chunks[c].t_idx.empty();
+        with_normals |= !chunks[c].n_idx.empty();
+    }
+    const auto &total = offsets.back();
+
+    mesh.vertices.resize(total.v);
+    std::vector<bcg_index_t> indices(total.corners), face_offsets(total.faces + 1, 0);
+    std::vector<VectorS<2>> all_tex_coords(total.t);
+    std::vector<VectorS<3>> all_normals(total.n);
+    std::vector<bcg_index_t> corner_tex, corner_normals;
+    if (with_tex_coords) corner_tex.assign(total.corners, bcg_index_t(-1));
+    if (with_normals) corner_normals.assign(total.corners, bcg_index_t(-1));
+    tbb::parallel_for(size_t(0), chunks.size(), [&](size_t c) {
+        auto &chunk = chunks[c];
+        const auto &offset = offsets[c];
+        std::copy(chunk.positions.begin(), chunk.positions.end(), mesh.positions.vector().begin() + offset.v);
+        std::copy(chunk.tex_coords.begin(), chunk.tex_coords.end(), all_tex_coords.begin() + offset.t);
+        std::copy(chunk.normals.begin(), chunk.normals.end(), all_normals.begin() + offset.n);
+        // out of range corners make build_from_faces skip their face
+        for (auto i : chunk.relative_v) chunk.v_idx[i] += bcg_index_t(offset.v);
+        for (auto i : chunk.relative_t) chunk.t_idx[i] += bcg_index_t(offset.t);
+        for (auto i : chunk.relative_n) chunk.n_idx[i] += bcg_index_t(offset.n);
+        std::copy(chunk.v_idx.begin(), chunk.v_idx.end(), indices.begin() + offset.corners);
+        // the corner attributes are only allocated if any face has them
+        if (with_tex_coords) {
+            std::copy(chunk.t_idx.begin(), chunk.t_idx.end(), corner_tex.begin() + offset.corners);
+        }
+        if (with_normals) {
+            std::copy(chunk.n_idx.begin(), chunk.n_idx.end(), corner_normals.begin() + offset.corners);
+        }
+        for (size_t f = 0; f < chunk.face_ends.size(); ++f) {
+            face_offsets[offset.faces + f + 1] = bcg_index_t(offset.corners + chunk.face_ends[f]);
+        }
+    });
+    chunks.clear();
+
+    auto faces = mesh.build_from_faces(indices, face_offsets);
+
+    // per corner attributes are stored on the halfedges, the corners of a face start at its first vertex
+    auto store_corners = [&](auto &prop, const std::vector<bcg_index_t> &corner_index, const auto &values) {
+        tbb::parallel_for(size_t(0), faces.size(), [&](size_t i) {
+            if (!faces[i].is_valid()) return;
+            size_t corner = face_offsets[i];
+            for (const auto h : mesh.get_halfedges(faces[i])) {
+                bcg_index_t idx = corner_index[corner++];
+                if (idx < values.size()) {
+                    prop[h] = values[idx];
                 }
             }
-        }
-        // clear line
-        memset(&s, 0, 200);
+        });
+    };
+    if (with_tex_coords) {
+        auto tex_coords = mesh.halfedges.get_or_add<VectorS<2>, 2>("v_tex");
+        store_corners(tex_coords, corner_tex, all_tex_coords);
     }
-
-    // if there are no textures, delete texture property!
-    if (!with_tex_coord) {
-        mesh.halfedges.remove(tex_coords);
+    if (with_normals) {
+        auto normals = mesh.halfedges.get_or_add<VectorS<3>, 3>("h_normal");
+        store_corners(normals, corner_normals, all_normals);
     }
-
-    fclose(in);
     return true;
 }
 
 
-class CmpVec {
-public:
-    explicit CmpVec(bcg_scalar_t eps = scalar_eps) : eps_(eps) {}
-
-    bool operator()(const VectorS<3> &v0, const VectorS<3> &v1) const {
-        if (std::abs(v0[0] - v1[0]) <= eps_) {
-            if (std::abs(v0[1] - v1[1]) <= eps_) {
-                return (v0[2] < v1[2] - eps_);
-            } else {
-                return (v0[1] < v1[1] - eps_);
-            }
-        } else {
-            return (v0[0] < v1[0] - eps_);
-        }
+// keywords of ascii stl files may be upper or lower case, keyword is lower case
+static bool is_keyword(const char *pen, const char *end, const char *keyword) {
+    for (; *keyword; ++keyword, ++pen) {
+        if (pen == end || std::tolower((unsigned char) *pen) != *keyword) return false;
     }
+    return true;
+}
 
-private:
-    bcg_scalar_t eps_;
-};
-
-bool meshio::read_stl(halfedge_mesh &mesh) {
-    char line[100], *c;
-    unsigned int i, nT(0);
-    Vector<float, 3> p;
-    vertex_handle v;
-    std::vector<vertex_handle> vertices(3);
-
-
-    CmpVec comp(scalar_min);
-    std::map<VectorS<3>, vertex_handle, CmpVec> vMap(comp);
-    std::map<VectorS<3>, vertex_handle, CmpVec>::iterator vMapIt;
-
-    // open file (in ASCII mode)
-    FILE *in = fopen(filename.c_str(), "r");
-    if (!in) return false;
+static const char *find_keyword(const char *pen, const char *end, const char *keyword) {
+    return std::search(pen, end, keyword, keyword + std::strlen(keyword), [](char c, char k) {
+        return std::tolower((unsigned char) c) == k;
+    });
+}
 
-    // ASCII or binary STL?
-    c = fgets(line, 6, in);
-    assert(c != nullptr);
-    const bool binary = ((strncmp(line, "SOLID", 5) != 0) && (strncmp(line, "solid", 5) != 0));
+static const char *skip_space(const char *pen, const char *end) {
+    while (pen != end && std::isspace((unsigned char) *pen)) ++pen;
+    return pen;
+}
 
-    // parse binary STL
+bool meshio::read_stl(halfedge_mesh &mesh) {
+    mapped_file file(filename);
+    if (!file) return false;
+
+    // ascii if it starts with "solid" and its first line is followed by "facet" or "endsolid". Binary files may
+    // start with "solid" as well, and may carry bytes after the triangles.
+    const char *begin = file.begin(), *end = file.end();
+    const char *pen = skip_space(begin, end);
+    bool ascii = false;
+    if (is_keyword(pen, end, "solid")) {
+        pen = std::find(pen, end, '\n');
+        pen = skip_space(pen, end);
+        ascii = is_keyword(pen, end, "facet") || is_keyword(pen, end, "endsolid");
+    }
+    uint32_t nT = 0;
+    if (file.size() >= 84) {
+        std::memcpy(&nT, begin + 80, sizeof(nT));
+    }
+    const bool binary = !ascii && file.size() >= 84 + 50 * size_t(nT);
+
+    // triangle corners, welded into vertices afterwards
+    std::vector<VectorS<3>> corners;
     if (binary) {
-        size_t n_items(0);
-        // re-open file in binary mode
-        fclose(in);
-        in = fopen(filename.c_str(), "rb");
-        if (!in) {
-            return false;
-        }
-
-        // skip dummy header
-        n_items = fread(line, 1, 80, in);
-        assert(n_items > 0);
-
-        // read number of triangles
-        tfread(in, nT);
-
-        // read triangles
-        while (nT) {
-            // skip triangle normal
-            n_items = fread(line, 1, 12, in);
-            assert(n_items > 0);
-            // triangle's vertices
-            for (i = 0; i < 3; ++i) {
-                tfread(in, p);
-
-                // has vector been referenced before?
-                if ((vMapIt = vMap.find(p.cast<bcg_scalar_t>())) == vMap.end()) {
-                    // No : add vertex and remember idx/vector mapping
-                    v = mesh.add_vertex(p.cast<bcg_scalar_t>());
-                    vertices[i] = v;
-                    vMap[p.cast<bcg_scalar_t>()] = v;
-                } else {
-                    // Yes : get index from map
-                    vertices[i] = vMapIt->second;
-                }
+        // per triangle: normal, three corners, attribute byte count
+        corners.resize(3 * size_t(nT));
+        tbb::parallel_for(size_t(0), size_t(nT), [&](size_t t) {
+            float p[9];
+            std::memcpy(p, begin + 84 + 50 * t + 12, sizeof(p));
+            for (size_t i = 0; i < 3; ++i) {
+                corners[3 * t + i] = Vector<float, 3>(p[3 * i], p[3 * i + 1], p[3 * i + 2]).cast<bcg_scalar_t>();
             }
-
-            // Add face only if it is not degenerated
-            face_handle f;
-            if ((vertices[0] != vertices[1]) &&
-                (vertices[0] != vertices[2]) &&
-                (vertices[1] != vertices[2])) {
-                f = mesh.add_face(vertices);
+        });
+    } else {
+        // every "vertex" keyword is followed by three numbers
+        float p[3];
+        pen = begin;
+        while ((pen = find_keyword(pen, end, "vertex")) != end) {
+            pen += 6;
+            if (parse_number_row(pen, end, p, 3) == 3) {
+                corners.emplace_back(p[0], p[1], p[2]);
             }
-
-            n_items = fread(line, 1, 2, in);
-            assert(n_items > 0);
-            --nT;
         }
+        corners.resize(corners.size() / 3 * 3);
     }
+    if (corners.empty()) return false;
 
-        // parse ASCII STL
-    else {
-        // parse line by line
-        while (in && !feof(in) && fgets(line, 100, in)) {
-            // skip white-space
-            for (c = line; isspace(*c) && *c != '\0'; ++c) {}
-
-            // face begins
-            if ((strncmp(c, "outer", 5) == 0) || (strncmp(c, "OUTER", 5) == 0)) {
-                // read three vertices
-                for (i = 0; i < 3; ++i) {
-                    // read line
-                    c = fgets(line, 100, in);
-                    assert(c != nullptr);
-
-                    // skip white-space
-                    for (c = line; isspace(*c) && *c != '\0'; ++c) {}
-
-                    // read x, y, z
-                    sscanf(c + 6, "%f %f %f", &p[0], &p[1], &p[2]);
-
-                    // has vector been referenced before?
-                    if ((vMapIt = vMap.find(p.cast<bcg_scalar_t>())) == vMap.end()) {
-                        // No : add vertex and remember idx/vector mapping
-                        v = mesh.add_vertex(p.cast<bcg_scalar_t>());
-                        vertices[i] = v;
-                        vMap[p.cast<bcg_scalar_t>()] = v;
-                    } else {
-                        // Yes : get index from map
-                        vertices[i] = vMapIt->second;
-                    }
-                }
+    std::vector<VectorS<3>> points;
+    auto indices = weld_vertices(corners, flags.stl_weld_tolerance, points);
 
-                // Add face only if it is not degenerated
-                face_handle f;
-                if ((vertices[0] != vertices[1]) &&
-                    (vertices[0] != vertices[2]) &&
-                    (vertices[1] != vertices[2]))
-                    f = mesh.add_face(vertices);
-            }
+    // drop triangles that became degenerate
+    size_t num_triangles = 0;
+    for (size_t t = 0; t < indices.size(); t += 3) {
+        if (indices[t] != indices[t + 1] && indices[t] != indices[t + 2] && indices[t + 1] != indices[t + 2]) {
+            std::copy(indices.begin() + t, indices.begin() + t + 3, indices.begin() + 3 * num_triangles++);
         }
     }
-
-    fclose(in);
+    indices.resize(3 * num_triangles);
+    mesh.build_from_faces(points, indices);
     return true;
 }
 
@@ -640,6 +654,11 @@ static int vertexCallback(p_ply_argument argument) {
 
 //-----------------------------------------------------------------------------
 
+// face indices collected for halfedge_mesh::build_from_faces
+struct ply_faces {
+    std::vector<bcg_index_t> indices, offsets{0};
+};
+
 // helper to assemble face data
 static int faceCallback(p_ply_argument argument) {
     long length, value_index;
@@ -648,30 +667,34 @@ static int faceCallback(p_ply_argument argument) {
     ply_get_argument_user_data(argument, &pdata, &idata);
     ply_get_argument_property(argument, nullptr, &length, &value_index);
 
-    auto *mesh = (halfedge_mesh *) pdata;
-    auto vertices = mesh->object_properties.get<std::vector<vertex_handle>, 1>("vertices");
-
-    if (value_index == 0) {
-        vertices[0].clear();
+    auto *faces = (ply_faces *) pdata;
+    if (value_index < 0) {
+        // the list length
+        return 1;
     }
 
-    int idx = (int)ply_get_argument_value(argument);
+    faces->indices.push_back((bcg_index_t) ply_get_argument_value(argument));
 
-    vertices[0].push_back(idx);
-
-    face_handle f;
     if (value_index == length - 1) {
-        f = mesh->add_face(vertices[0]);
+        faces->offsets.push_back(faces->indices.size());
     }
 
     return 1;
 }
 
 bool meshio::read_ply(halfedge_mesh &mesh) {
+    // binary little endian files are read directly, others through rply
+    std::vector<bcg_index_t> indices, offsets;
+    if (read_ply_binary(filename, mesh.vertices, &indices, &offsets)) {
+        mesh.build_from_faces(indices, offsets);
+        return mesh.faces.size() > 0;
+    }
+    mesh.vertices.clear();
+
     // add object properties to hold temporary data
     auto point = mesh.object_properties.add<VectorS<3>, 3>("v_position");
     point.resize(1);
-    auto vertices = mesh.object_properties.add<std::vector<vertex_handle>, 1>("vertices");
+    ply_faces faces;
 
     // open file, read header
     p_ply ply = ply_open(filename.c_str(), nullptr, 0, nullptr);
@@ -689,7 +712,7 @@ bool meshio::read_ply(halfedge_mesh &mesh) {
     ply_set_read_cb(ply, "vertex", "y", vertexCallback, &mesh, 1);
     ply_set_read_cb(ply, "vertex", "z", vertexCallback, &mesh, 2);
 
-    ply_set_read_cb(ply, "face", "vertex_indices", faceCallback, &mesh, 0);
+    ply_set_read_cb(ply, "face", "vertex_indices", faceCallback, &faces, 0);
 
     // read the data
     if (!ply_read(ply)) {
@@ -697,10 +720,10 @@ bool meshio::read_ply(halfedge_mesh &mesh) {
     }
 
     ply_close(ply);
+    mesh.build_from_faces(faces.indices, faces.offsets);
 
     // clean-up properties
     mesh.object_properties.remove(point);
-    mesh.object_properties.remove(vertices);
 
     return mesh.faces.size() > 0;
 }
@@ -731,7 +754,7 @@ bool meshio::read_pmp(halfedge_mesh &mesh) {
 
     // get properties
     auto vconn = mesh.vertices.get_or_add<halfedge_mesh::vertex_connectivity, 1>("v_connectivity");
-    auto hconn = mesh.halfedges.get_or_add<halfedge_mesh::halfedge_connectivity, 1>("h_connectivity");
+    auto hconn = mesh.halfedges.get_or_add<halfedge_mesh::halfedge_connectivity, 4>("h_connectivity");
     auto fconn = mesh.faces.get_or_add<halfedge_mesh::face_connectivity, 1>("f_connectivity");
     auto point = mesh.vertices.get_or_add<VectorS<3>, 3>("v_position");
 
@@ -788,16 +811,14 @@ bool meshio::read_xyz(halfedge_mesh &mesh) {
     auto vnormal = mesh.vertices.get_or_add<VectorS<3>, 3>("v_normal");
 
     char line[200];
-    bcg_scalar_t x, y, z;
-    bcg_scalar_t nx, ny, nz;
+    double x, y, z;
+    double nx, ny, nz;
     int n;
     vertex_handle v;
 
     // read data
     while (in && !feof(in) && fgets(line, 200, in)) {
-        n = sscanf(line, "%lf %lf %lf %lf %lf %lf", reinterpret_cast<double *>(&x), reinterpret_cast<double *>(&y),
-                   reinterpret_cast<double *>(&z), reinterpret_cast<double *>(&nx), reinterpret_cast<double *>(&ny),
-                   reinterpret_cast<double *>(&nz));
+        n = sscanf(line, "%lf %lf %lf %lf %lf %lf", &x, &y, &z, &nx, &ny, &nz);
         if (n >= 3) {
             v = mesh.add_vertex(VectorS<3>(x, y, z));
             if (n >= 6) {
@@ -822,18 +843,15 @@ bool meshio::read_agi(halfedge_mesh &mesh) {
     auto color = mesh.vertices.get_or_add<VectorS<3>, 3>("v_color");
 
     char line[200];
-    bcg_scalar_t x, y, z;
-    bcg_scalar_t nx, ny, nz;
-    bcg_scalar_t r, g, b;
+    double x, y, z;
+    double nx, ny, nz;
+    double r, g, b;
     int n;
     vertex_handle v;
 
     // read data
     while (in && !feof(in) && fgets(line, 200, in)) {
-        n = sscanf(line, "%lf %lf %lf %lf %lf %lf %lf %lf %lf", reinterpret_cast<double *>(&x),
-                   reinterpret_cast<double *>(&y), reinterpret_cast<double *>(&z), reinterpret_cast<double *>(&r),
-                   reinterpret_cast<double *>(&g), reinterpret_cast<double *>(&b),
-                   reinterpret_cast<double *>(&nx), reinterpret_cast<double *>(&ny), reinterpret_cast<double *>(&nz));
+        n = sscanf(line, "%lf %lf %lf %lf %lf %lf %lf %lf %lf", &x, &y, &z, &r, &g, &b, &nx, &ny, &nz);
         if (n >= 3) {
             v = mesh.add_vertex(VectorS<3>(x, y, z));
             if (n >= 6) {
@@ -914,7 +932,7 @@ bool meshio::write_off(const halfedge_mesh &mesh) {
         int nv = (int) mesh.get_valence(f);
         fprintf(out, "%d", nv);
         for (const auto fv : mesh.get_vertices(f)) {
-            fprintf(out, " %zu", fv.idx);
+            fprintf(out, " %u", fv.idx);
         }
         fprintf(out, "\n");
     }
@@ -1008,12 +1026,12 @@ bool meshio::write_obj(const halfedge_mesh &mesh) {
         do {
             if (with_tex_coord) {
                 // write vertex index, texCoord index and normal index
-                fprintf(out, " %lu/%lu/%lu", (*fvit).idx + 1, (*fhit).idx + 1,
+                fprintf(out, " %u/%u/%u", (*fvit).idx + 1, (*fhit).idx + 1,
                         (*fvit).idx + 1);
                 ++fhit;
             } else {
                 // write vertex index and normal index
-                fprintf(out, " %lu//%lu", (*fvit).idx + 1, (*fvit).idx + 1);
+                fprintf(out, " %u//%u", (*fvit).idx + 1, (*fvit).idx + 1);
             }
         } while (++fvit != fvend);
         fprintf(out, "\n");
@@ -1035,9 +1053,28 @@ bool meshio::write_stl(const halfedge_mesh &mesh) {
         return false;
     }
 
-    std::ofstream ofs(filename.c_str());
     auto positions = mesh.vertices.get<VectorS<3>, 3>("v_position");
+    if (flags.use_binary) {
+        FILE *out = fopen(filename.c_str(), "wb");
+        if (!out) {
+            return false;
+        }
+        char header[80] = "binary stl";
+        uint16_t attributes = 0;
+        fwrite(header, 1, 80, out);
+        tfwrite(out, uint32_t(mesh.num_faces()));
+        for (const auto f : mesh.faces) {
+            tfwrite(out, fnormals[f].cast<float>().eval());
+            for (const auto v : mesh.get_vertices(f)) {
+                tfwrite(out, positions[v].cast<float>().eval());
+            }
+            tfwrite(out, attributes);
+        }
+        fclose(out);
+        return true;
+    }
 
+    std::ofstream ofs(filename.c_str());
     ofs << "solid stl" << std::endl;
     ofs.precision(10);
     ofs.setf(std::ios::fixed);
@@ -1061,6 +1098,20 @@ bool meshio::write_stl(const halfedge_mesh &mesh) {
 }
 
 bool meshio::write_ply(const halfedge_mesh &mesh) {
+    if (flags.use_binary) {
+        // all arithmetic vertex properties, without rply
+        std::vector<bcg_index_t> indices, offsets{0};
+        indices.reserve(3 * mesh.num_faces());
+        offsets.reserve(mesh.num_faces() + 1);
+        for (const auto f : mesh.faces) {
+            for (const auto v : mesh.get_vertices(f)) {
+                indices.push_back(v.idx);
+            }
+            offsets.push_back(indices.size());
+        }
+        return write_ply_binary(filename, mesh.vertices, &indices, &offsets);
+    }
+
     e_ply_storage_mode mode = flags.use_binary ? PLY_LITTLE_ENDIAN : PLY_ASCII;
     p_ply ply = ply_create(filename.c_str(), mode, nullptr, 0, nullptr);
 
@@ -1093,6 +1144,18 @@ bool meshio::write_ply(const halfedge_mesh &mesh) {
     return true;
 }
 
+bool meshio::read_bcg(halfedge_mesh &mesh) {
+    if (!read_property_containers(filename, {&mesh.vertices, &mesh.halfedges, &mesh.edges, &mesh.faces,
+                                             &mesh.object_properties})) {
+        return false;
+    }
+    mesh.size_vertices_deleted = mesh.vertices_deleted.vector().count();
+    mesh.size_halfedges_deleted = mesh.halfedges_deleted.vector().count();
+    mesh.size_edges_deleted = mesh.edges_deleted.vector().count();
+    mesh.size_faces_deleted = mesh.faces_deleted.vector().count();
+    return true;
+}
+
 bool meshio::write_pmp(const halfedge_mesh &mesh) {
 // open file (in binary mode)
     FILE *out = fopen(filename.c_str(), "wb");
@@ -1102,7 +1165,7 @@ bool meshio::write_pmp(const halfedge_mesh &mesh) {
 
     // get properties
     auto vconn = mesh.vertices.get<halfedge_mesh::vertex_connectivity, 1>("v_connectivity");
-    auto hconn = mesh.halfedges.get<halfedge_mesh::halfedge_connectivity, 1>("h_connectivity");
+    auto hconn = mesh.halfedges.get<halfedge_mesh::halfedge_connectivity, 4>("h_connectivity");
     auto fconn = mesh.faces.get<halfedge_mesh::face_connectivity, 1>("f_connectivity");
     auto point = mesh.vertices.get<VectorS<3>, 3>("v_position");
     auto htex = mesh.halfedges.get<VectorS<2>, 2>("v_tex");
@@ -1155,4 +1218,14 @@ bool meshio::write_xyz(const halfedge_mesh &mesh) {
     ofs.close();
     return true;
 }
-}
\ No newline at end of file
+
+bool meshio::write_bcg(const halfedge_mesh &mesh) {
+    // connectivity refers to elements by index, so they keep their order
+    property_file_compression compression;
+    compression.delta_code = flags.use_compression;
+    compression.position_bits = flags.position_bits;
+    return write_property_containers(filename, {&mesh.vertices, &mesh.halfedges, &mesh.edges, &mesh.faces,
+                                                &mesh.object_properties}, compression);
+}
+
+}
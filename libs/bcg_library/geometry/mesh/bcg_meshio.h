@@ -21,6 +21,9 @@ struct meshio_flags {
     bool use_face_normals = false;       //!< read / write face normals
     bool use_face_colors = false;        //!< read / write face colors
     bool use_halfedge_texcoords = false; //!< read / write halfedge texcoords
+    bcg_scalar_t stl_weld_tolerance = 0; //!< stl: merge corners in the same cell of this size, 0 merges equal ones
+    bool use_compression = false;        //!< bcg: delta code connectivity and integer properties
+    unsigned int position_bits = 0;      //!< bcg: quantize positions to this many bits per axis, 0 keeps them exact
 };
 
 struct meshio {
@@ -46,6 +49,8 @@ private:
 
     bool read_agi(halfedge_mesh &mesh);
 
+    bool read_bcg(halfedge_mesh &mesh);
+
     bool write_off(const halfedge_mesh &mesh);
 
     bool write_off_binary(const halfedge_mesh &mesh);
@@ -60,6 +65,8 @@ private:
 
     bool write_xyz(const halfedge_mesh &mesh);
 
+    bool write_bcg(const halfedge_mesh &mesh);
+
 private:
     std::string filename;
     meshio_flags flags;
@@ -2,14 +2,10 @@
 // Created by alex on 25.11.20.
 //
 
-#include <queue>
-#include <utility>
+#include <array>
+#include <algorithm>
+#include "tbb/tbb.h"
 #include "bcg_octree.h"
-#include "aligned_box/bcg_aligned_child_hierarchy.h"
-#include "sphere/bcg_sphere.h"
-#include "sphere/bcg_sphere_contains_aabb.h"
-#include "intersect/bcg_intersect_sphere_aabb.h"
-#include "utils/bcg_stl_utils.h"
 
 namespace bcg {
 
@@ -20,200 +16,301 @@ octree::octree(property<VectorS<3>, 3> positions, int leaf_size, int max_depth){
 void octree::clear(){
     aabb = aligned_box3();
     storage.clear();
+    indices.clear();
 }
 
-inline uint8_t MortonCode(const VectorS<3> &center, const VectorS<3> &other) {
-    uint8_t mortonCode = 0;
-    if (other[0] > center[0]) {
-        SET_BIT(mortonCode, 0);
-    }
-    if (other[1] > center[1]) {
-        SET_BIT(mortonCode, 1);
-    }
-    if (other[2] > center[2]) {
-        SET_BIT(mortonCode, 2);
-    }
-    return mortonCode;
+// inserts two zero bits between the lowest 21 bits of x.
+static inline uint64_t spread_bits(uint64_t x) {
+    x &= 0x1fffffULL;
+    x = (x | x << 32) & 0x1f00000000ffffULL;
+    x = (x | x << 16) & 0x1f0000ff0000ffULL;
+    x = (x | x << 8) & 0x100f00f00f00f00fULL;
+    x = (x | x << 4) & 0x10c30c30c30c30c3ULL;
+    x = (x | x << 2) & 0x1249249249249249ULL;
+    return x;
 }
 
-inline bool child_exists(uint8_t config, uint8_t i) {
-    return CHECK_BIT(config, i);
+static inline uint64_t compact_bits(uint64_t x) {
+    x &= 0x1249249249249249ULL;
+    x = (x ^ (x >> 2)) & 0x10c30c30c30c30c3ULL;
+    x = (x ^ (x >> 4)) & 0x100f00f00f00f00fULL;
+    x = (x ^ (x >> 8)) & 0x1f0000ff0000ffULL;
+    x = (x ^ (x >> 16)) & 0x1f00000000ffffULL;
+    x = (x ^ (x >> 32)) & 0x1fffffULL;
+    return x;
 }
 
-inline void SetChildExists(uint8_t &config, uint8_t i) {
-    SET_BIT(config, i);
+// stable LSD radix sort of keys and values by the lowest num_bits of the keys, 8 bits per pass. Each pass counts
+// digits per block, scans the counts and scatters the blocks in parallel. Passes over a digit that is the same for
+// all keys are skipped.
+static void radix_sort(std::vector<uint64_t> &keys, std::vector<size_t> &values, int num_bits,
+                       size_t parallel_grain_size) {
+    size_t n = keys.size();
+    size_t num_blocks = (n + parallel_grain_size - 1) / parallel_grain_size;
+    std::vector<uint64_t> keys_out(n);
+    std::vector<size_t> values_out(n);
+    std::vector<std::array<size_t, 256>> counts(num_blocks);
+    for (int shift = 0; shift < num_bits; shift += 8) {
+        tbb::parallel_for(size_t(0), num_blocks, [&](size_t b) {
+            auto &count = counts[b];
+            count.fill(0);
+            size_t end = std::min(n, (b + 1) * parallel_grain_size);
+            for (size_t i = b * parallel_grain_size; i < end; ++i) {
+                ++count[(keys[i] >> shift) & 0xff];
+            }
+        });
+        size_t offset = 0;
+        bool constant_digit = false;
+        for (size_t digit = 0; digit < 256; ++digit) {
+            size_t start = offset;
+            for (auto &count : counts) {
+                size_t c = count[digit];
+                count[digit] = offset;
+                offset += c;
+            }
+            if (offset - start == n) {
+                constant_digit = true;
+            }
+        }
+        if (constant_digit) {
+            continue;
+        }
+        tbb::parallel_for(size_t(0), num_blocks, [&](size_t b) {
+            auto &offsets = counts[b];
+            size_t end = std::min(n, (b + 1) * parallel_grain_size);
+            for (size_t i = b * parallel_grain_size; i < end; ++i) {
+                size_t j = offsets[(keys[i] >> shift) & 0xff]++;
+                keys_out[j] = keys[i];
+                values_out[j] = values[i];
+            }
+        });
+        keys.swap(keys_out);
+        values.swap(values_out);
+    }
 }
 
 void octree::build(property<VectorS<3>, 3> positions, int leaf_size, int max_depth) {
     clear();
-    this->max_depth = max_depth;
-    this->leaf_size = leaf_size;
+    this->max_depth = std::min(max_depth, max_code_depth);
+    this->leaf_size = std::max(leaf_size, 1);
     this->positions = positions;
-    indices = std::vector<size_t>(positions.size());
-    for (size_t i = 0; i < positions.size(); ++i) {
-        aabb.grow(positions[i]);
-        indices[i] = i;
-    }
-
-    struct build_node {
-        build_node(aligned_box3 aabb, uint8_t depth) : aabb(std::move(aabb)), depth(depth) {}
-
-        aligned_box3 aabb;
-        uint8_t depth;
-    };
-
-    std::queue<build_node> queue;
-    queue.emplace(aabb, 0);
-    const auto &node = queue.front();
-    storage.push_back({0, positions.size() - 1, positions.size(), BCG_INVALID_ID, BCG_INVALID_ID, 0, 0});
-    size_t counter = 0;
-    int max_depth_ = std::min<int>(max_depth, 21);
-    while (!queue.empty()) {
-        auto &node = queue.front();
-        if (storage[counter].size > leaf_size && node.depth < max_depth_) {
-            std::vector<size_t> buckets[8];
-
-            auto node_center = node.aabb.center();
-            for (size_t j = storage[counter].v_start; j <= storage[counter].v_end; ++j) {
-                size_t morton_code = MortonCode(node_center, positions[indices[j]]);
-                buckets[morton_code].push_back(indices[j]);
-            }
-
-            bool firsttime = true;
-            size_t child_start = storage[counter].v_start;
+    size_t n = positions.size();
+    if (n == 0) return;
 
-            for (uint8_t octant = 0; octant < 8; ++octant) {
-                if (buckets[octant].empty()) continue;
-                if (firsttime) {
-                    firsttime = false;
-                    storage[counter].first_child_index = storage.size();
+    aabb = tbb::parallel_reduce(
+            tbb::blocked_range<size_t>(0, n, parallel_grain_size), aligned_box3(),
+            [&](const tbb::blocked_range<size_t> &range, aligned_box3 box) {
+                for (size_t i = range.begin(); i != range.end(); ++i) {
+                    box.grow(positions[i]);
                 }
+                return box;
+            },
+            [](const aligned_box3 &a, const aligned_box3 &b) { return a.merge(b); });
+    aabb.make_cubic();
+    if (aabb.diagonal()[0] <= 0) {
+        aabb.set_centered_form(aabb.center(), VectorS<3>::Constant(0.5));
+    }
 
-                SetChildExists(storage[counter].config, octant);
-
-                size_t child_size = buckets[octant].size();
-                size_t child_end = child_start + child_size - 1;
+    const uint64_t max_cell = (uint64_t(1) << max_code_depth) - 1;
+    const bcg_scalar_t scale = bcg_scalar_t(uint64_t(1) << max_code_depth) / aabb.diagonal()[0];
+    std::vector<uint64_t> codes(n);
+    indices.resize(n);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, n, parallel_grain_size),
+                      [&](const tbb::blocked_range<size_t> &range) {
+                          for (size_t i = range.begin(); i != range.end(); ++i) {
+                              VectorS<3> cell = (positions[i] - aabb.min) * scale;
+                              uint64_t code = 0;
+                              for (int k = 0; k < 3; ++k) {
+                                  auto c = uint64_t(std::max<bcg_scalar_t>(cell[k], 0));
+                                  code |= spread_bits(std::min(c, max_cell)) << k;
+                              }
+                              codes[i] = code;
+                              indices[i] = i;
+                          }
+                      });
+    radix_sort(codes, indices, 3 * max_code_depth, parallel_grain_size);
 
-                storage.push_back(
-                        {child_start, child_end, child_size, BCG_INVALID_ID,
-                         counter, 0, static_cast<uint8_t>(node.depth + 1)});
-                for (size_t l = 0; l < child_size; ++l) {
-                    indices[child_start + l] = buckets[octant][l];
+    // one level at a time: the children of a node are the runs of equal next octant digit in its sorted range.
+    storage.push_back({0, n, 0, 0, 0, 0});
+    size_t level_begin = 0, level_end = 1;
+    std::vector<std::array<size_t, 9>> ranges;
+    std::vector<size_t> first_child;
+    while (level_begin < level_end) {
+        size_t m = level_end - level_begin;
+        ranges.resize(m);
+        first_child.assign(m + 1, 0);
+        tbb::parallel_for(size_t(0), m, [&](size_t i) {
+            auto &node = storage[level_begin + i];
+            if (node.v_end - node.v_start <= size_t(this->leaf_size) || node.depth >= this->max_depth) return;
+            int shift = 3 * (max_code_depth - node.depth - 1);
+            auto &range = ranges[i];
+            range[0] = node.v_start;
+            for (uint8_t octant = 0; octant < 8; ++octant) {
+                range[octant + 1] = std::partition_point(codes.begin() + range[octant], codes.begin() + node.v_end,
+                                                         [&](uint64_t code) {
+                                                             return ((code >> shift) & 7) <= octant;
+                                                         }) - codes.begin();
+                if (range[octant + 1] > range[octant]) {
+                    node.config |= uint8_t(1) << octant;
+                    ++first_child[i + 1];
                 }
-
-                buckets[octant].clear();
-                child_start += child_size;
-                queue.emplace(child_box(node.aabb, octant), node.depth + 1);
-                assert(storage.back().v_start >= storage[counter].v_start);
-                assert(storage.back().v_end <= storage[counter].v_end);
-                assert(storage.back().size <= storage[counter].size);
             }
+        });
+        first_child[0] = storage.size();
+        for (size_t i = 0; i < m; ++i) {
+            first_child[i + 1] += first_child[i];
         }
-        ++counter;
-        queue.pop();
+        storage.resize(first_child[m]);
+        tbb::parallel_for(size_t(0), m, [&](size_t i) {
+            auto &node = storage[level_begin + i];
+            if (node.config == 0) return;
+            node.first_child_index = first_child[i];
+            size_t child = first_child[i];
+            for (uint8_t octant = 0; octant < 8; ++octant) {
+                if (node.config & (uint8_t(1) << octant)) {
+                    storage[child++] = {ranges[i][octant], ranges[i][octant + 1], node.code << 3 | octant, 0, 0,
+                                        uint8_t(node.depth + 1)};
+                }
+            }
+        });
+        level_begin = level_end;
+        level_end = storage.size();
     }
 }
 
-//test if sphere overlaps with aabb
-/*bool overlaps(const sphere3 &sphere, const aligned_box3 &aabb) {
-    VectorS<3> xyz = (sphere.center - aabb.center()).cwiseAbs() - aabb.halfextent();
-    if (xyz[0] > sphere.radius || xyz[1] > sphere.radius || xyz[2] > sphere.radius) return false;
-    int num_less_extent = (xyz[0] < 0) + (xyz[1] < 0) + (xyz[2] < 0);
-    if (num_less_extent > 1) return true;
-    xyz.cwiseMax(0);
-    return xyz.squaredNorm() < sphere.radius * sphere.radius;
-}*/
-
-neighbors_query octree::query_radius(const VectorS<3> &query_point, bcg_scalar_t radius) const {
-    neighbors_query result_set;
-    query_radius(0, aabb, sphere3(query_point, radius), result_set);
-    return result_set;
+aligned_box3 octree::node_box(const octree_node &node) const {
+    bcg_scalar_t side = aabb.diagonal()[0];
+    bcg_scalar_t cell = side / bcg_scalar_t(uint64_t(1) << max_code_depth);
+    uint64_t code = node.code << 3 * (max_code_depth - node.depth);
+    VectorS<3> corner = aabb.min + cell * VectorS<3>(bcg_scalar_t(compact_bits(code)),
+                                                     bcg_scalar_t(compact_bits(code >> 1)),
+                                                     bcg_scalar_t(compact_bits(code >> 2)));
+    bcg_scalar_t width = side / bcg_scalar_t(uint64_t(1) << node.depth);
+    // one finest cell of slack for points rounded into the neighboring cell
+    return aligned_box3(corner - VectorS<3>::Constant(cell), corner + VectorS<3>::Constant(width + cell));
 }
 
-neighbors_query octree::query_knn(const VectorS<3> &query_point, int num_closest) const {
-    neighbors_query result_set;
-    query_knn(0, aabb, query_point, num_closest, result_set);
-    return result_set;
-}
+// a node during traversal. Its cell is derived from the parent cell, so queries need no code decoding.
+struct octree_cell {
+    size_t index;
+    VectorS<3> min;
+    bcg_scalar_t width;
+    bcg_scalar_t sqr_distance;
+};
 
-void
-octree::query_radius(size_t index, const aligned_box3 &aabb, const sphere3 &sphere, neighbors_query &result_set) const {
-    if (index >= storage.size()) return;
-    if (contains<3>(sphere, aabb)) {
-        for (size_t j = storage[index].v_start; j <= storage[index].v_end; ++j) {
-            result_set.indices.push_back(indices[j]);
-        }
-        return;
+// squared distance of point to the cell grown by slack on all sides.
+static inline bcg_scalar_t sqr_distance(const VectorS<3> &min, bcg_scalar_t width, bcg_scalar_t slack,
+                                        const VectorS<3> &point) {
+    bcg_scalar_t sum = 0;
+    for (int k = 0; k < 3; ++k) {
+        bcg_scalar_t d = std::max(min[k] - slack - point[k], point[k] - (min[k] + width + slack));
+        if (d > 0) sum += d * d;
     }
+    return sum;
+}
 
-    if (storage[index].depth == max_depth || storage[index].config == 0) {
-        bcg_scalar_t sqr_radius = sphere.radius * sphere.radius;
-        for (size_t j = storage[index].v_start; j <= storage[index].v_end; ++j) {
-            bcg_scalar_t sqr_distance = (positions[indices[j]] - sphere.center).squaredNorm();
-            if (sqr_distance <= sqr_radius) {
-                result_set.indices.push_back(indices[j]);
-            }
-        }
-        return;
+static inline bcg_scalar_t sqr_max_distance(const VectorS<3> &min, bcg_scalar_t width, bcg_scalar_t slack,
+                                            const VectorS<3> &point) {
+    bcg_scalar_t sum = 0;
+    for (int k = 0; k < 3; ++k) {
+        bcg_scalar_t d = std::max(std::abs(point[k] - min[k] + slack), std::abs(min[k] + width + slack - point[k]));
+        sum += d * d;
     }
+    return sum;
+}
 
-    uint8_t offset = 0;
+// writes the cells of the children of node to children and returns their number.
+static inline size_t child_cells(const octree_node &node, const octree_cell &cell, bcg_scalar_t slack,
+                                 const VectorS<3> &point, octree_cell *children) {
+    bcg_scalar_t half = cell.width / 2;
+    size_t count = 0;
+    size_t index = node.first_child_index;
     for (uint8_t octant = 0; octant < 8; ++octant) {
-        if (!child_exists(storage[index].config, octant)) {
-            continue;
-        }
-        aligned_box3 cbox = child_box(aabb, octant);
-        if (intersect<3>(sphere, cbox)) {
-            query_radius(storage[index].first_child_index + offset, cbox, sphere, result_set);
-        }
-        ++offset;
+        if (!(node.config & (uint8_t(1) << octant))) continue;
+        VectorS<3> min = cell.min + half * VectorS<3>(octant & 1, (octant >> 1) & 1, (octant >> 2) & 1);
+        children[count++] = {index++, min, half, sqr_distance(min, half, slack, point)};
     }
+    return count;
 }
 
-void octree::query_knn(size_t index, const aligned_box3 &aabb, const VectorS<3> &query_point, int num_closest,
-                       neighbors_query &result_set) const {
-    if (storage[index].depth == max_depth || storage[index].config == 0) {
-        for (size_t j = storage[index].v_start; j <= storage[index].v_end; ++j) {
-            bcg_scalar_t sqr_distance = (positions[indices[j]] - query_point).squaredNorm();
-            result_set.indices.push_back(indices[j]);
-            result_set.distances.push_back(sqr_distance);
+neighbors_query octree::query_radius(const VectorS<3> &query_point, bcg_scalar_t radius) const {
+    neighbors_query result_set;
+    if (storage.empty()) return result_set;
+    bcg_scalar_t sqr_radius = radius * radius;
+    bcg_scalar_t side = aabb.diagonal()[0];
+    bcg_scalar_t slack = side / bcg_scalar_t(uint64_t(1) << max_code_depth);
+    std::vector<octree_cell> stack = {{0, aabb.min, side, sqr_distance(aabb.min, side, slack, query_point)}};
+    octree_cell children[8];
+    while (!stack.empty()) {
+        auto cell = stack.back();
+        stack.pop_back();
+        if (cell.sqr_distance > sqr_radius) continue;
+        const auto &node = storage[cell.index];
+        if (node.config != 0 && sqr_max_distance(cell.min, cell.width, slack, query_point) > sqr_radius) {
+            size_t count = child_cells(node, cell, slack, query_point, children);
+            stack.insert(stack.end(), children, children + count);
+            continue;
         }
-        if (result_set.indices.size() >= num_closest) {
-            sort_by_first(result_set.distances, result_set.indices);
-            result_set.distances.resize(num_closest);
-            result_set.indices.resize(num_closest);
+        // leaf or completely inside the sphere
+        for (size_t j = node.v_start; j < node.v_end; ++j) {
+            bcg_scalar_t sqr_distance = (positions[indices[j]] - query_point).squaredNorm();
+            if (sqr_distance <= sqr_radius) {
+                result_set.indices.push_back(indices[j]);
+                result_set.distances.push_back(sqr_distance);
+            }
         }
-        return;
     }
+    return result_set;
+}
 
-    uint8_t morton_code = MortonCode(aabb.center(), query_point);
-    uint8_t offset = 0;
-    for (uint8_t i = 0; i < 8; ++i) {
-        if (morton_code == i) break;
-        if (!child_exists(storage[index].config, i)) continue;
-        ++offset;
-    }
-    if (child_exists(storage[index].config, morton_code)) {
-        query_knn(storage[index].first_child_index + offset, child_box(aabb, morton_code), query_point, num_closest,
-                  result_set);
-    }
+neighbors_query octree::query_knn(const VectorS<3> &query_point, int num_closest) const {
+    neighbors_query result_set;
+    size_t k = std::min<size_t>(std::max(num_closest, 0), indices.size());
+    if (k == 0) return result_set;
 
-    for (uint8_t octant = 0; octant < 8; ++octant) {
-        if (!child_exists(storage[index].config, octant)) {
-            continue;
-        }
-        if (morton_code == octant) {
-            ++offset;
+    // depth first, nearest child first, skipping cells that cannot contain a point closer than the current k-th.
+    std::vector<std::pair<bcg_scalar_t, size_t>> heap;
+    heap.reserve(k);
+    auto worst = [&]() {
+        return heap.size() < k ? scalar_max : heap.front().first;
+    };
+    bcg_scalar_t side = aabb.diagonal()[0];
+    bcg_scalar_t slack = side / bcg_scalar_t(uint64_t(1) << max_code_depth);
+    std::vector<octree_cell> stack = {{0, aabb.min, side, 0}};
+    octree_cell children[8];
+    while (!stack.empty()) {
+        auto cell = stack.back();
+        stack.pop_back();
+        if (cell.sqr_distance >= worst()) continue;
+        const auto &node = storage[cell.index];
+        if (node.config != 0) {
+            size_t count = child_cells(node, cell, slack, query_point, children);
+            std::sort(children, children + count, [](const octree_cell &a, const octree_cell &b) {
+                return a.sqr_distance > b.sqr_distance;
+            });
+            stack.insert(stack.end(), children, children + count);
             continue;
         }
-        aligned_box3 cbox = child_box(aabb, octant);
-
-        if (result_set.indices.size() < num_closest ||
-            intersect<3>(sphere3(query_point, result_set.distances.back()), cbox)) {
-            query_knn(storage[index].first_child_index + offset, cbox, query_point, num_closest, result_set);
+        for (size_t j = node.v_start; j < node.v_end; ++j) {
+            bcg_scalar_t sqr_distance = (positions[indices[j]] - query_point).squaredNorm();
+            if (sqr_distance < worst()) {
+                if (heap.size() == k) {
+                    std::pop_heap(heap.begin(), heap.end());
+                    heap.pop_back();
+                }
+                heap.emplace_back(sqr_distance, indices[j]);
+                std::push_heap(heap.begin(), heap.end());
+            }
         }
-        ++offset;
     }
+    std::sort_heap(heap.begin(), heap.end());
+    result_set.indices.reserve(heap.size());
+    result_set.distances.reserve(heap.size());
+    for (const auto &item : heap) {
+        result_set.indices.push_back(bcg_index_t(item.second));
+        result_set.distances.push_back(item.first);
+    }
+    return result_set;
 }
 
-}
\ No newline at end of file
+}
@@ -9,18 +9,22 @@
 #include "math/vector/bcg_vector.h"
 #include "bcg_property.h"
 #include "aligned_box/bcg_aligned_box.h"
-#include "sphere/bcg_sphere.h"
 #include "bcg_neighbors_query.h"
 
 namespace bcg{
 
+// node of the linear octree: a cell given by its Morton code prefix and depth. Children of a node are stored
+// consecutively, in octant order, starting at first_child_index.
 struct octree_node{
-    size_t v_start, v_end;
-    size_t size;
-    uint64_t first_child_index, parent_index;
-    uint8_t config, depth;
+    size_t v_start, v_end;  // points [v_start, v_end) of octree::indices
+    uint64_t code;          // 3 * depth bits, octant bits x, y, z from the root down
+    uint64_t first_child_index;
+    uint8_t config, depth;  // bit i of config is set if octant i has a child
 };
 
+// Linear octree: points are sorted by Morton code (parallel radix sort) and nodes are the code prefixes shared by
+// more than leaf_size points, stored pointer-free in one array in breadth-first order. Queries are iterative and
+// return squared distances, sorted for knn.
 struct octree{
     octree() = default;
 
@@ -34,16 +38,19 @@ struct octree{
 
     neighbors_query query_knn(const VectorS<3> &query_point, int num_closest) const;
 
+    // bounds of a node, computed from its code.
+    aligned_box3 node_box(const octree_node &node) const;
+
     property<VectorS<3>, 3> positions;
-    aligned_box3 aabb;
+    aligned_box3 aabb;  // cubic
     std::vector<octree_node> storage;
     std::vector<size_t> indices;
     int max_depth;
     int leaf_size;
-private:
-    void query_radius(size_t index, const aligned_box3 &aabb, const sphere3 &sphere, neighbors_query &result_set) const;
+    size_t parallel_grain_size = 1 << 16;
 
-    void query_knn(size_t index, const aligned_box3 &aabb, const VectorS<3> &query_point, int num_closest, neighbors_query &result_set) const;
+    // 21 bits per axis fit into 64 bit codes.
+    static constexpr int max_code_depth = 21;
 };
 
 }
@@ -5,6 +5,7 @@
 #include <cassert>
 #include "bcg_point_cloud.h"
 #include "utils/bcg_stl_utils.h"
+#include "kdtree/bcg_kdtree.h"
 
 namespace bcg {
 
@@ -58,6 +59,7 @@ void point_cloud::clear() {
     positions = vertices.add<position_t, 3>("v_position");
     vertices_deleted = vertices.add<bool, 1>("v_deleted");
     size_vertices_deleted = 0;
+    vertex_index_cache.reset();
 }
 
 bool point_cloud::empty() const {
@@ -75,32 +77,9 @@ bool point_cloud::has_garbage() const {
 void point_cloud::garbage_collection() {
     if (!has_garbage()) return;
 
-    size_t nV = vertices.size();
-    if (nV > 0) {
-        size_t i0 = 0;
-        size_t i1 = nV - 1;
-
-        while (true) {
-            // find first deleted and last un-deleted
-            while (!vertices_deleted[i0] && i0 < i1) {
-                ++i0;
-            }
-            while (vertices_deleted[i1] && i0 < i1) {
-                --i1;
-            }
-            if (i0 >= i1) break;
-
-            // swap
-            vertices.swap(i0, i1);
-        }
-
-        // remember new size
-        nV = vertices_deleted[i0] ? i0 : i0 + 1;
-    }
-
-    vertices.resize(nV);
-    vertices.free_unused_memory();
+    vertices.compact(kept_indices(vertices_deleted.vector()));
     size_vertices_deleted = 0;
+    vertex_index_cache.reset();
     assert(!has_garbage());
     assert(vertices.is_dirty());
 }
@@ -137,65 +116,80 @@ void point_cloud::mark_vertex_deleted(vertex_handle v) {
     assert(has_garbage());
 }
 
-vertex_handle point_cloud::find_closest_vertex(const point_cloud::position_t &point) {
-    vertex_handle closest_yet(0);
-    auto min_dist_yet = scalar_max;
-    for (const auto v : vertices) {
-        auto dist = (positions[v] - point).norm();
-        if (dist < min_dist_yet) {
-            min_dist_yet = dist;
-            closest_yet = v;
-
-            if (dist < scalar_eps) break;
+struct point_cloud::vertex_index {
+    kdtree_property<bcg_scalar_t> kdtree;
+    const base_property *positions = nullptr;
+    size_t version = 0;
+    size_t num_deleted = 0;
+};
+
+std::shared_ptr<const point_cloud::vertex_index> point_cloud::get_vertex_index() const {
+    std::lock_guard<std::mutex> lock(vertex_index_cache.mutex);
+    auto &index = vertex_index_cache.index;
+    auto *base = vertices.get_base_ptr("v_position");
+    if (!index || index->positions != base) {
+        index = std::make_shared<vertex_index>();
+        index->kdtree.build(positions);
+        index->positions = base;
+    } else if (index->version != positions.version() || index->kdtree.index->size() != vertices.size()) {
+        auto *tree = index->kdtree.index.get();
+        index->kdtree.update();
+        if (index->kdtree.index.get() != tree) {
+            // rebuilt, removed vertices are back in the tree
+            index->num_deleted = 0;
         }
     }
-    return closest_yet;
-}
-
-std::vector<vertex_handle>
-point_cloud::find_closest_k_vertices(const point_cloud::position_t &point, size_t k) {
-    using DistIndex = std::pair<bcg_scalar_t, vertex_handle>;
-    std::vector<DistIndex> closest_k;
-
-    for (const auto v : vertices) {
-        auto dist = (positions[v] - point).norm();
-        if (closest_k.size() < k) {
-            closest_k.emplace_back(dist, v);
-        } else {
-            std::sort(closest_k.begin(), closest_k.end(), [](const DistIndex &lhs, const DistIndex &rhs) {
-                return lhs.first < rhs.first;
-            });
-
-            closest_k.resize(k);
-            if (dist < closest_k.back().first) {
-                closest_k.back() = std::make_pair(dist, v);
+    index->version = positions.version();
+    if (index->num_deleted != size_vertices_deleted) {
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            if (vertices_deleted[i]) {
+                index->kdtree.remove(bcg_index_t(i));
             }
         }
+        index->num_deleted = size_vertices_deleted;
     }
+    return index;
+}
 
-    std::sort(closest_k.begin(), closest_k.end());
-    std::vector<vertex_handle> indices;
-    unzip<bcg_scalar_t, vertex_handle>(closest_k, nullptr, &indices);
-    return indices;
+static std::vector<vertex_handle> to_vertex_handles(const neighbors_query &result) {
+    return std::vector<vertex_handle>(result.indices.begin(), result.indices.end());
+}
+
+vertex_handle point_cloud::find_closest_vertex(const point_cloud::position_t &point) const {
+    auto result = get_vertex_index()->kdtree.query_knn(point, std::min<size_t>(1, num_vertices()));
+    return result.indices.empty() ? vertex_handle() : vertex_handle(result.indices[0]);
 }
 
 std::vector<vertex_handle>
-point_cloud::find_closest_vertices_radius(const point_cloud::position_t &point, bcg_scalar_t radius) {
-    using DistIndex = std::pair<bcg_scalar_t, vertex_handle>;
-    std::vector<DistIndex> closest;
-    for (const auto v: vertices) {
-        auto dist = (positions[v] - point).norm();
-        if (dist <= radius) {
-            closest.emplace_back(dist, v);
+point_cloud::find_closest_k_vertices(const point_cloud::position_t &point, size_t k) const {
+    return to_vertex_handles(get_vertex_index()->kdtree.query_knn(point, std::min(k, num_vertices())));
+}
+
+std::vector<vertex_handle>
+point_cloud::find_closest_vertices_radius(const point_cloud::position_t &point, bcg_scalar_t radius) const {
+    // the kd-tree compares squared distances
+    auto result = get_vertex_index()->kdtree.query_radius(point, radius * radius);
+    sort_by_first(result.distances, result.indices);
+    return to_vertex_handles(result);
+}
+
+std::vector<vertex_handle> point_cloud::find_closest_vertex_batch(const std::vector<position_t> &points) const {
+    auto neighbors = find_closest_k_vertices_batch(points, 1);
+    std::vector<vertex_handle> indices(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (neighbors.num_neighbors(i) > 0) {
+            indices[i] = vertex_handle(neighbors[i].indices[0]);
         }
     }
-
-    std::sort(closest.begin(), closest.end());
-    std::vector<vertex_handle> indices;
-    unzip<bcg_scalar_t, vertex_handle>(closest, nullptr, &indices);
     return indices;
 }
 
+neighbors_batch point_cloud::find_closest_k_vertices_batch(const std::vector<position_t> &points, size_t k) const {
+    neighbors_batch result;
+    get_vertex_index()->kdtree.query_knn_batch(points, k, result);
+    return result;
+}
+
 std::string point_cloud::to_string() const {
     std::stringstream stream;
     stream << "point cloud\n";
@@ -7,6 +7,8 @@
 
 #include "math/bcg_linalg.h"
 #include "bcg_property.h"
+#include "bcg_neighbors_query.h"
+#include "bcg_lazy_index.h"
 
 namespace bcg {
 
@@ -22,6 +24,11 @@ struct point_cloud {
 
     virtual ~point_cloud() = default;
 
+    point_cloud(const point_cloud &) = default;
+
+    // moves the properties, the property handles keep pointing to them
+    point_cloud(point_cloud &&) = default;
+
     void assign(const point_cloud &other);
 
     point_cloud &operator=(const point_cloud &other);
@@ -44,18 +51,30 @@ struct point_cloud {
 
     size_t num_vertices() const;
 
-    vertex_handle find_closest_vertex(const point_cloud::position_t &point);
+    // closest vertex queries are answered by a kd-tree over the positions. It is built on the first query and
+    // updated by later ones if vertices were moved, added or deleted since (see base_property::version()).
+    vertex_handle find_closest_vertex(const point_cloud::position_t &point) const;
 
     std::vector<vertex_handle>
-    find_closest_k_vertices(const point_cloud::position_t &point, size_t k);
+    find_closest_k_vertices(const point_cloud::position_t &point, size_t k) const;
 
     std::vector<vertex_handle>
-    find_closest_vertices_radius(const point_cloud::position_t &point, bcg_scalar_t radius);
+    find_closest_vertices_radius(const point_cloud::position_t &point, bcg_scalar_t radius) const;
+
+    std::vector<vertex_handle> find_closest_vertex_batch(const std::vector<position_t> &points) const;
+
+    // k closest vertices of all points, distances are squared.
+    neighbors_batch find_closest_k_vertices_batch(const std::vector<position_t> &points, size_t k) const;
 
     virtual std::string to_string() const;
 
+    struct vertex_index;
+    mutable lazy_index<vertex_index> vertex_index_cache;
+
 protected:
     void mark_vertex_deleted(vertex_handle v);
+
+    std::shared_ptr<const vertex_index> get_vertex_index() const;
 };
 
 std::ostream &operator<<(std::ostream &stream, const point_cloud &pc);
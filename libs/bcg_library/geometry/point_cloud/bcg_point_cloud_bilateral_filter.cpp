@@ -3,6 +3,7 @@
 //
 
 #include "bcg_point_cloud_bilateral_filter.h"
+#include "kdtree/bcg_neighbors_cache.h"
 #include "bcg_property_map_eigen.h"
 #include "tbb/tbb.h"
 
@@ -29,15 +30,16 @@ void point_cloud_bilateral_filter_knn(vertex_container *vertices, const kdtree_p
         normals = vertices->get<VectorS<3>, 3>("v_pca_normal");
     }
 
+    auto neighbors = vertex_neighbors_knn(vertices, index, num_closest, parallel_grain_size);
     tbb::parallel_for(
             tbb::blocked_range<uint32_t>(0u, (uint32_t) vertices->size(), parallel_grain_size),
             [&](const tbb::blocked_range<uint32_t> &range) {
                 for (uint32_t i = range.begin(); i != range.end(); ++i) {
                     auto v = vertex_handle(i);
-                    auto result = index.query_knn(positions[v], num_closest);
+                    auto result = (*neighbors)[i];
                     delta[v] = 0;
                     bcg_scalar_t sum = 0;
-                    for (int j = 0; j < num_closest; ++j) {
+                    for (size_t j = 0; j < result.size; ++j) {
                         VectorS<3> diff = positions[result.indices[j]] - positions[v];
                         bcg_scalar_t d_d = diff.squaredNorm();
                         bcg_scalar_t d_n = diff.dot(normals[v]);
@@ -76,15 +78,16 @@ void point_cloud_bilateral_filter_radius(vertex_container *vertices, const kdtre
         normals = vertices->get<VectorS<3>, 3>("v_pca_normal");
     }
 
+    auto neighbors = vertex_neighbors_radius(vertices, index, radius, parallel_grain_size);
     tbb::parallel_for(
             tbb::blocked_range<uint32_t>(0u, (uint32_t) vertices->size(), parallel_grain_size),
             [&](const tbb::blocked_range<uint32_t> &range) {
                 for (uint32_t i = range.begin(); i != range.end(); ++i) {
                     auto v = vertex_handle(i);
-                    auto result = index.query_radius(positions[v], radius);
+                    auto result = (*neighbors)[i];
                     delta[v] = 0;
                     bcg_scalar_t sum = 0;
-                    for (int j = 0; j < result.indices.size(); ++j) {
+                    for (size_t j = 0; j < result.size; ++j) {
                         VectorS<3> diff = positions[result.indices[j]] - positions[v];
                         bcg_scalar_t d_d = diff.squaredNorm();
                         bcg_scalar_t d_n = diff.dot(normals[v]);
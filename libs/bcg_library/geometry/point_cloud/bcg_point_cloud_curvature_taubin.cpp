@@ -3,6 +3,7 @@
 //
 
 #include "bcg_point_cloud_curvature_taubin.h"
+#include "kdtree/bcg_neighbors_cache.h"
 #include "math/bcg_vertex_classify_curvature.h"
 #include "bcg_property_map_eigen.h"
 #include "tbb/tbb.h"
@@ -30,6 +31,7 @@ point_cloud_curvature_taubin(vertex_container *vertices, const kdtree_property<b
         normals = vertices->get<VectorS<3>, 3>("v_pca_normal");
     }
 
+    auto neighbors = vertex_neighbors_knn(vertices, index, num_closest, parallel_grain_size);
     tbb::parallel_for(
             tbb::blocked_range<uint32_t>(0u, (uint32_t) vertices->size(), parallel_grain_size),
             [&](const tbb::blocked_range<uint32_t> &range) {
@@ -38,11 +40,11 @@ point_cloud_curvature_taubin(vertex_container *vertices, const kdtree_property<b
                     bcg_scalar_t kmin = 0.0;
                     bcg_scalar_t kmax = 0.0;
 
-                    auto result = index.query_knn(positions[v], num_closest);
+                    auto result = (*neighbors)[i];
                     MatrixS<3, 3> tensor(MatrixS<3, 3>::Zero());
                     bcg_scalar_t H = v_pca_loading[v][2] / v_pca_loading[v].sum();
 
-                    for (int j = 0; j < num_closest; ++j) {
+                    for (size_t j = 0; j < result.size; ++j) {
                         VectorS<3> ev = positions[v] - positions[result.indices[j]];
                         bcg_scalar_t l = ev.norm();
                         if (l == 0) continue;
@@ -150,6 +152,7 @@ void point_cloud_curvature_taubin(vertex_container *vertices, const kdtree_prope
         normals = vertices->get<VectorS<3>, 3>("v_pca_normal");
     }
 
+    auto neighbors = vertex_neighbors_radius(vertices, index, radius, parallel_grain_size);
     tbb::parallel_for(
             tbb::blocked_range<uint32_t>(0u, (uint32_t) vertices->size(), parallel_grain_size),
             [&](const tbb::blocked_range<uint32_t> &range) {
@@ -158,11 +161,10 @@ void point_cloud_curvature_taubin(vertex_container *vertices, const kdtree_prope
                     bcg_scalar_t kmin = 0.0;
                     bcg_scalar_t kmax = 0.0;
 
-                    auto result = index.query_radius(positions[v], radius);
+                    auto result = (*neighbors)[i];
                     MatrixS<3, 3> tensor(MatrixS<3, 3>::Zero());
                     bcg_scalar_t H = v_pca_loading[v][2] / v_pca_loading[v].sum();
-                    size_t size = result.indices.size();
-                    for (int j = 0; j < size; ++j) {
+                    for (size_t j = 0; j < result.size; ++j) {
                         VectorS<3> ev = positions[result.indices[j]] - positions[v];
                         bcg_scalar_t l = ev.norm();
                         if (l == 0) continue;
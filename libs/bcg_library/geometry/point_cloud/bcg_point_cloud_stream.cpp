@@ -0,0 +1,240 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <cstring>
+#include <iostream>
+#include "bcg_point_cloud_stream.h"
+#include "utils/bcg_path.h"
+#include "utils/bcg_number_table.h"
+#include "tbb/tbb.h"
+
+namespace bcg {
+
+point_cloud_stream::point_cloud_stream(const std::string &filename, size_t chunk_bytes) : chunk_bytes(
+        std::max<size_t>(chunk_bytes, 1 << 12)) {
+    std::string ext = path_extension(filename);
+    if (ext == ".xyz" || ext == ".csv") {
+        type = format::XYZ;
+    } else if (ext == ".pts") {
+        type = format::PTS;
+    } else if (ext == ".3d") {
+        type = format::THREE_D;
+    } else if (ext == ".txt") {
+        type = format::TXT;
+        header_lines = 1;
+    } else if (ext == ".ply") {
+        type = format::PLY;
+    } else {
+        return;
+    }
+
+    file = fopen(filename.c_str(), "rb");
+    if (!file || type != format::PLY) return;
+
+    // the header is read in small steps, it is usually a few hundred bytes
+    const char marker[] = "end_header";
+    while (!eof && std::search(buffer.begin(), buffer.end(), marker, marker + sizeof(marker) - 1) == buffer.end() &&
+           buffer.size() < (1 << 24)) {
+        fill(1 << 12);
+    }
+    ply_header header;
+    if (!parse_ply_header(buffer.data(), buffer.data() + buffer.size(), header) ||
+        header.format != ply_header::format::BINARY_LITTLE_ENDIAN) {
+        std::cerr << filename << ": streaming needs a binary little endian ply file\n";
+        type = format::UNSUPPORTED;
+        return;
+    }
+
+    // elements before the vertices are skipped, which needs their size
+    size_t skip = header.data_offset;
+    bool unknown_size = false;
+    auto vertex_element = header.elements.begin();
+    for (; vertex_element != header.elements.end() && vertex_element->name != "vertex"; ++vertex_element) {
+        unknown_size = unknown_size || vertex_element->stride == 0;
+        skip += vertex_element->count * vertex_element->stride;
+    }
+    if (vertex_element == header.elements.end() || vertex_element->stride == 0 || unknown_size) {
+        std::cerr << filename << ": streaming needs fixed size ply vertex records\n";
+        type = format::UNSUPPORTED;
+        return;
+    }
+    ply_vertices = *vertex_element;
+    while (buffer.size() < skip) {
+        skip -= buffer.size();
+        buffer.clear();
+        if (eof) {
+            type = format::UNSUPPORTED;
+            return;
+        }
+        fill(std::min(skip, this->chunk_bytes));
+    }
+    buffer.erase(buffer.begin(), buffer.begin() + skip);
+}
+
+point_cloud_stream::~point_cloud_stream() {
+    if (file) fclose(file);
+}
+
+point_cloud_stream::operator bool() const {
+    return file != nullptr && type != format::UNSUPPORTED;
+}
+
+bool point_cloud_stream::next(point_cloud &batch) {
+    if (!*this) return false;
+    batch.vertices.clear();
+    batch.size_vertices_deleted = 0;
+    bool ok = type == format::PLY ? next_ply(batch) : next_ascii(batch);
+    points_read += batch.vertices.size();
+    return ok;
+}
+
+size_t point_cloud_stream::fill(size_t max_bytes) {
+    size_t size = buffer.size();
+    buffer.resize(size + max_bytes);
+    size_t count = fread(buffer.data() + size, 1, max_bytes, file);
+    buffer.resize(size + count);
+    eof = count < max_bytes;
+    return count;
+}
+
+bool point_cloud_stream::next_ascii(point_cloud &batch) {
+    std::vector<bcg_scalar_t> defaults;
+    switch (type) {
+        case format::PTS:
+            defaults = {0, 0, 0, 1, 255, 255, 255};
+            break;
+        case format::THREE_D:
+            defaults = {0, 0, 0, 0};
+            break;
+        case format::TXT:
+            defaults = {0, 0, 0, 0, 0, 0, 0};
+            break;
+        default:
+            defaults = {0, 0, 0};
+    }
+
+    while (!buffer.empty() || !eof) {
+        // the buffer starts with the incomplete last line of the previous chunk, lines longer than a chunk grow it
+        if (!eof) fill(buffer.size() < chunk_bytes ? chunk_bytes - buffer.size() : chunk_bytes);
+        auto line_end = std::find(buffer.rbegin(), buffer.rend(), '\n');
+        if (line_end == buffer.rend() && !eof) continue;
+        size_t complete = eof ? buffer.size() : size_t(buffer.rend() - line_end);
+
+        auto table = parse_number_table<bcg_scalar_t>(buffer.data(), buffer.data() + complete, defaults, 3,
+                                                      header_lines);
+        header_lines = 0;
+        buffer.erase(buffer.begin(), buffer.begin() + complete);
+        if (table.num_rows() == 0) continue;
+
+        auto &pc = batch;
+        pc.vertices.resize(table.num_rows());
+        switch (type) {
+            case format::PTS: {
+                auto colors = pc.vertices.get_or_add<VectorS<3>, 3>("v_color");
+                auto intensities = pc.vertices.get_or_add<bcg_scalar_t, 1>("v_intensity");
+                table.for_each_row([&](size_t i, const bcg_scalar_t *row) {
+                    pc.positions[i] = VectorS<3>(row[0], row[1], row[2]);
+                    intensities[i] = row[3];
+                    colors[i] = VectorS<3>(row[4], row[5], row[6]) / 255.0;
+                });
+                break;
+            }
+            case format::THREE_D: {
+                auto intensities = pc.vertices.get_or_add<bcg_scalar_t, 1>("v_intensity");
+                table.for_each_row([&](size_t i, const bcg_scalar_t *row) {
+                    pc.positions[i] = VectorS<3>(row[0], row[1], row[2]);
+                    intensities[i] = row[3];
+                });
+                break;
+            }
+            case format::TXT: {
+                auto colors = pc.vertices.get_or_add<VectorS<3>, 3>("v_color");
+                auto reflectances = pc.vertices.get_or_add<bcg_scalar_t, 1>("v_reflectance");
+                table.for_each_row([&](size_t i, const bcg_scalar_t *row) {
+                    pc.positions[i] = VectorS<3>(row[0], row[1], row[2]);
+                    colors[i] = VectorS<3>(row[3], row[4], row[5]);
+                    reflectances[i] = row[6];
+                });
+                break;
+            }
+            default:
+                table.for_each_row([&](size_t i, const bcg_scalar_t *row) {
+                    pc.positions[i] = VectorS<3>(row[0], row[1], row[2]);
+                });
+        }
+        return true;
+    }
+    return false;
+}
+
+bool point_cloud_stream::next_ply(point_cloud &batch) {
+    size_t stride = ply_vertices.stride;
+    size_t count = std::min(ply_vertices.count - points_read, std::max<size_t>(chunk_bytes / stride, 1));
+    if (count == 0) return false;
+    if (buffer.size() < count * stride && !eof) {
+        fill(count * stride - buffer.size());
+    }
+    if (buffer.size() < count * stride) {
+        std::cerr << "ply vertex element ends early, after " << points_read + buffer.size() / stride << " of "
+                  << ply_vertices.count << " vertices\n";
+        count = buffer.size() / stride;
+        ply_vertices.count = points_read + count;
+        if (count == 0) return false;
+    }
+    read_ply_vertices(ply_vertices, buffer.data(), count, batch.vertices);
+    buffer.erase(buffer.begin(), buffer.begin() + count * stride);
+    return true;
+}
+
+void point_stream_statistics::push(const property<VectorS<3>, 3> &points, size_t parallel_grain_size) {
+    struct partial {
+        aligned_box3 aabb;
+        std::array<running_stats, 3> coordinates;
+    };
+    auto result = tbb::parallel_reduce(
+            tbb::blocked_range<size_t>(0, points.size(), parallel_grain_size), partial(),
+            [&](const tbb::blocked_range<size_t> &range, partial init) {
+                for (size_t i = range.begin(); i != range.end(); ++i) {
+                    init.aabb.grow(points[i]);
+                    for (int j = 0; j < 3; ++j) {
+                        init.coordinates[j].push(points[i][j]);
+                    }
+                }
+                return init;
+            },
+            [](partial a, const partial &b) {
+                a.aabb = a.aabb.merge(b.aabb);
+                for (int j = 0; j < 3; ++j) {
+                    a.coordinates[j] += b.coordinates[j];
+                }
+                return a;
+            });
+    num_points += points.size();
+    aabb = aabb.merge(result.aabb);
+    for (int j = 0; j < 3; ++j) {
+        coordinates[j] += result.coordinates[j];
+    }
+}
+
+running_stats voxel_density_statistics(const sample_mean_grid &grid) {
+    running_stats stats;
+    for (const auto size : grid.sample_size) {
+        stats.push(double(size));
+    }
+    return stats;
+}
+
+std::vector<VectorS<3>> dense_sample_points(const sample_mean_grid &grid, bcg_scalar_t k) {
+    auto stats = voxel_density_statistics(grid);
+    double threshold = stats.size() > 1 ? stats.mean() - k * stats.standard_deviation() : 0;
+    std::vector<VectorS<3>> points;
+    for (size_t i = 0; i < grid.sample_points.size(); ++i) {
+        if (double(grid.sample_size[i]) >= threshold) {
+            points.push_back(grid.sample_points[i]);
+        }
+    }
+    return points;
+}
+
+}
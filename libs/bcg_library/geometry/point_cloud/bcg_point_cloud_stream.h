@@ -0,0 +1,79 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#ifndef BCG_GRAPHICS_BCG_POINT_CLOUD_STREAM_H
+#define BCG_GRAPHICS_BCG_POINT_CLOUD_STREAM_H
+
+#include <array>
+#include <cstdio>
+#include "bcg_point_cloud.h"
+#include "bcg_ply_io.h"
+#include "geometry/sampling/bcg_sampling_grid.h"
+#include "math/statistics/bcg_statistics_running.h"
+
+namespace bcg {
+
+// Reads point cloud files in batches, for files larger than memory. Each batch holds the points of about chunk_bytes
+// of the file, with the attributes point_cloudio reads for the format. The file is read through one buffer of
+// chunk_bytes, so memory use does not depend on the file size. Supported are the ascii formats .xyz, .pts, .csv, .3d,
+// .txt and binary little endian .ply with fixed size vertex records.
+struct point_cloud_stream {
+    explicit point_cloud_stream(const std::string &filename, size_t chunk_bytes = 1 << 26);
+
+    ~point_cloud_stream();
+
+    point_cloud_stream(const point_cloud_stream &) = delete;
+
+    point_cloud_stream &operator=(const point_cloud_stream &) = delete;
+
+    // replaces the vertices of batch with the next points. Returns false at the end of the file or on errors.
+    bool next(point_cloud &batch);
+
+    // index of the first point of the next batch in the whole file
+    [[nodiscard]] inline size_t num_points_read() const { return points_read; }
+
+    // true if the file is open and its format is supported
+    operator bool() const;
+
+private:
+    enum class format {
+        UNSUPPORTED, XYZ, PTS, THREE_D, TXT, PLY
+    };
+
+    bool next_ascii(point_cloud &batch);
+
+    bool next_ply(point_cloud &batch);
+
+    // appends up to max_bytes from the file to the buffer, returns the number of bytes read
+    size_t fill(size_t max_bytes);
+
+    FILE *file = nullptr;
+    format type = format::UNSUPPORTED;
+    size_t chunk_bytes;
+    std::vector<char> buffer;
+    size_t points_read = 0;
+    size_t header_lines = 0;
+    ply_element ply_vertices;
+    bool eof = false;
+};
+
+// accumulates the bounds and the statistics of each coordinate over batches, in parallel within a batch
+struct point_stream_statistics {
+    void push(const property<VectorS<3>, 3> &points, size_t parallel_grain_size = 1 << 16);
+
+    size_t num_points = 0;
+    aligned_box3 aabb;
+    std::array<running_stats, 3> coordinates;
+};
+
+// statistics of the number of points in the occupied voxels of a mean grid
+running_stats voxel_density_statistics(const sample_mean_grid &grid);
+
+// samples of the voxels with at least mean - k * standard deviation points. Sparse voxels hold the isolated outliers
+// of a scan, this removes them without neighborhood queries on the whole cloud.
+std::vector<VectorS<3>> dense_sample_points(const sample_mean_grid &grid, bcg_scalar_t k);
+
+}
+
+#endif //BCG_GRAPHICS_BCG_POINT_CLOUD_STREAM_H
@@ -3,6 +3,7 @@
 //
 
 #include "bcg_point_cloud_vertex_outlier_probability.h"
+#include "kdtree/bcg_neighbors_cache.h"
 #include "math/vector/bcg_vector_map_eigen.h"
 #include "bcg_property_map_eigen.h"
 #include "tbb/tbb.h"
@@ -15,27 +16,27 @@ void point_cloud_vertex_outlier_probability_knn(vertex_container *vertices, cons
     auto likelihood = vertices->get_or_add<bcg_scalar_t, 1>("v_likelihood");
     auto outlier_probability = vertices->get_or_add<bcg_scalar_t, 1>("v_outlier_probability");
     auto avg_distance = vertices->get_or_add<bcg_scalar_t, 1>("v_average_distance");
-    auto knn = vertices->get_or_add<std::vector<bcg_index_t>, 1>("v_knn");
-    auto knn_dists = vertices->get_or_add<VectorS<-1>, 1>("v_knn_distances");
     auto covs = vertices->get_or_add<MatrixS<3, 3>, 1>("v_cov");
     auto normalizers = vertices->get_or_add<bcg_scalar_t, 1>("v_normalizer");
 
+    auto neighbors = vertex_neighbors_knn(vertices, index, num_closest, parallel_grain_size);
     tbb::parallel_for(
             tbb::blocked_range<uint32_t>(0u, (uint32_t) vertices->size(), parallel_grain_size),
             [&](const tbb::blocked_range<uint32_t> &range) {
                 for (uint32_t i = range.begin(); i != range.end(); ++i) {
                     auto v = vertex_handle(i);
-                    auto result = index.query_knn(positions[v], num_closest);
-                    knn[v] = result.indices;
-                    knn_dists[v] = MapConst<bcg_scalar_t>(result.distances);
-                    avg_distance[v] = knn_dists[v].mean();
+                    auto result = (*neighbors)[i];
+                    avg_distance[v] = 0;
+                    for (size_t j = 0; j < result.size; ++j) {
+                        avg_distance[v] += result.distances[j] / result.size;
+                    }
 
                     covs[v] = MatrixS<3, 3>::Zero(3, 3);
 
-                    for (int j = 0; j < num_closest; ++j) {
-                        VectorS<3> diff = positions[v] - positions[knn[v][j]];
+                    for (size_t j = 0; j < result.size; ++j) {
+                        VectorS<3> diff = positions[v] - positions[result.indices[j]];
                         covs[v] += diff * diff.transpose() *
-                                   std::exp(-knn_dists[v][j] * knn_dists[v][j] / (avg_distance[v]));
+                                   std::exp(-result.distances[j] * result.distances[j] / (avg_distance[v]));
                     }
 
                     normalizers[v] = covs[v].trace() * pi / 2.0;
@@ -49,10 +50,11 @@ void point_cloud_vertex_outlier_probability_knn(vertex_container *vertices, cons
             [&](const tbb::blocked_range<uint32_t> &range) {
                 for (uint32_t i = range.begin(); i != range.end(); ++i) {
                     auto v = vertex_handle(i);
+                    auto result = (*neighbors)[i];
                     likelihood[v] = 0;
-                    for (int j = 0; j < num_closest; ++j) {
-                        VectorS<3> diff = positions[knn[v][j]] - positions[v];
-                        likelihood[v] += std::exp(-diff.transpose() * covs[v].inverse() * diff) / num_closest;
+                    for (size_t j = 0; j < result.size; ++j) {
+                        VectorS<3> diff = positions[result.indices[j]] - positions[v];
+                        likelihood[v] += std::exp(-diff.transpose() * covs[v].inverse() * diff) / result.size;
                     }
                 }
             }
@@ -61,8 +63,6 @@ void point_cloud_vertex_outlier_probability_knn(vertex_container *vertices, cons
     Map<bcg_scalar_t, 1>(outlier_probability) = 1.0 - MapConst<bcg_scalar_t, 1>(likelihood).array();
 
     vertices->remove(covs);
-    vertices->remove(knn);
-    vertices->remove(knn_dists);
     vertices->remove(normalizers);
     vertices->remove(avg_distance);
 }
@@ -74,27 +74,27 @@ point_cloud_vertex_outlier_probability_radius(vertex_container *vertices, const
     auto likelihood = vertices->get_or_add<bcg_scalar_t, 1>("v_likelihood");
     auto outlier_probability = vertices->get_or_add<bcg_scalar_t, 1>("v_outlier_probability");
     auto avg_distance = vertices->get_or_add<bcg_scalar_t, 1>("v_average_distance");
-    auto knn = vertices->get_or_add<std::vector<bcg_index_t>, 1>("v_knn");
-    auto knn_dists = vertices->get_or_add<VectorS<-1>, 1>("v_knn_distances");
     auto covs = vertices->get_or_add<MatrixS<3, 3>, 1>("v_cov");
     auto normalizers = vertices->get_or_add<bcg_scalar_t, 1>("v_normalizer");
 
+    auto neighbors = vertex_neighbors_radius(vertices, index, radius, parallel_grain_size);
     tbb::parallel_for(
             tbb::blocked_range<uint32_t>(0u, (uint32_t) vertices->size(), parallel_grain_size),
             [&](const tbb::blocked_range<uint32_t> &range) {
                 for (uint32_t i = range.begin(); i != range.end(); ++i) {
                     auto v = vertex_handle(i);
-                    auto result = index.query_radius(positions[v], radius);
-                    knn[v] = result.indices;
-                    knn_dists[v] = MapConst<bcg_scalar_t>(result.distances);
-                    avg_distance[v] = knn_dists[v].mean();
+                    auto result = (*neighbors)[i];
+                    avg_distance[v] = 0;
+                    for (size_t j = 0; j < result.size; ++j) {
+                        avg_distance[v] += result.distances[j] / result.size;
+                    }
 
                     covs[v] = MatrixS<3, 3>::Zero(3, 3);
 
-                    for (int j = 0; j < knn[v].size(); ++j) {
-                        VectorS<3> diff = positions[v] - positions[knn[v][j]];
+                    for (size_t j = 0; j < result.size; ++j) {
+                        VectorS<3> diff = positions[v] - positions[result.indices[j]];
                         covs[v] += diff * diff.transpose() *
-                                   std::exp(-knn_dists[v][j] * knn_dists[v][j] / (avg_distance[v]));
+                                   std::exp(-result.distances[j] * result.distances[j] / (avg_distance[v]));
                     }
 
                     normalizers[v] = covs[v].trace() * pi / 2.0;
@@ -108,10 +108,11 @@ point_cloud_vertex_outlier_probability_radius(vertex_container *vertices, const
             [&](const tbb::blocked_range<uint32_t> &range) {
                 for (uint32_t i = range.begin(); i != range.end(); ++i) {
                     auto v = vertex_handle(i);
+                    auto result = (*neighbors)[i];
                     likelihood[v] = 0;
-                    for (int j = 0; j < knn[v].size(); ++j) {
-                        VectorS<3> diff = positions[knn[v][j]] - positions[v];
-                        likelihood[v] += std::exp(-diff.transpose() * covs[v].inverse() * diff) / knn[v].size();
+                    for (size_t j = 0; j < result.size; ++j) {
+                        VectorS<3> diff = positions[result.indices[j]] - positions[v];
+                        likelihood[v] += std::exp(-diff.transpose() * covs[v].inverse() * diff) / result.size;
                         if (std::isnan(likelihood[v])) likelihood[v] = 0;
                     }
                 }
@@ -121,8 +122,6 @@ point_cloud_vertex_outlier_probability_radius(vertex_container *vertices, const
     Map<bcg_scalar_t, 1>(outlier_probability) = 1.0 - MapConst<bcg_scalar_t, 1>(likelihood).array();
 
     vertices->remove(covs);
-    vertices->remove(knn);
-    vertices->remove(knn_dists);
     vertices->remove(normalizers);
     vertices->remove(avg_distance);
 }
@@ -3,6 +3,7 @@
 //
 
 #include "bcg_point_cloud_vertex_pca.h"
+#include "kdtree/bcg_neighbors_cache.h"
 #include "bcg_property_map_eigen.h"
 #include "tbb/tbb.h"
 
@@ -63,15 +64,16 @@ void point_cloud_vertex_pcas_knn(vertex_container *vertices, const kdtree_proper
     auto v_pca_tangent1_loading = vertices->get_or_add<bcg_scalar_t, 1>("v_pca_tangent1_loading");
     auto v_pca_tangent2_loading = vertices->get_or_add<bcg_scalar_t, 1>("v_pca_tangent2_loading");
     auto v_pca_loading = vertices->get_or_add<VectorS<3>, 3>("v_pca_loading");
+    auto neighbors = vertex_neighbors_knn(vertices, index, num_closest, parallel_grain_size);
     tbb::parallel_for(
             tbb::blocked_range<uint32_t>(0u, (uint32_t) vertices->size(), parallel_grain_size),
             [&](const tbb::blocked_range<uint32_t> &range) {
                 MatrixS<-1, 3> P;
                 for (uint32_t i = range.begin(); i != range.end(); ++i) {
                     auto v = vertex_handle(i);
-                    auto result = index.query_knn(positions[v], num_closest);
-                    P.resize(result.indices.size(), 3);
-                    for(size_t i = 0; i < result.indices.size(); ++i){
+                    auto result = (*neighbors)[i];
+                    P.resize(result.size, 3);
+                    for(size_t i = 0; i < result.size; ++i){
                         P.row(i) = positions[result.indices[i]];
                     }
                     auto pca = method(P, positions[v], compute_mean);
@@ -112,15 +114,16 @@ point_cloud_vertex_pcas_radius(vertex_container *vertices, const kdtree_property
     auto v_pca_tangent1_loading = vertices->get_or_add<bcg_scalar_t, 1>("v_pca_tangent1_loading");
     auto v_pca_tangent2_loading = vertices->get_or_add<bcg_scalar_t, 1>("v_pca_tangent2_loading");
     auto v_pca_loading = vertices->get_or_add<VectorS<3>, 3>("v_pca_loading");
+    auto neighbors = vertex_neighbors_radius(vertices, index, radius, parallel_grain_size);
     tbb::parallel_for(
             tbb::blocked_range<uint32_t>(0u, (uint32_t) vertices->size(), parallel_grain_size),
             [&](const tbb::blocked_range<uint32_t> &range) {
                 MatrixS<-1, 3> P;
                 for (uint32_t i = range.begin(); i != range.end(); ++i) {
                     auto v = vertex_handle(i);
-                    auto result = index.query_radius(positions[v], radius);
-                    P.resize(result.indices.size(), 3);
-                    for(size_t i = 0; i < result.indices.size(); ++i){
+                    auto result = (*neighbors)[i];
+                    P.resize(result.size, 3);
+                    for(size_t i = 0; i < result.size; ++i){
                         P.row(i) = positions[result.indices[i]];
                     }
                     auto pca = method(P, positions[v], compute_mean);
@@ -5,7 +5,10 @@
 #include "bcg_point_cloudio.h"
 #include "utils/bcg_path.h"
 #include "utils/bcg_file.h"
-#include "utils/bcg_string_utils.h"
+#include "utils/bcg_mapped_file.h"
+#include "utils/bcg_number_table.h"
+#include "bcg_property_io.h"
+#include "bcg_ply_io.h"
 #include "color/bcg_colors.h"
 #include "rply/rply.h"
 
@@ -40,6 +43,8 @@ bool point_cloudio::read(point_cloud &pc) {
         return read_txt(pc);
     } else if (ext == ".ply") {
         return read_ply(pc);
+    } else if (ext == ".bcg") {
+        return read_bcg(pc);
     }
 
     // we didn't find a reader module
@@ -50,89 +55,45 @@ bool point_cloudio::write(point_cloud &pc) {
 // extract file extension
     std::string ext = path_extension(filename);
 
-    //TODO implement write functions for pointclouds
-    // extension determines reader
-    /*if (ext == ".pts") {
-        return write_pts(pc);
-    } else if (ext == ".xyz") {
-        return write_xyz(pc);
-    } else if (ext == ".pwn") {
-        return write_pwn(pc);
-    } else if (ext == ".pb") {
-        return write_pb(pc);
-    } else if (ext == ".csv") {
-        return write_csv(pc);
-    } else if (ext == ".3d") {
-        return write_3d(pc);
-    } else if (ext == ".txt") {
-        return write_txt(pc);
-    }*/
+    // writers exist for .bcg and binary .ply only, the ascii formats are read only
+    if (ext == ".bcg") {
+        return write_bcg(pc);
+    } else if (ext == ".ply") {
+        return write_ply(pc);
+    }
 
     // we didn't find a writer module
     return false;
 }
 
 bool point_cloudio::read_pts(point_cloud &pc) {
-    auto processText = [](const char *, size_t) {
-
-    };
+    mapped_file file(filename);
+    if (!file) return false;
+    // x y z intensity r g b, the leading point count is a single number and skipped as a short line
+    auto table = parse_number_table<bcg_scalar_t>(file.begin(), file.end(), {0, 0, 0, 1, 255, 255, 255}, 3);
 
     auto colors = pc.vertices.get_or_add<VectorS<3>, 3>("v_color", color<>::white);
     auto intensities = pc.vertices.get_or_add<bcg_scalar_t, 1>("v_intensity", 1.0);
-    vertex_handle v;
-    auto insertLambda = [&v, &pc, &colors, &intensities](bcg_scalar_t result, size_t lineCount, size_t ScalarTypePerLineCount) {
-        if (lineCount == 0) {
-            pc.vertices.reserve((size_t)result);
-        } else {
-            if (ScalarTypePerLineCount == 0) {
-                v = pc.add_vertex(zero3s);
-            }
-            if (ScalarTypePerLineCount < 3) {
-                pc.positions[v][ScalarTypePerLineCount] = result;
-            } else if (ScalarTypePerLineCount < 4) {
-                intensities[v] = bcg_scalar_t(result);
-            } else if (ScalarTypePerLineCount < 7) {
-                colors[v][ScalarTypePerLineCount - 4] = bcg_scalar_t(result) / 255.0;
-            }
-        }
-    };
-
-    std::string txt;
-    file_stream(filename).load_text(txt);
-    if (txt.empty()) return false;
-    parse_numbers<bcg_scalar_t>(txt, processText, insertLambda);
+    pc.vertices.resize(table.num_rows());
+    table.for_each_row([&](size_t i, const bcg_scalar_t *row) {
+        pc.positions[i] = VectorS<3>(row[0], row[1], row[2]);
+        intensities[i] = row[3];
+        colors[i] = VectorS<3>(row[4], row[5], row[6]) / 255.0;
+    });
     return true;
 }
 
 
 bool point_cloudio::read_xyz(point_cloud &pc) {
-    int skipCount = -1;
-    auto processText = [&skipCount](const char *start, size_t n) {
-        for (size_t i = 0; i < n; ++i) {
-            if (*(start + i) == 'L') {
-                skipCount = 1;
-                return;
-            }
-        }
-    };
-    vertex_handle v;
-    auto insertLambda = [&v, &pc, &skipCount](bcg_scalar_t result, size_t, size_t ScalarTypePerLineCount) {
-        if (skipCount > 0) {
-            skipCount -= 1;
-            return;
-        }
-        if (ScalarTypePerLineCount == 0) {
-            v = pc.add_vertex(zero3s);
-        }
-        if (ScalarTypePerLineCount < 3) {
-            pc.positions.back()[ScalarTypePerLineCount] = result;
-        }
-    };
-
-    std::string txt;
-    file_stream(filename).load_text(txt);
-    if (txt.empty()) return false;
-    parse_numbers<bcg_scalar_t>(txt, processText, insertLambda);
+    mapped_file file(filename);
+    if (!file) return false;
+    // header and comment lines are text and skipped
+    auto table = parse_number_table<bcg_scalar_t>(file.begin(), file.end(), {0, 0, 0}, 3);
+
+    pc.vertices.resize(table.num_rows());
+    table.for_each_row([&](size_t i, const bcg_scalar_t *row) {
+        pc.positions[i] = VectorS<3>(row[0], row[1], row[2]);
+    });
     return true;
 }
 
@@ -155,17 +116,18 @@ bool point_cloudio::read_pwn(point_cloud &pc) {
 
     pc.vertices.reserve(size);
 
-    VectorS<3> p;
+    // read as double regardless of bcg_scalar_t, the format specifiers are fixed
+    double x, y, z;
     vertex_handle v;
     for (unsigned int i = 0; i < size; ++i) {
-        res = fscanf(in, "%lf %lf %lf", reinterpret_cast<double*>(&p[0]), reinterpret_cast<double*>(&p[1]), reinterpret_cast<double*>(&p[2]));
-        v = pc.add_vertex(p);
+        res = fscanf(in, "%lf %lf %lf", &x, &y, &z);
+        v = pc.add_vertex(VectorS<3>(x, y, z));
     }
 
     auto normals = pc.vertices.get_or_add<VectorS<3>, 3>("v_normal");
     for (unsigned int i = 0; i < size; ++i) {
-        res = fscanf(in, "%lf %lf %lf", reinterpret_cast<double*>(&normals[0]), reinterpret_cast<double*>(&normals[1]), reinterpret_cast<double*>(&normals[2]));
-        normals[i] = normals[i].normalized();
+        res = fscanf(in, "%lf %lf %lf", &x, &y, &z);
+        normals[i] = VectorS<3>(x, y, z).normalized();
     }
 
     fclose(in);
@@ -221,84 +183,48 @@ bool point_cloudio::read_pb(point_cloud &pc) {
 
 
 bool point_cloudio::read_csv(point_cloud &pc) {
-    auto processText = [](const char *, size_t) {
-
-    };
-    vertex_handle v;
-    auto insertLambda = [&v, &pc](bcg_scalar_t result, size_t, size_t ScalarTypePerLineCount) {
-        if (ScalarTypePerLineCount == 0) {
-            v = pc.add_vertex(zero3s);
-        }
-        if (ScalarTypePerLineCount < 3) {
-            pc.positions[v][ScalarTypePerLineCount] = result;
-        }
-    };
-
-    std::string txt;
-    file_stream(filename).load_text(txt);
-    if (txt.empty()) return false;
-    parse_numbers<bcg_scalar_t>(txt, processText, insertLambda);
+    mapped_file file(filename);
+    if (!file) return false;
+    auto table = parse_number_table<bcg_scalar_t>(file.begin(), file.end(), {0, 0, 0}, 3);
+
+    pc.vertices.resize(table.num_rows());
+    table.for_each_row([&](size_t i, const bcg_scalar_t *row) {
+        pc.positions[i] = VectorS<3>(row[0], row[1], row[2]);
+    });
     return true;
 }
 
 
 bool point_cloudio::read_3d(point_cloud &pc) {
-    auto processText = [](const char *, size_t) {
+    mapped_file file(filename);
+    if (!file) return false;
+    // x y z intensity
+    auto table = parse_number_table<bcg_scalar_t>(file.begin(), file.end(), {0, 0, 0, 0}, 3);
 
-    };
-
-    std::vector<bcg_scalar_t> position, intensity;
     auto intensities = pc.vertices.get_or_add<bcg_scalar_t, 1>("v_intensity");
-    vertex_handle v;
-    auto insertLambda = [&v, &pc, &intensities](bcg_scalar_t result, size_t, size_t ScalarTypePerLineCount) {
-        if (ScalarTypePerLineCount == 0) {
-            v = pc.add_vertex(zero3s);
-        }
-        if (ScalarTypePerLineCount < 3) {
-            pc.positions[v][ScalarTypePerLineCount] = result;
-        } else if (ScalarTypePerLineCount < 4) {
-            intensities[v] = result;
-        }
-    };
-
-    std::string txt;
-    file_stream(filename).load_text(txt);
-    if (txt.empty()) return false;
-    parse_numbers<bcg_scalar_t>(txt, processText, insertLambda);
+    pc.vertices.resize(table.num_rows());
+    table.for_each_row([&](size_t i, const bcg_scalar_t *row) {
+        pc.positions[i] = VectorS<3>(row[0], row[1], row[2]);
+        intensities[i] = row[3];
+    });
     return true;
 }
 
 
 bool point_cloudio::read_txt(point_cloud &pc) {
-    auto processText = [](const char *, size_t) {
-
-    };
+    mapped_file file(filename);
+    if (!file) return false;
+    // x y z r g b reflectance, after a header line
+    auto table = parse_number_table<bcg_scalar_t>(file.begin(), file.end(), {0, 0, 0, 0, 0, 0, 0}, 3, 1);
 
     auto colors = pc.vertices.get_or_add<VectorS<3>, 3>("v_color");
     auto reflectances = pc.vertices.get_or_add<bcg_scalar_t, 1>("v_reflectance");
-    vertex_handle v;
-    auto insertLambda = [&v, &pc, &colors, &reflectances](bcg_scalar_t result, size_t lineCount,
-                                                          size_t ScalarTypePerLineCount) {
-        if (lineCount == 0) {
-            //pc.vertices.reserve((size_t)result);
-        } else {
-            if (ScalarTypePerLineCount == 0) {
-                v = pc.add_vertex(zero3s);
-            }
-            if (ScalarTypePerLineCount < 3) {
-                pc.positions[v][ScalarTypePerLineCount] = result;
-            } else if (ScalarTypePerLineCount < 6) {
-                colors[v][ScalarTypePerLineCount - 3] = result;
-            } else if (ScalarTypePerLineCount < 7) {
-                reflectances[v] = result;
-            }
-        }
-    };
-
-    std::string txt;
-    file_stream(filename).load_text(txt);
-    if (txt.empty()) return false;
-    parse_numbers<bcg_scalar_t>(txt, processText, insertLambda);
+    pc.vertices.resize(table.num_rows());
+    table.for_each_row([&](size_t i, const bcg_scalar_t *row) {
+        pc.positions[i] = VectorS<3>(row[0], row[1], row[2]);
+        colors[i] = VectorS<3>(row[3], row[4], row[5]);
+        reflectances[i] = row[6];
+    });
     return true;
 }
 
@@ -323,6 +249,12 @@ static int PCvertexCallback(p_ply_argument argument) {
 }
 
 bool point_cloudio::read_ply(point_cloud &pc) {
+    // binary little endian files are read directly, others through rply
+    if (read_ply_binary(filename, pc.vertices)) {
+        return pc.vertices.size() > 0;
+    }
+    pc.vertices.clear();
+
     // add object properties to hold temporary data
     auto point = pc.object_properties.add<VectorS<3>, 3>("point");
     point.resize(1);
@@ -353,4 +285,24 @@ bool point_cloudio::read_ply(point_cloud &pc) {
     return pc.vertices.size() > 0;
 }
 
-}
\ No newline at end of file
+bool point_cloudio::read_bcg(point_cloud &pc) {
+    if (!read_property_containers(filename, {&pc.vertices, &pc.object_properties})) {
+        return false;
+    }
+    pc.size_vertices_deleted = pc.vertices_deleted.vector().count();
+    return true;
+}
+
+bool point_cloudio::write_bcg(const point_cloud &pc) {
+    property_file_compression compression;
+    compression.delta_code = flags.use_compression;
+    compression.morton_order = flags.use_compression;
+    compression.position_bits = flags.position_bits;
+    return write_property_containers(filename, {&pc.vertices, &pc.object_properties}, compression);
+}
+
+bool point_cloudio::write_ply(const point_cloud &pc) {
+    return write_ply_binary(filename, pc.vertices);
+}
+
+}
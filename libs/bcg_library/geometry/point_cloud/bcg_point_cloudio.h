@@ -15,6 +15,8 @@ struct point_cloudio_flags {
     bool use_binary = false;             //!< read / write binary format
     bool use_vertex_normals = false;     //!< read / write vertex normals
     bool use_vertex_colors = false;      //!< read / write vertex colors
+    bool use_compression = false;        //!< bcg: morton order the points and delta code integer properties
+    unsigned int position_bits = 0;      //!< bcg: quantize positions to this many bits per axis, 0 keeps them exact
 };
 
 struct point_cloudio {
@@ -22,7 +24,7 @@ struct point_cloudio {
 
     bool read(point_cloud &pc);
 
-    //TODO implement point cloud writing!
+    // writes .bcg and binary .ply files, false for other extensions
     bool write(point_cloud &pc);
 
 private:
@@ -43,6 +45,14 @@ private:
 
     bool read_ply(point_cloud &pc);
 
+    // native binary format with all properties, see bcg_property_io.h
+    bool read_bcg(point_cloud &pc);
+
+    bool write_bcg(const point_cloud &pc);
+
+    // binary little endian with all arithmetic vertex properties, see bcg_ply_io.h
+    bool write_ply(const point_cloud &pc);
+
 private:
     std::string filename;
     point_cloudio_flags flags;
@@ -28,6 +28,9 @@ std::vector<std::string> grid_sampling_type_names(){
  *--------------------------------------------------------------------------------------------------------------------*/
 
 sample_first_grid::sample_first_grid(const VectorI<3> &dims, const aligned_box3 &aabb) : sampling_grid(dims, aabb),
+                                                                                         sample_points(
+                                                                                                 nodes.get_or_add<VectorS<3>, 3>(
+                                                                                                         "samples")),
                                                                                          sampled_index(
                                                                                                  nodes.get_or_add<size_t, 1>(
                                                                                                          "sampled_indices")) {
@@ -46,7 +49,7 @@ void sample_first_grid::build(property<VectorS<3>, 3> points) {
 void sample_first_grid::build(const std::vector<VectorS<3>> &points) {
     ref_points = vertices.get_or_add<VectorS<3>, 3>("ref_points");
     vertices.resize(points.size());
-    ref_points.vector() = points;
+    ref_points.vector().assign(points.begin(), points.end());
 
     size_t size = ref_points.size();
     for (size_t i = 0; i < size; ++i) {
@@ -65,31 +68,35 @@ void sample_first_grid::build(const MatrixS<-1, 3> &points) {
     }
 }
 
+void sample_first_grid::insert_points(const property<VectorS<3>, 3> &points, size_t first_index) {
+    for (size_t i = 0; i < points.size(); ++i) {
+        insert_point(points[i], first_index + i);
+    }
+}
+
 void sample_first_grid::insert_point(const VectorS<3> &point, size_t idx) {
     size_t lin_idx = to_idx(point);
     if (!is_occupied_idx(lin_idx)) {
         mark_occupied_idx(lin_idx);
         nodes.push_back();
         sampled_index[nodes.size() - 1] = idx;
+        sample_points[nodes.size() - 1] = point;
         grid_map.emplace(lin_idx, nodes.size() - 1);
     }
 }
 
 std::vector<VectorS<3>> sample_first_grid::get_occupied_sample_points() const {
-    std::vector<VectorS<3>> points(sampled_index.size());
-    for (size_t i = 0; i < points.size(); ++i) {
-        points[i] = ref_points[sampled_index[i]];
-    }
-    return points;
+    return {sample_points.begin(), sample_points.end()};
 }
 
 std::vector<size_t> sample_first_grid::get_occupied_samples_indices() const{
-    return sampled_index.vector();
+    return {sampled_index.begin(), sampled_index.end()};
 }
 
 void sample_first_grid::clear() {
     grid_map.clear();
     sampled_index.clear();
+    sample_points.clear();
     ref_points.clear();
     sampling_grid::occupancy_grid::clear();
 }
@@ -107,6 +114,9 @@ void sample_first_grid::clear() {
  *--------------------------------------------------------------------------------------------------------------------*/
 
 sample_last_grid::sample_last_grid(const VectorI<3> &dims, const aligned_box3 &aabb) : sampling_grid(dims, aabb),
+                                                                                       sample_points(
+                                                                                               nodes.get_or_add<VectorS<3>, 3>(
+                                                                                                       "samples")),
                                                                                        sampled_index(
                                                                                                nodes.get_or_add<size_t, 1>(
                                                                                                        "sampled_indices")) {
@@ -125,7 +135,7 @@ void sample_last_grid::build(property<VectorS<3>, 3> points) {
 void sample_last_grid::build(const std::vector<VectorS<3>> &points) {
     ref_points = vertices.get_or_add<VectorS<3>, 3>("ref_points");
     vertices.resize(points.size());
-    ref_points.vector() = points;
+    ref_points.vector().assign(points.begin(), points.end());
 
     size_t size = ref_points.size();
     for (size_t i = 0; i < size; ++i) {
@@ -144,33 +154,39 @@ void sample_last_grid::build(const MatrixS<-1, 3> &points) {
     }
 }
 
+void sample_last_grid::insert_points(const property<VectorS<3>, 3> &points, size_t first_index) {
+    for (size_t i = 0; i < points.size(); ++i) {
+        insert_point(points[i], first_index + i);
+    }
+}
+
 void sample_last_grid::insert_point(const VectorS<3> &point, size_t idx) {
     size_t lin_idx = to_idx(point);
     if (!is_occupied_idx(lin_idx)) {
         mark_occupied_idx(lin_idx);
         nodes.push_back();
         sampled_index[nodes.size() - 1] = idx;
+        sample_points[nodes.size() - 1] = point;
         grid_map.emplace(lin_idx, nodes.size() - 1);
     } else {
-        sampled_index[grid_map[lin_idx]] = idx;
+        size_t voxel_idx = grid_map[lin_idx];
+        sampled_index[voxel_idx] = idx;
+        sample_points[voxel_idx] = point;
     }
 }
 
 std::vector<VectorS<3>> sample_last_grid::get_occupied_sample_points() const {
-    std::vector<VectorS<3>> points(sampled_index.size());
-    for (size_t i = 0; i < points.size(); ++i) {
-        points[i] = ref_points[sampled_index[i]];
-    }
-    return points;
+    return {sample_points.begin(), sample_points.end()};
 }
 
 std::vector<size_t> sample_last_grid::get_occupied_samples_indices() const{
-    return sampled_index.vector();
+    return {sampled_index.begin(), sampled_index.end()};
 }
 
 void sample_last_grid::clear() {
     grid_map.clear();
     sampled_index.clear();
+    sample_points.clear();
     ref_points.clear();
     sampling_grid::occupancy_grid::clear();
 }
@@ -188,6 +204,9 @@ void sample_last_grid::clear() {
  *--------------------------------------------------------------------------------------------------------------------*/
 
 sample_closest_grid::sample_closest_grid(const VectorI<3> &dims, const aligned_box3 &aabb) : sampling_grid(dims, aabb),
+                                                                                             sample_points(
+                                                                                                     nodes.get_or_add<VectorS<3>, 3>(
+                                                                                                             "samples")),
                                                                                              sampled_index(
                                                                                                      nodes.get_or_add<size_t, 1>(
                                                                                                              "sampled_indices")),
@@ -209,7 +228,7 @@ void sample_closest_grid::build(property<VectorS<3>, 3> points) {
 void sample_closest_grid::build(const std::vector<VectorS<3>> &points) {
     ref_points = vertices.get_or_add<VectorS<3>, 3>("ref_points");
     vertices.resize(points.size());
-    ref_points.vector() = points;
+    ref_points.vector().assign(points.begin(), points.end());
 
     size_t size = ref_points.size();
     for (size_t i = 0; i < size; ++i) {
@@ -228,12 +247,19 @@ void sample_closest_grid::build(const MatrixS<-1, 3> &points) {
     }
 }
 
+void sample_closest_grid::insert_points(const property<VectorS<3>, 3> &points, size_t first_index) {
+    for (size_t i = 0; i < points.size(); ++i) {
+        insert_point(points[i], first_index + i);
+    }
+}
+
 void sample_closest_grid::insert_point(const VectorS<3> &point, size_t idx) {
     size_t lin_idx = to_idx(point);
     if (!is_occupied_idx(lin_idx)) {
         mark_occupied_idx(lin_idx);
         nodes.push_back();
         sampled_index[nodes.size() - 1] = idx;
+        sample_points[nodes.size() - 1] = point;
         grid_map.emplace(lin_idx, nodes.size() - 1);
         distances_to_voxel_centers[nodes.size() - 1] = (idx_to_voxel_center(lin_idx) - point).norm();
     } else {
@@ -241,26 +267,24 @@ void sample_closest_grid::insert_point(const VectorS<3> &point, size_t idx) {
         size_t voxel_idx = grid_map[lin_idx];
         if (distance < distances_to_voxel_centers[voxel_idx]) {
             sampled_index[voxel_idx] = idx;
+            sample_points[voxel_idx] = point;
             distances_to_voxel_centers[voxel_idx] = distance;
         }
     }
 }
 
 std::vector<VectorS<3>> sample_closest_grid::get_occupied_sample_points() const {
-    std::vector<VectorS<3>> points(sampled_index.size());
-    for (size_t i = 0; i < points.size(); ++i) {
-        points[i] = ref_points[sampled_index[i]];
-    }
-    return points;
+    return {sample_points.begin(), sample_points.end()};
 }
 
 std::vector<size_t> sample_closest_grid::get_occupied_samples_indices() const{
-    return sampled_index.vector();
+    return {sampled_index.begin(), sampled_index.end()};
 }
 
 void sample_closest_grid::clear() {
     grid_map.clear();
     sampled_index.clear();
+    sample_points.clear();
     ref_points.clear();
     sampling_grid::occupancy_grid::clear();
 }
@@ -299,7 +323,7 @@ void sample_mean_grid::build(property<VectorS<3>, 3> points) {
 void sample_mean_grid::build(const std::vector<VectorS<3>> &points) {
     ref_points = vertices.get_or_add<VectorS<3>, 3>("ref_points");
     vertices.resize(points.size());
-    ref_points.vector() = points;
+    ref_points.vector().assign(points.begin(), points.end());
 
     size_t size = ref_points.size();
     for (size_t i = 0; i < size; ++i) {
@@ -318,6 +342,12 @@ void sample_mean_grid::build(const MatrixS<-1, 3> &points) {
     }
 }
 
+void sample_mean_grid::insert_points(const property<VectorS<3>, 3> &points, size_t) {
+    for (size_t i = 0; i < points.size(); ++i) {
+        insert_point(points[i]);
+    }
+}
+
 void sample_mean_grid::insert_point(const VectorS<3> &point) {
     size_t lin_idx = to_idx(point);
     if (!is_occupied_idx(lin_idx)) {
@@ -336,7 +366,7 @@ void sample_mean_grid::insert_point(const VectorS<3> &point) {
 }
 
 std::vector<VectorS<3>> sample_mean_grid::get_occupied_sample_points() const {
-    return sample_points.vector();
+    return {sample_points.begin(), sample_points.end()};
 }
 
 void sample_mean_grid::clear() {
@@ -31,6 +31,10 @@ struct sampling_grid : protected occupancy_grid{
 
     virtual void build(const MatrixS<-1, 3> &points) = 0;
 
+    // inserts a batch of a point stream, without keeping a reference to the points. first_index is the index of the
+    // first point of the batch in the stream.
+    virtual void insert_points(const property<VectorS<3>, 3> &points, size_t first_index) = 0;
+
     virtual std::vector<VectorS<3>> get_occupied_sample_points() const = 0;
 
     vertex_container nodes;
@@ -49,6 +53,8 @@ struct sample_first_grid : public sampling_grid{
 
     void build(const MatrixS<-1, 3> &points) override;
 
+    void insert_points(const property<VectorS<3>, 3> &points, size_t first_index) override;
+
     void insert_point(const VectorS<3> &point, size_t idx);
 
     std::vector<VectorS<3>> get_occupied_sample_points() const override;
@@ -58,6 +64,7 @@ struct sample_first_grid : public sampling_grid{
     void clear() override;
 
     property<VectorS<3>, 3> ref_points;
+    property<VectorS<3>, 3> sample_points;
     property<size_t, 1> sampled_index;
 };
 
@@ -72,6 +79,8 @@ struct sample_last_grid : public sampling_grid{
 
     void build(const MatrixS<-1, 3> &points) override;
 
+    void insert_points(const property<VectorS<3>, 3> &points, size_t first_index) override;
+
     void insert_point(const VectorS<3> &point, size_t idx);
 
     std::vector<VectorS<3>> get_occupied_sample_points() const override;
@@ -81,6 +90,7 @@ struct sample_last_grid : public sampling_grid{
     void clear() override;
 
     property<VectorS<3>, 3> ref_points;
+    property<VectorS<3>, 3> sample_points;
     property<size_t, 1> sampled_index;
 };
 
@@ -96,6 +106,8 @@ struct sample_closest_grid : public sampling_grid{
 
     void build(const MatrixS<-1, 3> &points) override;
 
+    void insert_points(const property<VectorS<3>, 3> &points, size_t first_index) override;
+
     void insert_point(const VectorS<3> &point, size_t idx);
 
     std::vector<VectorS<3>> get_occupied_sample_points() const override;
@@ -105,6 +117,7 @@ struct sample_closest_grid : public sampling_grid{
     void clear() override;
 
     property<VectorS<3>, 3> ref_points;
+    property<VectorS<3>, 3> sample_points;
     property<size_t, 1> sampled_index;
     property<bcg_scalar_t, 1> distances_to_voxel_centers;
 };
@@ -120,6 +133,8 @@ struct sample_mean_grid : public sampling_grid{
 
     void build(const MatrixS<-1, 3> &points) override;
 
+    void insert_points(const property<VectorS<3>, 3> &points, size_t first_index) override;
+
     void insert_point(const VectorS<3> &point);
 
     std::vector<VectorS<3>> get_occupied_sample_points() const override;
@@ -11,7 +11,12 @@
 namespace bcg {
 using byte = unsigned int;
 using bcg_index_t = unsigned int;
+// configure with -DBCG_SINGLE_PRECISION=ON to store positions, normals and scalar fields as float
+#ifdef BCG_SINGLE_PRECISION
+using bcg_scalar_t = float;
+#else
 using bcg_scalar_t = double;
+#endif
 
 [[maybe_unused]] inline constexpr bcg_scalar_t pi = 3.14159265358979323846;
 
@@ -9,16 +9,17 @@
 
 namespace bcg {
 
-template<int N, typename Real>
-inline Eigen::Map<Eigen::Matrix<Real, -1, N>, 0, Eigen::Stride<-1, N>> Map(std::vector<Vector<Real, N>> &points) {
+template<int N, typename Real, typename Alloc>
+inline Eigen::Map<Eigen::Matrix<Real, -1, N>, 0, Eigen::Stride<-1, N>>
+Map(std::vector<Vector<Real, N>, Alloc> &points) {
     return Eigen::Map<Eigen::Matrix<Real, -1, N>, 0, Eigen::Stride<-1, N>>(&points[0][0], points.size(),
                                                                            points[0].size(),
                                                                            Eigen::Stride<-1, N>(1, points[0].size()));
 }
 
-template<int N, typename Real>
+template<int N, typename Real, typename Alloc>
 inline Eigen::Map<const Eigen::Matrix<Real, -1, N>, 0, Eigen::Stride<-1, N>>
-MapConst(const std::vector<Vector<Real, N>> &points) {
+MapConst(const std::vector<Vector<Real, N>, Alloc> &points) {
     return Eigen::Map<const Eigen::Matrix<Real, -1, N>, 0, Eigen::Stride<-1, N>>(&points[0][0],
                                                                                  points.size(), points[0].size(),
                                                                                  Eigen::Stride<-1, N>(1,
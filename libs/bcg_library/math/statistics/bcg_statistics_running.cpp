@@ -3,6 +3,7 @@
 //
 
 #include <cmath>
+#include <limits>
 #include <algorithm>
 #include "bcg_statistics_running.h"
 
@@ -10,7 +11,7 @@ namespace bcg {
 
 running_stats::running_stats() : n(0), M1(0), M2(0), M3(0), M4(0), M5(0),
                                  MIN(std::numeric_limits<double>::max()),
-                                 MAX(std::numeric_limits<double>::min()) {
+                                 MAX(std::numeric_limits<double>::lowest()) {
     clear();
 }
 
@@ -18,7 +19,7 @@ void running_stats::clear() {
     n = 0;
     M1 = M2 = M3 = M4 = M5 = 0.0;
     MIN = std::numeric_limits<double>::max();
-    MAX = std::numeric_limits<double>::min();
+    MAX = std::numeric_limits<double>::lowest();
 }
 
 void running_stats::push(double x) {
@@ -79,6 +80,8 @@ double running_stats::max() const {
 }
 
 running_stats operator+(const running_stats a, const running_stats b) {
+    if (a.n == 0) return b;
+    if (b.n == 0) return a;
     running_stats combined;
 
     combined.n = a.n + b.n;
@@ -94,7 +97,7 @@ running_stats operator+(const running_stats a, const running_stats b) {
                   delta2 * a.n * b.n / combined.n;
 
     combined.M3 = a.M3 + b.M3 +
-                  delta3 * a.n * b.n * double(a.n - b.n) / double(combined.n * combined.n);
+                  delta3 * a.n * b.n * (double(a.n) - double(b.n)) / double(combined.n * combined.n);
     combined.M3 += 3.0 * delta * (a.n * b.M2 - b.n * a.M2) / combined.n;
 
     combined.M4 = a.M4 + b.M4 + delta4 * a.n * b.n * double(a.n * a.n - a.n * b.n + b.n * b.n) /
@@ -103,6 +106,11 @@ running_stats operator+(const running_stats a, const running_stats b) {
             6.0 * delta2 * (double(a.n * a.n) * b.M2 + double(b.n * b.n) * a.M2) / double(combined.n * combined.n) +
             4.0 * delta * (a.n * b.M3 - b.n * a.M3) / combined.n;
 
+    // the running median has no exact merge, the weighted mean of both approximations is close for similar parts
+    combined.M5 = (a.n * a.M5 + b.n * b.M5) / combined.n;
+    combined.MIN = fmin(a.MIN, b.MIN);
+    combined.MAX = fmax(a.MAX, b.MAX);
+
     return combined;
 }
 
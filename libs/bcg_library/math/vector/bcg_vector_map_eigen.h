@@ -10,13 +10,13 @@
 
 namespace bcg {
 
-template<typename Real>
-inline Eigen::Map<Vector<Real, -1>> Map(std::vector<Real> &points) {
+template<typename Real, typename Alloc>
+inline Eigen::Map<Vector<Real, -1>> Map(std::vector<Real, Alloc> &points) {
     return Eigen::Map<Vector<Real, -1>>(points.data(), points.size(), 1);
 }
 
-template<typename Real>
-inline Eigen::Map<const Vector<Real, -1>> MapConst(const std::vector<Real> &points) {
+template<typename Real, typename Alloc>
+inline Eigen::Map<const Vector<Real, -1>> MapConst(const std::vector<Real, Alloc> &points) {
     return Eigen::Map<const Vector<Real, -1>>(points.data(), points.size(), 1);
 }
 
@@ -0,0 +1,228 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#ifndef BCG_GRAPHICS_BCG_ALIGNED_ALLOCATOR_H
+#define BCG_GRAPHICS_BCG_ALIGNED_ALLOCATOR_H
+
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <vector>
+#include <type_traits>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace bcg {
+
+constexpr size_t BCG_ALIGNMENT = 64;
+
+constexpr size_t BCG_HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+inline size_t align_up(size_t bytes, size_t alignment = BCG_ALIGNMENT) {
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+// 64-byte aligned heap allocation. Buffers of at least a huge page are optionally aligned to and advised as
+// transparent huge pages (linux only, elsewhere the hint is ignored).
+inline void *aligned_allocate(size_t bytes, bool huge_pages = false) {
+    size_t alignment = BCG_ALIGNMENT;
+    if (huge_pages && bytes >= BCG_HUGE_PAGE_SIZE) {
+        alignment = BCG_HUGE_PAGE_SIZE;
+    }
+    size_t size = align_up(bytes == 0 ? 1 : bytes, alignment);
+    void *ptr = std::aligned_alloc(alignment, size);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (alignment == BCG_HUGE_PAGE_SIZE) {
+        madvise(ptr, size, MADV_HUGEPAGE);
+    }
+#endif
+    return ptr;
+}
+
+inline void aligned_free(void *ptr) {
+    std::free(ptr);
+}
+
+// Hands out aligned slices of a few large blocks. Intended to be shared by all properties of one container, so that
+// reserving n elements costs one allocation instead of one per property. Released slices are kept in free lists by
+// size and handed out again first, since the properties of a container grow through the same sizes. The last slice
+// of a block gives its space back directly, and a block is returned once all its slices are released. Requests that
+// do not fit are refused and served by the heap instead. The lock is only taken when a buffer grows or is freed.
+class AlignedArena {
+public:
+    explicit AlignedArena(bool huge_pages = false) : huge_pages(huge_pages) {}
+
+    AlignedArena(const AlignedArena &) = delete;
+
+    AlignedArena &operator=(const AlignedArena &) = delete;
+
+    ~AlignedArena() {
+        for (auto &item : blocks) {
+            aligned_free(item.first);
+        }
+    }
+
+    // makes sure the next allocations of up to bytes in total are served from one block.
+    void reserve(size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (current && blocks[current].size - blocks[current].used >= bytes) {
+            return;
+        }
+        size_t size = align_up(bytes);
+        current = static_cast<char *>(aligned_allocate(size, huge_pages));
+        blocks[current].size = size;
+    }
+
+    void *allocate(size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        bytes = align_up(bytes == 0 ? 1 : bytes);
+        auto list = free.find(bytes);
+        if (list != free.end() && !list->second.empty()) {
+            char *slice = list->second.back();
+            list->second.pop_back();
+            ++find_block(slice)->second.live;
+            return slice;
+        }
+        if (!current) {
+            return nullptr;
+        }
+        auto &b = blocks[current];
+        if (b.size - b.used < bytes) {
+            return nullptr;
+        }
+        char *slice = current + b.used;
+        b.used += bytes;
+        ++b.live;
+        return slice;
+    }
+
+    // bytes as passed to allocate. Returns false if ptr was not handed out by this arena.
+    bool deallocate(void *ptr, size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto *slice = static_cast<char *>(ptr);
+        auto item = find_block(slice);
+        if (item == blocks.end()) {
+            return false;
+        }
+        auto &b = item->second;
+        bytes = align_up(bytes == 0 ? 1 : bytes);
+        if (--b.live == 0) {
+            for (auto &entry : free) {
+                auto &slices = entry.second;
+                slices.erase(std::remove_if(slices.begin(), slices.end(), [&](char *p) {
+                    return p >= item->first && p < item->first + b.size;
+                }), slices.end());
+            }
+            if (item->first == current) {
+                b.used = 0;
+            } else {
+                aligned_free(item->first);
+                blocks.erase(item);
+            }
+        } else if (slice + bytes == item->first + b.used) {
+            b.used -= bytes;
+        } else {
+            free[bytes].push_back(slice);
+        }
+        return true;
+    }
+
+    [[nodiscard]] size_t capacity() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t size = 0;
+        for (const auto &item : blocks) {
+            size += item.second.size;
+        }
+        return size;
+    }
+
+    [[nodiscard]] size_t num_blocks() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return blocks.size();
+    }
+
+    const bool huge_pages;
+
+private:
+    struct block {
+        size_t size = 0;
+        size_t used = 0;
+        size_t live = 0;
+    };
+
+    // the block containing ptr, found by address
+    std::map<char *, block>::iterator find_block(char *ptr) {
+        auto item = blocks.upper_bound(ptr);
+        if (item == blocks.begin()) {
+            return blocks.end();
+        }
+        --item;
+        return ptr < item->first + item->second.size ? item : blocks.end();
+    }
+
+    // blocks by start address, new slices are cut from current
+    std::map<char *, block> blocks;
+    char *current = nullptr;
+    std::unordered_map<size_t, std::vector<char *>> free;
+    mutable std::mutex mutex;
+};
+
+// std allocator returning 64-byte aligned memory, taken from an arena if one is set and has room.
+template<typename T>
+struct AlignedAllocator {
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    AlignedAllocator() = default;
+
+    explicit AlignedAllocator(std::shared_ptr<AlignedArena> arena) : arena(std::move(arena)) {}
+
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t n) {
+        size_t bytes = n * sizeof(T);
+        if (arena) {
+            if (void *ptr = arena->allocate(bytes)) {
+                return static_cast<T *>(ptr);
+            }
+        }
+        return static_cast<T *>(aligned_allocate(bytes, arena && arena->huge_pages));
+    }
+
+    void deallocate(T *ptr, size_t n) {
+        if (arena && arena->deallocate(ptr, n * sizeof(T))) {
+            return;
+        }
+        aligned_free(ptr);
+    }
+
+    template<typename U>
+    bool operator==(const AlignedAllocator<U> &other) const {
+        return arena == other.arena;
+    }
+
+    template<typename U>
+    bool operator!=(const AlignedAllocator<U> &other) const {
+        return arena != other.arena;
+    }
+
+    std::shared_ptr<AlignedArena> arena;
+};
+
+}
+
+#endif //BCG_GRAPHICS_BCG_ALIGNED_ALLOCATOR_H
@@ -0,0 +1,336 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#ifndef BCG_GRAPHICS_BCG_BIT_VECTOR_H
+#define BCG_GRAPHICS_BCG_BIT_VECTOR_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <atomic>
+#include <utility>
+
+#include "bcg_bits.h"
+
+namespace bcg {
+
+// std::vector<bool> replacement with accessible 64-bit words. Used as storage of bool properties so that masks
+// (e.g. deletion flags) can be scanned a word at a time and uploaded as raw words.
+class BitVector {
+public:
+    using word_t = std::uint64_t;
+    static constexpr size_t word_bits = 64;
+
+    struct reference_t {
+        BitVector *bv;
+        size_t pos;
+
+        reference_t(BitVector *bv, size_t pos) : bv(bv), pos(pos) {}
+
+        inline reference_t &operator=(bool val) {
+            bv->set(pos, val);
+            return *this;
+        }
+
+        inline reference_t &operator=(const reference_t &other) {
+            return operator=(bool(other));
+        }
+
+        inline operator bool() const noexcept {
+            return bv->test(pos);
+        }
+    };
+
+    template<typename Derived, typename Vector, typename Reference>
+    struct base_iterator {
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = bool;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Reference;
+
+        base_iterator(Vector *bv = nullptr, size_t pos = 0) : bv(bv), pos(pos) {}
+
+        inline Reference operator*() const { return (*bv)[pos]; }
+
+        inline Derived &operator++() {
+            ++pos;
+            return static_cast<Derived &>(*this);
+        }
+
+        inline Derived &operator--() {
+            --pos;
+            return static_cast<Derived &>(*this);
+        }
+
+        inline Derived &operator+=(difference_type n) {
+            pos += n;
+            return static_cast<Derived &>(*this);
+        }
+
+        inline Derived operator+(difference_type n) const { return Derived(bv, pos + n); }
+
+        inline Derived operator-(difference_type n) const { return Derived(bv, pos - n); }
+
+        inline difference_type operator-(const Derived &other) const {
+            return difference_type(pos) - difference_type(other.pos);
+        }
+
+        inline bool operator==(const Derived &other) const { return pos == other.pos; }
+
+        inline bool operator!=(const Derived &other) const { return pos != other.pos; }
+
+        inline bool operator<(const Derived &other) const { return pos < other.pos; }
+
+        Vector *bv;
+        size_t pos;
+    };
+
+    struct iterator : public base_iterator<iterator, BitVector, reference_t> {
+        using base_iterator::base_iterator;
+    };
+
+    struct const_iterator : public base_iterator<const_iterator, const BitVector, bool> {
+        using base_iterator::base_iterator;
+
+        const_iterator(const iterator &other) : base_iterator(other.bv, other.pos) {}
+    };
+
+    using reference = reference_t;
+    using const_reference = bool;
+
+    BitVector() : m_size(0), m_maybe_set(false) {}
+
+    explicit BitVector(size_t n, bool value = false) : BitVector() {
+        resize(n, value);
+    }
+
+    BitVector(const std::vector<bool> &other) : BitVector() {
+        assign(other.begin(), other.end());
+    }
+
+    BitVector(const BitVector &other) : m_words(other.m_words), m_size(other.m_size),
+                                        m_maybe_set(other.maybe_any()) {}
+
+    BitVector &operator=(const BitVector &other) {
+        m_words = other.m_words;
+        m_size = other.m_size;
+        m_maybe_set = other.maybe_any();
+        return *this;
+    }
+
+    // the atomic flag is not movable, so these are spelled out. other is left empty.
+    BitVector(BitVector &&other) noexcept : m_words(std::move(other.m_words)), m_size(other.m_size),
+                                            m_maybe_set(other.maybe_any()) {
+        other.m_words.clear();
+        other.m_size = 0;
+        other.m_maybe_set = false;
+    }
+
+    BitVector &operator=(BitVector &&other) noexcept {
+        if (this != &other) {
+            m_words = std::move(other.m_words);
+            m_size = other.m_size;
+            m_maybe_set = other.maybe_any();
+            other.m_words.clear();
+            other.m_size = 0;
+            other.m_maybe_set = false;
+        }
+        return *this;
+    }
+
+    void assign(size_t n, bool value) {
+        clear();
+        resize(n, value);
+    }
+
+    template<typename InputIt>
+    void assign(InputIt first, InputIt last) {
+        clear();
+        for (; first != last; ++first) {
+            push_back(bool(*first));
+        }
+    }
+
+    template<typename InputIt>
+    iterator insert(const_iterator pos, InputIt first, InputIt last) {
+        size_t index = pos.pos;
+        std::vector<bool> tail;
+        for (size_t i = index; i < m_size; ++i) {
+            tail.push_back(test(i));
+        }
+        resize(index);
+        for (; first != last; ++first) {
+            push_back(bool(*first));
+        }
+        for (const bool value : tail) {
+            push_back(value);
+        }
+        return iterator(this, index);
+    }
+
+    [[nodiscard]] inline bool test(size_t pos) const {
+        return (m_words[pos / word_bits] >> (pos % word_bits)) & 1u;
+    }
+
+    inline void set(size_t pos, bool value = true) {
+        word_t mask = word_t(1) << (pos % word_bits);
+        if (value) {
+            m_words[pos / word_bits] |= mask;
+            m_maybe_set.store(true, std::memory_order_relaxed);
+        } else {
+            m_words[pos / word_bits] &= ~mask;
+        }
+    }
+
+    inline void reset(size_t pos) {
+        set(pos, false);
+    }
+
+    [[nodiscard]] inline reference_t operator[](size_t pos) { return reference_t(this, pos); }
+
+    [[nodiscard]] inline bool operator[](size_t pos) const { return test(pos); }
+
+    [[nodiscard]] inline reference_t back() { return reference_t(this, m_size - 1); }
+
+    [[nodiscard]] inline bool back() const { return test(m_size - 1); }
+
+    inline void push_back(bool value) {
+        if (m_size % word_bits == 0) {
+            m_words.push_back(0);
+        }
+        ++m_size;
+        set(m_size - 1, value);
+    }
+
+    inline void resize(size_t n, bool value = false) {
+        size_t old_size = m_size;
+        m_words.resize((n + word_bits - 1) / word_bits, 0);
+        m_size = n;
+        if (n < old_size) {
+            // keep the bits past the end cleared, the word scans rely on it
+            clear_tail();
+            update_maybe_any();
+        } else if (value) {
+            for (size_t i = old_size; i < n; ++i) {
+                set(i);
+            }
+        }
+    }
+
+    inline void reserve(size_t n) {
+        m_words.reserve((n + word_bits - 1) / word_bits);
+    }
+
+    inline void clear() {
+        m_words.clear();
+        m_size = 0;
+        m_maybe_set = false;
+    }
+
+    inline void shrink_to_fit() {
+        m_words.shrink_to_fit();
+    }
+
+    [[nodiscard]] inline size_t size() const { return m_size; }
+
+    [[nodiscard]] inline size_t capacity() const { return m_words.capacity() * word_bits; }
+
+    [[nodiscard]] inline bool empty() const { return m_size == 0; }
+
+    [[nodiscard]] inline size_t num_words() const { return m_words.size(); }
+
+    [[nodiscard]] inline word_t *data() { return m_words.data(); }
+
+    [[nodiscard]] inline const word_t *data() const { return m_words.data(); }
+
+    [[nodiscard]] inline iterator begin() { return iterator(this, 0); }
+
+    [[nodiscard]] inline iterator end() { return iterator(this, m_size); }
+
+    [[nodiscard]] inline const_iterator begin() const { return const_iterator(this, 0); }
+
+    [[nodiscard]] inline const_iterator end() const { return const_iterator(this, m_size); }
+
+    // conservative: false guarantees that no bit is set, true means that a bit was set since the last recount.
+    [[nodiscard]] inline bool maybe_any() const {
+        return m_maybe_set.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] inline size_t count() const {
+        size_t count = 0;
+        for (const auto word : m_words) {
+            count += COUNTSETBITS(word);
+        }
+        return count;
+    }
+
+    // recounts the set bits and resets the maybe_any() summary if there are none.
+    inline void update_maybe_any() {
+        for (const auto word : m_words) {
+            if (word != 0) {
+                m_maybe_set = true;
+                return;
+            }
+        }
+        m_maybe_set = false;
+    }
+
+    // first position >= pos whose bit is not set, size() if there is none. Skips full words at once.
+    [[nodiscard]] inline size_t find_next_unset(size_t pos) const {
+        if (pos >= m_size) {
+            return m_size;
+        }
+        size_t w = pos / word_bits;
+        word_t word = ~m_words[w] & (~word_t(0) << (pos % word_bits));
+        while (word == 0) {
+            if (++w == m_words.size()) {
+                return m_size;
+            }
+            word = ~m_words[w];
+        }
+        size_t next = w * word_bits + ctz(word);
+        return next < m_size ? next : m_size;
+    }
+
+    // first position >= pos whose bit is set, size() if there is none. Skips empty words at once.
+    [[nodiscard]] inline size_t find_next_set(size_t pos) const {
+        if (pos >= m_size) {
+            return m_size;
+        }
+        size_t w = pos / word_bits;
+        word_t word = m_words[w] & (~word_t(0) << (pos % word_bits));
+        while (word == 0) {
+            if (++w == m_words.size()) {
+                return m_size;
+            }
+            word = m_words[w];
+        }
+        return w * word_bits + ctz(word);
+    }
+
+    [[nodiscard]] inline bool operator==(const BitVector &other) const {
+        return m_size == other.m_size && m_words == other.m_words;
+    }
+
+    [[nodiscard]] inline bool operator!=(const BitVector &other) const {
+        return !operator==(other);
+    }
+
+private:
+    inline void clear_tail() {
+        if (m_size % word_bits != 0) {
+            m_words.back() &= ~(~word_t(0) << (m_size % word_bits));
+        }
+    }
+
+    std::vector<word_t> m_words;
+    size_t m_size;
+    std::atomic<bool> m_maybe_set;
+};
+
+}
+
+#endif //BCG_GRAPHICS_BCG_BIT_VECTOR_H
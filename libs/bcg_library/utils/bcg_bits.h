@@ -81,6 +81,19 @@ inline size_t clz(size_t x) {
     return n - x;
 }
 
+// number of trailing zero bits, 64 for x == 0
+inline size_t ctz(std::uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return x == 0 ? 64 : __builtin_ctzll(x);
+#else
+    size_t n = 0;
+    while (n < 64 && !((x >> n) & 1u)) {
+        ++n;
+    }
+    return n;
+#endif
+}
+
 template<typename T>
 inline size_t RMSB(T var) { return var == 0 ? 0 : std::log2((var) & -(var)) + 1; }
 
@@ -0,0 +1,72 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include "bcg_delta_coding.h"
+
+namespace bcg {
+
+namespace {
+
+inline void append_varint(std::string &out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(char(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(char(value));
+}
+
+}
+
+std::string delta_encode(const uint32_t *values, size_t count, size_t lanes, size_t block_size) {
+    block_size = std::max<size_t>(block_size, 1);
+    size_t num_blocks = (count + block_size - 1) / block_size;
+    std::vector<std::string> blocks(num_blocks);
+    tbb::parallel_for(size_t(0), num_blocks, [&](size_t b) {
+        auto &out = blocks[b];
+        size_t first = b * block_size, last = std::min(count, first + block_size);
+        out.reserve((last - first) * lanes * 2);
+        // the first element of a block is coded against zero
+        for (size_t i = first; i < last; ++i) {
+            for (size_t lane = 0; lane < lanes; ++lane) {
+                uint32_t previous = i == first ? 0 : values[(i - 1) * lanes + lane];
+                uint32_t delta = values[i * lanes + lane] - previous;
+                append_varint(out, (delta << 1) ^ (0u - (delta >> 31)));
+            }
+        }
+    });
+
+    delta_coded_header header{count, uint32_t(lanes), uint32_t(block_size)};
+    std::vector<uint64_t> offsets(num_blocks + 1, 0);
+    for (size_t b = 0; b < num_blocks; ++b) {
+        offsets[b + 1] = offsets[b] + blocks[b].size();
+    }
+    std::string result;
+    result.reserve(sizeof(header) + offsets.size() * sizeof(uint64_t) + offsets.back());
+    result.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    result.append(reinterpret_cast<const char *>(offsets.data()), offsets.size() * sizeof(uint64_t));
+    for (const auto &block : blocks) {
+        result.append(block);
+    }
+    return result;
+}
+
+bool delta_decode_header(const char *begin, const char *end, delta_coded_header &header) {
+    if (size_t(end - begin) < sizeof(header)) return false;
+    std::memcpy(&header, begin, sizeof(header));
+    if (header.block_size == 0 || header.lanes == 0) return header.count == 0;
+    uint64_t num_blocks = (header.count + header.block_size - 1) / header.block_size;
+    size_t available = size_t(end - begin) - sizeof(header);
+    if (num_blocks + 1 > available / sizeof(uint64_t)) return false;
+    size_t data_size = available - (num_blocks + 1) * sizeof(uint64_t);
+    uint64_t previous = 0;
+    for (uint64_t b = 0; b <= num_blocks; ++b) {
+        uint64_t offset;
+        std::memcpy(&offset, begin + sizeof(header) + b * sizeof(uint64_t), sizeof(offset));
+        if (offset < previous || offset > data_size) return false;
+        previous = offset;
+    }
+    return true;
+}
+
+}
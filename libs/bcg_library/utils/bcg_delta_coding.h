@@ -0,0 +1,77 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#ifndef BCG_GRAPHICS_BCG_DELTA_CODING_H
+#define BCG_GRAPHICS_BCG_DELTA_CODING_H
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include "tbb/tbb.h"
+
+namespace bcg {
+
+// Lossless coding of arrays of elements made of 32-bit lanes, like index tuples or quantized coordinates. Per lane each
+// value is stored as the zigzag and varint coded difference to the value of the previous element. Elements are split
+// into blocks which are coded independently, so decoding runs in parallel per block. Layout:
+//
+//   uint64 count, uint32 lanes, uint32 block_size, uint64 block offsets[num_blocks + 1], block data
+//
+std::string delta_encode(const uint32_t *values, size_t count, size_t lanes, size_t block_size = 1 << 16);
+
+struct delta_coded_header {
+    uint64_t count = 0;
+    uint32_t lanes = 0;
+    uint32_t block_size = 0;
+};
+
+// reads the header and checks that the block offsets lie in [begin, end)
+bool delta_decode_header(const char *begin, const char *end, delta_coded_header &header);
+
+inline uint32_t read_varint(const uint8_t *&pen, const uint8_t *end, bool &ok) {
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35 && pen != end; shift += 7) {
+        uint8_t byte = *pen++;
+        value |= uint32_t(byte & 0x7f) << shift;
+        if (byte < 0x80) return value;
+    }
+    ok = false;
+    return value;
+}
+
+// calls store(element index, pointer to its lanes) for all elements, in parallel over blocks. False if the data is
+// malformed, elements of broken blocks are not stored then.
+template<typename Store>
+bool delta_decode(const char *begin, const char *end, Store &&store) {
+    delta_coded_header header;
+    if (!delta_decode_header(begin, end, header)) return false;
+    if (header.count == 0) return true;
+    size_t num_blocks = (header.count + header.block_size - 1) / header.block_size;
+    const char *table = begin + sizeof(header);
+    const char *data = table + (num_blocks + 1) * sizeof(uint64_t);
+    std::atomic<bool> valid{true};
+    tbb::parallel_for(size_t(0), num_blocks, [&](size_t b) {
+        uint64_t offsets[2];
+        std::memcpy(offsets, table + b * sizeof(uint64_t), sizeof(offsets));
+        auto pen = reinterpret_cast<const uint8_t *>(data + offsets[0]);
+        auto block_end = reinterpret_cast<const uint8_t *>(data + offsets[1]);
+        std::vector<uint32_t> values(header.lanes, 0);
+        size_t last = std::min<size_t>(header.count, (b + 1) * size_t(header.block_size));
+        bool ok = true;
+        for (size_t i = b * size_t(header.block_size); i < last && ok; ++i) {
+            for (size_t lane = 0; lane < header.lanes; ++lane) {
+                uint32_t zigzag = read_varint(pen, block_end, ok);
+                values[lane] += (zigzag >> 1) ^ (0u - (zigzag & 1));
+            }
+            if (ok) store(i, values.data());
+        }
+        if (!ok) valid = false;
+    });
+    return valid;
+}
+
+}
+
+#endif //BCG_GRAPHICS_BCG_DELTA_CODING_H
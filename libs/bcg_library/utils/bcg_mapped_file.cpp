@@ -0,0 +1,82 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include "bcg_mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace bcg {
+
+#ifdef _WIN32
+
+mapped_file::mapped_file(const std::string &filename) {
+    file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                       FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        file = nullptr;
+        return;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        return;
+    }
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        return;
+    }
+    data = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (data != nullptr) {
+        length = size_t(file_size.QuadPart);
+    }
+}
+
+mapped_file::~mapped_file() {
+    if (data != nullptr) UnmapViewOfFile(data);
+    if (mapping != nullptr) CloseHandle(mapping);
+    if (file != nullptr) CloseHandle(file);
+}
+
+#else
+
+mapped_file::mapped_file(const std::string &filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat info{};
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void *ptr = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr != MAP_FAILED) {
+            // the pages are read front to back, let the kernel read ahead
+            madvise(ptr, size_t(info.st_size), MADV_SEQUENTIAL);
+            data = static_cast<const char *>(ptr);
+            length = size_t(info.st_size);
+        }
+    }
+    // the mapping stays valid after closing the descriptor
+    close(fd);
+}
+
+mapped_file::~mapped_file() {
+    if (data != nullptr) {
+        munmap(const_cast<char *>(data), length);
+    }
+}
+
+#endif
+
+mapped_file::operator bool() const {
+    return data != nullptr && length > 0;
+}
+
+}
@@ -0,0 +1,43 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#ifndef BCG_GRAPHICS_BCG_MAPPED_FILE_H
+#define BCG_GRAPHICS_BCG_MAPPED_FILE_H
+
+#include <string>
+
+namespace bcg {
+
+// read-only memory mapping of a whole file. Readers parse the mapped bytes in place instead of copying the file into
+// a string first. The data is not zero terminated.
+struct mapped_file {
+    explicit mapped_file(const std::string &filename);
+
+    ~mapped_file();
+
+    mapped_file(const mapped_file &) = delete;
+
+    mapped_file &operator=(const mapped_file &) = delete;
+
+    [[nodiscard]] inline const char *begin() const { return data; }
+
+    [[nodiscard]] inline const char *end() const { return data + length; }
+
+    [[nodiscard]] inline size_t size() const { return length; }
+
+    // true if the file was mapped and is not empty
+    operator bool() const;
+
+private:
+    const char *data = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void *file = nullptr;
+    void *mapping = nullptr;
+#endif
+};
+
+}
+
+#endif //BCG_GRAPHICS_BCG_MAPPED_FILE_H
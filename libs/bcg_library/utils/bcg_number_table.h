@@ -0,0 +1,112 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#ifndef BCG_GRAPHICS_BCG_NUMBER_TABLE_H
+#define BCG_GRAPHICS_BCG_NUMBER_TABLE_H
+
+#include <vector>
+#include <algorithm>
+#include "tbb/tbb.h"
+#include "bcg_string_utils.h"
+
+namespace bcg {
+
+// rows of numbers parsed from ascii text, stored row-major per chunk of the input.
+template<typename Real>
+struct number_table {
+    size_t num_columns = 0;
+    std::vector<std::vector<Real>> chunks;
+    std::vector<size_t> chunk_offsets{0};  // first row of each chunk, one past the last row at the end
+
+    [[nodiscard]] inline size_t num_rows() const {
+        return chunk_offsets.back();
+    }
+
+    // calls func(row index, pointer to num_columns numbers) for every row, in parallel over chunks.
+    template<typename Func>
+    void for_each_row(Func &&func) const {
+        tbb::parallel_for(size_t(0), chunks.size(), [&](size_t c) {
+            const Real *row = chunks[c].data();
+            for (size_t i = chunk_offsets[c]; i < chunk_offsets[c + 1]; ++i, row += num_columns) {
+                func(i, row);
+            }
+        });
+    }
+};
+
+// parses the numbers of the line starting at pen into row, missing columns keep their value. Leaves pen behind the
+// line break. Returns the number of numbers on the line, or 0 for text lines (any letter that is not an exponent).
+template<typename Real>
+size_t parse_number_row(const char *&pen, const char *end, Real *row, size_t num_columns) {
+    const char *begin = pen;
+    size_t count = 0;
+    bool text = false;
+    while (pen != end) {
+        char c = *pen;
+        if (is_digit(c) || (c == '.' && pen + 1 != end && is_digit(pen[1]))) {
+            bool neg = pen != begin && pen[-1] == '-';
+            auto const result = parse_unsigned<Real>(pen, end);
+            if (count < num_columns) {
+                row[count] = neg ? -result : result;
+            }
+            ++count;
+            continue;
+        }
+        ++pen;
+        if (c == '\n') {
+            break;
+        }
+        text |= static_cast<unsigned char>((c | 0x20) - 'a') < 26;
+    }
+    return text ? 0 : count;
+}
+
+// Parses rows of numbers from [begin, end) in parallel. The text is split into chunks of about chunk_size bytes at
+// line breaks, each chunk is parsed into its own buffer. The first skip_lines lines, text lines and lines with fewer
+// than min_columns numbers are skipped. Columns beyond defaults.size() are ignored, missing ones take the default.
+template<typename Real>
+number_table<Real> parse_number_table(const char *begin, const char *end, const std::vector<Real> &defaults,
+                                      size_t min_columns, size_t skip_lines = 0, size_t chunk_size = 1 << 22) {
+    number_table<Real> table;
+    table.num_columns = defaults.size();
+    for (; skip_lines > 0 && begin != end; --skip_lines) {
+        begin = std::find(begin, end, '\n');
+        if (begin != end) ++begin;
+    }
+
+    std::vector<const char *> bounds{begin};
+    while (bounds.back() != end) {
+        const char *next = size_t(end - bounds.back()) > chunk_size ? bounds.back() + chunk_size : end;
+        next = std::find(next, end, '\n');
+        bounds.push_back(next == end ? end : next + 1);
+    }
+
+    size_t num_chunks = bounds.size() - 1;
+    table.chunks.resize(num_chunks);
+    tbb::parallel_for(size_t(0), num_chunks, [&](size_t c) {
+        auto &rows = table.chunks[c];
+        // about 8 bytes per number is a cheap guess that avoids most reallocations
+        rows.reserve(size_t(bounds[c + 1] - bounds[c]) / 8 + table.num_columns);
+        const char *pen = bounds[c];
+        while (pen != bounds[c + 1]) {
+            size_t offset = rows.size();
+            rows.insert(rows.end(), defaults.begin(), defaults.end());
+            size_t count = parse_number_row(pen, bounds[c + 1], rows.data() + offset, table.num_columns);
+            if (count == 0 || count < min_columns) {
+                rows.resize(offset);
+            }
+        }
+    });
+
+    table.chunk_offsets.resize(num_chunks + 1);
+    size_t row_size = std::max<size_t>(table.num_columns, 1);
+    for (size_t c = 0; c < num_chunks; ++c) {
+        table.chunk_offsets[c + 1] = table.chunk_offsets[c] + table.chunks[c].size() / row_size;
+    }
+    return table;
+}
+
+}
+
+#endif //BCG_GRAPHICS_BCG_NUMBER_TABLE_H
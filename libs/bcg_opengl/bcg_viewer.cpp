@@ -18,6 +18,7 @@
 #include <GLFW/glfw3.h>
 
 #include "bcg_imgui.h"
+#include "bcg_opengl/guis/bcg_gui_loading.h"
 #include "imgui/backends/imgui_impl_glfw.h"
 #include "imgui/backends/imgui_impl_opengl3.h"
 
@@ -52,6 +53,7 @@ static void draw_window(viewer_state *state) {
         if (state->gui.left.show && state->gui.left.active) {
             state->gui.left.render(state);
         }
+        gui_loading(state);
 
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
@@ -31,6 +31,14 @@ struct simplification{
     unsigned int max_valence = 0;
     bcg_scalar_t normal_deviation = 0.0;
     bcg_scalar_t hausdorff_error = 0.0;
+    bool parallel = false;
+    // keeps the collapses as progressive_mesh of the entity
+    bool progressive = false;
+};
+
+struct progressive_level{
+    entt::entity id;
+    unsigned int n_vertices;
 };
 
 namespace smoothing{
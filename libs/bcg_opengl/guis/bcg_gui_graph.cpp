@@ -15,9 +15,9 @@ void gui_graph(viewer_state *state, halfedge_graph *graph){
     static bool show_halfedges_edit = false;
     static bool show_edges_edit = false;
     if (ImGui::CollapsingHeader("graph properties")) {
-        gui_property_container_selector(state, &graph->vertices, state->picker.vertex_id.idx);
-        gui_property_container_selector(state, &graph->halfedges, state->picker.halfedge_id.idx);
-        gui_property_container_selector(state, &graph->edges, state->picker.edge_id.idx);
+        gui_property_container_selector(state, &graph->vertices, state->picker.vertex_id);
+        gui_property_container_selector(state, &graph->halfedges, state->picker.halfedge_id);
+        gui_property_container_selector(state, &graph->edges, state->picker.edge_id);
         if(ImGui::Button("edit vertices")){
             show_vertices_edit = true;
         }
@@ -0,0 +1,38 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include "bcg_gui_loading.h"
+#include "bcg_viewer_state.h"
+#include "bcg_opengl/systems/bcg_loading_system.h"
+#include "bcg_library/utils/bcg_path.h"
+
+namespace bcg {
+
+void gui_loading(viewer_state *state) {
+    if (!state->systems.has("loading_system")) return;
+    auto *loading = dynamic_cast<loading_system *>(state->systems["loading_system"].get());
+    if (!loading || loading->jobs.empty()) return;
+
+    ImGui::SetNextWindowPos({(float) state->window.widgets_width + 10, (float) state->gui.menu_height + 10});
+    ImGui::SetNextWindowBgAlpha(0.8f);
+    if (ImGui::Begin("loading", nullptr, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoMove |
+                                         ImGuiWindowFlags_NoSavedSettings)) {
+        for (const auto &job : loading->jobs) {
+            ImGui::PushID(job.get());
+            const char *label = job->state == loading_job::status::queued ? "queued" : "loading";
+            ImGui::Text("%s (%.1f MB): %s %.1f s", path_filename(job->filename).c_str(),
+                        job->file_size / double(1 << 20), label, job->timer.measure<MILLISECONDS>() / 1000.0);
+            ImGui::SameLine();
+            if (job->cancel) {
+                ImGui::Text("cancelled");
+            } else if (ImGui::Button("Cancel")) {
+                loading->cancel(*job);
+            }
+            ImGui::PopID();
+        }
+    }
+    ImGui::End();
+}
+
+}
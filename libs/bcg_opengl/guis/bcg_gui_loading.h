@@ -0,0 +1,17 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#ifndef BCG_GRAPHICS_BCG_GUI_LOADING_H
+#define BCG_GRAPHICS_BCG_GUI_LOADING_H
+
+namespace bcg {
+
+struct viewer_state;
+
+// overlay listing the files the loading_system is reading, with a cancel button each
+void gui_loading(viewer_state *state);
+
+}
+
+#endif //BCG_GRAPHICS_BCG_GUI_LOADING_H
@@ -16,10 +16,10 @@ void gui_mesh(viewer_state *state, halfedge_mesh *mesh){
     static bool show_edges_edit = false;
     static bool show_faces_edit = false;
     if (ImGui::CollapsingHeader("mesh properties")) {
-        gui_property_container_selector(state, &mesh->vertices, state->picker.vertex_id.idx);
-        gui_property_container_selector(state, &mesh->halfedges, state->picker.halfedge_id.idx);
-        gui_property_container_selector(state, &mesh->edges, state->picker.edge_id.idx);
-        gui_property_container_selector(state, &mesh->faces, state->picker.face_id.idx);
+        gui_property_container_selector(state, &mesh->vertices, state->picker.vertex_id);
+        gui_property_container_selector(state, &mesh->halfedges, state->picker.halfedge_id);
+        gui_property_container_selector(state, &mesh->edges, state->picker.edge_id);
+        gui_property_container_selector(state, &mesh->faces, state->picker.face_id);
         if(ImGui::Button("edit vertices")){
             show_vertices_edit = true;
         }
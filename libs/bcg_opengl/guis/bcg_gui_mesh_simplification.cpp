@@ -6,9 +6,19 @@
 #include "bcg_gui_reload_entity.h"
 #include "bcg_viewer_state.h"
 #include "renderers/mesh_renderer/bcg_material_mesh.h"
+#include "geometry/mesh/bcg_mesh_progressive.h"
 
 namespace bcg {
 
+static void update_gpu(viewer_state *state) {
+    auto &material = state->scene.get<material_mesh>(state->picker.entity_id);
+    state->dispatcher.trigger<event::gpu::update_vertex_attributes>(state->picker.entity_id, material.attributes);
+    auto edge_attributes = {attribute{"edges", "edges", "edges", 0, true}};
+    state->dispatcher.trigger<event::gpu::update_edge_attributes>(state->picker.entity_id, edge_attributes);
+    auto face_attributes = {attribute{"triangles", "triangles", "triangles", 0, true}};
+    state->dispatcher.trigger<event::gpu::update_face_attributes>(state->picker.entity_id, face_attributes);
+}
+
 void gui_mesh_simplification(viewer_state *state) {
     static int n_vertices;
     static bcg_scalar_t aspect_ratio = 0.0;
@@ -16,25 +26,31 @@ void gui_mesh_simplification(viewer_state *state) {
     static int max_valence = 0;
     static bcg_scalar_t normal_deviation = 0.0;
     static bcg_scalar_t hausdorff_error = 0.0;
+    static bool parallel = false;
+    static bool progressive = false;
     ImGui::InputInt("num vertices", &n_vertices);
     draw_input(&state->window, "aspect ratio", aspect_ratio);
     draw_input(&state->window, "edge length", edge_length);
     ImGui::InputInt("max valence", &max_valence);
     draw_input(&state->window, "normal deviation", normal_deviation);
     draw_input(&state->window, "hausdorff error", hausdorff_error);
+    ImGui::Checkbox("parallel", &parallel);
+    ImGui::Checkbox("progressive", &progressive);
     if (ImGui::Button("Compute")) {
         state->dispatcher.trigger<event::mesh::simplification>(state->picker.entity_id, (unsigned int) n_vertices,
                                                                aspect_ratio,
                                                                edge_length, (unsigned int) max_valence,
                                                                normal_deviation,
-                                                               hausdorff_error);
-
-        auto &material = state->scene.get<material_mesh>(state->picker.entity_id);
-        state->dispatcher.trigger<event::gpu::update_vertex_attributes>(state->picker.entity_id, material.attributes);
-        auto edge_attributes = {attribute{"edges", "edges", "edges", 0, true}};
-        state->dispatcher.trigger<event::gpu::update_edge_attributes>(state->picker.entity_id, edge_attributes);
-        auto face_attributes = {attribute{"triangles", "triangles", "triangles", 0, true}};
-        state->dispatcher.trigger<event::gpu::update_face_attributes>(state->picker.entity_id, face_attributes);
+                                                               hausdorff_error, parallel, progressive);
+        update_gpu(state);
+    }
+    if (state->scene.valid(state->picker.entity_id) && state->scene.has<progressive_mesh>(state->picker.entity_id)) {
+        auto &levels = state->scene.get<progressive_mesh>(state->picker.entity_id);
+        int level = (int) levels.num_vertices;
+        if (ImGui::SliderInt("level", &level, (int) levels.num_base_vertices, (int) levels.positions.size())) {
+            state->dispatcher.trigger<event::mesh::progressive_level>(state->picker.entity_id, (unsigned int) level);
+            update_gpu(state);
+        }
     }
     gui_reload_entity(state);
 }
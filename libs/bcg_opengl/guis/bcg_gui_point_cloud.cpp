@@ -13,7 +13,7 @@ void gui_point_cloud(viewer_state *state, point_cloud *pc){
     if (!pc) return;
     static bool show_vertices_edit = false;
     if (ImGui::CollapsingHeader("point_cloud properties")) {
-        gui_property_container_selector(state, &pc->vertices, state->picker.vertex_id.idx);
+        gui_property_container_selector(state, &pc->vertices, state->picker.vertex_id);
         if(ImGui::Button("edit vertices")){
             show_vertices_edit = true;
         }
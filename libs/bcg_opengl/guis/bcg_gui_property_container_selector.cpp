@@ -89,4 +89,10 @@ void gui_property_container_selector(viewer_state *state, property_container *co
     }
 }
 
+void gui_property_container_selector(viewer_state *state, property_container *container, base_handle &current_handle){
+    size_t current_entry = current_handle.idx;
+    gui_property_container_selector(state, container, current_entry);
+    current_handle = base_handle(current_entry);
+}
+
 }
\ No newline at end of file
@@ -13,6 +13,8 @@ struct viewer_state;
 
 void gui_property_container_selector(viewer_state *state, property_container *container, size_t &current_entry);
 
+void gui_property_container_selector(viewer_state *state, property_container *container, base_handle &current_handle);
+
 }
 
 #endif //BCG_GRAPHICS_BCG_GUI_PROPERTY_CONTAINER_SELECTOR_H
@@ -19,9 +19,8 @@ void edit_field(viewer_state *state, property_container *container, const std::s
     gui_property_selector(state, container, {}, "property", current_property_name);
 
     if (ImGui::Button("delete")) {
-        auto iter = container->container.find(current_property_name);
-        if(iter != container->container.end()) {
-            container->container.erase(iter);
+        if(container->has(current_property_name)) {
+            container->remove(current_property_name);
             current_property_name = "";
         }
     }
@@ -30,12 +29,7 @@ void edit_field(viewer_state *state, property_container *container, const std::s
     draw_textinput(&state->window, "name", new_name);
 
     if (ImGui::Button("rename")) {
-        auto iter = container->container.find(current_property_name);
-        if(iter != container->container.end()){
-            auto p = iter->second;
-            p->set_name(new_name);
-            container->container[new_name] = p;
-            container->container.erase(iter);
+        if(container->rename(current_property_name, new_name)){
             current_property_name = new_name;
         }
     }
@@ -48,7 +48,7 @@ void gui_sampling_octree(viewer_state *state) {
                     indices[i] = i;
                 }
                 auto prop = vertices->get<bcg_scalar_t, 1>(current_property_name);
-                std::vector<bcg_scalar_t> values = prop.vector();
+                std::vector<bcg_scalar_t> values(prop.begin(), prop.end());
                 if(absolute){
                     Map(values) = Map(prop.vector()).cwiseAbs();
                 }
@@ -55,10 +55,11 @@ void gpu_system::on_update_property(const event::gpu::update_property &event) {
         buffer->upload(colors[0].data(), base_ptr->size(), 3, 0, true);
     } else {
         if (base_ptr->void_ptr() != nullptr) {
-            if(base_ptr->type() == property_types::Type::DOUBLE || base_ptr->type() == property_types::Type::FLOAT){
-                Matrix<float, -1, -1> DATAF = Map<bcg_scalar_t>(base_ptr).transpose().cast<float>();
+            if(base_ptr->type() == property_types::Type::DOUBLE){
+                Matrix<float, -1, -1> DATAF = Map<double>(base_ptr).transpose().cast<float>();
                 buffer->upload((const void *) DATAF.data(), base_ptr->size(), base_ptr->dims(), 0, true);
             }else{
+                // float properties (all geometry in single precision builds) are uploaded without conversion
                 buffer->upload(base_ptr->void_ptr(), base_ptr->size(), base_ptr->dims(), 0, true);
             }
         } else {
@@ -103,15 +104,18 @@ void gpu_system::on_update_edge_attributes(const event::gpu::update_edge_attribu
                 if (state->scene.has<halfedge_mesh>(event.id)) {
                     auto &mesh = state->scene.get<halfedge_mesh>(event.id);
                     property = mesh.edges.get_or_add<VectorI<2>, 2>("edges");
-                    property.vector() = mesh.get_connectivity();
+                    auto connectivity = mesh.get_connectivity();
+                    property.vector().assign(connectivity.begin(), connectivity.end());
                 } else if (state->scene.has<halfedge_graph>(event.id)) {
                     auto &graph = state->scene.get<halfedge_graph>(event.id);
                     property = graph.edges.get_or_add<VectorI<2>, 2>("edges");
-                    property.vector() = graph.get_connectivity();
+                    auto connectivity = graph.get_connectivity();
+                    property.vector().assign(connectivity.begin(), connectivity.end());
                 } else if (state->scene.has<curve_bezier>(event.id)) {
                     auto &curve = state->scene.get<curve_bezier>(event.id);
                     property = curve.edges.get_or_add<VectorI<2>, 2>("edges");
-                    property.vector() = curve.get_connectivity();
+                    auto connectivity = curve.get_connectivity();
+                    property.vector().assign(connectivity.begin(), connectivity.end());
                 }
 
                 halfedges->get<halfedge_graph::halfedge_connectivity, 4>("h_connectivity").set_clean();
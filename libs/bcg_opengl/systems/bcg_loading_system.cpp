@@ -3,45 +3,156 @@
 //
 
 #include <iostream>
+#include <filesystem>
 
 #include "bcg_loading_system.h"
 #include "bcg_viewer_state.h"
 #include "bcg_library/geometry/mesh/bcg_meshio.h"
 #include "bcg_library/geometry/point_cloud/bcg_point_cloudio.h"
+#include "bcg_library/geometry/bcg_ply_io.h"
+#include "bcg_library/geometry/bcg_property_io.h"
+#include "bcg_library/utils/bcg_path.h"
+#include "bcg_library/utils/bcg_mapped_file.h"
 
 namespace bcg {
 
+namespace {
+
+enum class file_kind {
+    unknown, mesh, point_cloud
+};
+
+// from the extension, or the element counts in the header for formats holding both
+file_kind detect_file_kind(const std::string &filename) {
+    std::string ext = path_extension(filename);
+    if (ext == ".off" || ext == ".obj" || ext == ".stl" || ext == ".pmp" || ext == ".agi") {
+        return file_kind::mesh;
+    }
+    if (ext == ".xyz" || ext == ".pts" || ext == ".pwn" || ext == ".pb" || ext == ".csv" || ext == ".3d" ||
+        ext == ".txt") {
+        return file_kind::point_cloud;
+    }
+    if (ext == ".ply") {
+        mapped_file file(filename);
+        ply_header header;
+        if (!file || !parse_ply_header(file.begin(), file.end(), header)) {
+            return file_kind::unknown;
+        }
+        for (const auto &element : header.elements) {
+            if (element.name == "face" && element.count > 0) {
+                return file_kind::mesh;
+            }
+        }
+        return file_kind::point_cloud;
+    }
+    if (ext == ".bcg") {
+        std::vector<std::pair<std::string, size_t>> sizes;
+        if (!read_property_container_sizes(filename, sizes)) {
+            return file_kind::unknown;
+        }
+        for (const auto &item : sizes) {
+            if (item.first == "faces" && item.second > 0) {
+                return file_kind::mesh;
+            }
+        }
+        return file_kind::point_cloud;
+    }
+    return file_kind::unknown;
+}
+
+void load(loading_job &job) {
+    auto expected = loading_job::status::queued;
+    if (!job.state.compare_exchange_strong(expected, loading_job::status::loading)) {
+        return;
+    }
+    switch (detect_file_kind(job.filename)) {
+        case file_kind::mesh: {
+            auto mesh = std::make_unique<halfedge_mesh>();
+            if (meshio(job.filename, meshio_flags()).read(*mesh) && mesh->faces.size() > 0) {
+                job.mesh = std::move(mesh);
+            } else if (!mesh->empty()) {
+                // only vertices, shares their properties without copying
+                job.pc = std::make_unique<point_cloud>();
+                mesh->vertices.remove("v_connectivity");
+                *job.pc = *mesh;
+            }
+            break;
+        }
+        case file_kind::point_cloud: {
+            auto pc = std::make_unique<point_cloud>();
+            if (point_cloudio(job.filename, point_cloudio_flags()).read(*pc) && !pc->empty()) {
+                job.pc = std::move(pc);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    if (job.cancel) {
+        job.mesh.reset();
+        job.pc.reset();
+        job.state = loading_job::status::cancelled;
+    } else {
+        job.state = job.mesh || job.pc ? loading_job::status::done : loading_job::status::failed;
+    }
+}
+
+}
+
 loading_system::loading_system(viewer_state *state) : system("loading_system", state){
     state->dispatcher.sink<event::internal::file_drop>().connect<&loading_system::on_file_drop>(this);
+    state->dispatcher.sink<event::internal::update>().connect<&loading_system::on_update>(this);
+}
+
+loading_system::~loading_system() {
+    for (auto &job : jobs) {
+        cancel(*job);
+    }
+    workers.wait();
 }
 
 void loading_system::on_file_drop(const event::internal::file_drop &event){
     for(const auto &filename : event.filenames){
-        meshio mesh_io(filename, meshio_flags());
-        halfedge_mesh mesh;
-        mesh_io.read(mesh);
-
-        if(mesh.empty() || mesh.edges.size() == 0 || mesh.faces.size() == 0){
-            point_cloudio point_cloud_io(filename, point_cloudio_flags());
-            point_cloud pc;
-            point_cloud_io.read(pc);
-            if(pc.empty()){
-                std::cout << "failed to read " << filename << ". Format unknown.\n";
-                return;
-            }else{
-                auto id = state->scene.create();
-                state->scene.emplace<point_cloud>(id, pc);
-                std::cout << "read successful " << filename << "\n";
-                state->dispatcher.trigger<event::point_cloud::setup>(id, filename);
-            }
-        }else{
+        auto job = std::make_shared<loading_job>();
+        job->filename = filename;
+        std::error_code error;
+        job->file_size = std::filesystem::file_size(filename, error);
+        jobs.push_back(job);
+        workers.run([job]() { load(*job); });
+    }
+}
+
+void loading_system::on_update(const event::internal::update &){
+    for (auto iter = jobs.begin(); iter != jobs.end();) {
+        auto &job = **iter;
+        auto status = job.state.load();
+        if (status == loading_job::status::queued || status == loading_job::status::loading) {
+            ++iter;
+            continue;
+        }
+        if (status == loading_job::status::done && !job.cancel) {
             auto id = state->scene.create();
-            state->scene.emplace<halfedge_mesh>(id, mesh);
-            std::cout << "read successful " << filename << "\n";
-            state->dispatcher.trigger<event::mesh::setup>(id, filename);
+            if (job.mesh) {
+                state->scene.emplace<halfedge_mesh>(id, std::move(*job.mesh));
+                state->dispatcher.trigger<event::mesh::setup>(id, job.filename);
+            } else {
+                state->scene.emplace<point_cloud>(id, std::move(*job.pc));
+                state->dispatcher.trigger<event::point_cloud::setup>(id, job.filename);
+            }
+            std::cout << "read successful " << job.filename << ", " << job.timer.pretty_report() << "\n";
+        } else if (status == loading_job::status::failed) {
+            std::cout << "failed to read " << job.filename << ". Format unknown.\n";
+        } else {
+            std::cout << "cancelled reading " << job.filename << "\n";
         }
-
+        iter = jobs.erase(iter);
     }
 }
 
-}
\ No newline at end of file
+void loading_system::cancel(loading_job &job) {
+    job.cancel = true;
+    auto expected = loading_job::status::queued;
+    job.state.compare_exchange_strong(expected, loading_job::status::cancelled);
+}
+
+}
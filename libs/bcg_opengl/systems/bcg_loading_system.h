@@ -5,14 +5,52 @@
 #ifndef BCG_GRAPHICS_BCG_LOADING_SYSTEM_H
 #define BCG_GRAPHICS_BCG_LOADING_SYSTEM_H
 
+#include <atomic>
+#include <memory>
+#include <vector>
 #include "bcg_systems.h"
+#include "bcg_library/geometry/mesh/bcg_mesh.h"
+#include "bcg_library/utils/bcg_timer.h"
+#include "tbb/task_group.h"
 
 namespace bcg {
 
+struct loading_job {
+    enum class status {
+        queued, loading, done, failed, cancelled
+    };
+
+    std::string filename;
+    size_t file_size = 0;
+    std::atomic<status> state{status::queued};
+    std::atomic<bool> cancel{false};
+    Timer timer;                              // started when the file was dropped
+
+    // written by the worker, moved into the scene on the main thread once state is done
+    std::unique_ptr<halfedge_mesh> mesh;
+    std::unique_ptr<point_cloud> pc;
+};
+
+// Dropped files are read on worker threads, several at once. The format is detected once from the extension and, for
+// .ply and .bcg files, from the header. Finished objects are moved into the scene in on_update, on the main thread.
 struct loading_system : public system {
     explicit loading_system(viewer_state *state);
 
+    // waits for running readers, their results are dropped
+    ~loading_system() override;
+
     void on_file_drop(const event::internal::file_drop &event);
+
+    void on_update(const event::internal::update &event);
+
+    // a queued job does not start, a running one is dropped when its reader returns
+    void cancel(loading_job &job);
+
+    // jobs not yet moved into the scene
+    std::vector<std::shared_ptr<loading_job>> jobs;
+
+private:
+    tbb::task_group workers;
 };
 
 }
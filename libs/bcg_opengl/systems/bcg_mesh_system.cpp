@@ -49,6 +49,7 @@ mesh_system::mesh_system(viewer_state *state) : system("mesh_system", state) {
     state->dispatcher.sink<event::mesh::laplacian::build>().connect<&mesh_system::on_build_laplacian>(this);
     state->dispatcher.sink<event::mesh::curvature::taubin>().connect<&mesh_system::on_curvature_taubin>(this);
     state->dispatcher.sink<event::mesh::simplification>().connect<&mesh_system::on_simplification>(this);
+    state->dispatcher.sink<event::mesh::progressive_level>().connect<&mesh_system::on_progressive_level>(this);
     state->dispatcher.sink<event::mesh::remeshing::uniform>().connect<&mesh_system::on_remeshing_uniform>(this);
     state->dispatcher.sink<event::mesh::remeshing::adaptive>().connect<&mesh_system::on_remeshing_adaptive>(this);
     state->dispatcher.sink<event::mesh::statistics>().connect<&mesh_system::on_statistics>(this);
@@ -163,6 +164,7 @@ void mesh_system::on_subdivision_catmull_clark(const event::mesh::subdivision::c
 
     auto &mesh = state->scene.get<halfedge_mesh>(event.id);
     mesh_subdivision_catmull_clark(mesh, state->config.parallel_grain_size);
+    state->scene.remove_if_exists<progressive_mesh>(event.id);
     state->dispatcher.trigger<event::mesh::vertex_normals::area_angle>(event.id);
     state->dispatcher.trigger<event::spatial_index::update_indices>(event.id);
 }
@@ -173,6 +175,7 @@ void mesh_system::on_subdivision_loop(const event::mesh::subdivision::loop &even
 
     auto &mesh = state->scene.get<halfedge_mesh>(event.id);
     mesh_subdivision_loop(mesh, state->config.parallel_grain_size);
+    state->scene.remove_if_exists<progressive_mesh>(event.id);
     state->dispatcher.trigger<event::mesh::vertex_normals::area_angle>(event.id);
     state->dispatcher.trigger<event::spatial_index::update_indices>(event.id);
 }
@@ -183,6 +186,7 @@ void mesh_system::on_subdivision_sqrt3(const event::mesh::subdivision::sqrt3 &ev
 
     auto &mesh = state->scene.get<halfedge_mesh>(event.id);
     mesh_subdivision_sqrt3(mesh, state->config.parallel_grain_size);
+    state->scene.remove_if_exists<progressive_mesh>(event.id);
     state->dispatcher.trigger<event::mesh::vertex_normals::area_angle>(event.id);
     state->dispatcher.trigger<event::spatial_index::update_indices>(event.id);
 }
@@ -234,11 +238,49 @@ void mesh_system::on_simplification(const event::mesh::simplification &event) {
     if (!state->scene.has<halfedge_mesh>(event.id)) return;
 
     auto &mesh = state->scene.get<halfedge_mesh>(event.id);
-    mesh_simplification(mesh, event.n_vertices, event.aspect_ratio,
-                        event.edge_length,
-                        event.max_valence,
-                        event.normal_deviation,
-                        event.hausdorff_error);
+    progressive_mesh progressive;
+    if (event.parallel) {
+        mesh_simplification_parallel(mesh, event.n_vertices, event.aspect_ratio,
+                                     event.edge_length,
+                                     event.max_valence,
+                                     event.normal_deviation,
+                                     event.hausdorff_error,
+                                     state->config.parallel_grain_size,
+                                     event.progressive ? &progressive : nullptr);
+    } else {
+        mesh_simplification(mesh, event.n_vertices, event.aspect_ratio,
+                            event.edge_length,
+                            event.max_valence,
+                            event.normal_deviation,
+                            event.hausdorff_error,
+                            event.progressive ? &progressive : nullptr);
+    }
+    if (event.progressive) {
+        state->scene.emplace_or_replace<progressive_mesh>(event.id, std::move(progressive));
+    } else {
+        // the recorded collapses no longer match the mesh
+        state->scene.remove_if_exists<progressive_mesh>(event.id);
+    }
+    state->dispatcher.trigger<event::mesh::vertex_normals::area_angle>(event.id);
+    state->dispatcher.trigger<event::spatial_index::update_indices>(event.id);
+}
+
+void mesh_system::on_progressive_level(const event::mesh::progressive_level &event) {
+    if (!state->scene.valid(event.id)) return;
+    if (!state->scene.has<halfedge_mesh>(event.id)) return;
+    if (!state->scene.has<progressive_mesh>(event.id)) return;
+
+    auto &mesh = state->scene.get<halfedge_mesh>(event.id);
+    auto &progressive = state->scene.get<progressive_mesh>(event.id);
+    progressive.set_num_vertices(event.n_vertices);
+    progressive.extract(mesh);
+
+    auto lines = mesh.edges.get_or_add<VectorI<2>, 2>("edges");
+    lines.set(mesh.get_connectivity());
+    auto triangles = mesh.edges.get_or_add<VectorI<3>, 3>("triangles");
+    triangles = mesh.get_triangles();
+    triangles.set_dirty();
+
     state->dispatcher.trigger<event::mesh::vertex_normals::area_angle>(event.id);
     state->dispatcher.trigger<event::spatial_index::update_indices>(event.id);
 }
@@ -248,7 +290,9 @@ void mesh_system::on_remeshing_uniform(const event::mesh::remeshing::uniform &ev
     if (!state->scene.has<halfedge_mesh>(event.id)) return;
 
     auto &mesh = state->scene.get<halfedge_mesh>(event.id);
-    mesh_remeshing_uniform(mesh, event.edge_length, event.iterations, event.use_projection);
+    mesh_remeshing_uniform(mesh, event.edge_length, event.iterations, event.use_projection,
+                           state->config.parallel_grain_size);
+    state->scene.remove_if_exists<progressive_mesh>(event.id);
 
     state->dispatcher.trigger<event::mesh::vertex_normals::area_angle>(event.id);
     state->dispatcher.trigger<event::spatial_index::update_indices>(event.id);
@@ -260,7 +304,8 @@ void mesh_system::on_remeshing_adaptive(const event::mesh::remeshing::adaptive &
 
     auto &mesh = state->scene.get<halfedge_mesh>(event.id);
     mesh_remeshing_adaptive(mesh, event.min_edge_length, event.max_edge_length, event.approx_error, event.iterations,
-                            event.use_projection);
+                            event.use_projection, state->config.parallel_grain_size);
+    state->scene.remove_if_exists<progressive_mesh>(event.id);
 
     state->dispatcher.trigger<event::mesh::vertex_normals::area_angle>(event.id);
     state->dispatcher.trigger<event::spatial_index::update_indices>(event.id);
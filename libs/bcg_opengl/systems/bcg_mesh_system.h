@@ -48,6 +48,8 @@ struct mesh_system : public system {
 
     void on_simplification(const event::mesh::simplification &event);
 
+    void on_progressive_level(const event::mesh::progressive_level &event);
+
     void on_remeshing_uniform(const event::mesh::remeshing::uniform &event);
 
     void on_remeshing_adaptive(const event::mesh::remeshing::adaptive &event);
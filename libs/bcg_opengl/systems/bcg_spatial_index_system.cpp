@@ -55,7 +55,12 @@ void spatial_index_system::on_update_indices(const event::spatial_index::update_
     auto positions = vertices->get<VectorS<3>, 3>("v_position");
     if (state->scene.has<kdtree_property<bcg_scalar_t>>(event.id)) {
         auto &index = state->scene.get<kdtree_property<bcg_scalar_t>>(event.id);
-        index.build(positions, index.leaf_size);
+        if (index.dataset->positions.shared_ptr() != positions.shared_ptr()) {
+            // the positions were replaced (e.g. by reading a file), the tree still refers to the old property
+            index.build(positions, index.leaf_size);
+        } else {
+            index.update();
+        }
     }
     if (state->scene.has<octree>(event.id)) {
         auto &index = state->scene.get<octree>(event.id);
@@ -0,0 +1,104 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <gtest/gtest.h>
+
+#include "bcg_library/utils/bcg_bit_vector.h"
+#include "bcg_library/geometry/point_cloud/bcg_point_cloud.h"
+
+using namespace bcg;
+
+TEST(TestSuiteBitVector, constructor) {
+    BitVector bits;
+    EXPECT_EQ(bits.size(), 0);
+    EXPECT_TRUE(bits.empty());
+    EXPECT_FALSE(bits.maybe_any());
+
+    BitVector ones(130, true);
+    EXPECT_EQ(ones.size(), 130);
+    EXPECT_EQ(ones.num_words(), 3);
+    EXPECT_EQ(ones.count(), 130);
+
+    BitVector from_vector(std::vector<bool>{true, false, true});
+    EXPECT_EQ(from_vector.size(), 3);
+    EXPECT_TRUE(from_vector[0]);
+    EXPECT_FALSE(from_vector[1]);
+    EXPECT_TRUE(from_vector[2]);
+}
+
+TEST(TestSuiteBitVector, move) {
+    BitVector bits(130);
+    bits[129] = true;
+    const auto *words = bits.data();
+
+    BitVector moved(std::move(bits));
+    EXPECT_EQ(moved.data(), words);
+    EXPECT_EQ(moved.size(), 130);
+    EXPECT_TRUE(moved[129]);
+    EXPECT_TRUE(moved.maybe_any());
+    EXPECT_EQ(bits.size(), 0);
+    EXPECT_FALSE(bits.maybe_any());
+
+    BitVector assigned;
+    assigned = std::move(moved);
+    EXPECT_EQ(assigned.data(), words);
+    EXPECT_EQ(assigned.count(), 1);
+    EXPECT_EQ(moved.size(), 0);
+}
+
+TEST(TestSuiteBitVector, set_reset) {
+    BitVector bits(100);
+    bits[3] = true;
+    bits[64] = true;
+    EXPECT_TRUE(bits.maybe_any());
+    EXPECT_EQ(bits.count(), 2);
+    bits[3] = false;
+    EXPECT_FALSE(bits[3]);
+    EXPECT_EQ(bits.count(), 1);
+
+    bits.resize(64);
+    EXPECT_EQ(bits.count(), 0);
+    EXPECT_FALSE(bits.maybe_any());
+    bits.resize(100);
+    EXPECT_FALSE(bits[64]);
+}
+
+TEST(TestSuiteBitVector, find_next) {
+    BitVector bits(200, true);
+    bits[150] = false;
+    EXPECT_EQ(bits.find_next_unset(0), 150);
+    EXPECT_EQ(bits.find_next_unset(151), 200);
+    EXPECT_EQ(bits.find_next_set(150), 151);
+
+    BitVector zeros(200);
+    zeros[199] = true;
+    EXPECT_EQ(zeros.find_next_set(0), 199);
+    EXPECT_EQ(zeros.find_next_unset(199), 200);
+}
+
+TEST(TestSuiteBitVector, deleted_iteration) {
+    point_cloud pc;
+    for (size_t i = 0; i < 300; ++i) {
+        pc.add_vertex(VectorS<3>::Constant(i));
+    }
+    for (size_t i = 0; i < 300; ++i) {
+        if (i < 70 || (i > 100 && i % 3 == 0)) {
+            pc.delete_vertex(vertex_handle(i));
+        }
+    }
+    size_t count = 0;
+    for (const auto v : pc.vertices) {
+        EXPECT_FALSE(pc.vertices_deleted[v]);
+        ++count;
+    }
+    EXPECT_EQ(count, pc.num_vertices());
+
+    pc.garbage_collection();
+    EXPECT_FALSE(pc.vertices_deleted.vector().maybe_any());
+    count = 0;
+    for (const auto v : pc.vertices) {
+        ++count;
+    }
+    EXPECT_EQ(count, pc.num_vertices());
+}
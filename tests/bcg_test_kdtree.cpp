@@ -0,0 +1,165 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <gtest/gtest.h>
+#include <algorithm>
+
+#include "geometry/point_cloud/bcg_point_cloud.h"
+#include "geometry/kdtree/bcg_kdtree.h"
+#include "geometry/kdtree/bcg_neighbors_cache.h"
+
+using namespace bcg;
+
+class TestKdtreeFixture : public ::testing::Test {
+public:
+    TestKdtreeFixture() {
+        for (int i = 0; i < 10; ++i) {
+            for (int j = 0; j < 10; ++j) {
+                for (int k = 0; k < 10; ++k) {
+                    pc.add_vertex(VectorS<3>(i, j, k + 0.01 * i));
+                }
+            }
+        }
+        kdtree.build(pc.positions);
+    }
+
+    point_cloud pc;
+    kdtree_property<bcg_scalar_t> kdtree;
+};
+
+TEST_F(TestKdtreeFixture, knn_batch) {
+    neighbors_batch batch;
+    kdtree.query_knn_batch(pc.positions, 7, batch, 64);
+    EXPECT_EQ(batch.size(), pc.vertices.size());
+    EXPECT_EQ(batch.offsets.back(), 7 * pc.vertices.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        auto result = kdtree.query_knn(pc.positions[i], 7);
+        auto neighbors = batch[i];
+        ASSERT_EQ(neighbors.size, result.indices.size());
+        EXPECT_EQ(neighbors.indices[0], i);
+        for (size_t j = 0; j < neighbors.size; ++j) {
+            EXPECT_EQ(neighbors.indices[j], result.indices[j]);
+            EXPECT_EQ(neighbors.distances[j], result.distances[j]);
+        }
+    }
+}
+
+TEST_F(TestKdtreeFixture, knn_batch_more_than_points) {
+    point_cloud small;
+    small.add_vertex(VectorS<3>(0, 0, 0));
+    small.add_vertex(VectorS<3>(1, 0, 0));
+    kdtree_property<bcg_scalar_t> small_kdtree(small.positions);
+    neighbors_batch batch;
+    small_kdtree.query_knn_batch(small.positions, 5, batch);
+    EXPECT_EQ(batch.size(), 2);
+    EXPECT_EQ(batch.num_neighbors(0), 2);
+    EXPECT_EQ(batch[1].indices[0], 1);
+}
+
+TEST_F(TestKdtreeFixture, radius_batch) {
+    neighbors_batch batch;
+    kdtree.query_radius_batch(pc.positions, 1.5, batch, 37);
+    EXPECT_EQ(batch.size(), pc.vertices.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        auto result = kdtree.query_radius(pc.positions[i], 1.5);
+        auto neighbors = batch[i];
+        ASSERT_EQ(neighbors.size, result.indices.size());
+        std::vector<bcg_index_t> expected(result.indices), indices(neighbors.indices, neighbors.indices + neighbors.size);
+        std::sort(expected.begin(), expected.end());
+        std::sort(indices.begin(), indices.end());
+        EXPECT_EQ(indices, expected);
+    }
+}
+
+TEST_F(TestKdtreeFixture, float_index) {
+    kdtree_property<float> float_kdtree(pc.positions);
+    neighbors_batch batch;
+    float_kdtree.query_knn_batch(pc.positions, 4, batch);
+    for (size_t i = 0; i < batch.size(); ++i) {
+        auto result = kdtree.query_knn(pc.positions[i], 4);
+        EXPECT_EQ(batch[i].indices[0], result.indices[0]);
+        EXPECT_NEAR(batch[i].distances[3], result.distances[3], 1e-4);
+    }
+    auto result = float_kdtree.query_radius(pc.positions[0], 1.1);
+    EXPECT_EQ(result.indices.size(), 4);
+}
+
+TEST_F(TestKdtreeFixture, neighbors_cache) {
+    auto knn = vertex_neighbors_knn(&pc.vertices, kdtree, 5);
+    EXPECT_EQ(knn->size(), pc.vertices.size());
+    EXPECT_EQ(vertex_neighbors_knn(&pc.vertices, kdtree, 5), knn);
+    EXPECT_NE(vertex_neighbors_knn(&pc.vertices, kdtree, 6), knn);
+    auto radius = vertex_neighbors_radius(&pc.vertices, kdtree, 1.1);
+    EXPECT_EQ(vertex_neighbors_radius(&pc.vertices, kdtree, 1.1), radius);
+
+    knn = vertex_neighbors_knn(&pc.vertices, kdtree, 5);
+    pc.positions.set_clean();
+    EXPECT_EQ(vertex_neighbors_knn(&pc.vertices, kdtree, 5), knn);
+    pc.positions[0] = VectorS<3>(-1, -1, -1);
+    pc.positions.set_dirty();
+    pc.positions.set_clean();
+    kdtree.build(pc.positions);
+    auto updated = vertex_neighbors_knn(&pc.vertices, kdtree, 5);
+    EXPECT_NE(updated, knn);
+    EXPECT_NEAR((*updated)[0].distances[1], 6, 1e-4);
+    EXPECT_NE(vertex_neighbors_radius(&pc.vertices, kdtree, 1.1), radius);
+}
+
+namespace {
+// brute force reference for the squared distance to the k-th closest valid point
+bcg_scalar_t kth_distance(const point_cloud &pc, const VectorS<3> &query, size_t k, const std::vector<bool> &skip = {}) {
+    std::vector<bcg_scalar_t> distances;
+    for (size_t i = 0; i < pc.positions.size(); ++i) {
+        if (i < skip.size() && skip[i]) continue;
+        distances.push_back((pc.positions[i] - query).squaredNorm());
+    }
+    std::nth_element(distances.begin(), distances.begin() + k - 1, distances.end());
+    return distances[k - 1];
+}
+}
+
+TEST_F(TestKdtreeFixture, parallel_build) {
+    using index_t = kdtree_property<bcg_scalar_t>::index_t;
+    index_t index(*kdtree.dataset, 4, 64);
+    index.build();
+    EXPECT_EQ(index.num_points(), pc.vertices.size());
+    for (size_t i = 0; i < pc.vertices.size(); i += 7) {
+        VectorS<3> query = pc.positions[i] + VectorS<3>(0.3, -0.2, 0.1);
+        auto result = kdtree_query_knn<bcg_scalar_t>(index, query, 9);
+        EXPECT_NEAR(result.distances[8], kth_distance(pc, query, 9), 1e-5);
+    }
+}
+
+TEST_F(TestKdtreeFixture, refit_insert_remove) {
+    for (size_t i = 0; i < pc.vertices.size(); ++i) {
+        pc.positions[i] = pc.positions[i] * 1.5 + VectorS<3>(0.2 * (i % 3), 0, -0.1 * (i % 5));
+    }
+    for (int i = 0; i < 30; ++i) {
+        pc.add_vertex(VectorS<3>(i * 0.3, 4.5, 4.5 - i * 0.1));
+    }
+    kdtree.update();
+    EXPECT_EQ(kdtree.index->size(), pc.vertices.size());
+    EXPECT_EQ(kdtree.index->size_at_build(), 1000);
+
+    std::vector<bool> skip(pc.vertices.size(), false);
+    for (size_t i = 0; i < pc.vertices.size(); i += 11) {
+        kdtree.remove(i);
+        skip[i] = true;
+    }
+    for (size_t i = 0; i < pc.vertices.size(); i += 3) {
+        VectorS<3> query = pc.positions[i] + VectorS<3>(0.1, 0.1, 0.1);
+        auto result = kdtree.query_knn(query, 5);
+        EXPECT_NEAR(result.distances[4], kth_distance(pc, query, 5, skip), 1e-5);
+        for (const auto idx : result.indices) {
+            EXPECT_FALSE(skip[idx]);
+        }
+    }
+
+    for (int i = 0; i < 600; ++i) {
+        pc.add_vertex(VectorS<3>(i * 0.01, -1, 0));
+    }
+    kdtree.update();
+    EXPECT_EQ(kdtree.index->size_at_build(), pc.vertices.size());
+    EXPECT_EQ(kdtree.index->num_points(), pc.vertices.size());
+}
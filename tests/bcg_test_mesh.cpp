@@ -7,6 +7,8 @@
 #include "geometry/mesh/bcg_mesh.h"
 #include "geometry/mesh/bcg_meshio.h"
 #include "geometry/mesh/bcg_mesh_factory.h"
+#include "geometry/distance_query/bcg_distance_triangle_point.h"
+#include "geometry/distance_query/bcg_distance_segment_point.h"
 
 using namespace bcg;
 
@@ -145,6 +147,18 @@ TEST_F(HalfedgeMeshTest, copy) {
     EXPECT_EQ(m2.num_faces(), size_t(1));
 }
 
+TEST_F(HalfedgeMeshTest, move) {
+    add_triangle();
+    auto *positions = mesh.positions.vector().data();
+
+    halfedge_mesh m2 = std::move(mesh);
+    EXPECT_EQ(m2.positions.vector().data(), positions);
+    EXPECT_EQ(m2.num_faces(), size_t(1));
+    m2.add_vertex(VectorS<3>(1, 1, 0));
+    EXPECT_EQ(m2.vertices.size(), size_t(4));
+    EXPECT_EQ(m2.positions.size(), size_t(4));
+}
+
 TEST_F(HalfedgeMeshTest, assignment) {
     auto v0 = mesh.add_vertex(VectorS<3>(0, 0, 0));
     auto v1 = mesh.add_vertex(VectorS<3>(1, 0, 0));
@@ -390,4 +404,241 @@ TEST_F(HalfedgeMeshTest, edge_length) {
     }
     sum /= (float) mesh.num_edges();
     EXPECT_FLOAT_EQ(sum, float(1));
-}
\ No newline at end of file
+}
+TEST_F(HalfedgeMeshTest, find_closest_face) {
+    for (int i = 0; i < 200; ++i) {
+        VectorS<3> center = VectorS<3>::Random();
+        mesh.add_triangle(mesh.add_vertex(center + VectorS<3>::Random() * 0.1),
+                          mesh.add_vertex(center + VectorS<3>::Random() * 0.1),
+                          mesh.add_vertex(center + VectorS<3>::Random() * 0.1));
+    }
+    auto face_distance = [&](face_handle f, const VectorS<3> &point) {
+        std::vector<VectorS<3>> corners;
+        for (const auto v : mesh.get_vertices(f)) {
+            corners.push_back(mesh.positions[v]);
+        }
+        return distance_point3_triangle3()(point, triangle3(corners[0], corners[1], corners[2])).sqr_distance;
+    };
+    auto edge_distance = [&](edge_handle e, const VectorS<3> &point) {
+        segment3 seg(mesh.positions[mesh.get_vertex(e, 0)], mesh.positions[mesh.get_vertex(e, 1)]);
+        return distance_point3_segment3()(point, seg).sqr_distance;
+    };
+    auto check = [&]() {
+        for (int i = 0; i < 20; ++i) {
+            VectorS<3> point = VectorS<3>::Random();
+            std::vector<bcg_scalar_t> expected;
+            for (const auto f : mesh.faces) {
+                expected.push_back(face_distance(f, point));
+            }
+            std::sort(expected.begin(), expected.end());
+            auto result = mesh.find_closest_k_face(point, 4);
+            ASSERT_EQ(result.size(), 4);
+            for (size_t j = 0; j < result.size(); ++j) {
+                EXPECT_FALSE(mesh.faces_deleted[result[j]]);
+                EXPECT_NEAR(face_distance(result[j], point), expected[j], 1e-5);
+            }
+            EXPECT_NEAR(face_distance(mesh.find_closest_face(point), point), expected[0], 1e-5);
+            auto radius = mesh.find_closest_faces(point, std::sqrt(expected[1]) + 1e-4);
+            EXPECT_EQ(radius.size(), 2);
+
+            expected.clear();
+            for (const auto e : mesh.edges) {
+                expected.push_back(edge_distance(e, point));
+            }
+            std::sort(expected.begin(), expected.end());
+            auto edges = mesh.find_closest_k_edges(point, 4);
+            ASSERT_EQ(edges.size(), 4);
+            for (size_t j = 0; j < edges.size(); ++j) {
+                EXPECT_NEAR(edge_distance(edges[j], point), expected[j], 1e-5);
+            }
+            EXPECT_NEAR(edge_distance(mesh.find_closest_edge(point), point), expected[0], 1e-5);
+        }
+    };
+    check();
+
+    for (size_t i = 0; i < 60; ++i) {
+        mesh.positions[i] = VectorS<3>::Random() * 2;
+    }
+    mesh.positions.set_dirty();
+    check();
+
+    for (size_t i = 0; i < 200; i += 4) {
+        mesh.delete_face(face_handle(i));
+    }
+    check();
+
+    std::vector<VectorS<3>> points = {VectorS<3>::Zero(), VectorS<3>::Ones()};
+    auto faces = mesh.find_closest_face_batch(points);
+    auto edges = mesh.find_closest_edge_batch(points);
+    for (size_t i = 0; i < points.size(); ++i) {
+        EXPECT_EQ(faces[i], mesh.find_closest_face(points[i]));
+        EXPECT_EQ(edges[i], mesh.find_closest_edge(points[i]));
+    }
+}
+
+TEST_F(HalfedgeMeshTest, find_closest_face_after_flip) {
+    EXPECT_TRUE(read(test_data_path + "pmp-data/off/icosahedron_subdiv.off"));
+    auto face_distance = [&](face_handle f, const VectorS<3> &point) {
+        std::vector<VectorS<3>> corners;
+        for (const auto v : mesh.get_vertices(f)) {
+            corners.push_back(mesh.positions[v]);
+        }
+        return distance_point3_triangle3()(point, triangle3(corners[0], corners[1], corners[2])).sqr_distance;
+    };
+    auto edge_distance = [&](edge_handle e, const VectorS<3> &point) {
+        segment3 seg(mesh.positions[mesh.get_vertex(e, 0)], mesh.positions[mesh.get_vertex(e, 1)]);
+        return distance_point3_segment3()(point, seg).sqr_distance;
+    };
+    std::vector<VectorS<3>> points;
+    for (int i = 0; i < 100; ++i) {
+        points.emplace_back(VectorS<3>::Random() * 1.2);
+    }
+    auto check = [&]() {
+        for (const auto &point : points) {
+            auto closest_face = std::numeric_limits<bcg_scalar_t>::max();
+            for (const auto f : mesh.faces) {
+                closest_face = std::min(closest_face, face_distance(f, point));
+            }
+            EXPECT_NEAR(face_distance(mesh.find_closest_face(point), point), closest_face, 1e-5);
+
+            auto closest_edge = std::numeric_limits<bcg_scalar_t>::max();
+            for (const auto e : mesh.edges) {
+                closest_edge = std::min(closest_edge, edge_distance(e, point));
+            }
+            EXPECT_NEAR(edge_distance(mesh.find_closest_edge(point), point), closest_edge, 1e-5);
+        }
+    };
+    check();
+
+    // flips keep the element counts, only the versions of the connectivity tell the indices to rebuild
+    size_t num_flips = 0;
+    for (const auto e : mesh.edges) {
+        if (e.idx % 3 == 0 && mesh.is_flip_ok(e)) {
+            mesh.flip(e);
+            ++num_flips;
+        }
+    }
+    EXPECT_GT(num_flips, size_t(0));
+    check();
+}
+
+static void expect_valid_connectivity(const halfedge_mesh &mesh) {
+    for (const auto h : mesh.halfedges) {
+        EXPECT_EQ(mesh.get_prev(mesh.get_next(h)), h);
+        EXPECT_EQ(mesh.get_next(mesh.get_prev(h)), h);
+        EXPECT_EQ(mesh.get_to_vertex(mesh.get_opposite(h)), mesh.get_to_vertex(mesh.get_prev(h)));
+        EXPECT_EQ(mesh.get_face(mesh.get_next(h)), mesh.get_face(h));
+    }
+    for (const auto f : mesh.faces) {
+        EXPECT_EQ(mesh.get_face(mesh.get_halfedge(f)), f);
+    }
+    for (const auto v : mesh.vertices) {
+        if (mesh.is_isolated(v)) continue;
+        EXPECT_EQ(mesh.get_from_vertex(mesh.halfedge_graph::get_halfedge(v)), v);
+        bool boundary = false;
+        for (const auto h : mesh.halfedge_graph::get_halfedges(v)) {
+            boundary |= mesh.is_boundary(h);
+        }
+        EXPECT_EQ(mesh.is_boundary(mesh.halfedge_graph::get_halfedge(v)), boundary);
+    }
+}
+
+static void expect_faces(const halfedge_mesh &mesh, const std::vector<face_handle> &faces,
+                         const std::vector<bcg_index_t> &indices) {
+    for (size_t i = 0; i < faces.size(); ++i) {
+        if (!faces[i].is_valid()) continue;
+        std::vector<bcg_index_t> corners;
+        for (const auto v : mesh.get_vertices(faces[i])) {
+            corners.push_back(v.idx);
+        }
+        EXPECT_EQ(corners, std::vector<bcg_index_t>(indices.begin() + 3 * i, indices.begin() + 3 * i + 3));
+    }
+}
+
+TEST_F(HalfedgeMeshTest, build_from_faces) {
+    mesh_factory factory;
+    for (auto reference : {factory.make_icosahedron(), factory.make_grid(7, 5)}) {
+        std::vector<bcg_index_t> indices;
+        for (const auto f : reference.faces) {
+            for (const auto v : reference.get_vertices(f)) {
+                indices.push_back(v.idx);
+            }
+        }
+        halfedge_mesh built;
+        std::vector<VectorS<3>> points(reference.positions.vector().begin(), reference.positions.vector().end());
+        auto faces = built.build_from_faces(points, indices);
+        ASSERT_EQ(faces.size(), reference.num_faces());
+        EXPECT_EQ(built.num_vertices(), reference.num_vertices());
+        EXPECT_EQ(built.num_edges(), reference.num_edges());
+        EXPECT_EQ(built.num_faces(), reference.num_faces());
+        for (const auto v : reference.vertices) {
+            EXPECT_EQ(built.halfedge_graph::get_valence(v), reference.halfedge_graph::get_valence(v));
+            EXPECT_EQ(built.is_boundary(v), reference.is_boundary(v));
+        }
+        for (size_t i = 0; i < faces.size(); ++i) {
+            EXPECT_EQ(faces[i], face_handle(i));
+        }
+        expect_valid_connectivity(built);
+        expect_faces(built, faces, indices);
+    }
+}
+
+TEST_F(HalfedgeMeshTest, build_from_polygonal_faces) {
+    std::vector<VectorS<3>> points(6, VectorS<3>::Zero());
+    std::vector<bcg_index_t> indices = {0, 1, 4, 3, 1, 2, 5, 4};
+    auto faces = mesh.build_from_faces(points, indices, {0, 4, 8});
+    EXPECT_EQ(mesh.num_faces(), 2);
+    EXPECT_EQ(mesh.num_edges(), 7);
+    EXPECT_EQ(mesh.get_valence(faces[0]), 4);
+    expect_valid_connectivity(mesh);
+}
+
+TEST_F(HalfedgeMeshTest, build_from_faces_skips_invalid_faces) {
+    std::vector<VectorS<3>> points(8, VectorS<3>::Zero());
+    // a third face at edge 0-1, a flipped face at edge 1-2, a degenerate face and an index out of range
+    std::vector<bcg_index_t> indices = {0, 1, 2, 1, 0, 3, 0, 1, 4, 1, 2, 5, 0, 0, 3, 0, 2, 9};
+    auto faces = mesh.build_from_faces(points, indices);
+    EXPECT_EQ(mesh.num_faces(), 2);
+    EXPECT_TRUE(faces[0].is_valid());
+    EXPECT_TRUE(faces[1].is_valid());
+    for (size_t i = 2; i < faces.size(); ++i) {
+        EXPECT_FALSE(faces[i].is_valid());
+    }
+    expect_valid_connectivity(mesh);
+    expect_faces(mesh, faces, indices);
+
+    // two closed tetrahedra sharing vertex 0, the faces of the second one at vertex 0 are skipped
+    indices = {0, 2, 1, 0, 3, 2, 0, 1, 3, 1, 2, 3, 0, 5, 4, 0, 6, 5, 0, 4, 6, 4, 5, 6};
+    faces = mesh.build_from_faces(points, indices);
+    EXPECT_EQ(mesh.num_faces(), 5);
+    EXPECT_FALSE(faces[4].is_valid());
+    EXPECT_TRUE(faces[7].is_valid());
+    expect_valid_connectivity(mesh);
+    expect_faces(mesh, faces, indices);
+
+    // a bowtie, two fans at one boundary vertex
+    indices = {0, 1, 2, 0, 3, 4};
+    faces = mesh.build_from_faces(points, indices);
+    EXPECT_EQ(mesh.num_faces(), 2);
+    EXPECT_TRUE(mesh.is_boundary(vertex_handle(0)));
+    EXPECT_EQ(mesh.halfedge_graph::get_valence(vertex_handle(0)), 4);
+    expect_valid_connectivity(mesh);
+}
+
+TEST_F(HalfedgeMeshTest, build_from_faces_keeps_deleted_vertices) {
+    std::vector<VectorS<3>> points = {VectorS<3>(0, 0, 0), VectorS<3>(1, 0, 0), VectorS<3>(1, 1, 0),
+                                      VectorS<3>(0, 1, 0)};
+    std::vector<bcg_index_t> indices = {0, 1, 2, 0, 2, 3};
+    mesh.build_from_faces(points, indices);
+    mesh.delete_vertex(vertex_handle(3));
+    EXPECT_EQ(mesh.num_vertices(), 3);
+
+    // rebuilding on the kept vertices skips the face at the deleted vertex
+    auto faces = mesh.build_from_faces(indices);
+    EXPECT_TRUE(faces[0].is_valid());
+    EXPECT_FALSE(faces[1].is_valid());
+    EXPECT_TRUE(mesh.vertices_deleted[vertex_handle(3)]);
+    EXPECT_EQ(mesh.num_vertices(), 3);
+    EXPECT_EQ(mesh.num_faces(), 1);
+    expect_valid_connectivity(mesh);
+}
@@ -0,0 +1,71 @@
+//
+// Created by alex on 27.11.20.
+//
+#include <gtest/gtest.h>
+
+#include "geometry/mesh/bcg_mesh.h"
+#include "geometry/mesh/bcg_meshio.h"
+#include "geometry/mesh/bcg_mesh_remeshing.h"
+
+#ifdef _WIN32
+static std::string test_data_path = "..\\tests\\";
+#else
+static std::string test_data_path = "../tests/";
+#endif
+
+using namespace bcg;
+
+
+class SurfaceRemeshingTest : public ::testing::Test {
+public:
+    SurfaceRemeshingTest() {
+
+    }
+
+    static bcg_scalar_t mean_edge_length(const halfedge_mesh &mesh) {
+        bcg_scalar_t length = 0;
+        for (const auto e : mesh.edges) {
+            length += (mesh.positions[mesh.get_vertex(e, 0)] - mesh.positions[mesh.get_vertex(e, 1)]).norm();
+        }
+        return length / mesh.edges.size();
+    }
+
+    halfedge_mesh mesh;
+};
+
+TEST_F(SurfaceRemeshingTest, uniform_remeshing) {
+    meshio read_io(test_data_path + "pmp-data/off/bunny_adaptive.off", meshio_flags());
+    EXPECT_TRUE(read_io.read(mesh));
+    auto edge_length = mean_edge_length(mesh);
+    mesh_remeshing_uniform(mesh, edge_length);
+    EXPECT_FALSE(mesh.has_garbage());
+    EXPECT_TRUE(mesh.is_manifold());
+    EXPECT_NEAR(mean_edge_length(mesh), edge_length, 0.1 * edge_length);
+}
+
+TEST_F(SurfaceRemeshingTest, adaptive_remeshing) {
+    meshio read_io(test_data_path + "pmp-data/off/fandisk.off", meshio_flags());
+    EXPECT_TRUE(read_io.read(mesh));
+    auto edge_length = mean_edge_length(mesh);
+    auto n_vertices = mesh.vertices.size();
+    mesh_remeshing_adaptive(mesh, 0.5 * edge_length, 2.0 * edge_length, 0.1 * edge_length);
+    EXPECT_FALSE(mesh.has_garbage());
+    EXPECT_TRUE(mesh.is_manifold());
+    EXPECT_LT(mesh.vertices.size(), n_vertices);
+}
+
+// independent operations are chosen by rank, not by thread, so the grain size does not change the result
+TEST_F(SurfaceRemeshingTest, uniform_remeshing_grain_size) {
+    meshio read_io(test_data_path + "pmp-data/off/bunny_adaptive.off", meshio_flags());
+    EXPECT_TRUE(read_io.read(mesh));
+    halfedge_mesh other;
+    other.assign(mesh);
+    auto edge_length = mean_edge_length(mesh);
+    mesh_remeshing_uniform(mesh, edge_length, 2, true, 1024);
+    mesh_remeshing_uniform(other, edge_length, 2, true, 16);
+    EXPECT_EQ(mesh.vertices.size(), other.vertices.size());
+    EXPECT_EQ(mesh.faces.size(), other.faces.size());
+    for (const auto v : mesh.vertices) {
+        EXPECT_TRUE(mesh.positions[v].isApprox(other.positions[v]));
+    }
+}
@@ -54,3 +54,51 @@ TEST_F(SurfaceSimplificationTest, simplification_with_features) {
                         0); // Hausdorff
     EXPECT_EQ(mesh.vertices.size(), size_t(64));
 }
+
+// parallel simplification keeps the mesh closed and reaches the target when unconstrained
+TEST_F(SurfaceSimplificationTest, simplification_parallel) {
+    meshio read_io(test_data_path + "pmp-data/off/bunny_adaptive.off", meshio_flags());
+    EXPECT_TRUE(read_io.read(mesh));
+    size_t n_vertices = mesh.vertices.size();
+    mesh_simplification_parallel(mesh, n_vertices * 0.1,
+                                 5,
+                                 0.01,   // edge length
+                                 10,     // max valence
+                                 10,     // normal deviation
+                                 0.001); // Hausdorff
+    EXPECT_LT(mesh.vertices.size(), n_vertices / 2);
+    EXPECT_EQ(mesh.faces.size(), 2 * mesh.vertices.size() - 4);
+    EXPECT_FALSE(mesh.has_garbage());
+
+    halfedge_mesh plain;
+    meshio plain_io(test_data_path + "pmp-data/off/bunny_adaptive.off", meshio_flags());
+    EXPECT_TRUE(plain_io.read(plain));
+    mesh_simplification_parallel(plain, n_vertices * 0.1);
+    EXPECT_EQ(plain.vertices.size(), size_t(n_vertices * 0.1));
+    EXPECT_EQ(plain.faces.size(), 2 * plain.vertices.size() - 4);
+}
+
+// the progressive mesh starts at the simplified mesh and replays back to the input
+TEST_F(SurfaceSimplificationTest, simplification_progressive) {
+    meshio read_io(test_data_path + "pmp-data/off/bunny_adaptive.off", meshio_flags());
+    EXPECT_TRUE(read_io.read(mesh));
+    size_t n_vertices = mesh.vertices.size();
+    size_t n_faces = mesh.faces.size();
+    progressive_mesh progressive;
+    mesh_simplification(mesh, n_vertices * 0.1, 0, 0, 0, 0, 0, &progressive);
+
+    halfedge_mesh level;
+    progressive.extract(level);
+    EXPECT_EQ(level.vertices.size(), mesh.vertices.size());
+    EXPECT_EQ(level.faces.size(), mesh.faces.size());
+    EXPECT_EQ(level.positions[0], mesh.positions[0]);
+
+    progressive.set_num_vertices(n_vertices);
+    EXPECT_EQ(progressive.num_faces(), n_faces);
+
+    progressive.set_num_vertices(n_vertices / 2);
+    progressive.extract(level);
+    EXPECT_EQ(level.vertices.size(), n_vertices / 2);
+    EXPECT_EQ(level.faces.size(), 2 * level.vertices.size() - 4);
+    EXPECT_TRUE(level.is_manifold());
+}
@@ -3,9 +3,14 @@
 //
 
 #include <gtest/gtest.h>
+#include <fstream>
 
+#include "geometry/bcg_property_io.h"
 #include "geometry/mesh/bcg_meshio.h"
 #include "geometry/mesh/bcg_mesh_factory.h"
+#include "geometry/mesh/bcg_mesh_face_normals.h"
+#include "geometry/mesh/bcg_mesh_vertex_welding.h"
+#include "utils/bcg_mapped_file.h"
 
 #ifdef _WIN32
 static std::string test_data_path = "..\\tests\\data\\";
@@ -54,6 +59,33 @@ TEST_F(TestMeshIoFixture, obj){
     EXPECT_EQ(mesh_write_triangle, mesh_read_triangle);
 }
 
+TEST_F(TestMeshIoFixture, obj_records){
+    // a polygon with a long face line, relative indices and per corner attributes
+    std::string obj = "# polygon\nvt 0.5 0.25\nvn 0 0 1\n";
+    std::string face = "f";
+    for (int i = 0; i < 100; ++i) {
+        double angle = 2 * M_PI * i / 100;
+        obj += "v " + std::to_string(std::cos(angle)) + " " + std::to_string(std::sin(angle)) + " 0.1\r\n";
+        face += " " + std::to_string(i - 100) + "/1/1";
+    }
+    obj += face + "\nv 0.123456789012345 0 0\nv 1 1 1\nf 101//1 102//1 1//1\n";
+    std::ofstream(test_data_path + "test_write_records.obj") << obj;
+
+    meshio io(test_data_path + "test_write_records.obj", meshio_flags());
+    EXPECT_TRUE(io.read(mesh));
+    EXPECT_EQ(mesh.num_vertices(), 102);
+    EXPECT_EQ(mesh.num_faces(), 2);
+    EXPECT_EQ(mesh.positions[100][0], bcg_scalar_t(0.123456789012345));
+    EXPECT_EQ(mesh.positions[0], VectorS<3>(1, 0, 0.1));
+    auto tex_coords = mesh.halfedges.get<VectorS<2>, 2>("v_tex");
+    auto normals = mesh.halfedges.get<VectorS<3>, 3>("h_normal");
+    ASSERT_TRUE(tex_coords && normals);
+    for (const auto h : mesh.get_halfedges(face_handle(0))) {
+        EXPECT_EQ(tex_coords[h], VectorS<2>(0.5, 0.25));
+        EXPECT_EQ(normals[h], VectorS<3>(0, 0, 1));
+    }
+}
+
 TEST_F(TestMeshIoFixture, stl){
     meshio read_io(test_data_path + "test_read_mesh.stl", meshio_flags());
     read_io.read(mesh);
@@ -70,6 +102,124 @@ TEST_F(TestMeshIoFixture, stl){
     EXPECT_EQ(mesh_write_triangle, mesh_read_triangle);
 }
 
+TEST_F(TestMeshIoFixture, stl_binary_ascii){
+    mesh_factory factory;
+    halfedge_mesh icosahedron = factory.make_icosahedron();
+    face_normals(icosahedron);
+    for (bool binary : {true, false}) {
+        meshio_flags flags;
+        flags.use_binary = binary;
+        meshio io(test_data_path + "test_write_icosahedron.stl", flags);
+        EXPECT_TRUE(io.write(icosahedron));
+        halfedge_mesh result;
+        EXPECT_TRUE(io.read(result));
+        EXPECT_EQ(result.num_vertices(), 12);
+        EXPECT_EQ(result.num_edges(), 30);
+        EXPECT_EQ(result.num_faces(), 20);
+        for (size_t i = 0; i < 20; ++i) {
+            auto v0 = *icosahedron.get_vertices(face_handle(i));
+            auto v1 = *result.get_vertices(face_handle(i));
+            EXPECT_TRUE((icosahedron.positions[v0] - result.positions[v1]).norm() < 1e-6);
+        }
+    }
+}
+
+TEST_F(TestMeshIoFixture, stl_padding_and_case){
+    // binary files may carry bytes after the triangles
+    mesh_factory factory;
+    halfedge_mesh icosahedron = factory.make_icosahedron();
+    face_normals(icosahedron);
+    meshio_flags flags;
+    flags.use_binary = true;
+    meshio io(test_data_path + "test_write_padded.stl", flags);
+    EXPECT_TRUE(io.write(icosahedron));
+    std::ofstream(test_data_path + "test_write_padded.stl", std::ios::binary | std::ios::app) << std::string(7, '\0');
+    EXPECT_TRUE(io.read(mesh));
+    EXPECT_EQ(mesh.num_faces(), 20);
+
+    // keywords of ascii files are matched in any case
+    std::ofstream(test_data_path + "test_write_upper.stl") << "SOLID upper\n"
+                                                             "  FACET NORMAL 0 0 1\n"
+                                                             "    OUTER LOOP\n"
+                                                             "      VERTEX 0 0 0\n"
+                                                             "      VERTEX 1 0 0\n"
+                                                             "      VERTEX 0 1 0\n"
+                                                             "    ENDLOOP\n"
+                                                             "  ENDFACET\n"
+                                                             "ENDSOLID upper\n";
+    halfedge_mesh upper;
+    EXPECT_TRUE(meshio(test_data_path + "test_write_upper.stl", meshio_flags()).read(upper));
+    EXPECT_EQ(upper.num_faces(), 1);
+    EXPECT_EQ(upper.positions[1], VectorS<3>(1, 0, 0));
+
+    // no triangles
+    std::ofstream(test_data_path + "test_write_empty.stl") << "solid empty\nendsolid empty\n";
+    halfedge_mesh empty;
+    EXPECT_FALSE(meshio(test_data_path + "test_write_empty.stl", meshio_flags()).read(empty));
+}
+
+TEST_F(TestMeshIoFixture, weld_vertices){
+    std::vector<VectorS<3>> corners = {{0, 0, 0}, {1, 0, 0}, {0, 1, 0},
+                                       {1, 0, 0}, {1, 1, 0}, {0, 1, 0},
+                                       {-0.0, 1, 0}, {1.02, 1.01, 0}, {0.01, 2, 0}};
+    std::vector<VectorS<3>> points;
+    auto indices = weld_vertices(corners, 0, points);
+    EXPECT_EQ(points.size(), 6);
+    EXPECT_EQ(indices, std::vector<bcg_index_t>({0, 1, 2, 1, 3, 2, 2, 4, 5}));
+
+    indices = weld_vertices(corners, 0.1, points);
+    EXPECT_EQ(points.size(), 5);
+    EXPECT_EQ(indices, std::vector<bcg_index_t>({0, 1, 2, 1, 3, 2, 2, 3, 4}));
+    EXPECT_EQ(points[3], VectorS<3>(1, 1, 0));
+}
+
+TEST_F(TestMeshIoFixture, ply_binary){
+    mesh_factory factory;
+    halfedge_mesh grid = factory.make_grid(4, 3);
+    auto quality = grid.vertices.add<bcg_scalar_t, 1>("v_quality");
+    for (const auto v : grid.vertices) {
+        quality[v] = v.idx * 0.5;
+    }
+    meshio_flags flags;
+    flags.use_binary = true;
+    meshio io(test_data_path + "test_write_binary.ply", flags);
+    EXPECT_TRUE(io.write(grid));
+    EXPECT_TRUE(io.read(mesh));
+    EXPECT_EQ(mesh.num_vertices(), grid.num_vertices());
+    EXPECT_EQ(mesh.num_faces(), grid.num_faces());
+    EXPECT_EQ(mesh.positions.vector(), grid.positions.vector());
+    auto result_quality = mesh.vertices.get<bcg_scalar_t, 1>("v_quality");
+    ASSERT_TRUE(result_quality);
+    EXPECT_EQ(result_quality.vector(), quality.vector());
+    for (const auto f : grid.faces) {
+        std::vector<vertex_handle> expected, result;
+        for (const auto v : grid.get_vertices(f)) expected.push_back(v);
+        for (const auto v : mesh.get_vertices(f)) result.push_back(v);
+        EXPECT_EQ(expected, result);
+    }
+}
+
+TEST_F(TestMeshIoFixture, ply_binary_deleted){
+    mesh_factory factory;
+    halfedge_mesh grid = factory.make_grid(4, 3);
+    grid.delete_vertex(vertex_handle(0));
+    std::vector<VectorS<3>> positions;
+    for (const auto v : grid.vertices) {
+        positions.push_back(grid.positions[v]);
+    }
+    meshio_flags flags;
+    flags.use_binary = true;
+    meshio io(test_data_path + "test_write_binary.ply", flags);
+    EXPECT_TRUE(io.write(grid));
+    EXPECT_TRUE(io.read(mesh));
+    EXPECT_EQ(mesh.num_vertices(), grid.num_vertices());
+    EXPECT_EQ(mesh.num_faces(), grid.num_faces());
+    ASSERT_EQ(mesh.positions.size(), positions.size());
+    for (size_t i = 0; i < positions.size(); ++i) {
+        EXPECT_EQ(mesh.positions[i], positions[i]);
+    }
+}
+
 TEST_F(TestMeshIoFixture, ply){
     meshio read_io(test_data_path + "test_read_mesh.ply", meshio_flags());
     read_io.read(mesh);
@@ -84,4 +234,99 @@ TEST_F(TestMeshIoFixture, ply){
     halfedge_mesh mesh_read_triangle;
     io.read(mesh_read_triangle);
     EXPECT_EQ(mesh_write_triangle, mesh_read_triangle);
-}
\ No newline at end of file
+}
+TEST_F(TestMeshIoFixture, bcg){
+    meshio read_io(test_data_path + "test_read_mesh.off", meshio_flags());
+    read_io.read(mesh);
+    auto v_quality = mesh.vertices.add<bcg_scalar_t, 1>("v_quality");
+    auto f_ids = mesh.faces.add<VectorI<3>, 3>("f_ids");
+    for (const auto v : mesh.vertices) {
+        v_quality[v] = bcg_scalar_t(v.idx) / 2;
+    }
+    for (const auto f : mesh.faces) {
+        f_ids[f] = VectorI<3>(f.idx, f.idx + 1, f.idx + 2);
+    }
+    mesh.delete_face(face_handle(0));
+
+    meshio io(test_data_path + "test_write_mesh.bcg", meshio_flags());
+    EXPECT_TRUE(io.write(mesh));
+    halfedge_mesh result;
+    EXPECT_TRUE(io.read(result));
+    EXPECT_EQ(result.vertices.size(), mesh.vertices.size());
+    EXPECT_EQ(result.faces.size(), mesh.faces.size());
+    EXPECT_EQ(result.num_faces(), mesh.num_faces());
+    EXPECT_TRUE(result.has_garbage());
+    EXPECT_EQ(result.positions.vector(), mesh.positions.vector());
+    EXPECT_EQ(result.hconn.vector().size(), mesh.hconn.vector().size());
+    for (size_t i = 0; i < mesh.hconn.size(); ++i) {
+        EXPECT_EQ(result.hconn[i].nh, mesh.hconn[i].nh);
+    }
+    auto quality = result.vertices.get<bcg_scalar_t, 1>("v_quality");
+    auto ids = result.faces.get<VectorI<3>, 3>("f_ids");
+    ASSERT_TRUE(quality);
+    ASSERT_TRUE(ids);
+    EXPECT_EQ(quality.vector(), v_quality.vector());
+    EXPECT_EQ(ids.vector(), f_ids.vector());
+    result.garbage_collection();
+    mesh.garbage_collection();
+    EXPECT_EQ(result, mesh);
+}
+
+TEST_F(TestMeshIoFixture, bcg_compressed){
+    meshio read_io(test_data_path + "test_read_mesh.off", meshio_flags());
+    read_io.read(mesh);
+    meshio raw_io(test_data_path + "test_write_mesh.bcg", meshio_flags());
+    EXPECT_TRUE(raw_io.write(mesh));
+    size_t raw_size = mapped_file(test_data_path + "test_write_mesh.bcg").size();
+
+    meshio_flags flags;
+    flags.use_compression = true;
+    flags.position_bits = 20;
+    meshio io(test_data_path + "test_write_compressed.bcg", flags);
+    EXPECT_TRUE(io.write(mesh));
+    EXPECT_LT(mapped_file(test_data_path + "test_write_compressed.bcg").size(), raw_size / 2);
+    halfedge_mesh result;
+    EXPECT_TRUE(io.read(result));
+    ASSERT_EQ(result.vertices.size(), mesh.vertices.size());
+    for (size_t i = 0; i < mesh.hconn.size(); ++i) {
+        EXPECT_EQ(result.hconn[i].nh, mesh.hconn[i].nh);
+        EXPECT_EQ(result.hconn[i].v, mesh.hconn[i].v);
+    }
+    aligned_box3 aabb(mesh.positions.vector());
+    bcg_scalar_t tolerance = aabb.diagonal().maxCoeff() / (1 << 20);
+    for (size_t i = 0; i < mesh.positions.size(); ++i) {
+        EXPECT_LE((result.positions[i] - mesh.positions[i]).cwiseAbs().maxCoeff(), tolerance);
+    }
+}
+
+TEST_F(TestMeshIoFixture, bcg_checkpoint){
+    meshio read_io(test_data_path + "test_read_mesh.off", meshio_flags());
+    read_io.read(mesh);
+    std::vector<const property_container *> containers = {&mesh.vertices, &mesh.halfedges, &mesh.edges, &mesh.faces,
+                                                          &mesh.object_properties};
+    property_checkpoint checkpoint(test_data_path + "test_write_checkpoint.bcg");
+    EXPECT_TRUE(checkpoint.save(containers));
+    size_t full_size = checkpoint.last_save_bytes;
+
+    auto quality = mesh.vertices.get_or_add<bcg_scalar_t, 1>("v_quality");
+    for (const auto v : mesh.vertices) {
+        quality[v] = bcg_scalar_t(v.idx);
+    }
+    mesh.positions[0] = VectorS<3>(1, 2, 3);
+    mesh.positions.set_dirty();
+    EXPECT_TRUE(checkpoint.save(containers));
+    EXPECT_LT(checkpoint.last_save_bytes, full_size / 2);
+    EXPECT_TRUE(checkpoint.save(containers));
+    EXPECT_LT(checkpoint.last_save_bytes, 1024);
+
+    halfedge_mesh result;
+    EXPECT_TRUE(meshio(checkpoint.filename, meshio_flags()).read(result));
+    EXPECT_EQ(result.num_faces(), mesh.num_faces());
+    EXPECT_EQ(result.positions[0], VectorS<3>(1, 2, 3));
+    auto result_quality = result.vertices.get<bcg_scalar_t, 1>("v_quality");
+    ASSERT_TRUE(result_quality);
+    EXPECT_EQ(result_quality.vector(), quality.vector());
+
+    EXPECT_TRUE(checkpoint.compact(containers));
+    EXPECT_LT(checkpoint.last_save_bytes, full_size + quality.size() * sizeof(bcg_scalar_t) + 1024);
+}
@@ -0,0 +1,90 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <gtest/gtest.h>
+#include <algorithm>
+
+#include "geometry/point_cloud/bcg_point_cloud.h"
+#include "geometry/octree/bcg_octree.h"
+
+using namespace bcg;
+
+class TestOctreeFixture : public ::testing::Test {
+public:
+    TestOctreeFixture() {
+        for (int i = 0; i < 2000; ++i) {
+            pc.add_vertex(VectorS<3>::Random());
+        }
+        // duplicates end in one cell at the maximal depth
+        for (int i = 0; i < 20; ++i) {
+            pc.add_vertex(VectorS<3>(0.5, 0.5, 0.5));
+        }
+        index.build(pc.positions, 8);
+    }
+
+    std::vector<bcg_scalar_t> brute_force(const VectorS<3> &point) const {
+        std::vector<bcg_scalar_t> distances;
+        for (const auto v : pc.vertices) {
+            distances.push_back((pc.positions[v] - point).squaredNorm());
+        }
+        std::sort(distances.begin(), distances.end());
+        return distances;
+    }
+
+    point_cloud pc;
+    octree index;
+};
+
+TEST_F(TestOctreeFixture, build) {
+    EXPECT_EQ(index.storage[0].v_start, 0);
+    EXPECT_EQ(index.storage[0].v_end, pc.vertices.size());
+    for (const auto &node : index.storage) {
+        if (node.config == 0) {
+            EXPECT_TRUE(node.v_end - node.v_start <= 8 || node.depth == index.max_depth);
+            continue;
+        }
+        size_t start = node.v_start;
+        for (size_t child = node.first_child_index; start < node.v_end; ++child) {
+            EXPECT_EQ(index.storage[child].v_start, start);
+            EXPECT_EQ(index.storage[child].depth, node.depth + 1);
+            start = index.storage[child].v_end;
+        }
+        EXPECT_EQ(start, node.v_end);
+    }
+    for (size_t i = 0; i < pc.vertices.size(); ++i) {
+        const auto &root = index.storage[0];
+        EXPECT_TRUE(index.node_box(root).contains(pc.positions[i]));
+    }
+}
+
+TEST_F(TestOctreeFixture, query_knn) {
+    for (int i = 0; i < 50; ++i) {
+        VectorS<3> point = VectorS<3>::Random() * 1.2;
+        auto expected = brute_force(point);
+        auto result = index.query_knn(point, 10);
+        ASSERT_EQ(result.indices.size(), 10);
+        for (size_t j = 0; j < 10; ++j) {
+            EXPECT_NEAR(result.distances[j], expected[j], 1e-6);
+            EXPECT_NEAR((pc.positions[result.indices[j]] - point).squaredNorm(), result.distances[j], 1e-6);
+        }
+    }
+    auto result = index.query_knn(VectorS<3>(0.5, 0.5, 0.5), 25);
+    EXPECT_EQ(result.distances[19], 0);
+    EXPECT_EQ(index.query_knn(VectorS<3>::Zero(), 5000).indices.size(), pc.vertices.size());
+}
+
+TEST_F(TestOctreeFixture, query_radius) {
+    for (int i = 0; i < 50; ++i) {
+        VectorS<3> point = VectorS<3>::Random();
+        auto expected = brute_force(point);
+        bcg_scalar_t radius = std::sqrt(expected[30]) + 1e-4;
+        auto result = index.query_radius(point, radius);
+        EXPECT_EQ(result.indices.size(), std::upper_bound(expected.begin(), expected.end(), radius * radius) -
+                                         expected.begin());
+        for (size_t j = 0; j < result.indices.size(); ++j) {
+            EXPECT_LE((pc.positions[result.indices[j]] - point).norm(), radius);
+        }
+    }
+    EXPECT_EQ(index.query_radius(VectorS<3>::Zero(), 10).indices.size(), pc.vertices.size());
+}
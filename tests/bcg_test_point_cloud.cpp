@@ -152,4 +152,62 @@ TEST_F(TestPointCloudFixture, find_closest) {
     EXPECT_EQ(pc_full.num_vertices(), 4);
     EXPECT_EQ(pc_full.vertices.size(), 4);
     EXPECT_EQ(pc_full.size_vertices_deleted, 0);
-}
\ No newline at end of file
+}
+TEST_F(TestPointCloudFixture, find_closest_after_edits) {
+    for (int i = 0; i < 500; ++i) {
+        pc_empty.add_vertex(VectorS<3>::Random());
+    }
+    auto brute_force = [&](const VectorS<3> &point, size_t k) {
+        std::vector<bcg_scalar_t> distances;
+        for (const auto v : pc_empty.vertices) {
+            distances.push_back((pc_empty.positions[v] - point).squaredNorm());
+        }
+        std::sort(distances.begin(), distances.end());
+        distances.resize(std::min(k, distances.size()));
+        return distances;
+    };
+    auto check = [&]() {
+        for (int i = 0; i < 20; ++i) {
+            VectorS<3> point = VectorS<3>::Random();
+            auto expected = brute_force(point, 5);
+            auto result = pc_empty.find_closest_k_vertices(point, 5);
+            ASSERT_EQ(result.size(), expected.size());
+            for (size_t j = 0; j < result.size(); ++j) {
+                EXPECT_FALSE(pc_empty.vertices_deleted[result[j]]);
+                EXPECT_NEAR((pc_empty.positions[result[j]] - point).squaredNorm(), expected[j], 1e-5);
+            }
+            EXPECT_EQ(pc_empty.find_closest_vertex(point), result[0]);
+            auto radius = pc_empty.find_closest_vertices_radius(point, std::sqrt(expected[2]) + 1e-4);
+            EXPECT_EQ(radius.size(), 3);
+        }
+    };
+    check();
+
+    for (size_t i = 0; i < 100; ++i) {
+        pc_empty.positions[i] = VectorS<3>::Random() * 2;
+    }
+    pc_empty.positions.set_dirty();
+    check();
+
+    for (int i = 0; i < 100; ++i) {
+        pc_empty.add_vertex(VectorS<3>::Random());
+    }
+    check();
+
+    for (size_t i = 0; i < 600; i += 3) {
+        pc_empty.delete_vertex(vertex_handle(i));
+    }
+    check();
+
+    pc_empty.garbage_collection();
+    check();
+
+    std::vector<VectorS<3>> points = {VectorS<3>::Zero(), VectorS<3>::Ones()};
+    auto closest = pc_empty.find_closest_vertex_batch(points);
+    auto k_closest = pc_empty.find_closest_k_vertices_batch(points, 3);
+    for (size_t i = 0; i < points.size(); ++i) {
+        EXPECT_EQ(closest[i], pc_empty.find_closest_vertex(points[i]));
+        ASSERT_EQ(k_closest.num_neighbors(i), 3);
+        EXPECT_NEAR(k_closest[i].distances[2], brute_force(points[i], 3)[2], 1e-5);
+    }
+}
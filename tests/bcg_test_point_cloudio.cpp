@@ -4,6 +4,8 @@
 
 #include <gtest/gtest.h>
 #include "geometry/point_cloud/bcg_point_cloudio.h"
+#include "geometry/bcg_property_io.h"
+#include "geometry/point_cloud/bcg_point_cloud_stream.h"
 
 #ifdef _WIN32
 static std::string test_data_path = "..\\tests\\data\\";
@@ -116,4 +118,178 @@ TEST_F(TestPointCloudIoFixture, txt) {
     EXPECT_FLOAT_EQ(reflectances[3], -0.113);
     EXPECT_FLOAT_EQ(reflectances[4], 0.447);
 
-}
\ No newline at end of file
+}
+TEST_F(TestPointCloudIoFixture, bcg) {
+    for (size_t i = 0; i < 100; ++i) {
+        pc.add_vertex(VectorS<3>(i, 2 * i, 3 * i));
+    }
+    auto normals = pc.vertices.add<VectorS<3>, 3>("v_normal", VectorS<3>::UnitZ());
+    auto labels = pc.vertices.add<int, 1>("v_label");
+    auto covariances = pc.vertices.add<MatrixS<3, 3>, 1>("v_covariance", MatrixS<3, 3>::Identity());
+    auto selected = pc.vertices.add<bool, 1>("v_selected");
+    for (size_t i = 0; i < 100; ++i) {
+        labels[i] = -int(i);
+        selected[i] = i % 3 == 0;
+    }
+    pc.delete_vertex(vertex_handle(7));
+
+    point_cloudio io(test_data_path + "test_write.bcg", point_cloudio_flags());
+    EXPECT_TRUE(io.write(pc));
+    point_cloud result;
+    EXPECT_TRUE(io.read(result));
+    EXPECT_EQ(result.vertices.size(), 100);
+    EXPECT_EQ(result.num_vertices(), 99);
+    EXPECT_TRUE(result.vertices_deleted[7]);
+    EXPECT_EQ(result.positions.vector(), pc.positions.vector());
+    auto result_normals = result.vertices.get<VectorS<3>, 3>("v_normal");
+    auto result_labels = result.vertices.get<int, 1>("v_label");
+    auto result_covariances = result.vertices.get<MatrixS<3, 3>, 1>("v_covariance");
+    auto result_selected = result.vertices.get<bool, 1>("v_selected");
+    ASSERT_TRUE(result_normals && result_labels && result_covariances && result_selected);
+    EXPECT_EQ(result_normals.vector(), normals.vector());
+    EXPECT_EQ(result_labels.vector(), labels.vector());
+    EXPECT_EQ(result_covariances.vector(), covariances.vector());
+    for (size_t i = 0; i < 100; ++i) {
+        EXPECT_EQ(result_selected[i], selected[i]);
+    }
+}
+
+TEST_F(TestPointCloudIoFixture, ply_binary) {
+    for (size_t i = 0; i < 100; ++i) {
+        pc.add_vertex(VectorS<3>(i, 2 * i, -0.5 * i));
+    }
+    auto normals = pc.vertices.add<VectorS<3>, 3>("v_normal", VectorS<3>::UnitZ());
+    auto colors = pc.vertices.add<VectorS<3>, 3>("v_color", VectorS<3>(1, 0, 0.2));
+    auto labels = pc.vertices.add<int, 1>("v_label");
+    auto uvs = pc.vertices.add<VectorS<2>, 2>("v_uv");
+    for (size_t i = 0; i < 100; ++i) {
+        labels[i] = -int(i);
+        uvs[i] = VectorS<2>(i, 0.25);
+    }
+
+    point_cloudio io(test_data_path + "test_write_binary.ply", point_cloudio_flags());
+    EXPECT_TRUE(io.write(pc));
+    point_cloud result;
+    EXPECT_TRUE(io.read(result));
+    EXPECT_EQ(result.vertices.size(), 100);
+    EXPECT_EQ(result.positions.vector(), pc.positions.vector());
+    auto result_normals = result.vertices.get<VectorS<3>, 3>("v_normal");
+    auto result_colors = result.vertices.get<VectorS<3>, 3>("v_color");
+    auto result_labels = result.vertices.get<bcg_scalar_t, 1>("v_label");
+    auto result_uvs = result.vertices.get<VectorS<2>, 2>("v_uv");
+    ASSERT_TRUE(result_normals && result_colors && result_labels && result_uvs);
+    EXPECT_EQ(result_normals.vector(), normals.vector());
+    EXPECT_EQ(result_uvs.vector(), uvs.vector());
+    for (size_t i = 0; i < 100; ++i) {
+        EXPECT_EQ(result_labels[i], labels[i]);
+        EXPECT_TRUE((result_colors[i] - colors[i]).norm() < 0.01);
+    }
+}
+
+TEST_F(TestPointCloudIoFixture, ply_binary_deleted) {
+    for (size_t i = 0; i < 10; ++i) {
+        pc.add_vertex(VectorS<3>(i, 0, 0));
+    }
+    pc.delete_vertex(vertex_handle(3));
+
+    point_cloudio io(test_data_path + "test_write_binary.ply", point_cloudio_flags());
+    EXPECT_TRUE(io.write(pc));
+    point_cloud result;
+    EXPECT_TRUE(io.read(result));
+    EXPECT_EQ(result.vertices.size(), 9);
+    EXPECT_EQ(result.positions[3], VectorS<3>(4, 0, 0));
+}
+
+TEST_F(TestPointCloudIoFixture, bcg_invalid) {
+    point_cloudio io(test_data_path + "test.xyz", point_cloudio_flags());
+    io.read(pc);
+    EXPECT_FALSE(read_property_containers(test_data_path + "test.xyz", {&pc.vertices}));
+    EXPECT_EQ(pc.vertices.size(), 5);
+}
+
+TEST_F(TestPointCloudIoFixture, stream_xyz) {
+    std::string filename = test_data_path + "test_write_stream.xyz";
+    FILE *out = fopen(filename.c_str(), "w");
+    ASSERT_TRUE(out);
+    fprintf(out, "# x y z\n");
+    for (size_t i = 0; i < 2000; ++i) {
+        fprintf(out, "%zu %zu -%zu.5\n", i % 10, i, i);
+    }
+    fclose(out);
+
+    point_cloudio(filename, point_cloudio_flags()).read(pc);
+    point_cloud_stream stream(filename, 4096);
+    ASSERT_TRUE(stream);
+    point_cloud batch;
+    point_stream_statistics stats;
+    size_t num_batches = 0;
+    while (stream.next(batch)) {
+        for (size_t i = 0; i < batch.vertices.size(); ++i) {
+            EXPECT_EQ(batch.positions[i], pc.positions[stream.num_points_read() - batch.vertices.size() + i]);
+        }
+        stats.push(batch.positions);
+        ++num_batches;
+    }
+    EXPECT_GT(num_batches, 1);
+    EXPECT_EQ(stream.num_points_read(), 2000);
+    EXPECT_EQ(stats.num_points, 2000);
+    EXPECT_EQ(stats.aabb.min, VectorS<3>(0, 0, -1999.5));
+    EXPECT_EQ(stats.aabb.max, VectorS<3>(9, 1999, -0.5));
+    EXPECT_NEAR(stats.coordinates[1].mean(), 999.5, 1e-6);
+    EXPECT_NEAR(stats.coordinates[1].variance(), 2000.0 * 2001.0 / 12.0, 1e-3);
+    EXPECT_EQ(stats.coordinates[2].max(), -0.5);
+}
+
+TEST_F(TestPointCloudIoFixture, stream_ply_grid) {
+    for (size_t i = 0; i < 1000; ++i) {
+        pc.add_vertex(VectorS<3>(i % 10, (i / 10) % 10, i / 100) / 10.0);
+    }
+    pc.add_vertex(VectorS<3>(5, 5, 5));
+    pc.vertices.add<bcg_scalar_t, 1>("v_quality", 2);
+    point_cloudio(test_data_path + "test_write_binary.ply", point_cloudio_flags()).write(pc);
+
+    aligned_box3 aabb(pc.positions.vector());
+    sample_mean_grid whole(VectorI<3>(10, 10, 10), aabb);
+    whole.build(pc.positions);
+
+    sample_mean_grid streamed(VectorI<3>(10, 10, 10), aabb);
+    point_cloud_stream stream(test_data_path + "test_write_binary.ply", 4096);
+    point_cloud batch;
+    while (stream.next(batch)) {
+        EXPECT_TRUE(batch.vertices.has("v_quality"));
+        streamed.insert_points(batch.positions, stream.num_points_read() - batch.vertices.size());
+    }
+    EXPECT_EQ(stream.num_points_read(), 1001);
+    EXPECT_EQ(streamed.get_occupied_sample_points(), whole.get_occupied_sample_points());
+    EXPECT_EQ(voxel_density_statistics(streamed).size(), streamed.get_occupied_sample_points().size());
+    auto dense = dense_sample_points(streamed, 1);
+    EXPECT_EQ(dense.size(), streamed.get_occupied_sample_points().size() - 1);
+    EXPECT_TRUE(std::find(dense.begin(), dense.end(), VectorS<3>(5, 5, 5)) == dense.end());
+}
+
+TEST_F(TestPointCloudIoFixture, bcg_compressed) {
+    auto labels = pc.vertices.add<int, 1>("v_label");
+    for (size_t i = 0; i < 10000; ++i) {
+        pc.add_vertex(VectorS<3>::Random());
+        labels[i] = int(i);
+    }
+    point_cloudio_flags flags;
+    flags.use_compression = true;
+    flags.position_bits = 16;
+    point_cloudio io(test_data_path + "test_write_compressed.bcg", flags);
+    EXPECT_TRUE(io.write(pc));
+    point_cloud result;
+    EXPECT_TRUE(io.read(result));
+    ASSERT_EQ(result.vertices.size(), 10000);
+    auto result_labels = result.vertices.get<int, 1>("v_label");
+    ASSERT_TRUE(result_labels);
+    // points are stored in morton order
+    std::vector<bool> found(10000, false);
+    for (size_t i = 0; i < 10000; ++i) {
+        size_t label = result_labels[i];
+        ASSERT_LT(label, 10000);
+        found[label] = true;
+        EXPECT_LE((result.positions[i] - pc.positions[label]).cwiseAbs().maxCoeff(), 2.0 / (1 << 16));
+    }
+    EXPECT_EQ(std::count(found.begin(), found.end(), true), 10000);
+}
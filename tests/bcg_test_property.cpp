@@ -177,4 +177,139 @@ TEST(TestSuiteProperty, Property) {
     EXPECT_EQ(vectorfield.size(), 100);
     vectorfield.append(data);
     EXPECT_EQ(vectorfield.size(), 200);
-}
\ No newline at end of file
+}
+TEST(TestSuiteProperty, handles) {
+    EXPECT_EQ(sizeof(vertex_handle), 4);
+    EXPECT_TRUE(std::is_trivially_copyable<halfedge_handle>::value);
+
+    vertex_handle invalid;
+    EXPECT_FALSE(invalid.is_valid());
+    EXPECT_FALSE(vertex_handle(BCG_INVALID_ID).is_valid());
+
+    vertex_handle v(42);
+    EXPECT_TRUE(v.is_valid());
+    EXPECT_EQ(size_t(v), 42);
+
+    face_handle f;
+    f = v;
+    EXPECT_EQ(f.idx, 42);
+    ++f;
+    EXPECT_EQ(f.idx, 43);
+}
+
+TEST(TestSuiteProperty, property_key) {
+    vertex_container vertices;
+    auto positions = vertices.add<VectorS<3>, 3>("v_position", zero3s);
+    vertices.resize(10);
+
+    auto key = vertices.key<VectorS<3>, 3>("v_position");
+    EXPECT_TRUE(vertices.has(key));
+    EXPECT_EQ(vertices.get(key), positions);
+    EXPECT_FALSE((vertices.key<bcg_scalar_t, 1>("v_position")));
+    EXPECT_FALSE((vertices.key<VectorS<3>, 3>("v_missing")));
+
+    EXPECT_TRUE(vertices.rename("v_position", "v_point"));
+    EXPECT_EQ(vertices.get(key), positions);
+    EXPECT_EQ(positions.name(), "v_point");
+
+    auto weights = vertices.add<VectorS<3>, 3>("v_weight", one3s);
+    vertices.remove(positions);
+    EXPECT_FALSE(vertices.has(key));
+    auto normals = vertices.add<VectorS<3>, 3>("v_normal", one3s);
+    EXPECT_FALSE(vertices.get(key));
+    EXPECT_EQ(normals.size(), 10);
+    EXPECT_EQ(vertices.get(vertices.key(weights)), weights);
+
+    auto deleted = vertices.add<bool, 1>("v_deleted", false);
+    deleted[3] = true;
+    size_t count = 0;
+    for (const auto v : vertices) {
+        EXPECT_NE(v.idx, 3);
+        ++count;
+    }
+    EXPECT_EQ(count, 9);
+    vertices.remove(deleted);
+    count = 0;
+    for (const auto v : vertices) {
+        ++count;
+    }
+    EXPECT_EQ(count, 10);
+}
+
+TEST(TestSuiteProperty, storage) {
+    vertex_container vertices;
+    auto positions = vertices.add<VectorS<3>, 3>("v_position", zero3s);
+    auto weights = vertices.add<bcg_scalar_t, 1>("v_weight", 1.0);
+    vertices.resize(10);
+    positions[3] = one3s;
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(positions.data()) % BCG_ALIGNMENT, 0);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(weights.data()) % BCG_ALIGNMENT, 0);
+
+    vertices.use_arena();
+    EXPECT_TRUE(vertices.get_arena());
+    EXPECT_EQ(positions[3], one3s);
+    EXPECT_EQ(weights[9], 1.0);
+
+    vertices.reserve(1000);
+    EXPECT_EQ(vertices.get_arena()->num_blocks(), 1);
+    auto normals = vertices.add<VectorS<3>, 3>("v_normal", one3s);
+    EXPECT_EQ(normals.size(), 10);
+    for (size_t i = 0; i < 2000; ++i) {
+        vertices.push_back();
+    }
+    EXPECT_EQ(positions.size(), 2010);
+    EXPECT_EQ(positions[3], one3s);
+    EXPECT_EQ(normals[2009], one3s);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(normals.data()) % BCG_ALIGNMENT, 0);
+
+    vertices.remove_all();
+    EXPECT_EQ(vertices.num_properties(), 0);
+}
+
+TEST(TestSuiteProperty, arena_reuse) {
+    AlignedArena arena;
+    arena.reserve(4096);
+    void *a = arena.allocate(1000);
+    void *b = arena.allocate(1000);
+    void *c = arena.allocate(500);
+    ASSERT_TRUE(a && b && c);
+
+    // a released slice is handed out again for the same size
+    EXPECT_TRUE(arena.deallocate(a, 1000));
+    EXPECT_EQ(arena.allocate(1000), a);
+
+    // the last slice of the block gives its space back
+    EXPECT_TRUE(arena.deallocate(c, 500));
+    EXPECT_EQ(arena.allocate(600), c);
+
+    int outside = 0;
+    EXPECT_FALSE(arena.deallocate(&outside, sizeof(outside)));
+    EXPECT_EQ(arena.num_blocks(), 1);
+}
+
+TEST(TestSuiteProperty, compact) {
+    vertex_container vertices;
+    auto values = vertices.add<int, 1>("v_value");
+    auto flags = vertices.add<bool, 1>("v_flag");
+    auto deleted = vertices.add<bool, 1>("v_deleted");
+    vertices.resize(1000);
+    for (size_t i = 0; i < 1000; ++i) {
+        values[i] = int(i);
+        flags[i] = i % 3 == 0;
+        deleted[i] = i % 7 == 0;
+    }
+
+    auto kept = kept_indices(deleted.vector());
+    EXPECT_EQ(kept.size(), 857);
+    auto map = compaction_map(kept, vertices.size());
+    EXPECT_EQ(map[7], BCG_INVALID_HANDLE_ID);
+    EXPECT_EQ(map[8], 6);
+
+    vertices.compact(kept);
+    EXPECT_EQ(vertices.size(), 857);
+    for (size_t i = 0; i < kept.size(); ++i) {
+        EXPECT_EQ(values[i], int(kept[i]));
+        EXPECT_EQ(flags[i], kept[i] % 3 == 0);
+        EXPECT_FALSE(deleted[i]);
+    }
+}
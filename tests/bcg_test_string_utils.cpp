@@ -6,6 +6,7 @@
 #include <gtest/gtest.h>
 
 #include "bcg_library/utils/bcg_string_utils.h"
+#include "bcg_library/utils/bcg_number_table.h"
 
 using namespace bcg;
 
@@ -87,4 +88,34 @@ TEST(TestSuiteStrings, parse_numbers) {
     EXPECT_EQ(result[0], 12.0f);
     EXPECT_EQ(result[1], 3.5f);
     EXPECT_EQ(result[2], 4.0f);
-}
\ No newline at end of file
+}
+TEST(TestSuiteStrings, parse_numbers_range) {
+    std::string test = "-1.5e2 7|8";
+    std::vector<double> result;
+    parse_numbers<double>(test.data(), test.data() + 8, [](const char *, size_t) {}, [&](double x, size_t, size_t) {
+        result.push_back(x);
+    });
+    ASSERT_EQ(result.size(), 2);
+    EXPECT_EQ(result[0], -150.0);
+    EXPECT_EQ(result[1], 7.0);
+}
+
+TEST(TestSuiteStrings, parse_unsigned_precision) {
+    for (std::string number : {"0.1", "0.3", "123.456789012345", "2.5e-7", "1234567890123456789012.5", "1e300"}) {
+        const char *pen = number.data();
+        EXPECT_EQ(parse_unsigned<double>(pen, number.data() + number.size()), std::stod(number)) << number;
+        EXPECT_EQ(pen, number.data() + number.size());
+    }
+}
+
+TEST(TestSuiteStrings, parse_number_table) {
+    std::string test = "x,y,z\n1,2,3,4\n42\n-.5 6e1 7\n8 9 10\n";
+    auto table = parse_number_table<double>(test.data(), test.data() + test.size(), {0, 0, 0, -1}, 3, 0, 8);
+    ASSERT_GT(table.chunks.size(), 1);
+    ASSERT_EQ(table.num_rows(), 3);
+    std::vector<double> rows(table.num_rows() * 4);
+    table.for_each_row([&](size_t i, const double *row) {
+        std::copy(row, row + 4, rows.begin() + i * 4);
+    });
+    EXPECT_EQ(rows, (std::vector<double>{1, 2, 3, 4, -0.5, 60, 7, -1, 8, 9, 10, -1}));
+}
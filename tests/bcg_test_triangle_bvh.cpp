@@ -0,0 +1,131 @@
+//
+// Created by alex on 16.10.26.
+//
+
+#include <gtest/gtest.h>
+#include <random>
+
+#include "geometry/mesh/bcg_mesh.h"
+#include "geometry/mesh/bcg_meshio.h"
+#include "geometry/bvh/bcg_triangle_bvh.h"
+
+#ifdef _WIN32
+static std::string test_data_path = "..\\tests\\";
+#else
+static std::string test_data_path = "../tests/";
+#endif
+
+using namespace bcg;
+
+class TestTriangleBvhFixture : public ::testing::Test {
+public:
+    TestTriangleBvhFixture() {
+        meshio read_io(test_data_path + "pmp-data/off/bunny_adaptive.off", meshio_flags());
+        read_io.read(mesh);
+        for (const auto v : mesh.vertices) {
+            box.grow(mesh.positions[v]);
+        }
+        std::mt19937 gen(0);
+        std::uniform_real_distribution<bcg_scalar_t> dist(-0.5, 1.5);
+        for (size_t i = 0; i < 200; ++i) {
+            points.emplace_back(box.min + box.diagonal().cwiseProduct(VectorS<3>(dist(gen), dist(gen), dist(gen))));
+        }
+    }
+
+    triangle3 get_triangle(face_handle f) const {
+        auto vfit = mesh.get_vertices(f);
+        const VectorS<3> p0 = mesh.positions[*vfit];
+        const VectorS<3> p1 = mesh.positions[*(++vfit)];
+        const VectorS<3> p2 = mesh.positions[*(++vfit)];
+        return triangle3(p0, p1, p2);
+    }
+
+    halfedge_mesh mesh;
+    aligned_box3 box;
+    std::vector<VectorS<3>> points;
+};
+
+TEST_F(TestTriangleBvhFixture, nearest) {
+    triangle_bvh bvh(mesh);
+    EXPECT_EQ(bvh.num_faces(), mesh.num_faces());
+    distance_point3_triangle3 distance;
+    auto batch = bvh.nearest_batch(points);
+    for (size_t i = 0; i < points.size(); ++i) {
+        auto min_dist = scalar_max;
+        for (const auto f : mesh.faces) {
+            min_dist = std::min(min_dist, distance(points[i], get_triangle(f)).distance);
+        }
+        auto nn = bvh.nearest(points[i]);
+        EXPECT_EQ(nn.result.distance, min_dist);
+        EXPECT_EQ(distance(points[i], get_triangle(nn.face)).distance, min_dist);
+        EXPECT_EQ(batch[i].face, nn.face);
+    }
+}
+
+TEST_F(TestTriangleBvhFixture, nearest_k_and_radius) {
+    triangle_bvh bvh(mesh);
+    distance_point3_triangle3 distance;
+    for (size_t i = 0; i < points.size(); i += 10) {
+        std::vector<bcg_scalar_t> distances;
+        for (const auto f : mesh.faces) {
+            distances.push_back(distance(points[i], get_triangle(f)).sqr_distance);
+        }
+        std::sort(distances.begin(), distances.end());
+
+        auto knn = bvh.nearest_k(points[i], 5);
+        ASSERT_EQ(knn.size(), 5);
+        for (size_t j = 0; j < knn.size(); ++j) {
+            EXPECT_EQ(knn[j].result.sqr_distance, distances[j]);
+        }
+
+        bcg_scalar_t radius = std::sqrt(distances[20]);
+        auto within = bvh.nearest_radius(points[i], radius);
+        auto expected = std::upper_bound(distances.begin(), distances.end(), radius * radius) - distances.begin();
+        ASSERT_EQ(within.size(), size_t(expected));
+        for (size_t j = 0; j < within.size(); ++j) {
+            EXPECT_EQ(within[j].result.sqr_distance, distances[j]);
+        }
+    }
+}
+
+TEST_F(TestTriangleBvhFixture, intersect) {
+    triangle_bvh bvh(mesh);
+    std::vector<VectorS<3>> origins, directions;
+    for (size_t i = 0; i + 1 < points.size(); i += 2) {
+        origins.push_back(points[i]);
+        directions.push_back(points[i + 1] - points[i]);
+    }
+    // a ray towards a vertex hits the surface
+    origins.push_back(box.max + box.diagonal());
+    directions.push_back(mesh.positions[vertex_handle(0)] - origins.back());
+
+    auto batch = bvh.intersect_batch(origins, directions);
+    for (size_t i = 0; i < origins.size(); ++i) {
+        auto hit = bvh.intersect(origins[i], directions[i]);
+        EXPECT_EQ(batch[i].face, hit.face);
+        auto min_t = scalar_max;
+        for (const auto f : mesh.faces) {
+            auto t = get_triangle(f);
+            VectorS<3> e1 = t.points[1] - t.points[0], e2 = t.points[2] - t.points[0];
+            VectorS<3> n = e1.cross(e2);
+            bcg_scalar_t denominator = n.dot(directions[i]);
+            if (denominator == 0) continue;
+            bcg_scalar_t s = n.dot(t.points[0] - origins[i]) / denominator;
+            if (s < 0) continue;
+            VectorS<3> q = origins[i] + s * directions[i];
+            VectorS<3> bc = to_barycentric_coordinates(t, q);
+            if (bc.minCoeff() >= -1e-9) {
+                min_t = std::min(min_t, s);
+            }
+        }
+        if (min_t == scalar_max) {
+            EXPECT_FALSE(hit.face.is_valid());
+        } else {
+            ASSERT_TRUE(hit.face.is_valid());
+            EXPECT_NEAR(hit.t, min_t, 1e-9);
+            VectorS<3> p = origins[i] + hit.t * directions[i];
+            EXPECT_LT((from_barycentric_coords(get_triangle(hit.face), hit.barycentric_coords) - p).norm(), 1e-9);
+        }
+    }
+    EXPECT_TRUE(batch.back().face.is_valid());
+}